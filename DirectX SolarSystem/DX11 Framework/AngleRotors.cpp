@@ -0,0 +1,126 @@
+#include "AngleRotors.h"
+#include <math.h>
+
+AngleRotors::AngleRotors()
+{
+	m_Phase = 0.0;
+	m_Step = 0.0;
+	m_Synchronised = false;
+	m_Incremental = true;
+	m_StepsSinceRenormalise = 0;
+	m_StepsSinceResynchronise = 0;
+}
+
+size_t AngleRotors::Add(float rate)
+{
+	m_Rates.push_back(rate);
+	m_Cos.push_back(1.0f);
+	m_Sin.push_back(0.0f);
+	m_StepCos.push_back(1.0f);
+	m_StepSin.push_back(0.0f);
+
+	//The new rotor has no angle or step rotation yet
+	m_Synchronised = false;
+	m_Step = 0.0;
+
+	return m_Rates.size() - 1;
+}
+
+void AngleRotors::SetStep(double step)
+{
+	m_Step = step;
+
+	for (size_t i = 0; i < m_Rates.size(); i++)
+		XMScalarSinCos(&m_StepSin[i], &m_StepCos[i], (float)(m_Rates[i] * step));
+
+	m_Synchronised = false;
+}
+
+void AngleRotors::SetIncremental(bool incremental)
+{
+	m_Incremental = incremental;
+	m_Synchronised = false;
+}
+
+void AngleRotors::Update(double phase)
+{
+	//The caller's phase is a step count times a step length and m_Phase a running sum of steps, so allow for their rounding apart.
+	//Anything nearer the next step than a quarter of one is it, and the rotors stay on the summed phase rather than the caller's.
+	//A float phase would be coarser than that quarter step after a few hours and make every update a resynchronise
+	if (m_Incremental && m_Synchronised && m_Step != 0.0 && fabs(phase - m_Phase - m_Step) <= fabs(m_Step) * 0.25)
+	{
+		if (m_StepsSinceResynchronise >= ResynchroniseInterval)
+		{
+			Resynchronise(m_Phase + m_Step);
+			return;
+		}
+
+		Advance();
+		m_Phase += m_Step;
+		return;
+	}
+
+	Resynchronise(phase);
+}
+
+void AngleRotors::Advance()
+{
+	float* cosines = m_Cos.data();
+	float* sines = m_Sin.data();
+	const float* stepCosines = m_StepCos.data();
+	const float* stepSines = m_StepSin.data();
+
+	//Complex multiply by the step's rotation, independent per rotor so the compiler can run it four or eight at a time
+	for (size_t i = 0; i < m_Rates.size(); i++)
+	{
+		float c = cosines[i];
+		float s = sines[i];
+
+		cosines[i] = c * stepCosines[i] - s * stepSines[i];
+		sines[i] = s * stepCosines[i] + c * stepSines[i];
+	}
+
+	m_StepsSinceResynchronise++;
+	if (++m_StepsSinceRenormalise >= RenormaliseInterval)
+		Renormalise();
+}
+
+void AngleRotors::Renormalise()
+{
+	//Magnitudes only drift by rounding, so one Newton step towards 1 / sqrt(length^2) around 1 is enough
+	for (size_t i = 0; i < m_Rates.size(); i++)
+	{
+		float lengthSq = m_Cos[i] * m_Cos[i] + m_Sin[i] * m_Sin[i];
+		float scale = 1.5f - 0.5f * lengthSq;
+
+		m_Cos[i] *= scale;
+		m_Sin[i] *= scale;
+	}
+
+	m_StepsSinceRenormalise = 0;
+}
+
+void AngleRotors::Resynchronise(double phase)
+{
+	for (size_t i = 0; i < m_Rates.size(); i++)
+	{
+		//Wrap in double first, large phases lose the angle's fraction of a turn if they go straight to float
+		double angle = fmod(m_Rates[i] * phase, XM_2PI);
+		XMScalarSinCos(&m_Sin[i], &m_Cos[i], (float)angle);
+	}
+
+	m_Phase = phase;
+	m_Synchronised = true;
+	m_StepsSinceRenormalise = 0;
+	m_StepsSinceResynchronise = 0;
+}
+
+XMMATRIX AngleRotors::RotationY(float cosine, float sine)
+{
+	XMMATRIX rotation;
+	rotation.r[0] = XMVectorSet(cosine, 0.0f, -sine, 0.0f);
+	rotation.r[1] = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	rotation.r[2] = XMVectorSet(sine, 0.0f, cosine, 0.0f);
+	rotation.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	return rotation;
+}
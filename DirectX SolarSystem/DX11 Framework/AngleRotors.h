@@ -0,0 +1,75 @@
+#pragma once
+#ifndef ANGLEROTORS
+#define ANGLEROTORS
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+//Angles that each turn at a fixed rate, kept as unit complex numbers (cos, sin) rather than recomputed from the time.
+//Moving on by the step given to SetStep multiplies each one by a rotation worked out once for that step, so the steady state needs no sin or cos.
+//Any other jump in time, such as a seek, sets every angle straight from the time instead
+class AngleRotors
+{
+private:
+	//Per rotor values, one array per component
+	std::vector<float> m_Rates;
+	std::vector<float> m_Cos, m_Sin;
+
+	//Rotation each rotor turns through in one step of m_Step
+	std::vector<float> m_StepCos, m_StepSin;
+
+	//Phase (time times speed) the rotors are currently at, and the step the rotations above are for, zero until SetStep
+	double m_Phase;
+	double m_Step;
+	bool m_Synchronised;
+	bool m_Incremental;
+
+	//Steps taken since the magnitudes were last brought back to one, and since the angles were last set from the time
+	unsigned int m_StepsSinceRenormalise;
+	unsigned int m_StepsSinceResynchronise;
+
+	//Helper methods for the above method(s)
+	void Advance();
+	void Renormalise();
+	void Resynchronise(double phase);
+
+public:
+	//Steps between renormalising, and between setting every angle from the time to clear the error each step's rounding adds up to
+	static const unsigned int RenormaliseInterval = 32;
+	static const unsigned int ResynchroniseInterval = 1024;
+
+	//Constructor
+	AngleRotors();
+
+	//Adds a rotor turning at rate radians per unit of phase and returns its index
+	size_t Add(float rate);
+
+	size_t GetCount() const { return m_Rates.size(); }
+
+	//Phase one fixed step of the caller's moves on by. Works out each rotor's rotation for it, so call it after adding the rotors
+	void SetStep(double step);
+
+	//With incremental updates off every Update sets each angle from the time, as if it were always a seek
+	void SetIncremental(bool incremental);
+	bool IsIncremental() const { return m_Incremental; }
+
+	//Brings every rotor to rate * phase. A phase one step on from the last is an incremental update, anything else a seek
+	void Update(double phase);
+
+	float GetCos(size_t index) const { return m_Cos[index]; }
+	float GetSin(size_t index) const { return m_Sin[index]; }
+
+	//Same matrix XMMatrixRotationY would give for the rotor's angle
+	XMMATRIX GetRotationY(size_t index) const { return RotationY(m_Cos[index], m_Sin[index]); }
+
+	//The first GetCount() cosines and sines, in the order the rotors were added
+	const float* GetCosines() const { return m_Cos.data(); }
+	const float* GetSines() const { return m_Sin.data(); }
+
+	//XMMatrixRotationY from an angle's cosine and sine rather than the angle
+	static XMMATRIX RotationY(float cosine, float sine);
+};
+
+#endif
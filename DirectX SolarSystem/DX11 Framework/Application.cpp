@@ -1,4 +1,6 @@
 #include "Application.h"
+#include "ParallelFor.h"
+#include <float.h>
 
 LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 {
@@ -23,7 +25,11 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
     return 0;
 }
 
-Application::Application()
+//Centres of two of the belt's largest asteroids once they touch
+static const float BeltCloseApproachDistance = 0.04f;
+
+//Simulation steps at a fixed 60Hz whatever rate frames are drawn at
+Application::Application() : _simulationClock(&_wallClock, SimulationStepLength)
 {
     _hInst = nullptr;
     _hWnd = nullptr;
@@ -39,6 +45,38 @@ Application::Application()
     _pVertexBuffer = nullptr;
     _pIndexBuffer = nullptr;
     _pConstantBuffer = nullptr;
+    _pImmediateContext1 = nullptr;
+    _pObjectConstantBuffer = nullptr;
+    _simulationRunning = false;
+    _interpolation = 1.0f;
+    _pickTreeStale = true;
+    _beltGravityActive = false;
+    _beltGravitySun = 0.0f;
+    _lastSimulatedTime = 0.0;
+    _beltOrbitsSolved = 0;
+
+    BeltViewer viewer = { XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f, 0.0f };
+    _beltViewer = viewer;
+    _beltGravityRequested = false;
+    _beltIntegratorRequested = INTEGRATOR_LEAPFROG;
+    _generationSeed = CommandLine::ClockSeed();
+    _ringSpinRotors = 0;
+    _looseRingRotors = 0;
+    _beltEnergyDrift = 0.0f;
+    _beltSubsteps = 1;
+    _beltCloseApproachCount = 0;
+    _showRenderStatistics = false;
+    _pInstancedVertexShader = nullptr;
+    _pInstancedPixelShader = nullptr;
+    _pInstancedVertexLayout = nullptr;
+    _pBodyInstanceBuffer = nullptr;
+    _bodyTextureArray = nullptr;
+    _batchBodies = true;
+    _occlusionCulling = true;
+    _bodyInstanceDraws = 0;
+    _adaptiveQuality = true;
+    _lastFrameStart = 0.0;
+    _beltGrid.SetCellSize(BeltCloseApproachDistance);
 }
 
 Application::~Application()
@@ -106,15 +144,43 @@ HRESULT Application::Initialise(HINSTANCE hInstance, int nCmdShow)
 
     FreeCamera = new OrbitalCamera(tempPos, tempAt, floatUp, _WindowWidth, _WindowHeight, 0.01f, 100.0f);
 
-    //assignment B3
-    //create the cubes
-    //load cube mesh
-    cubeMesh = OBJLoader::Load("cube.obj", _pd3dDevice, false);
-    sphereMesh = OBJLoader::Load("sphere.obj", _pd3dDevice, true);
+    InitOrbits();
+
+    //fill the first two frames here so there is always something to draw and blend from, then hand the simulation to its own thread
+    for (int i = 0; i < 2; i++)
+    {
+        Simulate(_snapshots.Back(), 0.0);
+        _snapshots.Back().publishedAt = _wallClock.Now();
+        _snapshots.Publish();
+        _snapshots.Acquire();
+    }
+
+    _simulationRunning = true;
+    _simulationThread = std::thread(&Application::SimulationLoop, this);
 
     return S_OK;
 }
 
+//Asteroid belt, spin 0 to 0.5 and an orbit of 3 to 6 years
+static const BeltGenerator::BeltDescription AsteroidBelt = { 12.4f, 12.8f, -0.1f, 0.1f, 0.0f, 1.0f / 50, 0.0f, 0.5f, 3 * 365.0f, 6 * 365.0f, 0.08f, 0.01f };
+
+//Slightly eccentric and tilted orbit through a generated belt particle, the tilt gives the belt its thickness
+static OrbitalElements BeltOrbit(const BeltGenerator::BeltParticle& particle)
+{
+    const XMFLOAT3& position = particle.Position;
+
+    OrbitalElements elements;
+    elements.SemiMajorAxis = sqrtf(position.x * position.x + position.z * position.z);
+    elements.Eccentricity = particle.Eccentricity;
+    elements.Inclination = particle.Inclination;
+    elements.LongitudeOfNode = particle.LongitudeOfNode;
+    elements.ArgumentOfPeriapsis = particle.ArgumentOfPeriapsis;
+    elements.MeanAnomalyAtEpoch = atan2f(-position.z, position.x) - elements.LongitudeOfNode - elements.ArgumentOfPeriapsis;
+    elements.MeanMotion = particle.OrbitRate;
+
+    return elements;
+}
+
 HRESULT Application::InitShadersAndInputLayout()
 {
     HRESULT hr;
@@ -176,7 +242,7 @@ HRESULT Application::InitShadersAndInputLayout()
     sampDesc.MinLOD = 0;
     sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
     _pd3dDevice->CreateSamplerState(&sampDesc, &_pSamplerLinear);
-    _pImmediateContext->PSSetSamplers(0, 1, &_pSamplerLinear);
+    _context.PSSetSamplers(0, 1, &_pSamplerLinear);
 
     UINT numElements = ARRAYSIZE(layout);
 
@@ -185,174 +251,78 @@ HRESULT Application::InitShadersAndInputLayout()
         pVSBlob->GetBufferSize(), &_pVertexLayout);
     pVSBlob->Release();
 
-    //create textures for planets
-    CreateDDSTextureFromFile(_pd3dDevice, L"sun texture.dds", nullptr, &_pSunTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"Mercury texture.dds", nullptr, &_pMercuryTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"venus surface.dds", nullptr, &_pVenusSurface);
-    CreateDDSTextureFromFile(_pd3dDevice, L"venus atmos.dds", nullptr, &_pVenusAtmos);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"earth.dds", nullptr, &_pEarthTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"moon texture.dds", nullptr, &_pMoonTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"mars texture.dds", nullptr, &_pMarsTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"phobos texture.dds", nullptr, &_pPhobosTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"deimos texture.dds", nullptr, &_pDeimosTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"asteroid texture.dds", nullptr, &_pAsteroidTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"jupiter texture.dds", nullptr, &_pJupiterTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"io texture.dds", nullptr, &_pIoTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"europa texture.dds", nullptr, &_pEuropaTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"ganymede texture.dds", nullptr, &_pGanymedeTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"callisto texture.dds", nullptr, &_pCallistoTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"saturn texture.dds", nullptr, &_pSaturnTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"enceladus texture.dds", nullptr, &_pEnceladusTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"titan texture.dds", nullptr, &_pTitanTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"uranus texture.dds", nullptr, &_pUranusTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"titania texture.dds", nullptr, &_pTitaniaTexture);
-    CreateDDSTextureFromFile(_pd3dDevice, L"oberon texture.dds", nullptr, &_pOberonTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"neptune texture.dds", nullptr, &_pNeptuneTexture);
-
-    CreateDDSTextureFromFile(_pd3dDevice, L"cubemap/px.dds", nullptr, &_pPlaneTexture);
-
-    // Assignment B2
-    //create planets
-    sun = new SolarObject(sphereMesh, _pSunTexture, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(1.0f, 0.8824f, 0.7294f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-
-    mercury = new SolarObject(sphereMesh, _pMercuryTexture, XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-
-    venus = new SolarObject(sphereMesh, _pVenusSurface, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    venusAtmos = new SolarObject(sphereMesh, _pVenusAtmos, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-
-    earth = new SolarObject(sphereMesh, _pEarthTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    moon = new SolarObject(sphereMesh, _pMoonTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-
-    mars = new SolarObject(sphereMesh, _pMarsTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    phobos = new SolarObject(sphereMesh, _pPhobosTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    deimos = new SolarObject(sphereMesh, _pDeimosTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-
-    jupiter = new SolarObject(sphereMesh, _pJupiterTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    io = new SolarObject(sphereMesh, _pIoTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    europa = new SolarObject(sphereMesh, _pEuropaTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    ganymede = new SolarObject(sphereMesh, _pGanymedeTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    callisto = new SolarObject(sphereMesh, _pCallistoTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-
-    saturn = new SolarObject(sphereMesh, _pSaturnTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    enceladus = new SolarObject(sphereMesh, _pEnceladusTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    titan = new SolarObject(sphereMesh, _pTitanTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-
-    uranus = new SolarObject(sphereMesh, _pUranusTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    titania = new SolarObject(sphereMesh, _pTitaniaTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
-    oberon = new SolarObject(sphereMesh, _pOberonTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
+    //assignment B3
+    //create the cubes
+    //load meshes, the resource manager owns the buffers
+    MeshHandle cubeHandle = _resources->LoadMesh("cube.obj", false);
+    MeshHandle sphereHandle = _resources->LoadSphere(SphereGenerator::DefaultLevel);
+    _cubeMeshHandle = cubeHandle;
 
-    neptune = new SolarObject(sphereMesh, _pNeptuneTexture, XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f));
+    //Every level a body can be drawn at, QueueScene picks one by its size on screen each frame
+    for (UINT level = 0; level <= MaxBodySphereLevel; level++)
+        _bodySphereLevels[level] = _resources->LoadSphere(level);
 
-    //Generate random seed
-    srand(time(nullptr));
-    for (int i = 0; i < 10000; i++)
-    {
-        //get a random number between -12.6 and 12.6 for both x and z
-        float x = ((-1 + 2 * ((float)rand()) / RAND_MAX) * 12.6f);
-        float z = ((-1 + 2 * ((float)rand()) / RAND_MAX) * 12.6f);
+    //asteroids and ring particles are tiny on screen so use the base icosahedron
+    MeshHandle asteroidHandle = _resources->LoadSphere(0);
+    _asteroidMeshHandle = asteroidHandle;
 
-        //calculate the distance from the origin
-        float distance = sqrt((x * x) + (z * z));
+    cubeMesh = _resources->GetMesh(cubeHandle);
+    sphereMesh = _resources->GetMesh(sphereHandle);
+    asteroidMesh = _resources->GetMesh(asteroidHandle);
 
-        //loop until x and z are inside the outer circle, and outside the inner circle
-        while(distance > 12.8f || distance < 12.4f)
-        {
-            x = ((-1 + 2 * ((float)rand()) / RAND_MAX) * 12.6f);
-            z = ((-1 + 2 * ((float)rand()) / RAND_MAX) * 12.6f);
+    //textures that are not tied to a planet
+    _asteroidTexture = _resources->LoadTexture(L"asteroid texture.dds");
+    _planeTexture = _resources->LoadTexture(L"cubemap/px.dds");
 
-            distance = sqrt((x * x) + (z * z));
-        }
+    //The belt and rings come from a counter based generator, so one _generationSeed always gives the same scene however many threads build it.
+    //It goes to the debug output so a scene worth seeing again can be brought back with -seed
+    char seedMessage[64];
+    sprintf_s(seedMessage, "Belt and rings generated from seed %llu\n", _generationSeed);
+    OutputDebugStringA(seedMessage);
 
-        AsteroidArray[i] = new Asteroid(x, (-1 + 2 * ((float)rand()) / RAND_MAX) / 10, z, (((float)rand()) / RAND_MAX) / 50, (((float)rand()) / RAND_MAX) / 50, (((float)rand()) / RAND_MAX) / 50, (((float)rand()) / RAND_MAX) / 2, 1 / (((((float)rand()) / RAND_MAX) * (6 - 3) + 3) * 365));
-    }
+    std::vector<BeltGenerator::BeltParticle> particles(BeltAsteroidCount);
 
-    //Generate saturn's rings
-    //inner ring
-    for (int i = 0; i < 750; i++)
-    {
-        const float innerRadius = 2.5f;
-	    //get random position for x and z within a circle with radius 2.5f
-        float x = ((-1 + 2 * ((float)rand()) / RAND_MAX) * innerRadius);
-        float z = ((-1 + 2 * ((float)rand()) / RAND_MAX) * innerRadius);
+    //Asteroid belt
+    BeltGenerator::Generate(AsteroidBelt, _generationSeed, 0, &particles[0], BeltAsteroidCount);
 
-        //calculate distance from origin
-        float distance = sqrt((x * x) + (z * z));
+    _beltOrbits.Reserve(BeltAsteroidCount);
+    for (int i = 0; i < BeltAsteroidCount; i++)
+        _beltOrbits.Add(BeltOrbit(particles[i]));
 
-        //loop until x and z are within the ring, but a set distance from saturn
-        float distanceFromSaturn = 1.75f;
-        while(distance > innerRadius || distance < distanceFromSaturn)
-        {
-            x = ((-1 + 2 * ((float)rand()) / RAND_MAX) * innerRadius);
-            z = ((-1 + 2 * ((float)rand()) / RAND_MAX) * innerRadius);
+    _beltSchedule.Reset(_beltOrbits.GetGroupCount());
+    _beltSolvedPositions.resize(BeltAsteroidCount);
+    _beltVelocities.resize(BeltAsteroidCount);
+    _beltSolveTimes.resize(_beltOrbits.GetGroupCount());
 
-            distance = sqrt((x * x) + (z * z));
-        }
+    //Planets, moons and the belt's asteroids
+    InitEntities(sphereHandle, asteroidHandle, &particles[0]);
 
-        SaturnInnerRingArray[i] = new Asteroid(x, ((float)rand() / RAND_MAX) / 10, z, (((float)rand()) / RAND_MAX) / 15, (((float)rand()) / RAND_MAX) / 15, (((float)rand()) / RAND_MAX) / 15, 4.8f, 4.8f);
-    }
+    //The opaque ones among the planets and moons in one draw, which is only an optimisation so the scene still draws without it
+    _sphereMeshHandle = sphereHandle;
+    InitBodyBatch(sphereHandle);
 
-    //middle ring
-    for(int i = 0; i < 1000; i++)
+    //Saturn's rings, each on its own stream, a set distance from saturn and turning together at a fixed rate.
+    //Every ring particle spins at the rate it orbits, so each ring is one rigid body and only needs a single matrix a frame.
+    //A retuned ring that breaks that still draws, its particles just move one at a time
+    const BeltGenerator::BeltDescription rings[3] =
     {
-        const float middleRadius = 3.5f;
-        //Get random position for x and z within a circle with radius 4.0f
-        float x = ((-1 + 2 * ((float)rand()) / RAND_MAX) * middleRadius);
-        float z = ((-1 + 2 * ((float)rand()) / RAND_MAX) * middleRadius);
-
-        //calculate distance from origin
-        float distance = sqrt((x * x) + (z * z));
-
-        //loop until x and z are within the ring, but a set distance from saturn
-        float distanceFromSaturn = 3.0f;
-        while (distance > middleRadius || distance < distanceFromSaturn)
-        {
-            x = ((-1 + 2 * ((float)rand()) / RAND_MAX) * middleRadius);
-            z = ((-1 + 2 * ((float)rand()) / RAND_MAX) * middleRadius);
-
-            distance = sqrt((x * x) + (z * z));
-        }
-
-        SaturnMidRingArray[i] = new Asteroid(x, ((float)rand() / RAND_MAX) / 10, z, (((float)rand()) / RAND_MAX) / 15, (((float)rand()) / RAND_MAX) / 15, (((float)rand()) / RAND_MAX) / 15, 3.69f, 3.69f);
-    }
+        { 1.75f, 2.5f, 0.0f, 0.1f, 0.0f, 1.0f / 15, 4.8f, 4.8f, 1.0f / 4.8f, 1.0f / 4.8f, 0.0f, 0.0f },
+        { 3.0f, 3.5f, 0.0f, 0.1f, 0.0f, 1.0f / 15, 3.69f, 3.69f, 1.0f / 3.69f, 1.0f / 3.69f, 0.0f, 0.0f },
+        { 3.75f, 5.5f, 0.0f, 0.1f, 0.0f, 1.0f / 15, 3.69f, 3.69f, 1.0f / 3.69f, 1.0f / 3.69f, 0.0f, 0.0f }
+    };
+    const int ringCounts[3] = { 750, 1000, 1500 };
 
-    //Outer Ring
-    for (int i = 0; i < 1500; i++)
+    for (int ring = 0; ring < 3; ring++)
     {
-        const float outerRadius = 5.5f;
-        //Get random position for x and z within a circle with radius 4.0f
-        float x = ((-1 + 2 * ((float)rand()) / RAND_MAX) * outerRadius);
-        float z = ((-1 + 2 * ((float)rand()) / RAND_MAX) * outerRadius);
-
-        //calculate distance from origin
-        float distance = sqrt((x * x) + (z * z));
-
-        //loop until x and z are within the ring, but a set distance from saturn
-        float distanceFromSaturn = 3.75f;
-        while (distance > outerRadius || distance < distanceFromSaturn)
-        {
-            x = ((-1 + 2 * ((float)rand()) / RAND_MAX) * outerRadius);
-            z = ((-1 + 2 * ((float)rand()) / RAND_MAX) * outerRadius);
-
-            distance = sqrt((x * x) + (z * z));
-        }
-
-        SaturnOuterRingArray[i] = new Asteroid(x, ((float)rand() / RAND_MAX) / 10, z, (((float)rand()) / RAND_MAX) / 15, (((float)rand()) / RAND_MAX) / 15, (((float)rand()) / RAND_MAX) / 15, 3.69f, 3.69f);
+        BeltGenerator::Generate(rings[ring], _generationSeed, ring + 1, &particles[0], ringCounts[ring]);
+        RigidGroup::Collect(&particles[0], ringCounts[ring], MaxRingGroups, _ringGroups, _looseRingParticles);
     }
 
     if (FAILED(hr))
         return hr;
 
     // Set the input layout
-    _pImmediateContext->IASetInputLayout(_pVertexLayout);
+    _context.IASetInputLayout(_pVertexLayout);
 
     return hr;
 }
@@ -591,6 +561,496 @@ HRESULT Application::InitIndexBuffer()
     return S_OK;
 }
 
+//Planets that pull on the belt in its gravity mode, after the Sun, and their masses as a fraction of the Sun's
+static const BodyOrbit GravityPlanets[8] = { ORBIT_MERCURY, ORBIT_VENUS, ORBIT_EARTH, ORBIT_MARS, ORBIT_JUPITER, ORBIT_SATURN, ORBIT_URANUS, ORBIT_NEPTUNE };
+static const float GravityPlanetMasses[8] = { 1.66e-7f, 2.448e-6f, 3.04e-6f, 3.227e-7f, 9.548e-4f, 2.859e-4f, 4.366e-5f, 5.151e-5f };
+
+//Adds the Sun at the origin and then the planets to a belt's gravity, returning the Sun's mass. The scene's orbital rates do not agree on one
+//mass for the Sun, so it takes the one the belt's own orbits average to
+static float AddGravityBodies(NBodySystem& gravity, const KeplerOrbits& belt)
+{
+    double sun = 0.0;
+    for (size_t i = 0; i < belt.GetCount(); i++)
+        sun += belt.GetGravitationalParameter(i);
+
+    float sunMass = belt.GetCount() > 0 ? (float)(sun / belt.GetCount()) : 0.0f;
+
+    gravity.SetMassiveBodyPosition(gravity.AddMassiveBody(sunMass), XMFLOAT3(0.0f, 0.0f, 0.0f));
+    for (int i = 0; i < 8; i++)
+        gravity.AddMassiveBody(sunMass * GravityPlanetMasses[i]);
+
+    //Only an asteroid passing right by a planet needs its steps split, up to 16 ways
+    gravity.SetAdaptive(0.2f, 4);
+
+    return sunMass;
+}
+
+//Moves the planets pulling on a belt to where their orbits are, the Sun stays put
+static void PlaceGravityPlanets(NBodySystem& gravity, const XMFLOAT3* orbitPositions)
+{
+    for (int i = 0; i < 8; i++)
+        gravity.SetMassiveBodyPosition(i + 1, orbitPositions[GravityPlanets[i]]);
+}
+
+//Starts each asteroid where its orbit has it at an orbit time, going at the speed that keeps it on the same ellipse around the belt's Sun.
+//positions gets where they start
+static void StartBeltGravity(NBodySystem& gravity, KeplerOrbits& belt, float sunMass, double time, XMFLOAT3* positions)
+{
+    std::vector<XMFLOAT3> velocities(belt.GetCount());
+    belt.Evaluate(time, positions, &velocities[0]);
+
+    for (size_t i = 0; i < velocities.size(); i++)
+    {
+        float scale = sqrtf(sunMass / belt.GetGravitationalParameter(i));
+        XMStoreFloat3(&velocities[i], XMVectorScale(XMLoadFloat3(&velocities[i]), scale));
+    }
+
+    //The whole belt is around 4.5e-10 of the Sun's mass
+    gravity.Reset(positions, &velocities[0], velocities.size(), sunMass * 4.5e-10f / velocities.size());
+}
+
+//Orbital elements with the angles in degrees, as they are usually listed. Every body starts at periapsis
+static OrbitalElements MakeOrbit(float semiMajorAxis, float eccentricity, float inclination, float longitudeOfNode, float argumentOfPeriapsis, float meanMotion)
+{
+    OrbitalElements elements;
+    elements.SemiMajorAxis = semiMajorAxis;
+    elements.Eccentricity = eccentricity;
+    elements.Inclination = XMConvertToRadians(inclination);
+    elements.LongitudeOfNode = XMConvertToRadians(longitudeOfNode);
+    elements.ArgumentOfPeriapsis = XMConvertToRadians(argumentOfPeriapsis);
+    elements.MeanAnomalyAtEpoch = 0.0f;
+    elements.MeanMotion = meanMotion;
+
+    return elements;
+}
+
+//How each body is placed, indexed by SceneBody: scale, radians of spin per unit of orbit time, the orbit it follows and the body it is carried along by
+static const EphemerisBody BodyDescriptions[BODY_COUNT] =
+{
+    { 1.5f, 0.037f, -1, -1 },                                //Sun
+    { 0.1f, 0.01695f, ORBIT_MERCURY, -1 },                   //Mercury
+    { 0.2f, 0.004115f, ORBIT_VENUS, -1 },                    //Venus
+    { 0.24f, 0.004115f * 25, ORBIT_VENUS, -1 },              //Venus' atmosphere
+    { 0.2106f, 1.0f, ORBIT_EARTH, -1 },                      //Earth
+    { 0.25f, 0.037f, ORBIT_MOON, BODY_EARTH },               //Moon
+    { 0.11214f, 1.025f, ORBIT_MARS, -1 },                    //Mars
+    { 0.1f, 3.125f, ORBIT_PHOBOS, BODY_MARS },               //Phobos
+    { 0.05f, 0.79f, ORBIT_DEIMOS, BODY_MARS },               //Deimos
+    { 1.053f, 2.4f, ORBIT_JUPITER, -1 },                     //Jupiter
+    { 0.03456f, 0.556f, ORBIT_IO, BODY_JUPITER },            //Io
+    { 0.0484f, 0.2857f, ORBIT_EUROPA, BODY_JUPITER },        //Europa
+    { 0.080256f, 0.1395f, ORBIT_GANYMEDE, BODY_JUPITER },    //Ganymede
+    { 0.08f, 0.0588f, ORBIT_CALLISTO, BODY_JUPITER },        //Callisto
+    { 1.0f, 2.233f, ORBIT_SATURN, -1 },                      //Saturn
+    { 0.0535f, 0.7299f, ORBIT_ENCELADUS, BODY_SATURN },      //Enceladus
+    { 0.235f, 0.0625f, ORBIT_TITAN, BODY_SATURN },           //Titan
+    { 0.4355f, 1.412f, ORBIT_URANUS, -1 },                   //Uranus
+    { 0.1f, 0.1148f, ORBIT_TITANIA, BODY_URANUS },           //Titania
+    { 0.08f, 0.0769f, ORBIT_OBERON, BODY_URANUS },           //Oberon
+    { 0.4155f, 1.5f, ORBIT_NEPTUNE, -1 },                    //Neptune
+};
+
+//Names for each body in an ephemeris export, indexed by SceneBody
+static const char* const BodyNames[BODY_COUNT] =
+{
+    "Sun", "Mercury", "Venus", "VenusAtmosphere", "Earth", "Moon", "Mars", "Phobos", "Deimos",
+    "Jupiter", "Io", "Europa", "Ganymede", "Callisto", "Saturn", "Enceladus", "Titan",
+    "Uranus", "Titania", "Oberon", "Neptune"
+};
+
+//Body each follow camera watches, indexed the same as currentCam
+static const SceneBody CameraBodies[9] =
+{
+    BODY_SUN, BODY_MERCURY, BODY_VENUS, BODY_EARTH, BODY_MARS, BODY_JUPITER, BODY_SATURN, BODY_URANUS, BODY_NEPTUNE
+};
+
+//Bodies that can be picked, in the order their spheres go into Application::_pickSpheres.
+//Venus's atmosphere is left out so a click on it finds Venus
+static const SceneBody PickableBodies[BODY_COUNT - 1] =
+{
+    BODY_SUN, BODY_MERCURY, BODY_VENUS, BODY_EARTH, BODY_MOON, BODY_MARS, BODY_PHOBOS, BODY_DEIMOS,
+    BODY_JUPITER, BODY_IO, BODY_EUROPA, BODY_GANYMEDE, BODY_CALLISTO, BODY_SATURN, BODY_ENCELADUS, BODY_TITAN,
+    BODY_URANUS, BODY_TITANIA, BODY_OBERON, BODY_NEPTUNE
+};
+
+//How each body is drawn, indexed by SceneBody. The Sun and Venus's atmosphere are see-through so the light and surface show through them
+struct BodyLook
+{
+    const wchar_t* Texture;
+    XMFLOAT4 Diffuse;
+    XMFLOAT4 Ambient;
+    bool Transparent;
+    float BlendFactor;
+};
+
+static const BodyLook BodyLooks[BODY_COUNT] =
+{
+    { L"sun texture.dds", XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT4(1.0f, 0.8824f, 0.7294f, 1.0f), true, 0.0f },
+    { L"Mercury texture.dds", XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"venus surface.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"venus atmos.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), true, 0.75f },
+    { L"earth.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"moon texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"mars texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"phobos texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"deimos texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"jupiter texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"io texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"europa texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"ganymede texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"callisto texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"saturn texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"enceladus texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"titan texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"uranus texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"titania texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"oberon texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f },
+    { L"neptune texture.dds", XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), false, 0.0f }
+};
+
+//Bodies drawn from a model, and the share of the model's triangles each reduced level keeps. Both models are Z up and are turned to stand
+//the way the sphere does. Only Saturn's planet is taken from its model, the rings are the particles
+struct BodyModel
+{
+    SceneBody Body;
+    const char* Filename;
+    const char* Group;
+};
+
+static const BodyModel BodyModels[BodyModelCount] =
+{
+    { BODY_SUN, "sun.obj", nullptr },
+    { BODY_SATURN, "saturn.obj", "Saturn" }
+};
+
+static const float BodyModelFractions[] = { 0.5f, 0.2f, 0.05f };
+
+//Every body and every asteroid share one specular
+static const XMFLOAT4 SceneSpecular = XMFLOAT4(0.25f, 0.25f, 0.25f, 1.0f);
+
+//Only one shader pair so far, the key in RenderQueue leaves room for more
+static const UINT LitShader = 0;
+
+//Per draw constants take 256 bytes of the ring each, so this holds three frames of every asteroid and ring particle with room to spare
+static const UINT ObjectConstantRingBytes = 16 * 1024 * 1024;
+
+//Occluders are drawn at this much of their bounding sphere for each sphere level, the flat faces of the mesh coming no nearer its centre than this
+static const float OccluderRadiusScales[MaxBodySphereLevel + 1] = { 0.79f, 0.93f, 0.98f, 0.995f, 0.998f };
+
+//Radius on screen in pixels a body needs to be drawn at sphere level 1, each level after needing twice the one before.
+//That keeps the sphere's edges around ten pixels long however close it is
+static const float BodyLevelPixels = 18.0f;
+
+//Belt asteroids and Saturn's ring particles
+static const Material AsteroidMaterial = { XMFLOAT4(0.64f, 0.64f, 0.64f, 1.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), SceneSpecular };
+
+void Application::InitEntities(MeshHandle sphere, MeshHandle asteroid, const BeltGenerator::BeltParticle* belt)
+{
+    //The Sun and Saturn come from their models, reduced the first time and cached next to them after that
+    for (int i = 0; i < BodyModelCount; i++)
+    {
+        _bodyModels[i] = MeshSimplifier::LoadLODs(*_resources, BodyModels[i].Filename, BodyModels[i].Group, BodyModelFractions, ARRAYSIZE(BodyModelFractions));
+        XMStoreFloat4x4(&_bodyModels[i].Fit, XMLoadFloat4x4(&_bodyModels[i].Fit) * XMMatrixRotationX(-XM_PIDIV2));
+    }
+
+    //Bodies first and in SceneBody order, so each one's Entity is its SceneBody. Each archetype is only the components the body needs,
+    //the Sun has no orbit and only moons have a parent
+    for (int i = 0; i < BODY_COUNT; i++)
+    {
+        const EphemerisBody& description = BodyDescriptions[i];
+        const BodyLook& look = BodyLooks[i];
+
+        Transform transform = { XMFLOAT4X4(), XMFLOAT3(description.Scale, description.Scale, description.Scale) };
+        XMStoreFloat4x4(&transform.World, XMMatrixIdentity());
+
+        Spin spin = { description.SpinRate, 0 };
+        //A body with a model that loaded is drawn from it, the rest from the sphere
+        MeshHandle mesh = sphere;
+        for (int m = 0; m < BodyModelCount; m++)
+        {
+            if (BodyModels[m].Body == i && _bodyModels[m].Count > 0)
+                mesh = _bodyModels[m].Levels[0];
+        }
+
+        Renderable renderable = { mesh, _resources->LoadTexture(look.Texture), look.Transparent, look.BlendFactor };
+        Material material = { look.Diffuse, look.Ambient, SceneSpecular };
+
+        if (description.Orbit < 0)
+        {
+            _entities.Create(transform, spin, renderable, material);
+            continue;
+        }
+
+        Orbit orbit = { (UINT)description.Orbit };
+
+        if (description.Parent < 0)
+        {
+            _entities.Create(transform, orbit, spin, renderable, material);
+        }
+        else
+        {
+            Parent parent = { (Entity)description.Parent };
+            _entities.Create(transform, orbit, spin, parent, renderable, material);
+        }
+    }
+
+    //The belt, each asteroid on its own orbit after the bodies' in _orbitPositions
+    const Renderable asteroidRenderable = { asteroid, _asteroidTexture, false, 0.0f };
+
+    for (int i = 0; i < BeltAsteroidCount; i++)
+    {
+        Transform transform = { XMFLOAT4X4(), belt[i].Scale };
+        XMStoreFloat4x4(&transform.World, XMMatrixIdentity());
+
+        Orbit orbit = { FirstBeltOrbit + i };
+        Spin spin = { belt[i].Spin, 0 };
+
+        _entities.Create(transform, orbit, spin, asteroidRenderable, AsteroidMaterial);
+    }
+}
+
+const MeshSimplifier::LODChain* Application::FindBodyModel(MeshHandle mesh) const
+{
+    for (int i = 0; i < BodyModelCount; i++)
+    {
+        const MeshSimplifier::LODChain& model = _bodyModels[i];
+        if (model.Count > 0 && model.Levels[0].Index == mesh.Index && model.Levels[0].Generation == mesh.Generation)
+            return &model;
+    }
+
+    return nullptr;
+}
+
+HRESULT Application::InitBodyBatch(MeshHandle sphere)
+{
+    //Each texture once, in the order the bodies first use it
+    std::vector<TextureHandle> textures;
+
+    _entities.ForEach<Renderable>([&](size_t count, const Entity*, const Renderable* renderables)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const Renderable& renderable = renderables[i];
+            if (renderable.Transparent || renderable.Mesh.Index != sphere.Index || renderable.Mesh.Generation != sphere.Generation)
+                continue;
+
+            if (renderable.Texture.Index >= _bodyTextureSlices.size())
+                _bodyTextureSlices.resize(renderable.Texture.Index + 1, NoBodySlice);
+
+            if (_bodyTextureSlices[renderable.Texture.Index] == NoBodySlice)
+            {
+                _bodyTextureSlices[renderable.Texture.Index] = (UINT)textures.size();
+                textures.push_back(renderable.Texture);
+            }
+        }
+    });
+
+    std::vector<ID3D11ShaderResourceView*> views;
+    for (size_t i = 0; i < textures.size(); i++)
+        views.push_back(_resources->GetTexture(textures[i]));
+
+    HRESULT hr = views.empty() ? E_FAIL : TextureArrayBuilder::CreateTextureArray(_pd3dDevice, _pImmediateContext, &views[0], (UINT)views.size(), &_bodyTextureArray);
+
+    ID3DBlob* pVSBlob = nullptr;
+    if (SUCCEEDED(hr))
+        hr = CompileShaderFromFile(L"DX11 Framework.fx", "VSInstanced", "vs_4_0", &pVSBlob);
+
+    if (SUCCEEDED(hr))
+        hr = _pd3dDevice->CreateVertexShader(pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), nullptr, &_pInstancedVertexShader);
+
+    //The mesh's vertices from the first buffer and one BodyInstance per body from the second
+    D3D11_INPUT_ELEMENT_DESC layout[] =
+    {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "DIFFUSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "AMBIENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 80, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "SPECULAR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 96, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "SLICE", 0, DXGI_FORMAT_R32_UINT, 1, 112, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+
+    if (SUCCEEDED(hr))
+        hr = _pd3dDevice->CreateInputLayout(layout, ARRAYSIZE(layout), pVSBlob->GetBufferPointer(), pVSBlob->GetBufferSize(), &_pInstancedVertexLayout);
+
+    if (pVSBlob)
+        pVSBlob->Release();
+
+    ID3DBlob* pPSBlob = nullptr;
+    if (SUCCEEDED(hr))
+        hr = CompileShaderFromFile(L"DX11 Framework.fx", "PSInstanced", "ps_4_0", &pPSBlob);
+
+    if (SUCCEEDED(hr))
+        hr = _pd3dDevice->CreatePixelShader(pPSBlob->GetBufferPointer(), pPSBlob->GetBufferSize(), nullptr, &_pInstancedPixelShader);
+
+    if (pPSBlob)
+        pPSBlob->Release();
+
+    //Rewritten every frame, with room for every body
+    if (SUCCEEDED(hr))
+    {
+        D3D11_BUFFER_DESC bd;
+        ZeroMemory(&bd, sizeof(bd));
+        bd.Usage = D3D11_USAGE_DYNAMIC;
+        bd.ByteWidth = sizeof(BodyInstance) * BODY_COUNT;
+        bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+        bd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+        hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pBodyInstanceBuffer);
+    }
+
+    //Without every piece QueueScene finds no slices and leaves the bodies in the render queue
+    if (FAILED(hr))
+    {
+        if (_bodyTextureArray) _bodyTextureArray->Release();
+        _bodyTextureArray = nullptr;
+        _bodyTextureSlices.clear();
+    }
+
+    _bodyInstances.reserve(BODY_COUNT);
+    _bodyInstanceLevels.reserve(BODY_COUNT);
+
+    return hr;
+}
+
+//Fills an ephemeris with the planets and moons, running at speed units of orbit time per unit of simulation time
+static void AddSolarSystem(Ephemeris& ephemeris, double speed)
+{
+    //Distances and rates are the scene's own, the shape of each orbit is the real one.
+    //Planets are against the ecliptic, moons against their planet's equator
+    ephemeris.AddOrbit(MakeOrbit(2.5f, 0.2056f, 7.005f, 48.33f, 29.12f, 0.01136f));        //Mercury
+    ephemeris.AddOrbit(MakeOrbit(4.5f, 0.0068f, 3.395f, 76.68f, 54.88f, 0.00446f));        //Venus
+    ephemeris.AddOrbit(MakeOrbit(8.032f, 0.0167f, 0.0f, 0.0f, 102.94f, 0.0027397f));       //Earth
+    ephemeris.AddOrbit(MakeOrbit(2.5f, 0.0549f, 5.145f, 0.0f, 0.0f, 0.037f));              //Moon
+    ephemeris.AddOrbit(MakeOrbit(11.6446f, 0.0934f, 1.850f, 49.56f, 286.5f, 0.0014556f));  //Mars
+    ephemeris.AddOrbit(MakeOrbit(2.0f, 0.0151f, 1.09f, 0.0f, 0.0f, 3.125f));               //Phobos
+    ephemeris.AddOrbit(MakeOrbit(3.0f, 0.0003f, 0.93f, 0.0f, 0.0f, 0.79f));                //Deimos
+    ephemeris.AddOrbit(MakeOrbit(20.5f, 0.0489f, 1.303f, 100.46f, 273.87f, 0.0002283f));   //Jupiter
+    ephemeris.AddOrbit(MakeOrbit(1.25f, 0.0041f, 0.05f, 0.0f, 0.0f, 0.556f));              //Io
+    ephemeris.AddOrbit(MakeOrbit(2.25f, 0.009f, 0.47f, 0.0f, 0.0f, 0.28957f));             //Europa
+    ephemeris.AddOrbit(MakeOrbit(3.25f, 0.0013f, 0.2f, 0.0f, 0.0f, 0.1395f));              //Ganymede
+    ephemeris.AddOrbit(MakeOrbit(4.25f, 0.0074f, 0.2f, 0.0f, 0.0f, 0.0588f));              //Callisto
+    ephemeris.AddOrbit(MakeOrbit(40.0f, 0.0565f, 2.485f, 113.67f, 339.39f, 0.00009447f));  //Saturn
+    ephemeris.AddOrbit(MakeOrbit(6.0f, 0.0047f, 0.02f, 0.0f, 0.0f, 0.7299f));              //Enceladus
+    ephemeris.AddOrbit(MakeOrbit(8.0f, 0.0288f, 0.35f, 0.0f, 0.0f, 0.0625f));              //Titan
+    ephemeris.AddOrbit(MakeOrbit(60.0f, 0.0457f, 0.773f, 74.01f, 96.9f, 0.000032615f));    //Uranus
+    ephemeris.AddOrbit(MakeOrbit(3.0f, 0.0011f, 0.34f, 0.0f, 0.0f, 0.1148f));              //Titania
+    ephemeris.AddOrbit(MakeOrbit(4.5f, 0.0014f, 0.058f, 0.0f, 0.0f, 0.0769f));             //Oberon
+    ephemeris.AddOrbit(MakeOrbit(75.0f, 0.0113f, 1.770f, 131.78f, 273.19f, 0.0000166f));   //Neptune
+
+    for (int i = 0; i < BODY_COUNT; i++)
+        ephemeris.AddBody(BodyDescriptions[i]);
+
+    //A table of each orbit once round costs the same to look up for every orbit and keeps positions to a few millionths of its size
+    ephemeris.SetSpeed(speed);
+    ephemeris.BuildCache(256);
+}
+
+void Application::InitOrbits()
+{
+    AddSolarSystem(_ephemeris, simulationSpeed);
+
+    _beltGravitySun = AddGravityBodies(_beltGravity, _beltOrbits);
+
+    //A spin for every entity that has one, in the order the store keeps them, then one for each ring group and two for each loose ring particle
+    _entities.ForEach<Spin>([&](size_t count, const Entity*, Spin* spins)
+    {
+        for (size_t i = 0; i < count; i++)
+            spins[i].Rotor = (UINT)_spinRotors.Add(spins[i].Rate);
+    });
+
+    _ringSpinRotors = _spinRotors.GetCount();
+    for (size_t i = 0; i < _ringGroups.size(); i++)
+        _spinRotors.Add(_ringGroups[i].GetAngularRate());
+
+    //A loose particle's spin goes in front of its offset and its orbit after, so the spin rotor only turns it by what it spins on top of its orbit
+    _looseRingRotors = _spinRotors.GetCount();
+    for (size_t i = 0; i < _looseRingParticles.size(); i++)
+    {
+        _spinRotors.Add(_looseRingParticles[i].Spin - _looseRingParticles[i].OrbitRate);
+        _spinRotors.Add(_looseRingParticles[i].OrbitRate);
+    }
+
+    _spinRotors.SetStep(_simulationClock.GetStepLength() * simulationSpeed);
+}
+
+HRESULT Application::ExportEphemeris(const EphemerisExport::Settings& settings, std::wstring& error)
+{
+    //Built straight from the same descriptions as the scene, without a window or device
+    Ephemeris ephemeris;
+    AddSolarSystem(ephemeris, settings.Speed > 0.0 ? settings.Speed : DefaultSimulationSpeed);
+
+    KeplerOrbits belt;
+    if (settings.Asteroids)
+    {
+        //The seed is in the file's header as well
+        char seedMessage[64];
+        sprintf_s(seedMessage, "Belt exported from seed %llu\n", settings.Seed);
+        OutputDebugStringA(seedMessage);
+
+        //The scene's own count, so an export and a scene from the same seed have the same asteroids
+        std::vector<BeltGenerator::BeltParticle> particles(BeltAsteroidCount);
+        BeltGenerator::Generate(AsteroidBelt, settings.Seed, 0, &particles[0], particles.size());
+
+        belt.Reserve(particles.size());
+        for (size_t i = 0; i < particles.size(); i++)
+            belt.Add(BeltOrbit(particles[i]));
+    }
+
+    return EphemerisExport::Write(settings, ephemeris, BodyNames, settings.Asteroids ? &belt : nullptr, error);
+}
+
+GravityBenchmark::Result Application::BenchmarkGravity(const GravityBenchmark::Settings& settings)
+{
+    //The same belt and planets as the scene, stepped as fast as they go rather than at the clock's pace
+    Ephemeris ephemeris;
+    AddSolarSystem(ephemeris, DefaultSimulationSpeed);
+
+    std::vector<BeltGenerator::BeltParticle> particles((size_t)settings.Particles);
+    BeltGenerator::Generate(AsteroidBelt, settings.Seed, 0, &particles[0], particles.size());
+
+    KeplerOrbits belt;
+    belt.Reserve(particles.size());
+    for (size_t i = 0; i < particles.size(); i++)
+        belt.Add(BeltOrbit(particles[i]));
+
+    NBodySystem gravity;
+    float sunMass = AddGravityBodies(gravity, belt);
+
+    std::vector<XMFLOAT3> orbitPositions(ephemeris.GetOrbitCount());
+    std::vector<XMFLOAT3> positions(particles.size());
+    ephemeris.EvaluateOrbits(0.0, &orbitPositions[0]);
+    PlaceGravityPlanets(gravity, &orbitPositions[0]);
+    StartBeltGravity(gravity, belt, sunMass, 0.0, &positions[0]);
+
+    GravityBenchmark::Result result = {};
+    result.Threads = GetParallelThreadCount();
+
+    HighResolutionClock clock;
+    for (unsigned long long step = 1; step <= settings.Steps; step++)
+    {
+        ephemeris.EvaluateOrbits(step * SimulationStepLength, &orbitPositions[0]);
+        PlaceGravityPlanets(gravity, &orbitPositions[0]);
+
+        double start = clock.Now();
+        gravity.Step((float)(SimulationStepLength * DefaultSimulationSpeed));
+        double seconds = clock.Now() - start;
+
+        result.AverageSeconds += seconds;
+        result.WorstSeconds = seconds > result.WorstSeconds ? seconds : result.WorstSeconds;
+        result.MaxSubsteps = gravity.GetLastSubsteps() > result.MaxSubsteps ? gravity.GetLastSubsteps() : result.MaxSubsteps;
+    }
+
+    result.AverageSeconds /= settings.Steps;
+    result.EnergyDrift = gravity.GetEnergyDrift();
+
+    return result;
+}
+
 HRESULT Application::InitWindow(HINSTANCE hInstance, int nCmdShow)
 {
     // Register class
@@ -725,6 +1185,9 @@ HRESULT Application::InitDevice()
     if (FAILED(hr))
         return hr;
 
+    //Pipeline state is bound through the filter from here on, so binding what is already there costs nothing
+    _context.SetContext(_pImmediateContext);
+
     //define depth buffer
     D3D11_TEXTURE2D_DESC depthStencilDesc;
 
@@ -771,6 +1234,8 @@ HRESULT Application::InitDevice()
     vp.TopLeftY = 0;
     _pImmediateContext->RSSetViewports(1, &vp);
 
+    _resources = new ResourceManager(_pd3dDevice);
+
     InitShadersAndInputLayout();
 
     InitVertexBuffer();
@@ -778,15 +1243,15 @@ HRESULT Application::InitDevice()
     // Set vertex buffer
     UINT stride = sizeof(SimpleVertex);
     UINT offset = 0;
-    _pImmediateContext->IASetVertexBuffers(0, 1, &_pVertexBuffer, &stride, &offset);
+    _context.IASetVertexBuffers(0, 1, &_pVertexBuffer, &stride, &offset);
 
     InitIndexBuffer();
 
     // Set index buffer
-    _pImmediateContext->IASetIndexBuffer(_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+    _context.IASetIndexBuffer(_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
 
     // Set primitive topology
-    _pImmediateContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    _context.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
     // Create the constant buffer
     D3D11_BUFFER_DESC bd;
@@ -797,6 +1262,21 @@ HRESULT Application::InitDevice()
     bd.CPUAccessFlags = 0;
     hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pConstantBuffer);
 
+    //Per draw constants go through a ring bound by offset where the runtime and driver allow both that and NO_OVERWRITE maps of constant buffers,
+    //with a plain buffer to fall back on
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+    ZeroMemory(&options, sizeof(options));
+    _pd3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+
+    if (options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer
+        && SUCCEEDED(_pImmediateContext->QueryInterface(__uuidof(ID3D11DeviceContext1), (void**)&_pImmediateContext1)))
+    {
+        _objectConstants.Create(_pd3dDevice, _pImmediateContext1, ObjectConstantRingBytes);
+    }
+
+    bd.ByteWidth = sizeof(ObjectConstants);
+    hr = _pd3dDevice->CreateBuffer(&bd, nullptr, &_pObjectConstantBuffer);
+
     //declare wire frame desc
     D3D11_RASTERIZER_DESC wfdesc;
     ZeroMemory(&wfdesc, sizeof(D3D11_RASTERIZER_DESC));
@@ -804,7 +1284,7 @@ HRESULT Application::InitDevice()
     wfdesc.CullMode = D3D11_CULL_NONE;
     hr = _pd3dDevice->CreateRasterizerState(&wfdesc, &_wireFrame);
 
-    _pImmediateContext->RSSetState(_wireFrame);
+    _context.RSSetState(_wireFrame);
 
     //declare solid fill desc
     D3D11_RASTERIZER_DESC solidDesc;
@@ -839,8 +1319,46 @@ HRESULT Application::InitDevice()
 
 void Application::Cleanup()
 {
+    //stop the simulation before anything it reads is freed
+    _simulationRunning = false;
+    if (_simulationThread.joinable())
+        _simulationThread.join();
+
     if (_pImmediateContext) _pImmediateContext->ClearState();
+
+    //Hands back every reference taken while building the scene, then frees whatever is left, which should be nothing.
+    //Each body took its own reference to its texture, the meshes and shared textures are held once here
+    if (_resources)
+    {
+        _entities.ForEach<Renderable>([&](size_t count, const Entity* entities, const Renderable* renderables)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                if (entities[i] < BODY_COUNT)
+                    _resources->Release(renderables[i].Texture);
+            }
+        });
+
+        for (UINT level = 0; level <= MaxBodySphereLevel; level++)
+            _resources->Release(_bodySphereLevels[level]);
+
+        for (int i = 0; i < BodyModelCount; i++)
+            MeshSimplifier::Release(*_resources, _bodyModels[i]);
+
+        _resources->Release(_cubeMeshHandle);
+        _resources->Release(_sphereMeshHandle);
+        _resources->Release(_asteroidMeshHandle);
+        _resources->Release(_asteroidTexture);
+        _resources->Release(_planeTexture);
+    }
+
+    delete _resources;
+    _resources = nullptr;
+
     if (_pConstantBuffer) _pConstantBuffer->Release();
+    _objectConstants.Release();
+    if (_pObjectConstantBuffer) _pObjectConstantBuffer->Release();
+    if (_pImmediateContext1) _pImmediateContext1->Release();
     if (_pVertexBuffer) _pVertexBuffer->Release();
     if (_pPyramidVertexBuffer) _pPyramidVertexBuffer->Release();
     if (_pPlaneVertexBuffer) _pPlaneVertexBuffer->Release();
@@ -861,124 +1379,412 @@ void Application::Cleanup()
     if (_pTextureRV) _pTextureRV->Release();
     if (_pSamplerLinear) _pSamplerLinear->Release();
     if (Transparency) Transparency->Release();
+    if (_pInstancedVertexShader) _pInstancedVertexShader->Release();
+    if (_pInstancedPixelShader) _pInstancedPixelShader->Release();
+    if (_pInstancedVertexLayout) _pInstancedVertexLayout->Release();
+    if (_pBodyInstanceBuffer) _pBodyInstanceBuffer->Release();
+    if (_bodyTextureArray) _bodyTextureArray->Release();
+}
 
-    if (_pEarthTexture) _pEarthTexture->Release();
-    if (_pMoonTexture) _pMoonTexture->Release();
-
-    if (_pSunTexture) _pSunTexture->Release();
+OrbitalCamera* Application::GetCamera(int index)
+{
+    switch (index)
+    {
+    case 1:
+        return MercuryCamera;
+    case 2:
+        return VenusCamera;
+    case 3:
+        return EarthCamera;
+    case 4:
+        return MarsCamera;
+    case 5:
+        return JupiterCamera;
+    case 6:
+        return SaturnCamera;
+    case 7:
+        return UranusCamera;
+    case 8:
+        return NeptuneCamera;
+    case 9:
+        return FreeCamera;
+    default:
+        return SunCamera;
+    }
+}
 
-    if (_pMercuryTexture) _pMercuryTexture->Release();
+XMMATRIX Application::InterpolateTransform(const XMFLOAT4X4& previous, const XMFLOAT4X4& current)
+{
+    //a straight blend of each row, a step is short enough that the rotation across it barely shrinks the result
+    XMMATRIX from = XMLoadFloat4x4(&previous);
+    XMMATRIX to = XMLoadFloat4x4(&current);
+    XMVECTOR blend = XMVectorReplicate(_interpolation);
 
-    if (_pVenusSurface) _pVenusSurface->Release();
-    if (_pVenusAtmos) _pVenusAtmos->Release();
+    for (int i = 0; i < 4; i++)
+    {
+        from.r[i] = XMVectorLerpV(from.r[i], to.r[i], blend);
+    }
 
-    if (_pMarsTexture) _pMarsTexture->Release();
-    if (_pPhobosTexture) _pPhobosTexture->Release();
-    if (_pDeimosTexture) _pDeimosTexture->Release();
+    return from;
+}
 
-    if (_pAsteroidTexture) _pAsteroidTexture->Release();
+void Application::SetObjectConstants(const ObjectConstants& constants)
+{
+    D3D11ConstantBufferRing::Allocation allocation;
+    if (_objectConstants.Upload(&constants, sizeof(constants), allocation))
+    {
+        _objectConstants.Bind(1, allocation);
 
-    if (_pJupiterTexture) _pJupiterTexture->Release();
-    if (_pIoTexture) _pIoTexture->Release();
-    if (_pGanymedeTexture) _pGanymedeTexture->Release();
-    if (_pEuropaTexture) _pEuropaTexture->Release();
-    if (_pCallistoTexture) _pCallistoTexture->Release();
+        //Bound by offset round _context, so it no longer knows what slot 1 holds
+        _context.InvalidateConstantBuffers(1, 1);
+        return;
+    }
 
-    if (_pSaturnTexture) _pSaturnTexture->Release();
-    if (_pEnceladusTexture) _pEnceladusTexture->Release();
-    if (_pTitanTexture) _pTitanTexture->Release();
+    //Draw binds the buffer once a frame, so these only reach the context when the ring has bound over it since
+    _pImmediateContext->UpdateSubresource(_pObjectConstantBuffer, 0, nullptr, &constants, 0, 0);
+    _context.VSSetConstantBuffers(1, 1, &_pObjectConstantBuffer);
+    _context.PSSetConstantBuffers(1, 1, &_pObjectConstantBuffer);
+}
 
-    if (_pUranusTexture) _pUranusTexture->Release();
-    if (_pTitaniaTexture) _pTitaniaTexture->Release();
-    if (_pOberonTexture) _pOberonTexture->Release();
+void Application::SetTexture(TextureHandle texture)
+{
+    ID3D11ShaderResourceView* textureView = _resources->GetTexture(texture);
+    _context.PSSetShaderResources(0, 1, &textureView);
+}
 
-    if (_pNeptuneTexture) _pNeptuneTexture->Release();
+//Radius on screen in pixels of a bounding sphere, pixelScale being the projection's y scale times half the window height.
+//Anything round the eye fills the screen
+static float PixelRadius(const XMFLOAT4& sphere, FXMVECTOR eye, float pixelScale)
+{
+    float distance = XMVectorGetX(XMVector3Length(XMLoadFloat4(&sphere) - eye));
+    return distance > sphere.w ? sphere.w / distance * pixelScale : FLT_MAX;
+}
 
-    if (_pPlaneTexture) _pPlaneTexture->Release();
+//Sphere level for a body of a radius on screen in pixels, moved bias levels coarser
+static UINT SelectSphereLevel(float pixels, int bias)
+{
+    int level = 0;
+    for (float size = BodyLevelPixels; pixels >= size && level < (int)MaxBodySphereLevel; size *= 2.0f)
+        level++;
 
-    earth = nullptr;
-    moon = nullptr;
+    level -= bias;
+    return level < 0 ? 0 : (level > (int)MaxBodySphereLevel ? MaxBodySphereLevel : (UINT)level);
+}
 
-    sun = nullptr;
+//Whether an asteroid or ring particle is among the fraction of them drawn. Each index hashes to a fixed point between 0 and 1,
+//so the same ones stay in as the fraction moves and those left out are spread evenly rather than all from one end of the belt
+static bool InAsteroidFraction(UINT index, float fraction)
+{
+    return fraction >= 1.0f || ((index * 2654435761u) >> 8) < (UINT)(fraction * 16777216.0f);
+}
 
-    venus = nullptr;
-    venusAtmos = nullptr;
+//Bounding sphere of a unit sphere mesh drawn with a world matrix, its centre and largest scale
+static XMFLOAT4 BoundingSphere(FXMMATRIX world)
+{
+    float radius = XMVectorGetX(XMVectorMax(XMVector3Length(world.r[0]), XMVectorMax(XMVector3Length(world.r[1]), XMVector3Length(world.r[2]))));
 
-    mercury = nullptr;
+    XMFLOAT4 sphere;
+    XMStoreFloat4(&sphere, XMVectorSetW(world.r[3], radius));
+    return sphere;
+}
 
-    mars = nullptr;
-    phobos = nullptr;
-    deimos = nullptr;
+//The pick spheres of both snapshots and how far between them the frame was drawn, for BlendedPickSphere
+struct PickBlend
+{
+    const XMFLOAT4* From;
+    const XMFLOAT4* To;
+    float Blend;
+};
 
-    jupiter = nullptr;
-    europa = nullptr;
-    io = nullptr;
-    ganymede = nullptr;
-    callisto = nullptr;
+//A pick sphere where it was drawn. Transforms blend linearly, so its centre does too and its radius never exceeds the blend of the two
+static XMFLOAT4 BlendedPickSphere(const void* context, UINT index)
+{
+    const PickBlend& blend = *(const PickBlend*)context;
 
-    saturn = nullptr;
-    enceladus = nullptr;
-    titan = nullptr;
+    XMFLOAT4 sphere;
+    XMStoreFloat4(&sphere, XMVectorLerp(XMLoadFloat4(&blend.From[index]), XMLoadFloat4(&blend.To[index]), blend.Blend));
+    return sphere;
+}
 
-    uranus = nullptr;
-    titania = nullptr;
-    oberon = nullptr;
-    
-    neptune = nullptr;
+void Application::BuildPickTree()
+{
+    const SimulationSnapshot& snapshot = _snapshots.Front();
+    const SimulationSnapshot& previous = _snapshots.Previous();
 
-    delete earth, moon, sun, venus, venusAtmos, mercury, mars, phobos, jupiter, europa, io, ganymede, callisto, saturn, enceladus, titan, uranus, titania, oberon, neptune;
+    _pickFrom.clear();
+    _pickTo.clear();
 
-    for(int i = 0; i < 10000; i++)
+    for (int i = 0; i < BODY_COUNT - 1; i++)
     {
-        delete AsteroidArray[i];
+        _pickFrom.push_back(BoundingSphere(XMLoadFloat4x4(&previous.entities[PickableBodies[i]])));
+        _pickTo.push_back(BoundingSphere(XMLoadFloat4x4(&snapshot.entities[PickableBodies[i]])));
     }
-    for(int i = 0; i < 750; i++)
+
+    for (int i = 0; i < BeltAsteroidCount; i++)
     {
-        delete SaturnInnerRingArray[i];
+        _pickFrom.push_back(BoundingSphere(XMLoadFloat4x4(&previous.entities[FirstBeltEntity + i])));
+        _pickTo.push_back(BoundingSphere(XMLoadFloat4x4(&snapshot.entities[FirstBeltEntity + i])));
     }
-    for(int i = 0; i < 1000; i++)
+
+    for (size_t group = 0; group < _ringGroups.size(); group++)
     {
-        delete SaturnMidRingArray[i];
-    }
-    for(int i = 0; i < 1500; i++)
+        const RigidGroup& ringGroup = _ringGroups[group];
+        XMMATRIX fromMatrix = XMLoadFloat4x4(&previous.ringGroups[group]);
+        XMMATRIX toMatrix = XMLoadFloat4x4(&snapshot.ringGroups[group]);
+
+        for (size_t i = 0; i < ringGroup.GetCount(); i++)
+        {
+            XMMATRIX local = XMLoadFloat4x4(&ringGroup.GetLocalMatrix(i));
+            _pickFrom.push_back(BoundingSphere(local * fromMatrix));
+            _pickTo.push_back(BoundingSphere(local * toMatrix));
+        }
+    }
+
+    for (size_t i = 0; i < _looseRingParticles.size(); i++)
     {
-        delete SaturnOuterRingArray[i];
+        _pickFrom.push_back(BoundingSphere(XMLoadFloat4x4(&previous.looseRingParticles[i])));
+        _pickTo.push_back(BoundingSphere(XMLoadFloat4x4(&snapshot.looseRingParticles[i])));
+    }
+
+    //Each sphere the tree is built from holds the object wherever it is drawn between the two snapshots
+    _pickSpheres.resize(_pickFrom.size());
+
+    for (size_t i = 0; i < _pickSpheres.size(); i++)
+    {
+        const XMFLOAT4& from = _pickFrom[i];
+        const XMFLOAT4& to = _pickTo[i];
+        XMVECTOR fromCentre = XMLoadFloat4(&from);
+        XMVECTOR toCentre = XMLoadFloat4(&to);
+        float halfTravel = 0.5f * XMVectorGetX(XMVector3Length(toCentre - fromCentre));
+
+        XMStoreFloat4(&_pickSpheres[i], XMVectorSetW(0.5f * (fromCentre + toCentre), (from.w > to.w ? from.w : to.w) + halfTravel));
     }
+
+    _pickTree.Build(&_pickSpheres[0], _pickSpheres.size());
 }
 
-void Application::Update()
+PickResult Application::Pick(const XMFLOAT3& origin, const XMFLOAT3& direction)
 {
-    // Update our time
-    static float t = 0.0f;
+    //The tree only changes with the snapshots, so clicks between two of them only pay for the ray
+    if (_pickTreeStale)
+    {
+        BuildPickTree();
+        _pickTreeStale = false;
+    }
+
+    PickBlend blend;
+    blend.From = &_pickFrom[0];
+    blend.To = &_pickTo[0];
+    blend.Blend = _interpolation;
 
-    if (_driverType == D3D_DRIVER_TYPE_REFERENCE)
+    PickResult result;
+    result.Kind = PICK_NONE;
+    result.Index = 0;
+    result.Distance = 0.0f;
+
+    SphereBVH::RayHit hit;
+    if (!_pickTree.Raycast(origin, direction, FLT_MAX, BlendedPickSphere, &blend, hit))
+        return result;
+
+    const UINT bodyCount = BODY_COUNT - 1;
+    const UINT asteroidCount = BeltAsteroidCount;
+
+    result.Distance = hit.Distance;
+
+    if (hit.Index < bodyCount)
+    {
+        result.Kind = PICK_BODY;
+        result.Index = PickableBodies[hit.Index];
+    }
+    else if (hit.Index < bodyCount + asteroidCount)
     {
-        t += (float)XM_PI * 0.0125f;
+        result.Kind = PICK_ASTEROID;
+        result.Index = hit.Index - bodyCount;
     }
     else
     {
-        static DWORD dwTimeStart = 0;
-        DWORD dwTimeCur = GetTickCount64();
+        result.Kind = PICK_RING_PARTICLE;
+        result.Index = hit.Index - bodyCount - asteroidCount;
+    }
 
-        if (dwTimeStart == 0)
-            dwTimeStart = dwTimeCur;
+    return result;
+}
 
-        t = (dwTimeCur - dwTimeStart) / 1000.0f;
-    }
+PickResult Application::PickScreen(float x, float y)
+{
+    XMFLOAT3 origin, direction;
+    GetCamera(currentCam)->GetPickRay(x, y, origin, direction);
+
+    return Pick(origin, direction);
+}
+
+void Application::Update()
+{
+    //How long the last frame took from its Update to this one, for the quality governor
+    double frameStart = _wallClock.Now();
+    double frameSeconds = _lastFrameStart > 0.0 ? frameStart - _lastFrameStart : 0.0;
+    _lastFrameStart = frameStart;
 
-    gTime = t;
+    //take the newest frame the simulation thread has finished, the last one is kept if nothing new has arrived
+    if (_snapshots.Acquire())
+        _pickTreeStale = true;
+    const SimulationSnapshot& snapshot = _snapshots.Front();
+    const SimulationSnapshot& previous = _snapshots.Previous();
+
+    //draw a step behind the simulation, blending from the previous snapshot to the newest as real time catches up with it
+    float span = (float)(snapshot.time - previous.time);
+    _interpolation = span > 0.0f ? (float)((_wallClock.Now() - snapshot.publishedAt) / span) : 1.0f;
+    _interpolation = _interpolation < 0.0f ? 0.0f : (_interpolation > 1.0f ? 1.0f : _interpolation);
+
+    gTime = (float)(previous.time + span * _interpolation);
 
     //get button press
     if (GetAsyncKeyState(VK_LEFT))
     {
         //if the left arrow key is pressed, set the rasterize state to wireframe
-        _pImmediateContext->RSSetState(_wireFrame);
+        _context.RSSetState(_wireFrame);
     }
     else if (GetAsyncKeyState(VK_RIGHT))
     {
         //else if the right arrow key is pressed, set the rasterize state to solid
-        _pImmediateContext->RSSetState(_solid);
+        _context.RSSetState(_solid);
+    }
+
+    //G switches the belt between its Kepler orbits and gravity, once per press
+    static bool gravityKeyWasDown = false;
+    bool gravityKeyDown = (GetAsyncKeyState('G') & 0x8000) != 0;
+    if (gravityKeyDown && !gravityKeyWasDown)
+    {
+        _beltGravityRequested = !_beltGravityRequested.load();
+
+        if (!_beltGravityRequested.load())
+            SetWindowText(_hWnd, L"DX11 Framework");
     }
+    gravityKeyWasDown = gravityKeyDown;
+
+    //I moves on to the next integrator for the belt's gravity
+    static bool integratorKeyWasDown = false;
+    bool integratorKeyDown = (GetAsyncKeyState('I') & 0x8000) != 0;
+    if (integratorKeyDown && !integratorKeyWasDown)
+        _beltIntegratorRequested = (_beltIntegratorRequested.load() + 1) % INTEGRATOR_TYPE_COUNT;
+    integratorKeyWasDown = integratorKeyDown;
+
+    //B shows how many draws and binds each frame takes in the title bar, once per press
+    static bool statisticsKeyWasDown = false;
+    bool statisticsKeyDown = (GetAsyncKeyState('B') & 0x8000) != 0;
+    if (statisticsKeyDown && !statisticsKeyWasDown)
+    {
+        _showRenderStatistics = !_showRenderStatistics;
+
+        if (!_showRenderStatistics)
+            SetWindowText(_hWnd, L"DX11 Framework");
+    }
+    statisticsKeyWasDown = statisticsKeyDown;
+
+    //T switches the opaque planets and moons between one instanced draw and a draw each, once per press
+    static bool batchKeyWasDown = false;
+    bool batchKeyDown = (GetAsyncKeyState('T') & 0x8000) != 0;
+    if (batchKeyDown && !batchKeyWasDown)
+        _batchBodies = !_batchBodies;
+    batchKeyWasDown = batchKeyDown;
+
+    //O switches leaving out what is hidden behind the planets and moons, once per press
+    static bool occlusionKeyWasDown = false;
+    bool occlusionKeyDown = (GetAsyncKeyState('O') & 0x8000) != 0;
+    if (occlusionKeyDown && !occlusionKeyWasDown)
+        _occlusionCulling = !_occlusionCulling;
+    occlusionKeyWasDown = occlusionKeyDown;
+
+    //Q switches the quality governor on and off, once per press. Either way it starts again from the default level
+    static bool qualityKeyWasDown = false;
+    bool qualityKeyDown = (GetAsyncKeyState('Q') & 0x8000) != 0;
+    if (qualityKeyDown && !qualityKeyWasDown)
+    {
+        _adaptiveQuality = !_adaptiveQuality;
+        _quality.Reset();
+    }
+    qualityKeyWasDown = qualityKeyDown;
+
+    //Every change of level goes to the debug output with what it was based on and what it now draws
+    if (_adaptiveQuality)
+    {
+        QualityGovernor::Decision decision = _quality.AddFrame(frameSeconds);
+        if (decision != QualityGovernor::DECISION_NONE)
+        {
+            const QualityGovernor::Settings& quality = _quality.GetSettings();
+
+            char message[224];
+            sprintf_s(message, "Quality %s to level %u, %.2f ms a frame against %.2f ms: %.0f%% of asteroids, LOD bias %+d, asteroids under %.2f pixels left out, belt solved to %.3f pixels\n",
+                decision == QualityGovernor::DECISION_LOWER ? "lowered" : "raised", _quality.GetLevel(), _quality.GetAverageSeconds() * 1000.0, _quality.GetTargetSeconds() * 1000.0,
+                quality.AsteroidFraction * 100.0f, quality.LODBias, quality.DetailPixels, quality.ExtrapolationPixels);
+            OutputDebugStringA(message);
+        }
+    }
+
+    //while the belt is under gravity show how far its energy has drifted in the title bar, a couple of times a second
+    static double lastTitleUpdate = 0.0;
+    if (_beltGravityRequested.load() && _wallClock.Now() - lastTitleUpdate > 0.5)
+    {
+        lastTitleUpdate = _wallClock.Now();
+
+        wchar_t title[160];
+        swprintf_s(title, L"DX11 Framework - belt gravity, %s, %u substeps, energy drift %.3e, %u close approaches", Integrator::GetName((IntegratorType)_beltIntegratorRequested.load()), _beltSubsteps.load(), _beltEnergyDrift.load(), _beltCloseApproachCount.load());
+        SetWindowText(_hWnd, title);
+    }
+    else if (_showRenderStatistics && _wallClock.Now() - lastTitleUpdate > 0.5)
+    {
+        lastTitleUpdate = _wallClock.Now();
+
+        const RenderQueue::Statistics& statistics = _renderQueue.GetStatistics();
+        const D3D11StateFilteringContext::Statistics& stateCalls = _context.GetStatistics();
+
+        const OcclusionBuffer::Statistics& occlusion = _occlusion.GetStatistics();
+
+        wchar_t title[256];
+        swprintf_s(title, L"DX11 Framework - quality %u, %u of %u belt orbits solved, %u draws, %u bodies instanced, %u occluded, %u shader, %u mesh, %u texture and %u blend binds, %u state calls filtered of %u",
+            _quality.GetLevel(), _beltOrbitsSolved.load(), (UINT)BeltAsteroidCount, statistics.Draws + (_bodyInstances.empty() ? 0 : _bodyInstanceDraws), (UINT)_bodyInstances.size(), occlusion.Culled, statistics.ShaderBinds, statistics.MeshBinds, statistics.TextureBinds, statistics.BlendBinds,
+            stateCalls.Filtered, stateCalls.Filtered + stateCalls.Forwarded);
+        SetWindowText(_hWnd, title);
+    }
+
+    //Left click picks whatever is under the cursor, a body with a follow camera switches to it and the title bar says what was hit
+    static bool clickWasDown = false;
+    bool clickDown = (GetAsyncKeyState(VK_LBUTTON) & 0x8000) != 0;
+    if (clickDown && !clickWasDown)
+    {
+        POINT cursor;
+        GetCursorPos(&cursor);
+        ScreenToClient(_hWnd, &cursor);
+
+        PickResult picked = PickScreen((float)cursor.x, (float)cursor.y);
+
+        wchar_t title[128];
+        if (picked.Kind == PICK_BODY)
+        {
+            for (int i = 0; i < 9; i++)
+            {
+                if (CameraBodies[i] == (SceneBody)picked.Index)
+                    currentCam = i;
+            }
+
+            swprintf_s(title, L"DX11 Framework - picked %hs", BodyNames[picked.Index]);
+        }
+        else if (picked.Kind == PICK_ASTEROID)
+        {
+            swprintf_s(title, L"DX11 Framework - picked asteroid %u", picked.Index);
+        }
+        else if (picked.Kind == PICK_RING_PARTICLE)
+        {
+            swprintf_s(title, L"DX11 Framework - picked ring particle %u", picked.Index);
+        }
+        else
+        {
+            swprintf_s(title, L"DX11 Framework");
+        }
+
+        SetWindowText(_hWnd, title);
+    }
+    clickWasDown = clickDown;
 
     //get change in camera
     if (GetAsyncKeyState(VK_NUMPAD0))
@@ -1022,182 +1828,493 @@ void Application::Update()
         currentCam = 9;
     }
 
-    //Sun
-    XMStoreFloat4x4(&_sun, XMMatrixScaling(1.5f, 1.5f, 1.5f) * XMMatrixRotationY(0.037f * t * simulationSpeed));
+    //blend from wherever the old camera was looking to the new one instead of cutting
+    if (currentCam != previousCam)
+    {
+        OrbitalCamera* fromCamera = GetCamera(previousCam);
+        GetCamera(currentCam)->BeginTransition(fromCamera->GetEyePosition(), fromCamera->GetLookAtPosition(), cameraTransitionTime);
+        previousCam = currentCam;
+    }
 
-    //SunCamera - Camera that follows the sun
-    XMStoreFloat4x4(&_sunCameraPos, XMMatrixTranslation(0.0f, 2.0f, -3.0f) * XMLoadFloat4x4(&_sun));
-    SunCamera->Update(_sunCameraPos, _sun);
+    static float lastT = gTime;
+    GetCamera(currentCam)->AdvanceTransition(gTime - lastT);
+    lastT = gTime;
 
-    //Mercury
-    XMStoreFloat4x4(&_mercury, XMMatrixScaling(0.1f, 0.1f, 0.1f)* XMMatrixRotationY(0.01695f * t * simulationSpeed)* XMMatrixTranslation(2.5f, 0.0f, 0.0f)* XMMatrixRotationY(0.01136f * t * simulationSpeed));
+    //follow cameras take their position from the snapshot, and only the one in use is touched
+    if (currentCam < 9)
+    {
+        XMFLOAT4X4 cameraPos, cameraAt;
+        XMStoreFloat4x4(&cameraPos, InterpolateTransform(previous.cameraPos[currentCam], snapshot.cameraPos[currentCam]));
+        XMStoreFloat4x4(&cameraAt, InterpolateTransform(previous.cameraAt[currentCam], snapshot.cameraAt[currentCam]));
 
-    //Mercury Camera
-    XMStoreFloat4x4(&_MercuryCameraPos, XMMatrixTranslation(0.0f, 2.0f, -3.0f) * XMLoadFloat4x4(&_mercury));
-    MercuryCamera->Update(_MercuryCameraPos, _mercury);
+        GetCamera(currentCam)->Update(cameraPos, cameraAt);
+    }
 
-    //VenusCamera - Camera that follows venus
-    XMStoreFloat4x4(&_VenusCameraPos, XMMatrixTranslation(0.0f, 2.0f, -3.0f) * XMLoadFloat4x4(&_venus));
-    VenusCamera->Update(_VenusCameraPos, _venus);
+    //Free Camera, only brought up to date on a frame one of its keys moved it
+    if(currentCam == 9)
+    {
+        bool freeCameraMoved = false;
 
-    //Venus Surface
-    XMStoreFloat4x4(&_venus, XMMatrixScaling(0.2f, 0.2f, 0.2f)* XMMatrixRotationY(0.004115f * t * simulationSpeed)* XMMatrixTranslation(4.5f, 0.0f, 0.0f)* XMMatrixRotationY(0.00446f * t * simulationSpeed));
+	    if(GetAsyncKeyState('D'))
+	    {
+            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x + 0.01f, FreeCamera->GetFloatPos().y, FreeCamera->GetFloatPos().z));
+            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x + 0.01f, FreeCamera->GetFloatAt().y, FreeCamera->GetFloatAt().z));
+            freeCameraMoved = true;
+	    }
+        if(GetAsyncKeyState('A'))
+        {
+            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x - 0.01f, FreeCamera->GetFloatPos().y, FreeCamera->GetFloatPos().z));
+            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x - 0.01f, FreeCamera->GetFloatAt().y, FreeCamera->GetFloatAt().z));
+            freeCameraMoved = true;
+        }
+        if(GetAsyncKeyState('W'))
+        {
+            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x, FreeCamera->GetFloatPos().y, FreeCamera->GetFloatPos().z + 0.01f));
+            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x, FreeCamera->GetFloatAt().y, FreeCamera->GetFloatAt().z + 0.01f));
+            freeCameraMoved = true;
+        }
+        if (GetAsyncKeyState('S'))
+        {
+            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x, FreeCamera->GetFloatPos().y, FreeCamera->GetFloatPos().z - 0.01f));
+            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x, FreeCamera->GetFloatAt().y, FreeCamera->GetFloatAt().z - 0.01f));
+            freeCameraMoved = true;
+        }
+        if (GetAsyncKeyState(VK_SPACE))
+        {
+            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x, FreeCamera->GetFloatPos().y + 0.01f, FreeCamera->GetFloatPos().z));
+            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x, FreeCamera->GetFloatAt().y + 0.01f, FreeCamera->GetFloatAt().z));
+            freeCameraMoved = true;
+        }
+        if (GetAsyncKeyState(VK_CONTROL))
+        {
+            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x, FreeCamera->GetFloatPos().y - 0.01f, FreeCamera->GetFloatPos().z));
+            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x, FreeCamera->GetFloatAt().y - 0.01f, FreeCamera->GetFloatAt().z));
+            freeCameraMoved = true;
+        }
 
-    //Venus Atmos
-    XMStoreFloat4x4(&_venusAtmos, XMMatrixScaling(0.24f, 0.24f, 0.24f) * XMMatrixRotationY(0.004115f * t * 25 * simulationSpeed) * XMMatrixTranslation(4.5f, 0.0f, 0.0f) * XMMatrixRotationY(0.00446f * t * simulationSpeed));
+        if (freeCameraMoved)
+            FreeCamera->Update();
+    }
 
-    //Earth
-    XMStoreFloat4x4(&_earth, XMMatrixScaling(0.2106f, 0.2106f, 0.2106f) * XMMatrixRotationY(t * simulationSpeed) * XMMatrixTranslation(8.032f, 0.0f, 0.0f) * XMMatrixRotationY(0.0027397f * t * simulationSpeed));
+    ////Back plane
+    //XMStoreFloat4x4(&_backPlane, XMMatrixScaling(25.0f, 25.0f, 25.0f) * XMMatrixTranslation(0.0, -5.0f, 0.0f));
+}
 
-    //EarthCamera - Camera that follows earth
-    XMStoreFloat4x4(&_EarthCameraPos, XMMatrixTranslation(0.0f, 2.0f, -3.0f) * XMLoadFloat4x4(&_earth));
-    EarthCamera->Update(_EarthCameraPos, _earth);
+void Application::SimulationLoop()
+{
+    _simulationClock.Reset();
 
-    //Moon
-    XMStoreFloat4x4(&_moon, XMMatrixScaling(0.25f, 0.25f, 0.25f) * XMMatrixRotationY(0.037f * t * simulationSpeed) * XMMatrixTranslation(2.50f, 0.0f, 0.0f) * XMMatrixRotationY(0.037f * t * simulationSpeed) * XMLoadFloat4x4(&_earth));
+    while (_simulationRunning.load())
+    {
+        //run every step that is due, each a fixed length however long frames are taking
+        bool stepped = false;
+        _simulationClock.Tick();
+        while (_simulationClock.Step())
+        {
+            Simulate(_snapshots.Back(), _simulationClock.GetTime());
+            stepped = true;
+        }
 
-    //Mars
-    XMStoreFloat4x4(&_mars, XMMatrixScaling(0.11214f, 0.11214f, 0.11214f) * XMMatrixRotationY(1.025f * t * simulationSpeed) * XMMatrixTranslation(11.6446f, 0.0f, 0.0f) * XMMatrixRotationY(0.0014556f * t * simulationSpeed));
+        //hand over the slot the render thread is not using
+        if (stepped)
+        {
+            _snapshots.Back().publishedAt = _wallClock.Now();
+            _snapshots.Publish();
+        }
 
-    //Mars Camera
-    XMStoreFloat4x4(&_MarsCameraPos, XMMatrixTranslation(0.0f, 2.0f, -3.0f) * XMLoadFloat4x4(&_mars));
-    MarsCamera->Update(_MarsCameraPos, _mars);
+        //sleep through most of the wait for the next step, Sleep is too coarse for the last couple of milliseconds
+        if (_simulationClock.TimeUntilNextStep() > 0.002)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        else
+            std::this_thread::yield();
+    }
+}
 
-    //Phobos
-    XMStoreFloat4x4(&_phobos, XMMatrixScaling(0.1f, 0.1f, 0.1f) * XMMatrixRotationY(3.125f * t * simulationSpeed) * XMMatrixTranslation(2.0f, 0.0f, 0.0f) * XMMatrixRotationY(3.125f * t * simulationSpeed) * XMLoadFloat4x4(&_mars));
+void Application::SimulateBeltGravity(double t)
+{
+    IntegratorType integrator = (IntegratorType)_beltIntegratorRequested.load();
+    if (_beltGravity.GetIntegrator() != integrator)
+        _beltGravity.SetIntegrator(integrator);
 
-    //Deimos
-    XMStoreFloat4x4(&_deimos, XMMatrixScaling(0.05f, 0.05f, 0.05f) * XMMatrixRotationY(0.79f * t * simulationSpeed) * XMMatrixTranslation(3.0f, 0.0f, 0.0f) * XMMatrixRotationY(0.79f * t * simulationSpeed) * XMLoadFloat4x4(&_mars));
+    //Planets go where they are at the end of this step before anything moves
+    PlaceGravityPlanets(_beltGravity, _orbitPositions);
 
-    //Asteroid Belt
-    for(int i = 0; i < 10000; i++)
+    if (!_beltGravityActive)
     {
-        AsteroidArray[i]->Update(t, simulationSpeed);
+        StartBeltGravity(_beltGravity, _beltOrbits, _beltGravitySun, t * simulationSpeed, &_orbitPositions[FirstBeltOrbit]);
+        _beltGravityActive = true;
     }
+    else
+    {
+        float dt = (float)((t - _lastSimulatedTime) * simulationSpeed);
+        if (dt > 0.0f)
+            _beltGravity.Step(dt);
 
-    //Jupiter
-    XMStoreFloat4x4(&_jupiter, XMMatrixScaling(1.053f, 1.053f, 1.053f) * XMMatrixRotationY(2.4f * t * simulationSpeed) * XMMatrixTranslation(20.5f, 0.0f, 0.0f) * XMMatrixRotationY(0.0002283f * t * simulationSpeed));
+        _beltGravity.CopyPositions(&_orbitPositions[FirstBeltOrbit]);
+    }
 
-    //Jupiter Camera
-    XMStoreFloat4x4(&_JupiterCameraPos, XMMatrixTranslation(0.0f, 2.0f, -3.0f) * XMLoadFloat4x4(&_jupiter));
-    JupiterCamera->Update(_JupiterCameraPos, _jupiter);
+    _beltEnergyDrift.store((float)_beltGravity.GetEnergyDrift());
+    _beltSubsteps.store(_beltGravity.GetLastSubsteps());
+}
 
-    //Io
-    XMStoreFloat4x4(&_io, XMMatrixScaling(0.03456f, 0.03456f, 0.03456f)* XMMatrixRotationY(0.556f * t * simulationSpeed)* XMMatrixTranslation(1.25f, 0.0f, 0.0f)* XMMatrixRotationY(0.556f * t * simulationSpeed)* XMLoadFloat4x4(&_jupiter));
+void Application::SimulateBeltOrbits(double t)
+{
+    double time = t * simulationSpeed;
+    float stepLength = (float)(_simulationClock.GetStepLength() * simulationSpeed);
 
-	//Europa
-    XMStoreFloat4x4(&_europa, XMMatrixScaling(0.0484f, 0.0484f, 0.0484f) * XMMatrixRotationY(0.2857f * t * simulationSpeed) * XMMatrixTranslation(2.25f, 0.0f, 0.0f) * XMMatrixRotationY(0.28957f * t * simulationSpeed) * XMLoadFloat4x4(&_jupiter));
+    BeltViewer viewer = _beltViewer.load();
+    XMVECTOR eye = XMLoadFloat3(&viewer.Eye);
 
-    //Ganymede
-    XMStoreFloat4x4(&_ganymede, XMMatrixScaling(0.080256f, 0.080256f, 0.080256f)* XMMatrixRotationY(0.1395f * t * simulationSpeed)* XMMatrixTranslation(3.25f, 0.0f, 0.0f)* XMMatrixRotationY(0.1395f * t * simulationSpeed)* XMLoadFloat4x4(&_jupiter));
+    //A group can go as many steps between solves as keeps its worst asteroid within the tolerance on screen. Carried on in a straight line
+    //an asteroid leaves its orbit by half its acceleration times the time squared, the acceleration of a near circular orbit being its speed
+    //squared over its radius, and what that comes to on screen falls off with distance from the eye
+    XMFLOAT3* positions = &_orbitPositions[FirstBeltOrbit];
 
-    //Callisto
-    XMStoreFloat4x4(&_callisto, XMMatrixScaling(0.08f, 0.08f, 0.08f)* XMMatrixRotationY(0.0588f * t * simulationSpeed)* XMMatrixTranslation(4.25f, 0.0f, 0.0f)* XMMatrixRotationY(0.0588f * t * simulationSpeed)* XMLoadFloat4x4(&_jupiter));
+    for (size_t group = 0; group < _beltSchedule.GetCount(); group++)
+    {
+        float worst = 0.0f;
 
-    //Saturn
-    XMStoreFloat4x4(&_saturn, XMMatrixScaling(1.0f, 1.0f, 1.0f)* XMMatrixRotationY(2.233f * t * simulationSpeed) * XMMatrixTranslation(40.0f, 0.0f, 0.0f) * XMMatrixRotationY(0.00009447f * t * simulationSpeed));
+        for (size_t i = group * 4; i < group * 4 + 4 && i < (size_t)BeltAsteroidCount; i++)
+        {
+            XMVECTOR position = XMLoadFloat3(&positions[i]);
+            float radius = XMVectorGetX(XMVector3Length(position));
+            float distance = XMVectorGetX(XMVector3Length(position - eye));
+            float speedSquared = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&_beltVelocities[i])));
 
-    //Saturn Camera
-    XMStoreFloat4x4(&_SaturnCameraPos, XMMatrixTranslation(0.0f, 2.0f, -6.5f) * XMLoadFloat4x4(&_saturn));
-    SaturnCamera->Update(_SaturnCameraPos, _saturn);
+            float drift = radius > 0.0f && distance > 0.0f ? 0.5f * speedSquared / radius * stepLength * stepLength * viewer.PixelScale / distance : FLT_MAX;
+            worst = drift > worst ? drift : worst;
+        }
 
-    //Saturn Inner Ring
-    for(int i = 0; i < 750; i++)
-    {
-        SaturnInnerRingArray[i]->Update(t, simulationSpeed, _saturn);
+        //Until a frame has been drawn there is no view to judge by, so everything is solved every step
+        _beltSchedule.SetInterval(group, viewer.PixelScale > 0.0f ? UpdateScheduler::IntervalForError(worst, viewer.TolerancePixels) : 1);
     }
 
-    //Saturn Middle Ring
-    for(int i = 0; i < 1000; i++)
+    const std::vector<UINT>& due = _beltSchedule.Schedule();
+    if (!due.empty())
+        _beltOrbits.EvaluateGroups(time, &due[0], due.size(), &_beltSolvedPositions[0], &_beltVelocities[0]);
+
+    unsigned int solved = 0;
+    for (size_t i = 0; i < due.size(); i++)
     {
-        SaturnMidRingArray[i]->Update(t, simulationSpeed, _saturn);
+        _beltSolveTimes[due[i]] = time;
+        solved += BeltAsteroidCount - due[i] * 4 < 4 ? BeltAsteroidCount - due[i] * 4 : 4;
     }
 
-    //Saturn Outer Ring
-    for(int i = 0; i < 1500; i++)
+    for (int i = 0; i < BeltAsteroidCount; i++)
     {
-        SaturnOuterRingArray[i]->Update(t, simulationSpeed, _saturn);
+        float sinceSolve = (float)(time - _beltSolveTimes[i / 4]);
+        XMStoreFloat3(&positions[i], XMVectorMultiplyAdd(XMLoadFloat3(&_beltVelocities[i]), XMVectorReplicate(sinceSolve), XMLoadFloat3(&_beltSolvedPositions[i])));
     }
 
-    //Enceladus
-    XMStoreFloat4x4(&_enceladus, XMMatrixScaling(0.0535f, 0.0535f, 0.0535f) * XMMatrixRotationY(0.7299f * t * simulationSpeed) * XMMatrixTranslation(6.0f, 0.0f, 0.0f) * XMMatrixRotationY(0.7299f * t * simulationSpeed) * XMLoadFloat4x4(&_saturn));
+    _beltOrbitsSolved.store(solved);
+}
 
-    //Titan
-    XMStoreFloat4x4(&_titan, XMMatrixScaling(0.235f, 0.235f, 0.235f)* XMMatrixRotationY(0.0625f * t * simulationSpeed)* XMMatrixTranslation(8.0f, 0.0f, 0.0f)* XMMatrixRotationY(0.0625f * t * simulationSpeed)* XMLoadFloat4x4(&_saturn));
+void Application::Simulate(SimulationSnapshot& snapshot, double t)
+{
+    snapshot.time = t;
 
-    //Uranus
-    XMStoreFloat4x4(&_uranus, XMMatrixScaling(0.4355f, 0.4355f, 0.4355f)* XMMatrixRotationY(1.412f * t * simulationSpeed)* XMMatrixTranslation(60.0f, 0.0f, 0.0f)* XMMatrixRotationY(0.000032615f * t * simulationSpeed));
+    //Every orbit for this step up front, the transforms below only place each body at its position
+    _ephemeris.EvaluateOrbits(t, _orbitPositions);
 
-    //Uranus Camera
-    XMStoreFloat4x4(&_UranusCameraPos, XMMatrixTranslation(0.0f, 2.0f, -3.0f) * XMLoadFloat4x4(&_uranus));
-    UranusCamera->Update(_UranusCameraPos, _uranus);
+    //The belt either follows its Kepler orbits or, with gravity switched on, moves under the pull of everything around it
+    if (_beltGravityRequested.load())
+    {
+        SimulateBeltGravity(t);
 
-    //Titania
-    XMStoreFloat4x4(&_titania, XMMatrixScaling(0.1f, 0.1f, 0.1f)* XMMatrixRotationY(0.1148f * t * simulationSpeed)* XMMatrixTranslation(3.0f, 0.0f, 0.0f)* XMMatrixRotationY(0.1148f * t * simulationSpeed)* XMLoadFloat4x4(&_uranus));
+        //Asteroids within touching distance of each other this step, a cell the size of that distance keeps the search to the neighbouring cells.
+        //Only gravity mode has anything that reads them, so on their orbits the search is left out
+        _beltGrid.Build(&_orbitPositions[FirstBeltOrbit], BeltAsteroidCount);
+        _beltGrid.FindCloseApproaches(BeltCloseApproachDistance, _beltCloseApproaches);
+        _beltCloseApproachCount.store((unsigned int)_beltCloseApproaches.size());
+    }
+    else
+    {
+        //Coming off gravity, or time jumping rather than stepping, leaves nothing to extrapolate from
+        double elapsed = t - _lastSimulatedTime;
+        if (_beltGravityActive || elapsed <= 0.0 || elapsed > _simulationClock.GetStepLength() * 1.5)
+            _beltSchedule.Invalidate();
 
-    //Oberon
-    XMStoreFloat4x4(&_oberon, XMMatrixScaling(0.08f, 0.08f, 0.08f)* XMMatrixRotationY(0.0769f * t * simulationSpeed)* XMMatrixTranslation(4.5f, 0.0f, 0.0f)* XMMatrixRotationY(0.0769f * t * simulationSpeed)* XMLoadFloat4x4(&_uranus));
+        _beltGravityActive = false;
+        SimulateBeltOrbits(t);
+    }
 
-    //Neptune
-    XMStoreFloat4x4(&_neptune, XMMatrixScaling(0.4155f, 0.4155f, 0.4155f)* XMMatrixRotationY(1.5f * t * simulationSpeed)* XMMatrixTranslation(75.0f, 0.0f, 0.0f)* XMMatrixRotationY(0.0000166f * t * simulationSpeed));
+    _lastSimulatedTime = t;
 
-    //Neptune Camera
-    XMStoreFloat4x4(&_NeptuneCameraPos, XMMatrixTranslation(0.0f, 2.0f, -3.0f) * XMLoadFloat4x4(&_neptune));
-    NeptuneCamera->Update(_NeptuneCameraPos, _neptune);
+    //Every spin below turns on from the last step by a fixed rotation, only a seek needs any sin or cos.
+    //t stays a double all the way here, as a float it is too coarse after a few hours to tell a step from a seek
+    _spinRotors.Update(t * simulationSpeed);
 
-    //Free Camera
-    if(currentCam == 9)
+    //Transforms are built by a few passes over the entity store, each touching only the components it needs.
+    //First whatever only spins where it is, which is just the Sun
+    const float* cosines = _spinRotors.GetCosines();
+    const float* sines = _spinRotors.GetSines();
+
+    _entities.ForEach<Transform, Spin>([&](size_t count, const Entity*, Transform* transforms, const Spin* spins)
     {
-	    if(GetAsyncKeyState('D'))
-	    {
-            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x + 0.01f, FreeCamera->GetFloatPos().y, FreeCamera->GetFloatPos().z));
-            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x + 0.01f, FreeCamera->GetFloatAt().y, FreeCamera->GetFloatAt().z));
-	    }
-        if(GetAsyncKeyState('A'))
+        for (size_t i = 0; i < count; i++)
         {
-            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x - 0.01f, FreeCamera->GetFloatPos().y, FreeCamera->GetFloatPos().z));
-            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x - 0.01f, FreeCamera->GetFloatAt().y, FreeCamera->GetFloatAt().z));
+            const XMFLOAT3& scale = transforms[i].Scale;
+            XMStoreFloat4x4(&transforms[i].World, XMMatrixScaling(scale.x, scale.y, scale.z) * AngleRotors::RotationY(cosines[spins[i].Rotor], sines[spins[i].Rotor]));
         }
-        if(GetAsyncKeyState('W'))
+    }, ComponentMaskOf<Orbit>::Value);
+
+    //Planets, moons and the belt, each spun and moved to its orbit position
+    _entities.ForEach<Transform, Orbit, Spin>([&](size_t count, const Entity*, Transform* transforms, const Orbit* orbits, const Spin* spins)
+    {
+        for (size_t i = 0; i < count; i++)
         {
-            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x, FreeCamera->GetFloatPos().y, FreeCamera->GetFloatPos().z + 0.01f));
-            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x, FreeCamera->GetFloatAt().y, FreeCamera->GetFloatAt().z + 0.01f));
+            const XMFLOAT3& scale = transforms[i].Scale;
+            XMMATRIX world = XMMatrixScaling(scale.x, scale.y, scale.z) * AngleRotors::RotationY(cosines[spins[i].Rotor], sines[spins[i].Rotor]);
+            XMStoreFloat4x4(&transforms[i].World, world * XMMatrixTranslationFromVector(XMLoadFloat3(&_orbitPositions[orbits[i].Index])));
         }
-        if (GetAsyncKeyState('S'))
+    });
+
+    //Moons carried along by their planet, which never has a parent of its own so is already in place
+    _entities.ForEach<Transform, Parent>([&](size_t count, const Entity*, Transform* transforms, const Parent* parents)
+    {
+        for (size_t i = 0; i < count; i++)
         {
-            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x, FreeCamera->GetFloatPos().y, FreeCamera->GetFloatPos().z - 0.01f));
-            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x, FreeCamera->GetFloatAt().y, FreeCamera->GetFloatAt().z - 0.01f));
+            const XMFLOAT4X4& parent = _entities.Get<Transform>(parents[i].Owner).World;
+            XMStoreFloat4x4(&transforms[i].World, XMLoadFloat4x4(&transforms[i].World) * XMLoadFloat4x4(&parent));
         }
-        if (GetAsyncKeyState(VK_SPACE))
+    });
+
+    //Hand every transform over by entity
+    _entities.ForEach<Transform>([&](size_t count, const Entity* entities, const Transform* transforms)
+    {
+        for (size_t i = 0; i < count; i++)
+            snapshot.entities[entities[i]] = transforms[i].World;
+    });
+
+    //Follow cameras sit above and behind their body, further back for Saturn to take in the rings
+    for (int i = 0; i < 9; i++)
+    {
+        const XMFLOAT4X4& body = snapshot.entities[CameraBodies[i]];
+
+        XMStoreFloat4x4(&snapshot.cameraPos[i], XMMatrixTranslation(0.0f, 2.0f, CameraBodies[i] == BODY_SATURN ? -6.5f : -3.0f) * XMLoadFloat4x4(&body));
+        snapshot.cameraAt[i] = body;
+    }
+
+    //Saturn's rings, one matrix per group however many particles are in it
+    for (size_t group = 0; group < _ringGroups.size(); group++)
+    {
+        XMStoreFloat4x4(&snapshot.ringGroups[group], _ringGroups[group].GetGroupMatrix(_spinRotors.GetRotationY(_ringSpinRotors + group), snapshot.entities[BODY_SATURN]));
+    }
+
+    //and a matrix each for any that could not be grouped
+    XMMATRIX saturn = XMLoadFloat4x4(&snapshot.entities[BODY_SATURN]);
+    for (size_t i = 0; i < _looseRingParticles.size(); i++)
+    {
+        const BeltGenerator::BeltParticle& particle = _looseRingParticles[i];
+        size_t rotor = _looseRingRotors + i * 2;
+
+        XMStoreFloat4x4(&snapshot.looseRingParticles[i], XMMatrixScaling(particle.Scale.x, particle.Scale.y, particle.Scale.z) * _spinRotors.GetRotationY(rotor)
+            * XMMatrixTranslation(particle.Position.x, particle.Position.y, particle.Position.z) * _spinRotors.GetRotationY(rotor + 1) * saturn);
+    }
+}
+
+void Application::QueueScene(const XMFLOAT3& eye, CXMMATRIX view, CXMMATRIX projection)
+{
+    const SimulationSnapshot& snapshot = _snapshots.Front();
+    const SimulationSnapshot& previous = _snapshots.Previous();
+    XMVECTOR eyePosition = XMLoadFloat3(&eye);
+
+    RenderQueue::DrawItem item;
+    item.Shader = LitShader;
+
+    _bodyInstances.clear();
+    _bodyInstanceLevels.clear();
+    bool batchBodies = _batchBodies && _bodyTextureArray;
+
+    //Pixels on screen per unit of radius at unit distance, for sizing bodies and asteroids
+    const QualityGovernor::Settings& quality = _quality.GetSettings();
+    float pixelScale = XMVectorGetY(projection.r[1]) * _WindowHeight * 0.5f;
+
+    //Where every entity is this frame, with the opaque planets and moons drawn into the occlusion buffer on the way,
+    //so everything can be tested against all of them as it is queued
+    _queuedWorlds.clear();
+    _occlusion.Begin(view, projection);
+
+    _entities.ForEach<Renderable, Material>([&](size_t count, const Entity* entities, const Renderable* renderables, const Material* materials)
+    {
+        for (size_t i = 0; i < count; i++)
         {
-            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x, FreeCamera->GetFloatPos().y + 0.01f, FreeCamera->GetFloatPos().z));
-            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x, FreeCamera->GetFloatAt().y + 0.01f, FreeCamera->GetFloatAt().z));
+            XMMATRIX world = InterpolateTransform(previous.entities[entities[i]], snapshot.entities[entities[i]]);
+            XMStoreFloat4x4(&item.World, world);
+            _queuedWorlds.push_back(item.World);
+
+            if (_occlusionCulling && !renderables[i].Transparent && renderables[i].Mesh.Index == _sphereMeshHandle.Index)
+            {
+                XMFLOAT4 sphere = BoundingSphere(world);
+                UINT level = SelectSphereLevel(PixelRadius(sphere, eyePosition, pixelScale), quality.LODBias);
+                _occlusion.AddOccluder(XMLoadFloat4(&sphere), sphere.w * OccluderRadiusScales[level]);
+            }
         }
-        if (GetAsyncKeyState(VK_CONTROL))
+    });
+
+    _occlusion.Finish();
+
+    //Every entity with something to draw that is not hidden or left out by the quality level. Bodies whose texture is in the array go to _bodyInstances instead
+    size_t queued = 0;
+    _entities.ForEach<Renderable, Material>([&](size_t count, const Entity* entities, const Renderable* renderables, const Material* materials)
+    {
+        for (size_t i = 0; i < count; i++)
         {
-            FreeCamera->SetPosition(XMFLOAT3(FreeCamera->GetFloatPos().x, FreeCamera->GetFloatPos().y - 0.01f, FreeCamera->GetFloatPos().z));
-            FreeCamera->SetLookAt(XMFLOAT3(FreeCamera->GetFloatAt().x, FreeCamera->GetFloatAt().y - 0.01f, FreeCamera->GetFloatAt().z));
+            const Renderable& renderable = renderables[i];
+
+            item.World = _queuedWorlds[queued++];
+            XMMATRIX world = XMLoadFloat4x4(&item.World);
+
+            XMFLOAT4 sphere = BoundingSphere(world);
+            float pixels = PixelRadius(sphere, eyePosition, pixelScale);
+
+            bool asteroid = renderable.Mesh.Index == _asteroidMeshHandle.Index;
+            if (asteroid && (!InAsteroidFraction(entities[i], quality.AsteroidFraction) || pixels < quality.DetailPixels))
+                continue;
+
+            if (_occlusionCulling && !_occlusion.IsVisible(XMLoadFloat4(&sphere), sphere.w))
+                continue;
+
+            bool sphereBody = renderable.Mesh.Index == _sphereMeshHandle.Index;
+            UINT level = sphereBody ? SelectSphereLevel(pixels, quality.LODBias) : 0;
+
+            UINT slice = NoBodySlice;
+            if (batchBodies && !renderable.Transparent && sphereBody && renderable.Texture.Index < _bodyTextureSlices.size())
+                slice = _bodyTextureSlices[renderable.Texture.Index];
+
+            if (slice != NoBodySlice)
+            {
+                BodyInstance instance = { item.World, materials[i].Diffuse, materials[i].Ambient, materials[i].Specular, slice };
+                _bodyInstances.push_back(instance);
+                _bodyInstanceLevels.push_back(level);
+                continue;
+            }
+
+            //A body drawn from a model picks its level by its size on screen too, and is moved onto the unit sphere its world matrix is made for
+            const MeshSimplifier::LODChain* model = FindBodyModel(renderable.Mesh);
+            if (model)
+            {
+                item.Mesh = model->Levels[MeshSimplifier::SelectLOD(*model, pixels, quality.LODBias)];
+                XMStoreFloat4x4(&item.World, XMLoadFloat4x4(&model->Fit) * world);
+            }
+            else
+            {
+                item.Mesh = sphereBody ? _bodySphereLevels[level] : renderable.Mesh;
+            }
+            item.Texture = renderable.Texture;
+            item.Surface = materials[i];
+            item.Blend = renderable.Transparent ? RenderQueue::BLEND_TRANSPARENT : RenderQueue::BLEND_OPAQUE;
+            item.BlendFactor = renderable.BlendFactor;
+
+            _renderQueue.Submit(item, XMVectorGetX(XMVector3LengthSq(world.r[3] - eyePosition)));
+        }
+    });
+
+    //Saturn's rings, the group matrix is blended once and each particle's baked local matrix put in front of it
+    item.Mesh = _asteroidMeshHandle;
+    item.Texture = _asteroidTexture;
+    item.Surface = AsteroidMaterial;
+    item.Blend = RenderQueue::BLEND_OPAQUE;
+    item.BlendFactor = 0.0f;
+
+    //Ring particles are counted on from the belt's entities so the two never thin out the same way
+    UINT ringIndex = SceneEntityCount;
+    for (size_t group = 0; group < _ringGroups.size(); group++)
+    {
+        const RigidGroup& ringGroup = _ringGroups[group];
+        XMMATRIX groupMatrix = InterpolateTransform(previous.ringGroups[group], snapshot.ringGroups[group]);
+
+        for (size_t i = 0; i < ringGroup.GetCount(); i++)
+        {
+            if (!InAsteroidFraction(ringIndex++, quality.AsteroidFraction))
+                continue;
+
+            XMMATRIX world = XMLoadFloat4x4(&ringGroup.GetLocalMatrix(i)) * groupMatrix;
+
+            XMFLOAT4 sphere = BoundingSphere(world);
+            if (PixelRadius(sphere, eyePosition, pixelScale) < quality.DetailPixels)
+                continue;
+
+            if (_occlusionCulling && !_occlusion.IsVisible(XMLoadFloat4(&sphere), sphere.w))
+                continue;
+
+            XMStoreFloat4x4(&item.World, world);
+            _renderQueue.Submit(item, XMVectorGetX(XMVector3LengthSq(world.r[3] - eyePosition)));
         }
     }
-    FreeCamera->Update();
 
-    ////Back plane
-    //XMStoreFloat4x4(&_backPlane, XMMatrixScaling(25.0f, 25.0f, 25.0f) * XMMatrixTranslation(0.0, -5.0f, 0.0f));
+    for (size_t i = 0; i < _looseRingParticles.size(); i++)
+    {
+        if (!InAsteroidFraction(ringIndex++, quality.AsteroidFraction))
+            continue;
+
+        XMMATRIX world = InterpolateTransform(previous.looseRingParticles[i], snapshot.looseRingParticles[i]);
+
+        XMFLOAT4 sphere = BoundingSphere(world);
+        if (PixelRadius(sphere, eyePosition, pixelScale) < quality.DetailPixels)
+            continue;
+
+        if (_occlusionCulling && !_occlusion.IsVisible(XMLoadFloat4(&sphere), sphere.w))
+            continue;
+
+        XMStoreFloat4x4(&item.World, world);
+        _renderQueue.Submit(item, XMVectorGetX(XMVector3LengthSq(world.r[3] - eyePosition)));
+    }
 }
 
-void Application::Draw()
+void Application::DrawBodyInstances()
 {
-    //set the defualt blend state (no blending) for opaque objects
-    _pImmediateContext->OMSetBlendState(0, 0, 0xffffffff);
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(_pImmediateContext->Map(_pBodyInstanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped)))
+        return;
 
-    //render opaque objects
+    //Written out grouped by sphere level, level n's instances running from firstInstance[n] up to firstInstance[n + 1]
+    UINT firstInstance[MaxBodySphereLevel + 2] = {};
+    for (size_t i = 0; i < _bodyInstanceLevels.size(); i++)
+        firstInstance[_bodyInstanceLevels[i] + 1]++;
 
-    //set buffers to the cube buffers
-    UINT stride = sizeof(SimpleVertex);
-    UINT offset = 0;
-    _pImmediateContext->IASetVertexBuffers(0, 1, &_pVertexBuffer, &stride, &offset);
+    for (UINT level = 1; level <= MaxBodySphereLevel + 1; level++)
+        firstInstance[level] += firstInstance[level - 1];
 
-    _pImmediateContext->IASetIndexBuffer(_pIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+    UINT next[MaxBodySphereLevel + 1];
+    memcpy(next, firstInstance, sizeof(next));
+
+    BodyInstance* instances = (BodyInstance*)mapped.pData;
+    for (size_t i = 0; i < _bodyInstances.size(); i++)
+        instances[next[_bodyInstanceLevels[i]]++] = _bodyInstances[i];
+
+    _pImmediateContext->Unmap(_pBodyInstanceBuffer, 0);
+
+    _context.IASetInputLayout(_pInstancedVertexLayout);
+    _context.VSSetShader(_pInstancedVertexShader, nullptr, 0);
+    _context.PSSetShader(_pInstancedPixelShader, nullptr, 0);
+    _context.PSSetShaderResources(1, 1, &_bodyTextureArray);
+    _context.OMSetBlendState(0, 0, 0xffffffff);
+
+    _bodyInstanceDraws = 0;
+    for (UINT level = 0; level <= MaxBodySphereLevel; level++)
+    {
+        UINT count = firstInstance[level + 1] - firstInstance[level];
+        if (count == 0)
+            continue;
+
+        MeshData sphere = _resources->GetMesh(_bodySphereLevels[level]);
+        ID3D11Buffer* buffers[2] = { sphere.VertexBuffer, _pBodyInstanceBuffer };
+        UINT strides[2] = { sphere.VBStride, sizeof(BodyInstance) };
+        UINT offsets[2] = { sphere.VBOffset, 0 };
+
+        _context.IASetVertexBuffers(0, 2, buffers, strides, offsets);
+        _context.IASetIndexBuffer(sphere.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+
+        _pImmediateContext->DrawIndexedInstanced(sphere.IndexCount, count, 0, 0, firstInstance[level]);
+        _bodyInstanceDraws++;
+    }
+}
+
+void Application::Draw()
+{
+    //Counts for this frame only, the render queue binds whatever the first draw needs
+    _context.ResetStatistics();
 
     //
     // Clear the back buffer
@@ -1206,53 +2323,14 @@ void Application::Draw()
     _pImmediateContext->ClearRenderTargetView(_pRenderTargetView, ClearColor);
     _pImmediateContext->ClearDepthStencilView(_depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-    XMMATRIX world = XMLoadFloat4x4(&_world);
-    XMMATRIX view = XMLoadFloat4x4(&SunCamera->GetViewMatrix());
-    XMMATRIX projection = XMLoadFloat4x4(&SunCamera->GetProjectionMatrix());
+    //only the current camera's matrices are built, the others stay dirty until they are used
+    OrbitalCamera* camera = GetCamera(currentCam);
+    XMMATRIX view = XMLoadFloat4x4(&camera->GetViewMatrix());
+    XMMATRIX projection = XMLoadFloat4x4(&camera->GetProjectionMatrix());
 
-    switch(currentCam)
-    {
-    case 0:
-        view = XMLoadFloat4x4(&SunCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&SunCamera->GetProjectionMatrix());
-        break;
-    case 1:
-        view = XMLoadFloat4x4(&MercuryCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&MercuryCamera->GetProjectionMatrix());
-        break;
-    case 2:
-        view = XMLoadFloat4x4(&VenusCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&VenusCamera->GetProjectionMatrix());
-        break;
-    case 3:
-        view = XMLoadFloat4x4(&EarthCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&EarthCamera->GetProjectionMatrix());
-        break;
-    case 4:
-        view = XMLoadFloat4x4(&MarsCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&MarsCamera->GetProjectionMatrix());
-        break;
-    case 5:
-        view = XMLoadFloat4x4(&JupiterCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&JupiterCamera->GetProjectionMatrix());
-        break;
-    case 6:
-        view = XMLoadFloat4x4(&SaturnCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&SaturnCamera->GetProjectionMatrix());
-        break;
-    case 7:
-        view = XMLoadFloat4x4(&UranusCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&UranusCamera->GetProjectionMatrix());
-        break;
-    case 8:
-        view = XMLoadFloat4x4(&NeptuneCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&NeptuneCamera->GetProjectionMatrix());
-        break;
-    case 9:
-        view = XMLoadFloat4x4(&FreeCamera->GetViewMatrix());
-        projection = XMLoadFloat4x4(&FreeCamera->GetProjectionMatrix());
-        break;
-    }
+    //The simulation thread paces the belt's orbits by how far each asteroid is from this eye
+    BeltViewer viewer = { camera->GetEyePosition(), XMVectorGetY(projection.r[1]) * _WindowHeight * 0.5f, _quality.GetSettings().ExtrapolationPixels };
+    _beltViewer.store(viewer);
 
     //
     // Update variables
@@ -1306,268 +2384,89 @@ void Application::Draw()
         cb.gSpotLights[i].Att = XMFLOAT3(0.5f, 0.01f, 0.0f);
     }
 
-    cb.mWorld = XMMatrixTranspose(world);
     cb.mView = XMMatrixTranspose(view);
     cb.mProjection = XMMatrixTranspose(projection);
     cb.gTime = gTime;
-    cb.DiffuseMtrl = diffuseMaterial;
-    cb.AmbientMtrl = ambientMaterial;
-    cb.SpecularMtrl = specularMaterial;
 
-    switch(currentCam)
-    {
-    case 0:
-        cb.EyePosW = XMFLOAT3(SunCamera->GetPosition()._41, SunCamera->GetPosition()._42, SunCamera->GetPosition()._43);
-        break;
-    case 1:
-        cb.EyePosW = XMFLOAT3(MercuryCamera->GetPosition()._41, MercuryCamera->GetPosition()._42, MercuryCamera->GetPosition()._43);
-        break;
-    case 2:
-        cb.EyePosW = XMFLOAT3(VenusCamera->GetPosition()._41, VenusCamera->GetPosition()._42, VenusCamera->GetPosition()._43);
-        break;
-    case 3:
-        cb.EyePosW = XMFLOAT3(EarthCamera->GetPosition()._41, EarthCamera->GetPosition()._42, EarthCamera->GetPosition()._43);
-        break;
-    case 4:
-        cb.EyePosW = XMFLOAT3(MarsCamera->GetPosition()._41, MarsCamera->GetPosition()._42, MarsCamera->GetPosition()._43);
-        break;
-    case 5:
-        cb.EyePosW = XMFLOAT3(JupiterCamera->GetPosition()._41, JupiterCamera->GetPosition()._42, JupiterCamera->GetPosition()._43);
-        break;
-    case 6:
-        cb.EyePosW = XMFLOAT3(SaturnCamera->GetPosition()._41, SaturnCamera->GetPosition()._42, SaturnCamera->GetPosition()._43);
-        break;
-    case 7:
-        cb.EyePosW = XMFLOAT3(UranusCamera->GetPosition()._41, UranusCamera->GetPosition()._42, UranusCamera->GetPosition()._43);
-        break;
-    case 8:
-        cb.EyePosW = XMFLOAT3(NeptuneCamera->GetPosition()._41, NeptuneCamera->GetPosition()._42, NeptuneCamera->GetPosition()._43);
-        break;
-    case 9:
-        cb.EyePosW = XMFLOAT3(FreeCamera->GetPosition()._41, FreeCamera->GetPosition()._42, FreeCamera->GetPosition()._43);
-        break;
-    }
+    cb.EyePosW = camera->GetEyePosition();
 
     _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
 
     //
     // Renders a triangle
     //
-    _pImmediateContext->VSSetShader(_pVertexShader, nullptr, 0);
-    _pImmediateContext->VSSetConstantBuffers(0, 1, &_pConstantBuffer);
-    _pImmediateContext->PSSetConstantBuffers(0, 1, &_pConstantBuffer);
-    _pImmediateContext->PSSetShader(_pPixelShader, nullptr, 0);
+    _context.VSSetConstantBuffers(0, 1, &_pConstantBuffer);
+    _context.PSSetConstantBuffers(0, 1, &_pConstantBuffer);
+
+    //per draw constants that cannot go in the ring are updated in place in slot 1, so it is bound for them up front
+    _context.VSSetConstantBuffers(1, 1, &_pObjectConstantBuffer);
+    _context.PSSetConstantBuffers(1, 1, &_pObjectConstantBuffer);
 
     //plane
-    //_pImmediateContext->IASetVertexBuffers(0, 1, &_pPlaneVertexBuffer, &stride, &offset);
-    //_pImmediateContext->IASetIndexBuffer(_pPlaneIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-    //_pImmediateContext->PSSetShaderResources(0, 1, &_pPlaneTexture);
+    //_context.IASetVertexBuffers(0, 1, &_pPlaneVertexBuffer, &stride, &offset);
+    //_context.IASetIndexBuffer(_pPlaneIndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+    //SetTexture(_planeTexture);
     //world = XMLoadFloat4x4(&_backPlane);
     //cb.mWorld = XMMatrixTranspose(world);
     //_pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
     //_pImmediateContext->DrawIndexed(96, 0, 0);
 
-    //Mercury
-    _pImmediateContext->IASetVertexBuffers(0, 1, &sphereMesh.VertexBuffer, &sphereMesh.VBStride, &sphereMesh.VBOffset);
-    _pImmediateContext->IASetIndexBuffer(sphereMesh.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pMercuryTexture);
-    world = XMLoadFloat4x4(&_mercury);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Venus Surface
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pVenusSurface);
-    world = XMLoadFloat4x4(&_venus);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Earth
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pEarthTexture);
-    world = XMLoadFloat4x4(&_earth);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Moon
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pMoonTexture);
-    world = XMLoadFloat4x4(&_moon);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Mars
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pMarsTexture);
-    world = XMLoadFloat4x4(&_mars);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Phobos
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pPhobosTexture);
-    world = XMLoadFloat4x4(&_phobos);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Deimos
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pDeimosTexture);
-    world = XMLoadFloat4x4(&_deimos);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Asteroid belt
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pAsteroidTexture);
-    for(int i = 0; i < 10000; i++)
-    {
-        world = XMLoadFloat4x4(&AsteroidArray[i]->GetMatrix());
-        cb.mWorld = XMMatrixTranspose(world);
-        _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-        _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-    }
-
-    //Jupiter
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pJupiterTexture);
-    world = XMLoadFloat4x4(&_jupiter);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Io
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pIoTexture);
-    world = XMLoadFloat4x4(&_io);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Europa
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pEuropaTexture);
-    world = XMLoadFloat4x4(&_europa);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Ganymede
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pGanymedeTexture);
-    world = XMLoadFloat4x4(&_ganymede);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Callisto
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pCallistoTexture);
-    world = XMLoadFloat4x4(&_callisto);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
+    //Everything drawn this frame, sorted so opaque draws sharing a mesh and texture go out together, nearest first,
+    //and the transparent ones after them furthest first. Only state that differs from the draw before is bound
+    _renderQueue.Clear();
+    QueueScene(camera->GetEyePosition(), view, projection);
+    _renderQueue.Sort();
 
-    //Saturn
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pSaturnTexture);
-    world = XMLoadFloat4x4(&_saturn);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
+    //The batched bodies are opaque, so going before everything in the queue keeps them ahead of the transparent items
+    if (!_bodyInstances.empty())
+        DrawBodyInstances();
 
-    //Saturn Inner ring
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pAsteroidTexture);
-    for (int i = 0; i < 750; i++)
+    MeshData mesh = {};
+    _renderQueue.Execute([&](const RenderQueue::DrawItem& item, UINT changes)
     {
-        world = XMLoadFloat4x4(&SaturnInnerRingArray[i]->GetMatrix());
-        cb.mWorld = XMMatrixTranspose(world);
-        _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-        _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-    }
-
-    //Saturn Mid Ring
-    for(int i = 0; i < 1000; i++)
-    {
-        world = XMLoadFloat4x4(&SaturnMidRingArray[i]->GetMatrix());
-        cb.mWorld = XMMatrixTranspose(world);
-        _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-        _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-    }
-
-    //Saturn Outer Ring
-    for(int i = 0; i < 1500; i++)
-    {
-        world = XMLoadFloat4x4(&SaturnOuterRingArray[i]->GetMatrix());
-        cb.mWorld = XMMatrixTranspose(world);
-        _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-        _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-    }
-
-    //Enceladus
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pEnceladusTexture);
-    world = XMLoadFloat4x4(&_enceladus);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //Titan
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pTitanTexture);
-    world = XMLoadFloat4x4(&_titan);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
+        if (changes & RenderQueue::CHANGE_SHADER)
+        {
+            _context.IASetInputLayout(_pVertexLayout);
+            _context.VSSetShader(_pVertexShader, nullptr, 0);
+            _context.PSSetShader(_pPixelShader, nullptr, 0);
+        }
 
-    //Uranus
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pUranusTexture);
-    world = XMLoadFloat4x4(&_uranus);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
+        if (changes & RenderQueue::CHANGE_MESH)
+        {
+            mesh = _resources->GetMesh(item.Mesh);
+            _context.IASetVertexBuffers(0, 1, &mesh.VertexBuffer, &mesh.VBStride, &mesh.VBOffset);
+            _context.IASetIndexBuffer(mesh.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
+        }
 
-    //Titania
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pTitaniaTexture);
-    world = XMLoadFloat4x4(&_titania);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
+        if (changes & RenderQueue::CHANGE_TEXTURE)
+            SetTexture(item.Texture);
 
-    //Oberon
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pOberonTexture);
-    world = XMLoadFloat4x4(&_oberon);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
+        //Transparent items blend by their own factor, the Sun's lets the ambient light pass through
+        if (changes & RenderQueue::CHANGE_BLEND)
+        {
+            if (item.Blend == RenderQueue::BLEND_OPAQUE)
+            {
+                _context.OMSetBlendState(0, 0, 0xffffffff);
+            }
+            else
+            {
+                float blendFactor[] = { item.BlendFactor, item.BlendFactor, item.BlendFactor, 1.0f };
+                _context.OMSetBlendState(Transparency, blendFactor, 0xffffffff);
+            }
+        }
 
-    //Neptune
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pNeptuneTexture);
-    world = XMLoadFloat4x4(&_neptune);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
-
-    //set blend state for transparent objects
-	//blend state
-    //fine tune the blending equation
-    float blendFactor[] = { 0.0f, 0.0f, 0.0f, 1.0f };
-    _pImmediateContext->OMSetBlendState(Transparency, blendFactor, 0xffffffff);
-
-    _pImmediateContext->IASetVertexBuffers(0, 1, &sphereMesh.VertexBuffer, &sphereMesh.VBStride, &sphereMesh.VBOffset);
-    _pImmediateContext->IASetIndexBuffer(sphereMesh.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-
-    //render the sun as transparent so the ambient light can pass through
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pSunTexture);
-    _pImmediateContext->IASetVertexBuffers(0, 1, &sphereMesh.VertexBuffer, &sphereMesh.VBStride, &sphereMesh.VBOffset);
-    _pImmediateContext->IASetIndexBuffer(sphereMesh.IndexBuffer, DXGI_FORMAT_R16_UINT, 0);
-    world = XMLoadFloat4x4(&_sun);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
+        ObjectConstants object;
+        object.mWorld = XMMatrixTranspose(XMLoadFloat4x4(&item.World));
+        object.DiffuseMtrl = item.Surface.Diffuse;
+        object.AmbientMtrl = item.Surface.Ambient;
+        object.SpecularMtrl = item.Surface.Specular;
+        SetObjectConstants(object);
 
-    blendFactor[0] = 0.75f;
-    blendFactor[1] = 0.75f;
-    blendFactor[2] = 0.75f;
+        _pImmediateContext->DrawIndexed(mesh.IndexCount, 0, 0);
+    });
 
-    //Venus Atmosphere
-    _pImmediateContext->PSSetShaderResources(0, 1, &_pVenusAtmos);
-    world = XMLoadFloat4x4(&_venusAtmos);
-    cb.mWorld = XMMatrixTranspose(world);
-    _pImmediateContext->UpdateSubresource(_pConstantBuffer, 0, nullptr, &cb, 0, 0);
-    _pImmediateContext->DrawIndexed(sphereMesh.IndexCount, 0, 0);
+    //Every draw using this frame's constants has gone, so their part of the ring can be reused once the GPU gets past here
+    _objectConstants.EndFrame();
 
     //
     // Present our back buffer to our front buffer
@@ -9,26 +9,49 @@
 #include "DDSTextureLoader.h"
 #include "Structures.h"
 #include "OBJLoader.h"
-#include "SolarObject.h"
-#include "Asteroid.h"
+#include "EntityStore.h"
 #include "OrbitalCamera.h"
+#include "MipGenerator.h"
+#include "SphereGenerator.h"
+#include "MeshSimplifier.h"
+#include "ResourceManager.h"
+#include "TripleBuffer.h"
+#include "SimulationClock.h"
+#include "KeplerOrbits.h"
+#include "NBodySystem.h"
+#include "BeltGenerator.h"
+#include "RigidGroup.h"
+#include "AngleRotors.h"
+#include "Ephemeris.h"
+#include "EphemerisExport.h"
+#include "GravityBenchmark.h"
+#include "CommandLine.h"
+#include "SpatialHashGrid.h"
+#include "SphereBVH.h"
+#include "RenderQueue.h"
+#include "D3D11StateTypes.h"
+#include "TextureArrayBuilder.h"
+#include "D3D11ConstantBufferTypes.h"
+#include "OcclusionBuffer.h"
+#include "QualityGovernor.h"
+#include "UpdateScheduler.h"
 #include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <chrono>
 
+//Constants set once a frame, bound to b0
 struct ConstantBuffer
 {
 	PointLight gPointLight, gPointLight2;
 
 	SpotLight gSpotLights[6];
 
-	XMMATRIX mWorld;
 	XMMATRIX mView;
 	XMMATRIX mProjection;
 
-	XMFLOAT4 DiffuseMtrl;
 	XMFLOAT4 DiffuseLight;
-	XMFLOAT4 AmbientMtrl;
 	XMFLOAT4 AmbientLight;
-	XMFLOAT4 SpecularMtrl;
 	XMFLOAT4 SpecularLight;
 	float SpecularPower;
 	XMFLOAT3 EyePosW; //camera pos in world space
@@ -37,6 +60,108 @@ struct ConstantBuffer
 	float gTime;
 };
 
+//Constants that change with every draw, bound to b1
+struct ObjectConstants
+{
+	XMMATRIX mWorld;
+
+	XMFLOAT4 DiffuseMtrl;
+	XMFLOAT4 AmbientMtrl;
+	XMFLOAT4 SpecularMtrl;
+};
+
+//Most groups of Saturn's ring particles that turn at their own rate, and the particles in all the rings together
+const int MaxRingGroups = 4;
+const int RingParticleCount = 750 + 1000 + 1500;
+
+//Every body drawn, in the order InitOrbits adds them to Application::_ephemeris. Also each one's Entity in Application::_entities
+enum SceneBody
+{
+	BODY_SUN, BODY_MERCURY, BODY_VENUS, BODY_VENUS_ATMOSPHERE, BODY_EARTH, BODY_MOON, BODY_MARS, BODY_PHOBOS, BODY_DEIMOS,
+	BODY_JUPITER, BODY_IO, BODY_EUROPA, BODY_GANYMEDE, BODY_CALLISTO, BODY_SATURN, BODY_ENCELADUS, BODY_TITAN,
+	BODY_URANUS, BODY_TITANIA, BODY_OBERON, BODY_NEPTUNE,
+	BODY_COUNT
+};
+
+//Asteroids in the belt, whose entities follow the bodies' from FirstBeltEntity
+const int BeltAsteroidCount = 10000;
+const Entity FirstBeltEntity = BODY_COUNT;
+const int SceneEntityCount = BODY_COUNT + BeltAsteroidCount;
+
+//Where the belt is being watched from, handed from the render thread to the simulation thread to pace the belt's orbit updates
+struct BeltViewer
+{
+	XMFLOAT3 Eye;
+
+	//Pixels on screen per unit of size at unit distance, zero until a frame has been drawn
+	float PixelScale;
+
+	//Pixels an asteroid may drift from its orbit between solves
+	float TolerancePixels;
+};
+
+//Everything the simulation thread hands over to the render thread for one frame
+struct SimulationSnapshot
+{
+	//Simulation time the transforms are for, and the wall clock time they were handed over. A float runs out of precision for a step within hours
+	double time;
+	double publishedAt;
+
+	//World transform of each entity, the bodies indexed by SceneBody and the belt from FirstBeltEntity
+	XMFLOAT4X4 entities[SceneEntityCount];
+
+	//Where each follow camera sits and what it looks at, indexed the same as currentCam
+	XMFLOAT4X4 cameraPos[9];
+	XMFLOAT4X4 cameraAt[9];
+
+	//Each ring turns as one, so only its group matrix is handed over, indexed the same as Application::_ringGroups.
+	//Any ring particle that could not be grouped has its own world matrix, indexed the same as Application::_looseRingParticles
+	XMFLOAT4X4 ringGroups[MaxRingGroups];
+	XMFLOAT4X4 looseRingParticles[RingParticleCount];
+};
+
+//Index of each orbit in Application::_ephemeris, in the order InitOrbits adds them. Moons are relative to their planet
+enum BodyOrbit
+{
+	ORBIT_MERCURY, ORBIT_VENUS, ORBIT_EARTH, ORBIT_MOON, ORBIT_MARS, ORBIT_PHOBOS, ORBIT_DEIMOS,
+	ORBIT_JUPITER, ORBIT_IO, ORBIT_EUROPA, ORBIT_GANYMEDE, ORBIT_CALLISTO, ORBIT_SATURN, ORBIT_ENCELADUS, ORBIT_TITAN,
+	ORBIT_URANUS, ORBIT_TITANIA, ORBIT_OBERON, ORBIT_NEPTUNE,
+	ORBIT_COUNT
+};
+
+//The belt's orbits follow the bodies' in Application::_orbitPositions
+const UINT FirstBeltOrbit = ORBIT_COUNT;
+
+//What Application::_bodyTextureSlices holds for a texture that is not in the body texture array
+const UINT NoBodySlice = 0xffffffff;
+
+//Finest sphere level a body is drawn at when it fills the screen
+const UINT MaxBodySphereLevel = 4;
+
+//Bodies drawn from a model rather than the sphere, listed in BodyModels
+const int BodyModelCount = 2;
+
+//What a pick ray hit
+enum PickKind
+{
+	PICK_NONE,
+	PICK_BODY,
+	PICK_ASTEROID,
+	PICK_RING_PARTICLE
+};
+
+struct PickResult
+{
+	PickKind Kind;
+
+	//A SceneBody, an asteroid in the belt, or a ring particle counted through Application::_ringGroups in order and then
+	//Application::_looseRingParticles, going by Kind
+	UINT Index;
+
+	//How far along the ray the hit was
+	float Distance;
+};
+
 class Application
 {
 private:
@@ -46,6 +171,9 @@ private:
 	D3D_FEATURE_LEVEL       _featureLevel;
 	ID3D11Device* _pd3dDevice;
 	ID3D11DeviceContext* _pImmediateContext;
+
+	//Every pipeline state bind goes through here so any that would change nothing never reaches the driver
+	D3D11StateFilteringContext _context;
 	IDXGISwapChain* _pSwapChain;
 	ID3D11RenderTargetView* _pRenderTargetView;
 	ID3D11VertexShader* _pVertexShader;
@@ -58,15 +186,25 @@ private:
 	ID3D11Buffer* _pPyramidIndexBuffer;
 	ID3D11Buffer* _pPlaneIndexBuffer;
 	ID3D11Buffer* _pConstantBuffer;
-	XMFLOAT4X4              _world, _sun, _mercury, _venus, _venusAtmos, _earth, _moon, _mars, _phobos, _deimos, _jupiter, _europa, _io, _ganymede, _callisto, _saturn, _enceladus, _titan;
-	XMFLOAT4X4              _uranus, _titania, _oberon, _neptune, _backPlane;
+
+	//Per draw constants are bump allocated from _objectConstants and bound by offset when the device can, which needs the 11.1 context.
+	//Otherwise they go through _pObjectConstantBuffer with an UpdateSubresource each, the buffer being bound to slot 1 through _context once a frame.
+	//The ring's binds go straight to the context and make _context forget slot 1, so a fallback after one binds the buffer again
+	ID3D11DeviceContext1* _pImmediateContext1;
+	D3D11ConstantBufferRing _objectConstants;
+	ID3D11Buffer* _pObjectConstantBuffer;
+	XMFLOAT4X4              _world, _backPlane;
 	XMFLOAT4X4              _view;
 	XMFLOAT4X4              _projection;
 	float                   gTime;
 
 	int currentCam = 0;
+	int previousCam = 0;
 
-	float simulationSpeed = 2.0f;
+	//Seconds a switch between cameras takes to blend across
+	const float cameraTransitionTime = 1.0f;
+
+	float simulationSpeed = DefaultSimulationSpeed;
 
 	ID3D11DepthStencilView* _depthStencilView;
 	ID3D11Texture2D* _depthStencilBuffer;
@@ -89,68 +227,33 @@ private:
 	//textures
 	ID3D11ShaderResourceView* _pTextureRV = nullptr;
 
-	//Asteroid Texture
-	ID3D11ShaderResourceView* _pAsteroidTexture = nullptr;
-
-	//Planet and moon textures
-	ID3D11ShaderResourceView* _pSunTexture = nullptr;
-
-	ID3D11ShaderResourceView* _pMercuryTexture = nullptr;
-
-	ID3D11ShaderResourceView* _pVenusSurface = nullptr;
-	ID3D11ShaderResourceView* _pVenusAtmos = nullptr;
-
-	ID3D11ShaderResourceView* _pEarthTexture = nullptr;
-	ID3D11ShaderResourceView* _pMoonTexture = nullptr;
-
-	ID3D11ShaderResourceView* _pMarsTexture = nullptr;
-	ID3D11ShaderResourceView* _pPhobosTexture = nullptr;
-	ID3D11ShaderResourceView* _pDeimosTexture = nullptr;
-
-	ID3D11ShaderResourceView* _pJupiterTexture = nullptr;
-	ID3D11ShaderResourceView* _pEuropaTexture = nullptr;
-	ID3D11ShaderResourceView* _pIoTexture = nullptr;
-	ID3D11ShaderResourceView* _pGanymedeTexture = nullptr;
-	ID3D11ShaderResourceView* _pCallistoTexture = nullptr;
-
-	ID3D11ShaderResourceView* _pSaturnTexture = nullptr;
-	ID3D11ShaderResourceView* _pEnceladusTexture = nullptr;
-	ID3D11ShaderResourceView* _pTitanTexture = nullptr;
+	//Owns every texture and mesh, entities only hold handles into it
+	ResourceManager* _resources = nullptr;
 
-	ID3D11ShaderResourceView* _pUranusTexture = nullptr;
-	ID3D11ShaderResourceView* _pTitaniaTexture = nullptr;
-	ID3D11ShaderResourceView* _pOberonTexture = nullptr;
-
-	ID3D11ShaderResourceView* _pNeptuneTexture = nullptr;
-
-	ID3D11ShaderResourceView* _pPlaneTexture = nullptr;
+	//Meshes and textures that are not tied to one body, each holding one reference that Cleanup releases
+	MeshHandle _cubeMeshHandle = {};
+	MeshHandle _asteroidMeshHandle = {};
+	TextureHandle _asteroidTexture = {};
+	TextureHandle _planeTexture = {};
 
 	ID3D11SamplerState* _pSamplerLinear = nullptr;
 
 	//mesh
 	MeshData cubeMesh;
 	MeshData sphereMesh;
+	MeshData asteroidMesh;
 	MeshData rocketMesh;
 
 	//Cameras orbiting the planets
 	OrbitalCamera* SunCamera;
-	XMFLOAT4X4 _sunCameraPos;
 	OrbitalCamera* MercuryCamera;
-	XMFLOAT4X4 _MercuryCameraPos;
 	OrbitalCamera* VenusCamera;
-	XMFLOAT4X4 _VenusCameraPos;
 	OrbitalCamera* EarthCamera;
-	XMFLOAT4X4 _EarthCameraPos;
 	OrbitalCamera* MarsCamera;
-	XMFLOAT4X4 _MarsCameraPos;
 	OrbitalCamera* JupiterCamera;
-	XMFLOAT4X4 _JupiterCameraPos;
 	OrbitalCamera* SaturnCamera;
-	XMFLOAT4X4 _SaturnCameraPos;
 	OrbitalCamera* UranusCamera;
-	XMFLOAT4X4 _UranusCameraPos;
 	OrbitalCamera* NeptuneCamera;
-	XMFLOAT4X4 _NeptuneCameraPos;
 
 	OrbitalCamera* FreeCamera;
 	XMFLOAT4X4 _FreeCameraPos;
@@ -158,62 +261,210 @@ private:
 
 	ID3D11BlendState* Transparency;
 
-	//Array to store all asteroid objects
-	Asteroid* AsteroidArray[10000];
+	//Body, asteroid and camera transforms passed from the simulation thread to the render thread
+	TripleBuffer<SimulationSnapshot> _snapshots;
+
+	//Monotonic clock both threads read, and the fixed step clock the simulation runs on
+	HighResolutionClock _wallClock;
+	SimulationClock _simulationClock;
+
+	//How far the frame being drawn is from the previous snapshot to the newest one, 0 to 1
+	float _interpolation;
+
+	//Runs Simulate in a loop until Cleanup stops it
+	std::thread _simulationThread;
+	std::atomic<bool> _simulationRunning;
+
+	//Seed the belt and rings are generated from, one from the clock for a different scene each run unless SetGenerationSeed is called before Initialise
+	unsigned long long _generationSeed;
+
+	//Orbits and placement of the planets and moons, which can be evaluated at any time from any thread once InitOrbits has filled it
+	Ephemeris _ephemeris;
+
+	//Where each orbit was at the last simulated step, the bodies' then the belt's from FirstBeltOrbit, and the asteroid belt's Kepler orbits.
+	//Only the simulation thread touches these
+	XMFLOAT3 _orbitPositions[ORBIT_COUNT + BeltAsteroidCount];
+	KeplerOrbits _beltOrbits;
+
+	//The belt's orbits are solved four at a time, each group as often as _beltSchedule says and carried on along its velocity in between,
+	//from where and when it was last solved. Only the simulation thread touches these, the render thread hands the view over through
+	//_beltViewer and reads back how many orbits the last step solved
+	UpdateScheduler _beltSchedule;
+	std::vector<XMFLOAT3> _beltSolvedPositions;
+	std::vector<XMFLOAT3> _beltVelocities;
+	std::vector<double> _beltSolveTimes;
+	std::atomic<BeltViewer> _beltViewer;
+	std::atomic<unsigned int> _beltOrbitsSolved;
+
+	//Optional Barnes-Hut gravity for the belt, with the Sun and planets as the massive bodies. G asks for it on the render thread and I picks the integrator,
+	//the simulation thread switches over at its next step and reports back how far the energy has drifted and how many substeps it took
+	NBodySystem _beltGravity;
+	bool _beltGravityActive;
+	float _beltGravitySun;
+	double _lastSimulatedTime;
+	std::atomic<bool> _beltGravityRequested;
+	std::atomic<int> _beltIntegratorRequested;
+	std::atomic<float> _beltEnergyDrift;
+	std::atomic<unsigned int> _beltSubsteps;
+
+	//The belt sorted into a grid each step it is under gravity and every pair of asteroids close enough to touch, for collisions to act on.
+	//Only the simulation thread touches the grid and pairs, how many pairs there were is passed back for the title bar
+	SpatialHashGrid _beltGrid;
+	std::vector<SpatialHashGrid::ParticlePair> _beltCloseApproaches;
+	std::atomic<unsigned int> _beltCloseApproachCount;
+
+	//Every draw of the frame, sorted by state before it goes out, and whether B has asked for its bind counts in the title bar.
+	//Only the render thread touches these
+	RenderQueue _renderQueue;
+	bool _showRenderStatistics;
+
+	//Opaque planets and moons drawn in one instanced draw, their textures packed into _bodyTextureArray, while T has it on.
+	//_bodyTextureSlices is each texture's slice by TextureHandle::Index, NoBodySlice for any not in the array. Built by InitBodyBatch,
+	//after that only the render thread touches these, and QueueScene fills _bodyInstances each frame with what it took out of _renderQueue
+	ID3D11VertexShader* _pInstancedVertexShader;
+	ID3D11PixelShader* _pInstancedPixelShader;
+	ID3D11InputLayout* _pInstancedVertexLayout;
+	ID3D11Buffer* _pBodyInstanceBuffer;
+	ID3D11ShaderResourceView* _bodyTextureArray;
+	std::vector<UINT> _bodyTextureSlices;
+	std::vector<BodyInstance> _bodyInstances;
+	MeshHandle _sphereMeshHandle = {};
+	bool _batchBodies;
+
+	//Each body is drawn at the sphere level its size on screen calls for, _bodyInstanceLevels holding the level of each of _bodyInstances
+	//and _bodyInstanceDraws how many draws DrawBodyInstances took for them last frame
+	MeshHandle _bodySphereLevels[MaxBodySphereLevel + 1] = {};
+
+	//The models of the bodies in BodyModels, each reduced to a few levels picked from the same way. A model that failed to load has no levels
+	//and its body keeps the sphere
+	MeshSimplifier::LODChain _bodyModels[BodyModelCount] = {};
+	std::vector<UINT> _bodyInstanceLevels;
+	UINT _bodyInstanceDraws;
+
+	//Moves the asteroid fraction, body LOD bias and asteroid detail size to keep frame time on target while Q has it on,
+	//timed from the start of one Update to the next. Only the render thread touches these
+	QualityGovernor _quality;
+	bool _adaptiveQuality;
+	double _lastFrameStart;
+
+	//The opaque planets and moons drawn small on the CPU each frame so whatever is behind them can be left out of the frame, while O has it on.
+	//_queuedWorlds holds each entity's blended world matrix between QueueScene's two passes. Only the render thread touches these
+	OcclusionBuffer _occlusion;
+	std::vector<XMFLOAT4X4> _queuedWorlds;
+	bool _occlusionCulling;
+
+	//Ring particles grouped by the rate they turn at, built once the rings are generated and only read after that.
+	//Those that do not turn with their ring, or whose rate found no room for a group, are kept loose and moved one at a time
+	std::vector<RigidGroup> _ringGroups;
+	std::vector<BeltGenerator::BeltParticle> _looseRingParticles;
+
+	//Bounding spheres of everything that can be picked in the previous and newest snapshots, bodies then asteroids then ring particles,
+	//and a tree over spheres round each one's whole path between the two. Built on the render thread by the first pick after a snapshot
+	//arrives and shared by every pick until the next one, each blending the two sets to test against what was drawn
+	std::vector<XMFLOAT4> _pickFrom;
+	std::vector<XMFLOAT4> _pickTo;
+	std::vector<XMFLOAT4> _pickSpheres;
+	SphereBVH _pickTree;
+	bool _pickTreeStale;
+
+	//Every body and asteroid, created by InitEntities and fixed from then on. The simulation thread only writes their Transform
+	//and the render thread only reads their Renderable and Material, so the two never touch the same component
+	EntityStore _entities;
+
+	//Every spin angle in the scene, each entity's at its Spin::Rotor, then the ring groups' from _ringSpinRotors,
+	//then two for each loose ring particle from _looseRingRotors, its spin against its orbit and its orbit
+	AngleRotors _spinRotors;
+	size_t _ringSpinRotors;
+	size_t _looseRingRotors;
+private:
+	HRESULT InitWindow(HINSTANCE hInstance, int nCmdShow);
+	HRESULT InitDevice();
+	void Cleanup();
+	HRESULT CompileShaderFromFile(WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut);
+	HRESULT InitShadersAndInputLayout();
+	HRESULT InitVertexBuffer();
+	HRESULT InitIndexBuffer();
+
+	//Loads the models in BodyModels, then creates an entity for each body in SceneBody order and one for each asteroid in the belt
+	void InitEntities(MeshHandle sphere, MeshHandle asteroid, const BeltGenerator::BeltParticle* belt);
 
-	//Arrays for each of Saturn's rings
-	Asteroid* SaturnInnerRingArray[750];
-	Asteroid* SaturnMidRingArray[1000];
-	Asteroid* SaturnOuterRingArray[1500];
-	
-	//solar objects
-	SolarObject* sun;
+	//Packs the textures of every opaque body drawn with the sphere mesh into _bodyTextureArray and creates what the instanced draw of them needs.
+	//If any of it fails the bodies are drawn one at a time as before
+	HRESULT InitBodyBatch(MeshHandle sphere);
 
-	SolarObject* mercury;
+	//The entry in _bodyModels drawn with a mesh, if it is any of their levels 0
+	const MeshSimplifier::LODChain* FindBodyModel(MeshHandle mesh) const;
 
-	SolarObject* venus;
-	SolarObject* venusAtmos;
+	//Draws every body in _bodyInstances with one call per sphere level in use, ahead of the render queue
+	void DrawBodyInstances();
 
-	SolarObject* earth;
-	SolarObject* moon;
+	//Fills _ephemeris with the planets and moons, and _spinRotors with everything that spins
+	void InitOrbits();
 
-	SolarObject* mars;
-	SolarObject* phobos;
-	SolarObject* deimos;
+	//Simulation thread body, and the per frame work it does. Only the asteroids and the snapshot are touched here
+	void SimulationLoop();
+	void Simulate(SimulationSnapshot& snapshot, double t);
 
-	SolarObject* jupiter;
-	SolarObject* europa;
-	SolarObject* io;
-	SolarObject* ganymede;
-	SolarObject* callisto;
+	//Moves the belt one step under gravity, starting it from the Kepler orbits if it has just been switched on
+	void SimulateBeltGravity(double t);
 
-	SolarObject* saturn;
-	SolarObject* enceladus;
-	SolarObject* titan;
+	//Moves the belt one step along its Kepler orbits, solving only the groups _beltSchedule has due and extrapolating the rest
+	void SimulateBeltOrbits(double t);
 
-	SolarObject* uranus;
-	SolarObject* titania;
-	SolarObject* oberon;
+	//Fills the pick spheres from the snapshots and builds _pickTree over them
+	void BuildPickTree();
 
-	SolarObject* neptune;
-private:
-	HRESULT InitWindow(HINSTANCE hInstance, int nCmdShow);
-	HRESULT InitDevice();
-	void Cleanup();
-	HRESULT CompileShaderFromFile(WCHAR* szFileName, LPCSTR szEntryPoint, LPCSTR szShaderModel, ID3DBlob** ppBlobOut);
-	HRESULT InitShadersAndInputLayout();
-	HRESULT InitVertexBuffer();
-	HRESULT InitIndexBuffer();
+	//Blends a transform from the previous snapshot towards the newest by _interpolation
+	XMMATRIX InterpolateTransform(const XMFLOAT4X4& previous, const XMFLOAT4X4& current);
+
+	//Returns the camera for a number key, 9 being the free camera
+	OrbitalCamera* GetCamera(int index);
+
+	//Uploads and binds the constants for the next draw
+	void SetObjectConstants(const ObjectConstants& constants);
+
+	//Binds a texture from the resource manager to the first pixel shader slot
+	void SetTexture(TextureHandle texture);
+
+	//Adds everything to draw this frame to _renderQueue, each at its distance from the eye, apart from the bodies batched into _bodyInstances
+	//and anything _occlusion finds hidden behind the opaque bodies as seen through view and projection
+	void QueueScene(const XMFLOAT3& eye, CXMMATRIX view, CXMMATRIX projection);
 
 	UINT _WindowHeight;
 	UINT _WindowWidth;
 
 public:
+	//Orbit time per unit of simulation time, unless changed
+	static constexpr float DefaultSimulationSpeed = 2.0f;
+
+	//Simulation time each fixed step moves on by
+	static constexpr double SimulationStepLength = 1.0 / 60.0;
+
 	Application();
 	~Application();
 
 	HRESULT Initialise(HINSTANCE hInstance, int nCmdShow);
 
+	//Seed the belt and rings are generated from, which only takes effect before Initialise
+	void SetGenerationSeed(unsigned long long seed) { _generationSeed = seed; }
+	unsigned long long GetGenerationSeed() const { return _generationSeed; }
+
 	void Update();
 	void Draw();
+
+	//Every body at any simulation time without stepping there, for scrubbing, time warps or analysis. Safe from any thread after Initialise
+	SimulationState Evaluate(double t) const { return _ephemeris.Evaluate(t); }
+	const Ephemeris& GetEphemeris() const { return _ephemeris; }
+
+	//Nearest body, asteroid or ring particle along a ray through the scene as it was last drawn, direction being unit length. Render thread only
+	PickResult Pick(const XMFLOAT3& origin, const XMFLOAT3& direction);
+
+	//The same for a point in the window, in pixels from its top left, seen through the camera in use
+	PickResult PickScreen(float x, float y);
+
+	//Runs a command line ephemeris export, building the planets, moons and optionally the belt without a window or device
+	static HRESULT ExportEphemeris(const EphemerisExport::Settings& settings, std::wstring& error);
+
+	//Runs a command line benchmark of the belt's gravity mode, on a belt of the size asked for, without a window or device
+	static GravityBenchmark::Result BenchmarkGravity(const GravityBenchmark::Settings& settings);
 };
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include "BarnesHutTree.h"
+#include "ParallelFor.h"
+#include <algorithm>
+#include <math.h>
+
+//Bits per axis in a Morton key, and so the deepest the tree can go
+static const UINT MaxDepth = 21;
+
+BarnesHutTree::BarnesHutTree()
+{
+	m_ParticleMass = 0.0f;
+	m_RootSize = 0.0f;
+}
+
+void BarnesHutTree::Build(const float* x, const float* y, const float* z, size_t count, float particleMass)
+{
+	m_ParticleMass = particleMass;
+	m_Keys.resize(count);
+	m_SortedPositions.resize(count);
+	m_Nodes.clear();
+
+	if (count == 0)
+		return;
+
+	//Bounding cube, grown slightly so nothing lands exactly on the far faces
+	XMFLOAT3 minimum = XMFLOAT3(x[0], y[0], z[0]);
+	XMFLOAT3 maximum = minimum;
+
+	for (size_t i = 1; i < count; i++)
+	{
+		minimum.x = fminf(minimum.x, x[i]);
+		minimum.y = fminf(minimum.y, y[i]);
+		minimum.z = fminf(minimum.z, z[i]);
+		maximum.x = fmaxf(maximum.x, x[i]);
+		maximum.y = fmaxf(maximum.y, y[i]);
+		maximum.z = fmaxf(maximum.z, z[i]);
+	}
+
+	m_RootSize = fmaxf(maximum.x - minimum.x, fmaxf(maximum.y - minimum.y, maximum.z - minimum.z)) * 1.001f + 1.0e-6f;
+
+	//Morton key for each particle
+	const float cells = (float)(1u << MaxDepth);
+	const float scale = cells / m_RootSize;
+
+	ParallelFor(count, 4096, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			uint64_t cellX = (uint64_t)fminf((x[i] - minimum.x) * scale, cells - 1.0f);
+			uint64_t cellY = (uint64_t)fminf((y[i] - minimum.y) * scale, cells - 1.0f);
+			uint64_t cellZ = (uint64_t)fminf((z[i] - minimum.z) * scale, cells - 1.0f);
+
+			m_Keys[i].Code = (SpreadBits(cellX) << 2) | (SpreadBits(cellY) << 1) | SpreadBits(cellZ);
+			m_Keys[i].Index = (UINT)i;
+		}
+	});
+
+	SortKeys();
+
+	ParallelFor(count, 4096, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			UINT index = m_Keys[i].Index;
+			m_SortedPositions[i] = XMFLOAT3(x[index], y[index], z[index]);
+		}
+	});
+
+	//Build the top of the tree here, stopping at ParallelDepth, then each subtree below that on its own thread into its own list
+	std::vector<Task> tasks;
+	m_Nodes.resize(1);
+	BuildNode(m_Nodes, 0, 0, (UINT)count, 0, &tasks);
+
+	UINT topCount = (UINT)m_Nodes.size();
+
+	std::vector<std::vector<Node>> subtrees(tasks.size());
+
+	ParallelFor(tasks.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			subtrees[i].resize(1);
+			BuildNode(subtrees[i], 0, tasks[i].Begin, tasks[i].End, tasks[i].Depth, nullptr);
+		}
+	});
+
+	//Splice each subtree in, its root replacing the placeholder and the rest appended with their child indices moved along
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		const std::vector<Node>& subtree = subtrees[i];
+		UINT offset = (UINT)m_Nodes.size() - 1;
+
+		Node root = subtree[0];
+		if (root.ChildCount > 0)
+			root.FirstChild += offset;
+		m_Nodes[tasks[i].Node] = root;
+
+		for (size_t j = 1; j < subtree.size(); j++)
+		{
+			Node node = subtree[j];
+			if (node.ChildCount > 0)
+				node.FirstChild += offset;
+			m_Nodes.push_back(node);
+		}
+	}
+
+	//The top nodes were summarised before their subtrees existed. Children always come after their parent, so going backwards finishes them in order
+	for (UINT i = topCount; i-- > 0;)
+	{
+		if (m_Nodes[i].ChildCount > 0)
+			Summarise(m_Nodes[i], m_Nodes);
+	}
+}
+
+void BarnesHutTree::Evaluate(UINT sortedIndex, float openingAngle, float softening, XMFLOAT3& acceleration, float& potential) const
+{
+	acceleration = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	potential = 0.0f;
+
+	if (m_Nodes.empty())
+		return;
+
+	const XMFLOAT3 position = m_SortedPositions[sortedIndex];
+	const float softeningSq = softening * softening;
+	const float openingAngleSq = openingAngle * openingAngle;
+
+	//At most seven siblings are left waiting per level on the way down
+	UINT stack[8 * (MaxDepth + 1)];
+	int top = 0;
+	stack[top++] = 0;
+
+	while (top > 0)
+	{
+		const Node& node = m_Nodes[stack[--top]];
+
+		float dx = node.CenterOfMass.x - position.x;
+		float dy = node.CenterOfMass.y - position.y;
+		float dz = node.CenterOfMass.z - position.z;
+		float distanceSq = dx * dx + dy * dy + dz * dz;
+
+		bool containsSelf = sortedIndex >= node.Begin && sortedIndex < node.Begin + node.Count;
+
+		//Far enough away to treat the whole node as one mass
+		if (!containsSelf && node.Size * node.Size < openingAngleSq * distanceSq)
+		{
+			float inverse = 1.0f / sqrtf(distanceSq + softeningSq);
+			float strength = node.Mass * inverse * inverse * inverse;
+
+			acceleration.x += dx * strength;
+			acceleration.y += dy * strength;
+			acceleration.z += dz * strength;
+			potential -= node.Mass * inverse;
+		}
+		else if (node.ChildCount == 0)
+		{
+			for (UINT i = node.Begin; i < node.Begin + node.Count; i++)
+			{
+				if (i == sortedIndex)
+					continue;
+
+				float px = m_SortedPositions[i].x - position.x;
+				float py = m_SortedPositions[i].y - position.y;
+				float pz = m_SortedPositions[i].z - position.z;
+
+				float inverse = 1.0f / sqrtf(px * px + py * py + pz * pz + softeningSq);
+				float strength = m_ParticleMass * inverse * inverse * inverse;
+
+				acceleration.x += px * strength;
+				acceleration.y += py * strength;
+				acceleration.z += pz * strength;
+				potential -= m_ParticleMass * inverse;
+			}
+		}
+		else
+		{
+			for (UINT i = 0; i < node.ChildCount; i++)
+				stack[top++] = node.FirstChild + i;
+		}
+	}
+}
+
+void BarnesHutTree::SortKeys()
+{
+	//Sort one run per thread, then merge pairs of runs, also in parallel, until a single run is left
+	size_t count = m_Keys.size();
+	size_t threads = GetParallelThreadCount();
+	size_t run = (count + threads - 1) / threads;
+	if (run < 4096)
+		run = 4096;
+
+	size_t runs = (count + run - 1) / run;
+
+	ParallelFor(runs, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			std::sort(m_Keys.begin() + i * run, m_Keys.begin() + ((i + 1) * run < count ? (i + 1) * run : count));
+	});
+
+	m_SortScratch.resize(count);
+	std::vector<Key>* source = &m_Keys;
+	std::vector<Key>* destination = &m_SortScratch;
+
+	for (size_t width = run; width < count; width *= 2)
+	{
+		size_t pairs = (count + 2 * width - 1) / (2 * width);
+
+		ParallelFor(pairs, 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				size_t low = i * 2 * width;
+				size_t middle = low + width < count ? low + width : count;
+				size_t high = low + 2 * width < count ? low + 2 * width : count;
+
+				std::merge(source->begin() + low, source->begin() + middle, source->begin() + middle, source->begin() + high, destination->begin() + low);
+			}
+		});
+
+		std::swap(source, destination);
+	}
+
+	if (source != &m_Keys)
+		m_Keys.swap(m_SortScratch);
+}
+
+void BarnesHutTree::BuildNode(std::vector<Node>& nodes, UINT nodeIndex, UINT begin, UINT end, UINT depth, std::vector<Task>* tasks)
+{
+	Node node;
+	node.Size = m_RootSize / (float)(1u << depth);
+	node.FirstChild = 0;
+	node.ChildCount = 0;
+	node.Begin = begin;
+	node.Count = end - begin;
+
+	if (node.Count <= LeafSize || depth == MaxDepth)
+	{
+		Summarise(node, nodes);
+		nodes[nodeIndex] = node;
+		return;
+	}
+
+	//Leave this subtree for a worker thread
+	if (tasks != nullptr && depth == ParallelDepth)
+	{
+		nodes[nodeIndex] = node;
+
+		Task task = { nodeIndex, begin, end, depth };
+		tasks->push_back(task);
+		return;
+	}
+
+	//Keys in the node share everything above this level, so the next three bits split the run into octants in order
+	UINT shift = 3 * (MaxDepth - 1 - depth);
+	UINT bounds[9];
+	bounds[0] = begin;
+	bounds[8] = end;
+
+	for (UINT octant = 1; octant < 8; octant++)
+		bounds[octant] = FindOctant(bounds[octant - 1], end, shift, octant);
+
+	for (UINT octant = 0; octant < 8; octant++)
+	{
+		if (bounds[octant + 1] > bounds[octant])
+			node.ChildCount++;
+	}
+
+	node.FirstChild = (UINT)nodes.size();
+	nodes.resize(nodes.size() + node.ChildCount);
+
+	UINT child = node.FirstChild;
+	for (UINT octant = 0; octant < 8; octant++)
+	{
+		if (bounds[octant + 1] > bounds[octant])
+			BuildNode(nodes, child++, bounds[octant], bounds[octant + 1], depth + 1, tasks);
+	}
+
+	Summarise(node, nodes);
+	nodes[nodeIndex] = node;
+}
+
+void BarnesHutTree::Summarise(Node& node, const std::vector<Node>& nodes) const
+{
+	float x = 0.0f, y = 0.0f, z = 0.0f;
+	float mass = 0.0f;
+
+	if (node.ChildCount == 0)
+	{
+		for (UINT i = node.Begin; i < node.Begin + node.Count; i++)
+		{
+			x += m_SortedPositions[i].x;
+			y += m_SortedPositions[i].y;
+			z += m_SortedPositions[i].z;
+		}
+
+		mass = m_ParticleMass * node.Count;
+		x *= m_ParticleMass;
+		y *= m_ParticleMass;
+		z *= m_ParticleMass;
+	}
+	else
+	{
+		for (UINT i = node.FirstChild; i < node.FirstChild + node.ChildCount; i++)
+		{
+			const Node& child = nodes[i];
+
+			x += child.CenterOfMass.x * child.Mass;
+			y += child.CenterOfMass.y * child.Mass;
+			z += child.CenterOfMass.z * child.Mass;
+			mass += child.Mass;
+		}
+	}
+
+	node.Mass = mass;
+	node.CenterOfMass = mass > 0.0f ? XMFLOAT3(x / mass, y / mass, z / mass) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+}
+
+UINT BarnesHutTree::FindOctant(UINT begin, UINT end, UINT shift, UINT octant) const
+{
+	//First key in the run at or past the octant
+	while (begin < end)
+	{
+		UINT middle = begin + (end - begin) / 2;
+
+		if (((m_Keys[middle].Code >> shift) & 7) < octant)
+			begin = middle + 1;
+		else
+			end = middle;
+	}
+
+	return begin;
+}
+
+uint64_t BarnesHutTree::SpreadBits(uint64_t value)
+{
+	//Puts two zero bits between each of the low 21 bits, so three axes can be interleaved
+	value &= 0x1fffff;
+	value = (value | value << 32) & 0x1f00000000ffffull;
+	value = (value | value << 16) & 0x1f0000ff0000ffull;
+	value = (value | value << 8) & 0x100f00f00f00f00full;
+	value = (value | value << 4) & 0x10c30c30c30c30c3ull;
+	value = (value | value << 2) & 0x1249249249249249ull;
+	return value;
+}
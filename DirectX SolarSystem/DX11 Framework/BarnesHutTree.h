@@ -0,0 +1,94 @@
+#pragma once
+#ifndef BARNESHUTTREE
+#define BARNESHUTTREE
+
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+#include <stdint.h>
+
+using namespace DirectX;
+
+//Octree over a set of equal mass particles for Barnes-Hut gravity.
+//Particles are sorted along a Morton curve so every node owns a contiguous run of them, which lets the tree be built
+//from the sorted keys alone and split into independent subtrees that are built on separate threads
+class BarnesHutTree
+{
+public:
+	struct Node
+	{
+		XMFLOAT3 CenterOfMass;
+		float Mass;
+
+		//Edge length of the node's cube
+		float Size;
+
+		//Children are stored next to each other, ChildCount is zero for a leaf
+		UINT FirstChild;
+		UINT ChildCount;
+
+		//Run of sorted particles inside the node
+		UINT Begin;
+		UINT Count;
+	};
+
+	static const UINT LeafSize = 8;
+
+private:
+	//Sort key and original index of each particle
+	struct Key
+	{
+		uint64_t Code;
+		UINT Index;
+
+		//Ties go by index so the order never depends on how the sort was split between threads
+		bool operator<(const Key& other) const { return Code < other.Code || (Code == other.Code && Index < other.Index); }
+	};
+
+	//Subtree left for a worker thread, rooted at a node already in m_Nodes
+	struct Task
+	{
+		UINT Node;
+		UINT Begin;
+		UINT End;
+		UINT Depth;
+	};
+
+	std::vector<Key> m_Keys;
+	std::vector<Key> m_SortScratch;
+	std::vector<XMFLOAT3> m_SortedPositions;
+	std::vector<Node> m_Nodes;
+
+	float m_ParticleMass;
+	float m_RootSize;
+
+	//Helper methods for the above method(s)
+	void SortKeys();
+	void BuildNode(std::vector<Node>& nodes, UINT nodeIndex, UINT begin, UINT end, UINT depth, std::vector<Task>* tasks);
+	void Summarise(Node& node, const std::vector<Node>& nodes) const;
+	UINT FindOctant(UINT begin, UINT end, UINT shift, UINT octant) const;
+
+	static uint64_t SpreadBits(uint64_t value);
+
+public:
+	//Depth at which the build hands subtrees to worker threads, 8^2 = 64 subtrees
+	static const UINT ParallelDepth = 2;
+
+	//Constructor
+	BarnesHutTree();
+
+	//Rebuilds the tree over the given positions, one array per axis, each particle having the same mass
+	void Build(const float* x, const float* y, const float* z, size_t count, float particleMass);
+
+	//Gravitational acceleration and potential at a sorted particle from all the others, opening nodes larger than openingAngle times their distance.
+	//Masses are gravitational parameters (G times mass) so no G is applied
+	void Evaluate(UINT sortedIndex, float openingAngle, float softening, XMFLOAT3& acceleration, float& potential) const;
+
+	//Original index of the particle at a position in sorted order
+	UINT GetParticleIndex(UINT sortedIndex) const { return m_Keys[sortedIndex].Index; }
+
+	size_t GetCount() const { return m_Keys.size(); }
+	const std::vector<Node>& GetNodes() const { return m_Nodes; }
+};
+
+#endif
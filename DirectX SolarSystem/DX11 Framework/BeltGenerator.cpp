@@ -0,0 +1,47 @@
+#include "BeltGenerator.h"
+#include "CounterRandom.h"
+#include "ParallelFor.h"
+#include <math.h>
+
+void BeltGenerator::Generate(const BeltDescription& description, uint64_t seed, uint32_t stream, BeltParticle* outParticles, size_t count)
+{
+	ParallelFor(count, 8192, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			uint64_t counter = i * ValuesPerParticle;
+			BeltParticle& particle = outParticles[i];
+
+			float radius = AnnulusRadius(description.InnerRadius, description.OuterRadius, CounterRandom::Uniform(seed, stream, counter++));
+			float angle = CounterRandom::Uniform(seed, stream, counter++, 0.0f, XM_2PI);
+
+			float sinAngle, cosAngle;
+			XMScalarSinCos(&sinAngle, &cosAngle, angle);
+
+			particle.Position.x = radius * cosAngle;
+			particle.Position.y = CounterRandom::Uniform(seed, stream, counter++, description.MinHeight, description.MaxHeight);
+			particle.Position.z = radius * sinAngle;
+
+			particle.Scale.x = CounterRandom::Uniform(seed, stream, counter++, description.MinScale, description.MaxScale);
+			particle.Scale.y = CounterRandom::Uniform(seed, stream, counter++, description.MinScale, description.MaxScale);
+			particle.Scale.z = CounterRandom::Uniform(seed, stream, counter++, description.MinScale, description.MaxScale);
+
+			particle.Spin = CounterRandom::Uniform(seed, stream, counter++, description.MinSpin, description.MaxSpin);
+			particle.OrbitRate = 1.0f / CounterRandom::Uniform(seed, stream, counter++, description.MinOrbitPeriod, description.MaxOrbitPeriod);
+
+			particle.Eccentricity = CounterRandom::Uniform(seed, stream, counter++, 0.0f, description.MaxEccentricity);
+			particle.Inclination = CounterRandom::Uniform(seed, stream, counter++, 0.0f, description.MaxInclination);
+			particle.LongitudeOfNode = CounterRandom::Uniform(seed, stream, counter++, 0.0f, XM_2PI);
+			particle.ArgumentOfPeriapsis = CounterRandom::Uniform(seed, stream, counter++, 0.0f, XM_2PI);
+		}
+	});
+}
+
+float BeltGenerator::AnnulusRadius(float innerRadius, float outerRadius, float u)
+{
+	//Area inside radius r grows with r^2, so spread u over the squared radii and take the root
+	float innerSq = innerRadius * innerRadius;
+	float outerSq = outerRadius * outerRadius;
+
+	return sqrtf(innerSq + u * (outerSq - innerSq));
+}
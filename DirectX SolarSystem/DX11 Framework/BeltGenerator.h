@@ -0,0 +1,54 @@
+#pragma once
+#ifndef BELTGENERATOR
+#define BELTGENERATOR
+
+#include <directxmath.h>
+#include <stdint.h>
+
+using namespace DirectX;
+
+namespace BeltGenerator
+{
+	//Ranges a belt or ring's particles are drawn from. Anything with the same minimum and maximum comes out fixed
+	struct BeltDescription
+	{
+		//Annulus in the XZ plane the particles are spread evenly over, and the band of heights above it
+		float InnerRadius, OuterRadius;
+		float MinHeight, MaxHeight;
+
+		float MinScale, MaxScale;
+		float MinSpin, MaxSpin;
+
+		//Orbit period, each particle's orbit rate being one over it
+		float MinOrbitPeriod, MaxOrbitPeriod;
+
+		//Upper limits on the shape of each particle's Kepler orbit, the node and periapsis are always anywhere round the circle
+		float MaxEccentricity;
+		float MaxInclination;
+	};
+
+	//One generated particle. Angles are in radians
+	struct BeltParticle
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Scale;
+		float Spin;
+		float OrbitRate;
+		float Eccentricity;
+		float Inclination;
+		float LongitudeOfNode;
+		float ArgumentOfPeriapsis;
+	};
+
+	//Random values each particle draws, particle i using counters i * ValuesPerParticle onwards
+	const uint64_t ValuesPerParticle = 12;
+
+	//Fills count particles across every thread. The result depends only on the seed and stream, never on the thread count
+	void Generate(const BeltDescription& description, uint64_t seed, uint32_t stream, BeltParticle* outParticles, size_t count);
+
+	//Helper methods for the above method
+	//Radius of the annulus that a uniform u in [0, 1) maps to so particles are spread evenly by area, the inverse of its CDF
+	float AnnulusRadius(float innerRadius, float outerRadius, float u);
+};
+
+#endif
@@ -0,0 +1,20 @@
+#include "Clock.h"
+
+HighResolutionClock::HighResolutionClock()
+{
+	QueryPerformanceFrequency(&m_Frequency);
+	QueryPerformanceCounter(&m_Start);
+}
+
+double HighResolutionClock::Now() const
+{
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+
+	//Split into whole seconds and remainder so large counts keep their precision
+	LONGLONG ticks = now.QuadPart - m_Start.QuadPart;
+	LONGLONG seconds = ticks / m_Frequency.QuadPart;
+	LONGLONG remainder = ticks % m_Frequency.QuadPart;
+
+	return (double)seconds + (double)remainder / (double)m_Frequency.QuadPart;
+}
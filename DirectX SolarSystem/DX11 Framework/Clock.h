@@ -0,0 +1,51 @@
+#pragma once
+#ifndef CLOCK
+#define CLOCK
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+//Source of monotonic time in seconds. Anything that needs the time takes one of these so it can be given a ManualClock instead
+class Clock
+{
+public:
+	virtual ~Clock() {}
+
+	//Seconds since some fixed point, never goes backwards
+	virtual double Now() const = 0;
+};
+
+#ifdef _WIN32
+//QueryPerformanceCounter based clock, safe to read from any thread. Left out elsewhere so the tests can use the rest without the SDK
+class HighResolutionClock : public Clock
+{
+private:
+	LARGE_INTEGER m_Frequency;
+	LARGE_INTEGER m_Start;
+
+public:
+	//Constructor, time is measured from here
+	HighResolutionClock();
+
+	double Now() const;
+};
+#endif
+
+//Clock that only moves when told to, for stepping the simulation deterministically
+class ManualClock : public Clock
+{
+private:
+	double m_Time;
+
+public:
+	//Constructor
+	ManualClock(double startTime = 0.0) : m_Time(startTime) {}
+
+	double Now() const { return m_Time; }
+
+	//Moves time forwards by the given number of seconds
+	void Advance(double seconds) { m_Time += seconds; }
+};
+
+#endif
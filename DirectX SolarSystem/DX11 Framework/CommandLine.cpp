@@ -0,0 +1,56 @@
+#include "CommandLine.h"
+#include "EphemerisExport.h"
+#include <shellapi.h>
+#include <time.h>
+
+bool CommandLine::ParseSeed(const wchar_t* commandLine, unsigned long long& seed, std::wstring& error)
+{
+	error.clear();
+
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(commandLine, &argc);
+	if (argv == nullptr)
+		return true;
+
+	for (int i = 1; i < argc && error.empty(); i++)
+	{
+		if (std::wstring(argv[i]) == L"-seed")
+		{
+			if (++i >= argc || !EphemerisExport::ParseNumber(argv[i], seed))
+				error = L"-seed needs a whole number";
+		}
+	}
+
+	LocalFree(argv);
+	return error.empty();
+}
+
+bool CommandLine::ParseThreads(const wchar_t* commandLine, size_t& threads, std::wstring& error)
+{
+	error.clear();
+
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(commandLine, &argc);
+	if (argv == nullptr)
+		return true;
+
+	for (int i = 1; i < argc && error.empty(); i++)
+	{
+		if (std::wstring(argv[i]) == L"-threads")
+		{
+			unsigned long long count = 0;
+			if (++i >= argc || !EphemerisExport::ParseNumber(argv[i], count) || count == 0)
+				error = L"-threads needs a count above zero";
+			else
+				threads = (size_t)count;
+		}
+	}
+
+	LocalFree(argv);
+	return error.empty();
+}
+
+unsigned long long CommandLine::ClockSeed()
+{
+	return (unsigned long long)time(nullptr);
+}
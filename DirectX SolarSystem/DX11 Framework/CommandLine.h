@@ -0,0 +1,23 @@
+#pragma once
+#ifndef COMMANDLINE
+#define COMMANDLINE
+
+#include <windows.h>
+#include <string>
+
+//Options every mode shares, found anywhere on the full command line (program name first) so they can go before or after the mode's own:
+//    -seed <n>       the belt and rings are generated from n, the same scene or export every time it is given
+//    -threads <n>    ParallelFor splits work across n threads rather than one per hardware thread
+namespace CommandLine
+{
+	//Fills seed from -seed, leaving it as it was if there is none. Returns false with error filled in if -seed is not followed by a whole number
+	bool ParseSeed(const wchar_t* commandLine, unsigned long long& seed, std::wstring& error);
+
+	//Fills threads from -threads, leaving it as it was if there is none. Returns false with error filled in if -threads is not followed by a count above zero
+	bool ParseThreads(const wchar_t* commandLine, size_t& threads, std::wstring& error);
+
+	//A seed from the clock, for a different scene each run when none is given
+	unsigned long long ClockSeed();
+};
+
+#endif
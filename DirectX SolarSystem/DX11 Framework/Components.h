@@ -0,0 +1,104 @@
+#pragma once
+#ifndef COMPONENTS
+#define COMPONENTS
+
+#include <windows.h>
+#include <DirectXMath.h>
+#include "ResourceManager.h"
+
+using namespace DirectX;
+
+//An entity is only a number, everything about it is in the components EntityStore keeps for it
+typedef UINT Entity;
+const Entity InvalidEntity = 0xffffffff;
+
+//Every kind of component, each one's bit in a ComponentMask
+enum ComponentType
+{
+	COMPONENT_TRANSFORM,
+	COMPONENT_ORBIT,
+	COMPONENT_SPIN,
+	COMPONENT_PARENT,
+	COMPONENT_RENDERABLE,
+	COMPONENT_MATERIAL,
+	COMPONENT_TYPE_COUNT
+};
+
+typedef UINT ComponentMask;
+
+//Where an entity is, rebuilt each step from its scale and whatever other components place it
+struct Transform
+{
+	XMFLOAT4X4 World;
+	XMFLOAT3 Scale;
+};
+
+//Index of the orbit position the entity sits at each step
+struct Orbit
+{
+	UINT Index;
+};
+
+//Radians of spin per unit of orbit time, and the AngleRotors entry that turns it
+struct Spin
+{
+	float Rate;
+	UINT Rotor;
+};
+
+//Entity whose transform this one is carried along by, which must not have a parent of its own
+struct Parent
+{
+	Entity Owner;
+};
+
+//Mesh and texture to draw with. Transparent entities are drawn after everything else, blended by BlendFactor
+struct Renderable
+{
+	MeshHandle Mesh;
+	TextureHandle Texture;
+	bool Transparent;
+	float BlendFactor;
+};
+
+struct Material
+{
+	XMFLOAT4 Diffuse;
+	XMFLOAT4 Ambient;
+	XMFLOAT4 Specular;
+};
+
+//Ties each component struct to its ComponentType
+template <typename T> struct ComponentTraits;
+template <> struct ComponentTraits<Transform> { static const ComponentType Type = COMPONENT_TRANSFORM; };
+template <> struct ComponentTraits<Orbit> { static const ComponentType Type = COMPONENT_ORBIT; };
+template <> struct ComponentTraits<Spin> { static const ComponentType Type = COMPONENT_SPIN; };
+template <> struct ComponentTraits<Parent> { static const ComponentType Type = COMPONENT_PARENT; };
+template <> struct ComponentTraits<Renderable> { static const ComponentType Type = COMPONENT_RENDERABLE; };
+template <> struct ComponentTraits<Material> { static const ComponentType Type = COMPONENT_MATERIAL; };
+
+//Bytes each component takes, indexed by ComponentType
+inline size_t GetComponentSize(ComponentType type)
+{
+	static const size_t sizes[COMPONENT_TYPE_COUNT] =
+	{
+		sizeof(Transform), sizeof(Orbit), sizeof(Spin), sizeof(Parent), sizeof(Renderable), sizeof(Material)
+	};
+
+	return sizes[type];
+}
+
+//Mask with the bit of every component listed
+template <typename... Components> struct ComponentMaskOf;
+
+template <> struct ComponentMaskOf<>
+{
+	static const ComponentMask Value = 0;
+};
+
+template <typename First, typename... Rest> struct ComponentMaskOf<First, Rest...>
+{
+	static const ComponentMask Value = (1u << ComponentTraits<First>::Type) | ComponentMaskOf<Rest...>::Value;
+};
+
+#endif
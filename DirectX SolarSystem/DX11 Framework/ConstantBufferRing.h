@@ -0,0 +1,229 @@
+#pragma once
+#ifndef CONSTANTBUFFERRING
+#define CONSTANTBUFFERRING
+
+#include <stdint.h>
+#include <string.h>
+#include "RingAllocator.h"
+
+//One large dynamic constant buffer that per draw constants are copied into end to end, each draw binding its own range of it by offset.
+//Writes map with NO_OVERWRITE so the driver never copies or waits, which is safe because a range is only reused once an event query
+//shows the GPU has finished the frame that used it. If the GPU falls so far behind that the ring fills, it maps with DISCARD for fresh memory.
+//Context is ID3D11DeviceContext1 in the application, with Types naming the interfaces, descriptions and flags its methods take
+//(D3D11ConstantBufferTypes). Nothing here needs the SDK, so a mock context can check the reuse, the polling and the discards without a GPU
+template <typename Context, typename Types>
+class ConstantBufferRing
+{
+public:
+	typedef typename Types::Buffer Buffer;
+	typedef typename Types::Query Query;
+	typedef typename Types::BufferDesc BufferDesc;
+	typedef typename Types::QueryDesc QueryDesc;
+	typedef typename Types::MappedSubresource MappedSubresource;
+	typedef typename Types::Result Result;
+
+	//Where an upload went, in the 16 byte constants VSSetConstantBuffers1 counts in
+	struct Allocation
+	{
+		unsigned int FirstConstant;
+		unsigned int NumConstants;
+	};
+
+	//Offsets have to be a multiple of 16 constants, so every upload takes at least this much of the ring
+	static const unsigned int AllocationAlignment = 256;
+
+	//Frames that can be waiting on the GPU at once, each with its own event query
+	static const unsigned int MaxFramesInFlight = 4;
+
+private:
+	Context* m_Context;
+	Buffer* m_Buffer;
+	RingAllocator m_Allocator;
+
+	//Query ending each frame still being waited on, and the frame it ends
+	Query* m_Queries[MaxFramesInFlight];
+	bool m_QueryPending[MaxFramesInFlight];
+	uint64_t m_QueryFrames[MaxFramesInFlight];
+
+	//Frame being filled, and whether the next map has to discard because nothing is known about what the buffer holds
+	uint64_t m_Frame;
+	bool m_DiscardNext;
+
+	unsigned int m_Discards;
+
+	//Helper methods for the above method(s)
+	//Retires every frame, oldest first, that the GPU has got through
+	void Poll()
+	{
+		for (;;)
+		{
+			unsigned int oldest = MaxFramesInFlight;
+			for (unsigned int i = 0; i < MaxFramesInFlight; i++)
+			{
+				if (m_QueryPending[i] && (oldest == MaxFramesInFlight || m_QueryFrames[i] < m_QueryFrames[oldest]))
+					oldest = i;
+			}
+
+			if (oldest == MaxFramesInFlight || m_Context->GetData(m_Queries[oldest], nullptr, 0, Types::GetDataDoNotFlush) != Types::Ok)
+				return;
+
+			m_QueryPending[oldest] = false;
+			m_Allocator.Retire(m_QueryFrames[oldest]);
+		}
+	}
+
+public:
+	//Constructor
+	ConstantBufferRing() : m_Context(nullptr), m_Buffer(nullptr), m_Frame(0), m_DiscardNext(true), m_Discards(0)
+	{
+		for (unsigned int i = 0; i < MaxFramesInFlight; i++)
+		{
+			m_Queries[i] = nullptr;
+			m_QueryPending[i] = false;
+			m_QueryFrames[i] = 0;
+		}
+	}
+
+	//Destructor
+	~ConstantBufferRing() { Release(); }
+
+	//Creates the buffer and queries, capacity being rounded up to a whole number of allocations. Device is ID3D11Device in the application
+	template <typename Device> Result Create(Device* device, Context* context, unsigned int capacity)
+	{
+		Release();
+
+		capacity = (capacity + AllocationAlignment - 1) & ~(AllocationAlignment - 1);
+
+		BufferDesc bd;
+		memset(&bd, 0, sizeof(bd));
+		bd.Usage = Types::UsageDynamic;
+		bd.ByteWidth = capacity;
+		bd.BindFlags = Types::BindConstantBuffer;
+		bd.CPUAccessFlags = Types::CpuAccessWrite;
+
+		Result hr = device->CreateBuffer(&bd, nullptr, &m_Buffer);
+
+		QueryDesc qd;
+		memset(&qd, 0, sizeof(qd));
+		qd.Query = Types::QueryEvent;
+
+		//Failures are negative, as FAILED has it
+		for (unsigned int i = 0; i < MaxFramesInFlight && hr >= 0; i++)
+			hr = device->CreateQuery(&qd, &m_Queries[i]);
+
+		if (hr < 0)
+		{
+			Release();
+			return hr;
+		}
+
+		m_Context = context;
+		m_Allocator.Reset(capacity);
+		m_Frame = 0;
+		m_DiscardNext = true;
+
+		return Types::Ok;
+	}
+
+	//Releases the buffer and queries, after which every Upload fails
+	void Release()
+	{
+		if (m_Buffer) m_Buffer->Release();
+		m_Buffer = nullptr;
+
+		for (unsigned int i = 0; i < MaxFramesInFlight; i++)
+		{
+			if (m_Queries[i]) m_Queries[i]->Release();
+			m_Queries[i] = nullptr;
+			m_QueryPending[i] = false;
+		}
+
+		m_Allocator.Reset(0);
+	}
+
+	bool IsCreated() const { return m_Buffer != nullptr; }
+	Buffer* GetBuffer() const { return m_Buffer; }
+
+	//Copies size bytes into the ring for a draw in this frame. False if the ring was never created or size is bigger than all of it
+	bool Upload(const void* data, unsigned int size, Allocation& allocation)
+	{
+		if (!m_Buffer)
+			return false;
+
+		//Whole allocations only, as that is how much of the ring a bind covers
+		size_t rounded = (size + AllocationAlignment - 1) & ~(size_t)(AllocationAlignment - 1);
+		size_t offset;
+		bool allocated = m_Allocator.Allocate(rounded, AllocationAlignment, offset);
+
+		//Full, so see whether the GPU has finished with anything, and if not start again on fresh memory
+		if (!allocated)
+		{
+			Poll();
+			allocated = m_Allocator.Allocate(rounded, AllocationAlignment, offset);
+		}
+
+		if (!allocated)
+		{
+			m_Allocator.Discard();
+			m_DiscardNext = true;
+			m_Discards++;
+
+			for (unsigned int i = 0; i < MaxFramesInFlight; i++)
+				m_QueryPending[i] = false;
+
+			if (!m_Allocator.Allocate(rounded, AllocationAlignment, offset))
+				return false;
+		}
+
+		MappedSubresource mapped;
+		if (m_Context->Map(m_Buffer, 0, m_DiscardNext ? Types::MapWriteDiscard : Types::MapWriteNoOverwrite, 0, &mapped) < 0)
+			return false;
+
+		memcpy((unsigned char*)mapped.pData + offset, data, size);
+		m_Context->Unmap(m_Buffer, 0);
+		m_DiscardNext = false;
+
+		allocation.FirstConstant = (unsigned int)(offset / 16);
+		allocation.NumConstants = (unsigned int)(rounded / 16);
+
+		return true;
+	}
+
+	//Binds an upload to a slot of both the vertex and pixel shader
+	void Bind(unsigned int slot, const Allocation& allocation)
+	{
+		m_Context->VSSetConstantBuffers1(slot, 1, &m_Buffer, &allocation.FirstConstant, &allocation.NumConstants);
+		m_Context->PSSetConstantBuffers1(slot, 1, &m_Buffer, &allocation.FirstConstant, &allocation.NumConstants);
+	}
+
+	//Marks the end of a frame's uploads with an event query, once every draw using them has been issued.
+	//If every query is still waiting the frame stays open and carries on into the next, so nothing ever blocks here
+	void EndFrame()
+	{
+		if (!m_Buffer)
+			return;
+
+		Poll();
+
+		for (unsigned int i = 0; i < MaxFramesInFlight; i++)
+		{
+			if (!m_QueryPending[i])
+			{
+				m_Context->End(m_Queries[i]);
+				m_QueryPending[i] = true;
+				m_QueryFrames[i] = m_Frame;
+				m_Allocator.EndFrame(m_Frame);
+				break;
+			}
+		}
+
+		m_Frame++;
+	}
+
+	//Bytes of the ring in use, by the frame being filled and those the GPU may still be reading, and how many times it has had to discard
+	size_t GetUsed() const { return m_Allocator.GetUsed(); }
+	size_t GetCapacity() const { return m_Allocator.GetCapacity(); }
+	unsigned int GetDiscards() const { return m_Discards; }
+};
+
+#endif
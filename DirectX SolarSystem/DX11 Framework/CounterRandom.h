@@ -0,0 +1,39 @@
+#pragma once
+#ifndef COUNTERRANDOM
+#define COUNTERRANDOM
+
+#include <stdint.h>
+
+//Counter based random numbers. Each value is a hash of (seed, stream, counter) rather than the next step of a shared sequence,
+//so any thread can draw any value in any order and always get the same answer for the same seed
+namespace CounterRandom
+{
+	//SplitMix64 finaliser, spreads every input bit across the whole output
+	inline uint64_t Mix(uint64_t value)
+	{
+		value += 0x9e3779b97f4a7c15ull;
+		value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+		value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+		return value ^ (value >> 31);
+	}
+
+	//64 random bits. Streams keep separate uses of one seed, such as different belts, from sharing values
+	inline uint64_t Bits(uint64_t seed, uint32_t stream, uint64_t counter)
+	{
+		return Mix(Mix(seed ^ ((uint64_t)stream << 32)) ^ counter);
+	}
+
+	//Uniform float in [0, 1), from the top 24 bits so every value is exactly representable
+	inline float Uniform(uint64_t seed, uint32_t stream, uint64_t counter)
+	{
+		return (float)(Bits(seed, stream, counter) >> 40) * (1.0f / 16777216.0f);
+	}
+
+	//Uniform float in [minimum, maximum)
+	inline float Uniform(uint64_t seed, uint32_t stream, uint64_t counter, float minimum, float maximum)
+	{
+		return minimum + (maximum - minimum) * Uniform(seed, stream, counter);
+	}
+};
+
+#endif
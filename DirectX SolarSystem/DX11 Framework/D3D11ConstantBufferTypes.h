@@ -0,0 +1,32 @@
+#pragma once
+#ifndef D3D11CONSTANTBUFFERTYPES
+#define D3D11CONSTANTBUFFERTYPES
+
+#include <windows.h>
+#include <d3d11_1.h>
+#include "ConstantBufferRing.h"
+
+//What ConstantBufferRing creates, maps and waits on, as Direct3D 11 names it
+struct D3D11ConstantBufferTypes
+{
+	typedef ID3D11Buffer Buffer;
+	typedef ID3D11Query Query;
+	typedef D3D11_BUFFER_DESC BufferDesc;
+	typedef D3D11_QUERY_DESC QueryDesc;
+	typedef D3D11_MAPPED_SUBRESOURCE MappedSubresource;
+	typedef HRESULT Result;
+
+	static const Result Ok = S_OK;
+
+	static const D3D11_USAGE UsageDynamic = D3D11_USAGE_DYNAMIC;
+	static const UINT BindConstantBuffer = D3D11_BIND_CONSTANT_BUFFER;
+	static const UINT CpuAccessWrite = D3D11_CPU_ACCESS_WRITE;
+	static const D3D11_QUERY QueryEvent = D3D11_QUERY_EVENT;
+	static const D3D11_MAP MapWriteDiscard = D3D11_MAP_WRITE_DISCARD;
+	static const D3D11_MAP MapWriteNoOverwrite = D3D11_MAP_WRITE_NO_OVERWRITE;
+	static const UINT GetDataDoNotFlush = D3D11_ASYNC_GETDATA_DONOTFLUSH;
+};
+
+typedef ConstantBufferRing<ID3D11DeviceContext1, D3D11ConstantBufferTypes> D3D11ConstantBufferRing;
+
+#endif
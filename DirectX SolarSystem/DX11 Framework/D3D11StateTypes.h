@@ -0,0 +1,30 @@
+#pragma once
+#ifndef D3D11STATETYPES
+#define D3D11STATETYPES
+
+#include <windows.h>
+#include <d3d11_1.h>
+#include "StateFilteringContext.h"
+
+//What StateFilteringContext shadows, as Direct3D 11 names it
+struct D3D11StateTypes
+{
+	typedef ID3D11InputLayout InputLayout;
+	typedef D3D11_PRIMITIVE_TOPOLOGY Topology;
+	typedef ID3D11Buffer Buffer;
+	typedef DXGI_FORMAT Format;
+	typedef ID3D11VertexShader VertexShader;
+	typedef ID3D11PixelShader PixelShader;
+	typedef ID3D11ClassInstance ClassInstance;
+	typedef ID3D11ShaderResourceView ShaderResourceView;
+	typedef ID3D11SamplerState SamplerState;
+	typedef ID3D11BlendState BlendState;
+	typedef ID3D11RasterizerState RasterizerState;
+
+	static const UINT ConstantBufferSlots = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+	static const UINT SamplerSlots = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+};
+
+typedef StateFilteringContext<ID3D11DeviceContext, D3D11StateTypes> D3D11StateFilteringContext;
+
+#endif
@@ -1,11 +1,61 @@
 #include "Application.h"
+#include "ParallelFor.h"
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR lpCmdLine, int nCmdShow)
 {
     UNREFERENCED_PARAMETER(hPrevInstance);
     UNREFERENCED_PARAMETER(lpCmdLine);
 
+    //-threads pins how many threads the simulation, export and benchmark share their work across, to compare runs or measure scaling
+    size_t threads = 0;
+    std::wstring threadsError;
+    if (!CommandLine::ParseThreads(GetCommandLineW(), threads, threadsError))
+    {
+        MessageBox(nullptr, threadsError.c_str(), L"DX11 Framework", MB_OK);
+        return -1;
+    }
+
+    SetParallelThreadCount(threads);
+
+    //-export writes an ephemeris to a file and exits without opening a window
+    EphemerisExport::Settings exportSettings;
+    std::wstring exportError;
+    if (EphemerisExport::ParseCommandLine(GetCommandLineW(), exportSettings, exportError))
+    {
+        if (exportError.empty() && SUCCEEDED(Application::ExportEphemeris(exportSettings, exportError)))
+            return 0;
+
+        MessageBox(nullptr, exportError.c_str(), L"Ephemeris export", MB_OK);
+        return -1;
+    }
+
+    //-benchmark times the belt's gravity mode and reports how it went, again without a window
+    GravityBenchmark::Settings benchmarkSettings;
+    std::wstring benchmarkError;
+    if (GravityBenchmark::ParseCommandLine(GetCommandLineW(), benchmarkSettings, benchmarkError))
+    {
+        if (!benchmarkError.empty())
+        {
+            MessageBox(nullptr, benchmarkError.c_str(), L"Gravity benchmark", MB_OK);
+            return -1;
+        }
+
+        GravityBenchmark::Result result = Application::BenchmarkGravity(benchmarkSettings);
+        MessageBox(nullptr, GravityBenchmark::Describe(benchmarkSettings, result).c_str(), L"Gravity benchmark", MB_OK);
+        return 0;
+    }
+
+    //-seed brings back the belt and rings of an earlier run, whose seed went to the debug output
+    unsigned long long seed = CommandLine::ClockSeed();
+    std::wstring seedError;
+    if (!CommandLine::ParseSeed(GetCommandLineW(), seed, seedError))
+    {
+        MessageBox(nullptr, seedError.c_str(), L"DX11 Framework", MB_OK);
+        return -1;
+    }
+
 	Application * theApp = new Application();
+	theApp->SetGenerationSeed(seed);
 
 	if (FAILED(theApp->Initialise(hInstance, nCmdShow)))
 	{
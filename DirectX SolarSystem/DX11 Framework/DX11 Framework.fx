@@ -45,20 +45,17 @@ struct DirectionalLight
 //--------------------------------------------------------------------------------------
 // Constant Buffer Variables
 //--------------------------------------------------------------------------------------
+//Set once a frame
 cbuffer ConstantBuffer : register( b0 )
 {
 	PointLight gPointLight, gPointLight2;
 	SpotLight gSpotLights[6];
 	
-	matrix World;
 	matrix View;
 	matrix Projection;
 
-    float4 DiffuseMtrl;
     float4 DiffuseLight;
-	float4 AmbientMtrl;
 	float4 AmbientLight;
-	float4 SpecularMtrl;
 	float4 SpecularLight;
 	float SpecularPower;
 	float3 EyePosW;
@@ -67,9 +64,27 @@ cbuffer ConstantBuffer : register( b0 )
     float gTime;
 }
 
+//Set for every draw, each one a range of the application's constant buffer ring
+cbuffer ObjectBuffer : register( b1 )
+{
+	matrix World;
+	
+	float4 DiffuseMtrl;
+	float4 AmbientMtrl;
+	float4 SpecularMtrl;
+}
+
+//How a surface takes the light, from the constant buffer for a single draw or from the instance for a batch
+struct SurfaceMaterial
+{
+	float4 Diffuse;
+	float4 Ambient;
+	float4 Specular;
+};
+
 //--------------------------------------------------------------------------------------
 //taken from Frank Luna 3D Game Programming with DirectX 11 pg 296
-void ComputeDirectionalLight(DirectionalLight L, float3 normal, float3 toEye, out float4 ambient, out float4 diffuse, out float4 specular)
+void ComputeDirectionalLight(DirectionalLight L, SurfaceMaterial M, float3 normal, float3 toEye, out float4 ambient, out float4 diffuse, out float4 specular)
 {
 	//Initialise outputs 
 	ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
@@ -80,7 +95,7 @@ void ComputeDirectionalLight(DirectionalLight L, float3 normal, float3 toEye, ou
 	float3 lightVec = -L.Direction;
 	
 	//Add ambient term
-	ambient = AmbientMtrl * L.Ambient;
+	ambient = M.Ambient * L.Ambient;
 	
 	//Add diffuse and specular
 	float diffuseFactor = dot(lightVec, normal);
@@ -90,14 +105,14 @@ void ComputeDirectionalLight(DirectionalLight L, float3 normal, float3 toEye, ou
 	if (diffuseFactor > 0.0f)
 	{
 		float3 v = reflect(-lightVec, normal);
-		float specFactor = pow(max(dot(v, toEye), 0.0f), SpecularMtrl.w);
+		float specFactor = pow(max(dot(v, toEye), 0.0f), M.Specular.w);
 
-		diffuse = diffuseFactor * DiffuseMtrl * L.Diffuse;
-		specular = specFactor * SpecularMtrl * L.Specular;
+		diffuse = diffuseFactor * M.Diffuse * L.Diffuse;
+		specular = specFactor * M.Specular * L.Specular;
 	}
 }
 //taken from Frank Luna 3D Game Programming with DirectX 11 pg 297
-void ComputePointLight(PointLight L, float3 Pos, float3 normal, float3 toEye, out float4 ambient, out float4 diffuse, out float4 specular)
+void ComputePointLight(PointLight L, SurfaceMaterial M, float3 Pos, float3 normal, float3 toEye, out float4 ambient, out float4 diffuse, out float4 specular)
 {
 	//Initialise ouputs
 	ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
@@ -118,7 +133,7 @@ void ComputePointLight(PointLight L, float3 Pos, float3 normal, float3 toEye, ou
 	lightVec /= d;
 	
 	//Ambient term
-	ambient = AmbientMtrl * L.Ambient;
+	ambient = M.Ambient * L.Ambient;
 	
 	//diffuse and specular
 	float diffuseFactor = dot(lightVec, normal);
@@ -128,10 +143,10 @@ void ComputePointLight(PointLight L, float3 Pos, float3 normal, float3 toEye, ou
 	if (diffuseFactor > 0.0f)
 	{
 		float3 v = reflect(-lightVec, normal);
-		float specFactor = pow(max(dot(v, toEye), 0.0f), SpecularMtrl.w);
+		float specFactor = pow(max(dot(v, toEye), 0.0f), M.Specular.w);
 		
-		diffuse = diffuseFactor * DiffuseMtrl * L.Diffuse;
-		specular = specFactor * SpecularMtrl * L.Specular;
+		diffuse = diffuseFactor * M.Diffuse * L.Diffuse;
+		specular = specFactor * M.Specular * L.Specular;
 	}
 	
 	//Attenuate
@@ -142,7 +157,7 @@ void ComputePointLight(PointLight L, float3 Pos, float3 normal, float3 toEye, ou
 }
 
 //taken from Frank Luna 3D Game Programming with DirectX 11 pg 298
-void ComputeSpotLight(SpotLight L, float3 pos, float3 normal, float3 toEye, out float4 ambient, out float4 diffuse, out float4 specular)
+void ComputeSpotLight(SpotLight L, SurfaceMaterial M, float3 pos, float3 normal, float3 toEye, out float4 ambient, out float4 diffuse, out float4 specular)
 {
 	//intialise outputs
 	ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
@@ -163,7 +178,7 @@ void ComputeSpotLight(SpotLight L, float3 pos, float3 normal, float3 toEye, out
 	lightVec /= d;
 	
 	//ambient term
-	ambient = AmbientMtrl * L.Ambient;
+	ambient = M.Ambient * L.Ambient;
 	
 	//diffuse and specular
 	float diffuseFactor = dot(lightVec, normal);
@@ -173,10 +188,10 @@ void ComputeSpotLight(SpotLight L, float3 pos, float3 normal, float3 toEye, out
 	if (diffuseFactor > 0.0f)
 	{
 		float3 v = reflect(-lightVec, normal);
-		float specFactor = pow(max(dot(v, toEye), 0.0f), SpecularMtrl.w);
+		float specFactor = pow(max(dot(v, toEye), 0.0f), M.Specular.w);
 
-		diffuse = diffuseFactor * DiffuseMtrl * L.Diffuse;
-		specular = specFactor * SpecularMtrl * L.Specular;
+		diffuse = diffuseFactor * M.Diffuse * L.Diffuse;
+		specular = specFactor * M.Specular * L.Specular;
 	}
 	
 	//scale by spotlight factor and attenuate
@@ -228,16 +243,10 @@ VS_OUTPUT VS(float4 Pos : POSITION, float3 NormalL : NORMAL, float2 Tex : TEXCOO
 }
 
 
-//--------------------------------------------------------------------------------------
-// Pixel Shader
-//--------------------------------------------------------------------------------------
-float4 PS(VS_OUTPUT input) : SV_Target
+//Sum of every light on a surface, ambient, diffuse and specular
+float4 ComputeLighting(SurfaceMaterial M, float3 posW, float3 normal)
 {
-	float4 textureColour = txDiffuse.Sample(samLinear, input.Tex);
-	
-	input.Norm = normalize(input.Norm);
-	
-	float3 toEyeW = normalize(EyePosW - input.PosW);
+	float3 toEyeW = normalize(EyePosW - posW);
 	
 	float4 ambient = float4(0.0f, 0.0f, 0.0f, 0.0f);
 	float4 diffuse = float4(0.0f, 0.0f, 0.0f, 0.0f);
@@ -246,7 +255,7 @@ float4 PS(VS_OUTPUT input) : SV_Target
 	float4 A, D, S;
 	
 	//first point light
-	ComputePointLight(gPointLight, input.PosW, input.Norm, toEyeW, A, D, S);
+	ComputePointLight(gPointLight, M, posW, normal, toEyeW, A, D, S);
 	ambient += A;
 	diffuse += D;
 	specular += S;
@@ -254,15 +263,87 @@ float4 PS(VS_OUTPUT input) : SV_Target
 	//Spot Lights
 	for (int i = 0; i < 5; i++)
 	{
-		ComputeSpotLight(gSpotLights[i], input.PosW, input.Norm, toEyeW, A, D, S);
+		ComputeSpotLight(gSpotLights[i], M, posW, normal, toEyeW, A, D, S);
 		ambient += A;
 		diffuse += D;
 		specular += S;
 	}
 	
-	float4 litColor = ambient + diffuse + specular;
+	return ambient + diffuse + specular;
+}
+
+//--------------------------------------------------------------------------------------
+// Pixel Shader
+//--------------------------------------------------------------------------------------
+float4 PS(VS_OUTPUT input) : SV_Target
+{
+	float4 textureColour = txDiffuse.Sample(samLinear, input.Tex);
+	
+	input.Norm = normalize(input.Norm);
+	
+	SurfaceMaterial M;
+	M.Diffuse = DiffuseMtrl;
+	M.Ambient = AmbientMtrl;
+	M.Specular = SpecularMtrl;
+	
+	float4 litColor = ComputeLighting(M, input.PosW, input.Norm);
 	    
 	input.Color = litColor * textureColour;
 	
 	return input.Color;
-}
\ No newline at end of file
+}
+
+//--------------------------------------------------------------------------------------
+// Instanced bodies - every opaque planet and moon in one draw, each instance carrying its own
+// world matrix, material and slice of txBodies instead of taking them from the constant buffer
+//--------------------------------------------------------------------------------------
+struct VS_INSTANCED_OUTPUT
+{
+	float4 Pos : SV_POSITION;
+	float3 Norm : NORMAL;
+	float3 PosW : POSITION0;
+	float2 Tex : TEXCOORD0;
+	nointerpolation uint Slice : TEXCOORD1;
+	nointerpolation float4 Diffuse : COLOR0;
+	nointerpolation float4 Ambient : COLOR1;
+	nointerpolation float4 Specular : COLOR2;
+};
+
+Texture2DArray txBodies : register(t1);
+
+VS_INSTANCED_OUTPUT VSInstanced(float4 Pos : POSITION, float3 NormalL : NORMAL, float2 Tex : TEXCOORD0,
+	float4 World0 : WORLD0, float4 World1 : WORLD1, float4 World2 : WORLD2, float4 World3 : WORLD3,
+	float4 Diffuse : DIFFUSE, float4 Ambient : AMBIENT, float4 Specular : SPECULAR, uint Slice : SLICE)
+{
+	VS_INSTANCED_OUTPUT output = (VS_INSTANCED_OUTPUT) 0;
+
+	//Rows as the application stores them, so the matrix is the same one VS gets through the constant buffer
+	float4x4 world = float4x4(World0, World1, World2, World3);
+
+	float4 posW = mul(Pos, world);
+	output.PosW = posW.xyz;
+	output.Pos = mul(posW, View);
+	output.Pos = mul(output.Pos, Projection);
+
+	output.Norm = normalize(mul(float4(NormalL, 0.0f), world).xyz);
+	output.Tex = Tex;
+
+	output.Slice = Slice;
+	output.Diffuse = Diffuse;
+	output.Ambient = Ambient;
+	output.Specular = Specular;
+
+	return output;
+}
+
+float4 PSInstanced(VS_INSTANCED_OUTPUT input) : SV_Target
+{
+	float4 textureColour = txBodies.Sample(samLinear, float3(input.Tex, input.Slice));
+	
+	SurfaceMaterial M;
+	M.Diffuse = input.Diffuse;
+	M.Ambient = input.Ambient;
+	M.Specular = input.Specular;
+	
+	return ComputeLighting(M, input.PosW, normalize(input.Norm)) * textureColour;
+}
@@ -0,0 +1,178 @@
+#include "EntityStore.h"
+#include <string.h>
+
+//Component arrays start on this boundary so loading any of them four floats at a time is aligned
+static const size_t ArrayAlignment = 16;
+
+static size_t AlignArray(size_t offset)
+{
+	return (offset + ArrayAlignment - 1) & ~(ArrayAlignment - 1);
+}
+
+EntityStore::EntityStore()
+{
+	m_Count = 0;
+}
+
+Entity EntityStore::Allocate(ComponentMask mask)
+{
+	UINT archetypeIndex = FindArchetype(mask);
+	Archetype& archetype = m_Archetypes[archetypeIndex];
+
+	if (archetype.Chunks.empty() || archetype.Chunks.back().Count == archetype.Capacity)
+	{
+		//Size the chunk from where its last array ends, which is past ChunkSize only when one row alone is bigger
+		size_t bytes = AlignArray(archetype.Capacity * sizeof(Entity));
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; type++)
+		{
+			if (mask & (1u << type))
+				bytes = archetype.Offsets[type] + AlignArray(archetype.Capacity * GetComponentSize((ComponentType)type));
+		}
+
+		Chunk chunk;
+		chunk.Data.assign(bytes, 0);
+		chunk.Count = 0;
+		archetype.Chunks.push_back(chunk);
+	}
+
+	Entity entity;
+	if (!m_FreeEntities.empty())
+	{
+		entity = m_FreeEntities.back();
+		m_FreeEntities.pop_back();
+	}
+	else
+	{
+		entity = (Entity)m_Locations.size();
+		m_Locations.push_back(Location());
+	}
+
+	Chunk& chunk = archetype.Chunks.back();
+	UINT row = chunk.Count++;
+
+	//Rows are zeroed when given out, as a destroyed entity's components may still be there
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; type++)
+	{
+		if (mask & (1u << type))
+		{
+			size_t size = GetComponentSize((ComponentType)type);
+			memset(&chunk.Data[archetype.Offsets[type] + row * size], 0, size);
+		}
+	}
+
+	((Entity*)&chunk.Data[0])[row] = entity;
+
+	m_Locations[entity].Archetype = archetypeIndex;
+	m_Locations[entity].Chunk = (UINT)archetype.Chunks.size() - 1;
+	m_Locations[entity].Row = row;
+	m_Count++;
+
+	return entity;
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+	if (!IsAlive(entity))
+		return;
+
+	Location location = m_Locations[entity];
+	Archetype& archetype = m_Archetypes[location.Archetype];
+	Chunk& last = archetype.Chunks.back();
+	UINT lastRow = last.Count - 1;
+
+	//Fill the hole with the archetype's last row, unless that is the one going
+	if (&archetype.Chunks[location.Chunk] != &last || location.Row != lastRow)
+	{
+		Chunk& chunk = archetype.Chunks[location.Chunk];
+		Entity moved = ((Entity*)&last.Data[0])[lastRow];
+
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; type++)
+		{
+			if (archetype.Mask & (1u << type))
+			{
+				size_t size = GetComponentSize((ComponentType)type);
+				memcpy(&chunk.Data[archetype.Offsets[type] + location.Row * size], &last.Data[archetype.Offsets[type] + lastRow * size], size);
+			}
+		}
+
+		((Entity*)&chunk.Data[0])[location.Row] = moved;
+		m_Locations[moved] = location;
+	}
+
+	if (--last.Count == 0)
+		archetype.Chunks.pop_back();
+
+	m_Locations[entity].Archetype = NoArchetype;
+	m_FreeEntities.push_back(entity);
+	m_Count--;
+}
+
+bool EntityStore::IsAlive(Entity entity) const
+{
+	return entity < m_Locations.size() && m_Locations[entity].Archetype != NoArchetype;
+}
+
+ComponentMask EntityStore::GetMask(Entity entity) const
+{
+	return IsAlive(entity) ? m_Archetypes[m_Locations[entity].Archetype].Mask : 0;
+}
+
+UINT EntityStore::FindArchetype(ComponentMask mask)
+{
+	for (UINT i = 0; i < m_Archetypes.size(); i++)
+	{
+		if (m_Archetypes[i].Mask == mask)
+			return i;
+	}
+
+	Archetype archetype;
+	archetype.Mask = mask;
+
+	size_t rowSize = sizeof(Entity);
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; type++)
+	{
+		archetype.Offsets[type] = 0;
+
+		if (mask & (1u << type))
+			rowSize += GetComponentSize((ComponentType)type);
+	}
+
+	//As many rows as fit once every array is padded out to its alignment, and never fewer than one
+	UINT capacity = (UINT)(ChunkSize / rowSize);
+	for (; capacity > 1; capacity--)
+	{
+		size_t bytes = AlignArray(capacity * sizeof(Entity));
+		for (int type = 0; type < COMPONENT_TYPE_COUNT; type++)
+		{
+			if (mask & (1u << type))
+				bytes += AlignArray(capacity * GetComponentSize((ComponentType)type));
+		}
+
+		if (bytes <= ChunkSize)
+			break;
+	}
+
+	archetype.Capacity = capacity > 0 ? capacity : 1;
+
+	size_t offset = AlignArray(archetype.Capacity * sizeof(Entity));
+	for (int type = 0; type < COMPONENT_TYPE_COUNT; type++)
+	{
+		if (mask & (1u << type))
+		{
+			archetype.Offsets[type] = offset;
+			offset += AlignArray(archetype.Capacity * GetComponentSize((ComponentType)type));
+		}
+	}
+
+	m_Archetypes.push_back(archetype);
+	return (UINT)m_Archetypes.size() - 1;
+}
+
+void* EntityStore::GetComponent(Entity entity, ComponentType type) const
+{
+	const Location& location = m_Locations[entity];
+	const Archetype& archetype = m_Archetypes[location.Archetype];
+	const Chunk& chunk = archetype.Chunks[location.Chunk];
+
+	return (void*)&chunk.Data[archetype.Offsets[type] + location.Row * GetComponentSize(type)];
+}
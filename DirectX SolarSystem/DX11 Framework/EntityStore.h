@@ -0,0 +1,130 @@
+#pragma once
+#ifndef ENTITYSTORE
+#define ENTITYSTORE
+
+#include "Components.h"
+#include <windows.h>
+#include <vector>
+
+//Components of every entity, grouped by archetype, the exact set of components an entity has.
+//Each archetype keeps its entities in fixed size chunks, and within a chunk each component is one contiguous array,
+//so a system walking a few components over thousands of entities streams through just those arrays
+class EntityStore
+{
+public:
+	//Bytes in each chunk, enough for a few hundred of the larger archetypes while staying well inside the L1 and L2 caches
+	static const size_t ChunkSize = 16384;
+
+private:
+	struct Chunk
+	{
+		//Entity ids of the rows at the start, then each component's array in ComponentType order
+		std::vector<unsigned char> Data;
+		UINT Count;
+	};
+
+	struct Archetype
+	{
+		ComponentMask Mask;
+
+		//Rows in each chunk
+		UINT Capacity;
+
+		//Start of each component's array in a chunk, for the components in Mask
+		size_t Offsets[COMPONENT_TYPE_COUNT];
+
+		//Every chunk full but the last
+		std::vector<Chunk> Chunks;
+	};
+
+	//Where each entity's components are, by entity
+	struct Location
+	{
+		UINT Archetype;
+		UINT Chunk;
+		UINT Row;
+	};
+
+	static const UINT NoArchetype = 0xffffffff;
+
+	std::vector<Archetype> m_Archetypes;
+	std::vector<Location> m_Locations;
+
+	//Destroyed entities whose numbers go to the next ones created
+	std::vector<Entity> m_FreeEntities;
+
+	size_t m_Count;
+
+	//Helper methods for the above method(s)
+	Entity Allocate(ComponentMask mask);
+	UINT FindArchetype(ComponentMask mask);
+	void* GetComponent(Entity entity, ComponentType type) const;
+
+	template <typename T> static T* GetArray(const Archetype& archetype, Chunk& chunk)
+	{
+		return (T*)&chunk.Data[archetype.Offsets[ComponentTraits<T>::Type]];
+	}
+
+public:
+	//Constructor
+	EntityStore();
+
+	//New entity with exactly the components given, each copied in. Entities are numbered from zero in the order
+	//they are created until one is destroyed, after which its number is handed out again
+	template <typename... Components> Entity Create(const Components&... components)
+	{
+		Entity entity = Allocate(ComponentMaskOf<Components...>::Value);
+
+		int expand[] = { 0, (Get<Components>(entity) = components, 0)... };
+		(void)expand;
+
+		return entity;
+	}
+
+	//Removes an entity, moving the last in its archetype into its place so the chunks stay packed
+	void Destroy(Entity entity);
+
+	bool IsAlive(Entity entity) const;
+	ComponentMask GetMask(Entity entity) const;
+	size_t GetCount() const { return m_Count; }
+
+	template <typename T> bool Has(Entity entity) const
+	{
+		return (GetMask(entity) & ComponentMaskOf<T>::Value) != 0;
+	}
+
+	//The entity must be alive and have the component
+	template <typename T> T& Get(Entity entity)
+	{
+		return *(T*)GetComponent(entity, ComponentTraits<T>::Type);
+	}
+
+	template <typename T> const T& Get(Entity entity) const
+	{
+		return *(const T*)GetComponent(entity, ComponentTraits<T>::Type);
+	}
+
+	//Calls function(count, entities, components...) once per chunk holding every component listed and none of those in exclude,
+	//with the chunk's entity ids and one array per component listed. Chunks go in archetype creation order, so the order is always the same.
+	//Creating or destroying entities from inside the function is not allowed
+	template <typename... Components, typename Function> void ForEach(const Function& function, ComponentMask exclude = 0)
+	{
+		const ComponentMask required = ComponentMaskOf<Components...>::Value;
+
+		for (size_t i = 0; i < m_Archetypes.size(); i++)
+		{
+			Archetype& archetype = m_Archetypes[i];
+
+			if ((archetype.Mask & required) != required || (archetype.Mask & exclude) != 0)
+				continue;
+
+			for (size_t c = 0; c < archetype.Chunks.size(); c++)
+			{
+				Chunk& chunk = archetype.Chunks[c];
+				function((size_t)chunk.Count, (const Entity*)&chunk.Data[0], GetArray<Components>(archetype, chunk)...);
+			}
+		}
+	}
+};
+
+#endif
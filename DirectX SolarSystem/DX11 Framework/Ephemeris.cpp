@@ -0,0 +1,177 @@
+#include "Ephemeris.h"
+#include "AngleRotors.h"
+#include "ParallelFor.h"
+#include <math.h>
+
+Ephemeris::Ephemeris()
+{
+	m_Speed = 1.0;
+	m_CacheKnots = 0;
+}
+
+size_t Ephemeris::AddOrbit(const OrbitalElements& elements)
+{
+	BuildCache(0);
+	return m_Orbits.Add(elements);
+}
+
+size_t Ephemeris::AddBody(const EphemerisBody& body)
+{
+	m_Bodies.push_back(body);
+	return m_Bodies.size() - 1;
+}
+
+void Ephemeris::BuildCache(unsigned int knotsPerOrbit)
+{
+	m_CacheKnots = knotsPerOrbit;
+	m_CachePositions.clear();
+	m_CacheTangents.clear();
+
+	size_t orbits = m_Orbits.GetCount();
+	if (knotsPerOrbit == 0 || orbits == 0)
+		return;
+
+	m_CachePositions.resize(orbits * knotsPerOrbit);
+	m_CacheTangents.resize(orbits * knotsPerOrbit);
+
+	std::vector<float> anomalies(orbits);
+	std::vector<XMFLOAT3> positions(orbits);
+	std::vector<XMFLOAT3> velocities(orbits);
+
+	for (unsigned int knot = 0; knot < knotsPerOrbit; knot++)
+	{
+		//Knots run from 0 round to just short of 2 pi, the solver wants them in [-pi, pi]
+		float anomaly = XM_2PI * knot / knotsPerOrbit;
+		if (anomaly > XM_PI)
+			anomaly -= XM_2PI;
+
+		for (size_t i = 0; i < orbits; i++)
+			anomalies[i] = anomaly;
+
+		m_Orbits.EvaluateAtMeanAnomaly(&anomalies[0], &positions[0], &velocities[0]);
+
+		for (size_t i = 0; i < orbits; i++)
+		{
+			//The solver's velocity is per unit of orbit time, the mean anomaly moves at the mean motion
+			float meanMotion = m_Orbits.GetMeanMotion(i);
+			float perAnomaly = meanMotion != 0.0f ? 1.0f / meanMotion : 0.0f;
+
+			m_CachePositions[i * knotsPerOrbit + knot] = positions[i];
+			XMStoreFloat3(&m_CacheTangents[i * knotsPerOrbit + knot], XMVectorScale(XMLoadFloat3(&velocities[i]), perAnomaly));
+		}
+	}
+}
+
+void Ephemeris::EvaluateOrbits(double time, XMFLOAT3* positions) const
+{
+	size_t orbits = m_Orbits.GetCount();
+	if (orbits == 0)
+		return;
+
+	double orbitTime = time * m_Speed;
+
+	if (!IsCached())
+	{
+		std::vector<float> anomalies(orbits);
+		for (size_t i = 0; i < orbits; i++)
+			anomalies[i] = m_Orbits.GetMeanAnomaly(i, orbitTime);
+
+		m_Orbits.EvaluateAtMeanAnomaly(&anomalies[0], positions);
+		return;
+	}
+
+	const float knotSpacing = XM_2PI / m_CacheKnots;
+
+	for (size_t i = 0; i < orbits; i++)
+	{
+		//Which knots the mean anomaly falls between, and how far along from the first
+		float knotPosition = m_Orbits.GetMeanAnomaly(i, orbitTime) / knotSpacing;
+		if (knotPosition < 0.0f)
+			knotPosition += m_CacheKnots;
+
+		unsigned int knot = (unsigned int)knotPosition;
+		if (knot >= m_CacheKnots)
+			knot = m_CacheKnots - 1;
+
+		float u = knotPosition - knot;
+		unsigned int next = knot + 1 < m_CacheKnots ? knot + 1 : 0;
+
+		size_t first = i * m_CacheKnots;
+
+		//Cubic Hermite basis, the tangents scaled from per radian to per knot
+		float u2 = u * u;
+		float u3 = u2 * u;
+		float h00 = 2.0f * u3 - 3.0f * u2 + 1.0f;
+		float h10 = (u3 - 2.0f * u2 + u) * knotSpacing;
+		float h01 = -2.0f * u3 + 3.0f * u2;
+		float h11 = (u3 - u2) * knotSpacing;
+
+		XMVECTOR position = XMVectorScale(XMLoadFloat3(&m_CachePositions[first + knot]), h00);
+		position = XMVectorMultiplyAdd(XMLoadFloat3(&m_CacheTangents[first + knot]), XMVectorReplicate(h10), position);
+		position = XMVectorMultiplyAdd(XMLoadFloat3(&m_CachePositions[first + next]), XMVectorReplicate(h01), position);
+		position = XMVectorMultiplyAdd(XMLoadFloat3(&m_CacheTangents[first + next]), XMVectorReplicate(h11), position);
+
+		XMStoreFloat3(&positions[i], position);
+	}
+}
+
+void Ephemeris::Compose(const XMFLOAT3* orbitPositions, const float* spinCosines, const float* spinSines, XMFLOAT4X4* transforms) const
+{
+	for (size_t i = 0; i < m_Bodies.size(); i++)
+	{
+		const EphemerisBody& body = m_Bodies[i];
+
+		XMMATRIX world = XMMatrixScaling(body.Scale, body.Scale, body.Scale) * AngleRotors::RotationY(spinCosines[i], spinSines[i]);
+
+		if (body.Orbit >= 0)
+			world = world * XMMatrixTranslationFromVector(XMLoadFloat3(&orbitPositions[body.Orbit]));
+
+		if (body.Parent >= 0)
+			world = world * XMLoadFloat4x4(&transforms[body.Parent]);
+
+		XMStoreFloat4x4(&transforms[i], world);
+	}
+}
+
+SimulationState Ephemeris::Evaluate(double time) const
+{
+	SimulationState state;
+	state.Time = time;
+	state.Transforms.resize(m_Bodies.size());
+
+	EphemerisWorkspace workspace;
+	if (!m_Bodies.empty())
+		Evaluate(time, &state.Transforms[0], workspace);
+
+	return state;
+}
+
+void Ephemeris::Evaluate(double time, XMFLOAT4X4* transforms, EphemerisWorkspace& workspace) const
+{
+	workspace.Positions.resize(m_Orbits.GetCount());
+	workspace.Cosines.resize(m_Bodies.size());
+	workspace.Sines.resize(m_Bodies.size());
+
+	if (m_Bodies.empty())
+		return;
+
+	EvaluateOrbits(time, workspace.Positions.data());
+
+	for (size_t i = 0; i < m_Bodies.size(); i++)
+	{
+		//Wrap in double first, as the spins may be far past their first turn
+		double angle = fmod((double)m_Bodies[i].SpinRate * time * m_Speed, XM_2PI);
+		XMScalarSinCos(&workspace.Sines[i], &workspace.Cosines[i], (float)angle);
+	}
+
+	Compose(workspace.Positions.data(), &workspace.Cosines[0], &workspace.Sines[0], transforms);
+}
+
+void Ephemeris::Evaluate(const double* times, size_t count, SimulationState* states) const
+{
+	ParallelFor(count, 64, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+			states[i] = Evaluate(times[i]);
+	});
+}
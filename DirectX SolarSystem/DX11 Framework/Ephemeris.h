@@ -0,0 +1,100 @@
+#pragma once
+#ifndef EPHEMERIS
+#define EPHEMERIS
+
+#include <DirectXMath.h>
+#include <vector>
+#include "KeplerOrbits.h"
+
+using namespace DirectX;
+
+//Every body's world transform at one time
+struct SimulationState
+{
+	double Time;
+
+	//Indexed the same as Ephemeris::AddBody hands out
+	std::vector<XMFLOAT4X4> Transforms;
+};
+
+//How one body is placed in the world: scaled, spun about its own Y axis, moved to where its orbit has it, then carried along by its parent
+struct EphemerisBody
+{
+	float Scale;
+
+	//Radians of spin per unit of orbit time
+	float SpinRate;
+
+	//Orbit the body follows, or -1 to stay at its parent's centre
+	int Orbit;
+
+	//Body it is placed relative to, which must have been added before it, or -1 for one placed straight in the world
+	int Parent;
+};
+
+//Working space for Evaluate, so a thread running through many times can reuse it rather than allocate for each
+struct EphemerisWorkspace
+{
+	std::vector<XMFLOAT3> Positions;
+	std::vector<float> Cosines, Sines;
+};
+
+//Where every body is at any time, worked out directly rather than by stepping there, so time can be scrubbed, warped or run backwards.
+//Positions come from solving each Kepler orbit, or once BuildCache has been called from a piecewise cubic Hermite table of it,
+//which costs the same for every orbit however eccentric. Nothing changes once it is set up, so any number of threads can Evaluate at once
+class Ephemeris
+{
+private:
+	KeplerOrbits m_Orbits;
+	std::vector<EphemerisBody> m_Bodies;
+
+	//Orbit time per unit of simulation time
+	double m_Speed;
+
+	//One whole period of every orbit, m_CacheKnots knots spread evenly over the mean anomaly, orbit after orbit.
+	//Each knot holds the position and how fast it changes with mean anomaly
+	std::vector<XMFLOAT3> m_CachePositions;
+	std::vector<XMFLOAT3> m_CacheTangents;
+	unsigned int m_CacheKnots;
+
+public:
+	//Constructor
+	Ephemeris();
+
+	void SetSpeed(double speed) { m_Speed = speed; }
+	double GetSpeed() const { return m_Speed; }
+
+	//Adds an orbit and returns its index, dropping any cache
+	size_t AddOrbit(const OrbitalElements& elements);
+
+	//Adds a body and returns its index
+	size_t AddBody(const EphemerisBody& body);
+
+	size_t GetOrbitCount() const { return m_Orbits.GetCount(); }
+	size_t GetBodyCount() const { return m_Bodies.size(); }
+	const EphemerisBody& GetBody(size_t index) const { return m_Bodies[index]; }
+	const KeplerOrbits& GetOrbits() const { return m_Orbits; }
+
+	//Tabulates every orbit once round with knotsPerOrbit knots. A Kepler orbit repeats exactly, so the one table covers all time.
+	//Zero knots goes back to solving Kepler's equation every time
+	void BuildCache(unsigned int knotsPerOrbit);
+	bool IsCached() const { return m_CacheKnots > 0; }
+
+	//Every orbit's position at a simulation time, relative to what it orbits. positions must hold GetOrbitCount() entries
+	void EvaluateOrbits(double time, XMFLOAT3* positions) const;
+
+	//Puts the bodies together from their orbit positions and the cosine and sine of each one's spin angle, parents first.
+	//transforms must hold GetBodyCount() entries
+	void Compose(const XMFLOAT3* orbitPositions, const float* spinCosines, const float* spinSines, XMFLOAT4X4* transforms) const;
+
+	//Every body at any simulation time, without stepping through the times in between
+	SimulationState Evaluate(double time) const;
+
+	//The same into transforms, which must hold GetBodyCount() entries
+	void Evaluate(double time, XMFLOAT4X4* transforms, EphemerisWorkspace& workspace) const;
+
+	//Many times at once, split across threads. states must hold count entries
+	void Evaluate(const double* times, size_t count, SimulationState* states) const;
+};
+
+#endif
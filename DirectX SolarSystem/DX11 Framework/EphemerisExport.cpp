@@ -0,0 +1,244 @@
+#include "EphemerisExport.h"
+#include "ParallelFor.h"
+#include "CommandLine.h"
+#include <shellapi.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+bool EphemerisExport::ParseCommandLine(const wchar_t* commandLine, Settings& settings, std::wstring& error)
+{
+	settings.Start = 0.0;
+	settings.End = 0.0;
+	settings.Samples = 0;
+	settings.Path.clear();
+	settings.Csv = false;
+	settings.Asteroids = false;
+	settings.Seed = CommandLine::ClockSeed();
+	settings.Speed = 0.0;
+
+	error.clear();
+
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(commandLine, &argc);
+	if (argv == nullptr)
+		return false;
+
+	bool requested = false;
+
+	for (int i = 1; i < argc && error.empty(); i++)
+	{
+		std::wstring argument = argv[i];
+
+		if (argument == L"-export")
+		{
+			requested = true;
+
+			if (i + 4 >= argc || !ParseNumber(argv[i + 1], settings.Start) || !ParseNumber(argv[i + 2], settings.End) || !ParseNumber(argv[i + 3], settings.Samples))
+				error = L"-export needs a start time, an end time, a sample count and a file";
+			else
+				settings.Path = argv[i + 4];
+
+			i += 4;
+		}
+		else if (argument == L"-csv")
+		{
+			settings.Csv = true;
+		}
+		else if (argument == L"-asteroids")
+		{
+			settings.Asteroids = true;
+		}
+		else if (argument == L"-speed")
+		{
+			if (++i >= argc || !ParseNumber(argv[i], settings.Speed) || settings.Speed <= 0.0)
+				error = L"-speed needs a number above zero";
+		}
+	}
+
+	LocalFree(argv);
+
+	if (requested && error.empty())
+		CommandLine::ParseSeed(commandLine, settings.Seed, error);
+
+	if (requested && error.empty() && settings.Samples == 0)
+		error = L"-export needs at least one sample";
+
+	return requested;
+}
+
+HRESULT EphemerisExport::Write(const Settings& settings, const Ephemeris& bodies, const char* const* bodyNames, const KeplerOrbits* belt, std::wstring& error)
+{
+	FILE* file = nullptr;
+	if (_wfopen_s(&file, settings.Path.c_str(), L"wb") != 0 || file == nullptr)
+	{
+		error = L"Cannot open " + settings.Path + L" for writing";
+		return E_FAIL;
+	}
+
+	FILE* csv = nullptr;
+	if (settings.Csv)
+	{
+		std::wstring csvPath = settings.Path + L".csv";
+		if (_wfopen_s(&csv, csvPath.c_str(), L"w") != 0 || csv == nullptr)
+		{
+			fclose(file);
+			error = L"Cannot open " + csvPath + L" for writing";
+			return E_FAIL;
+		}
+	}
+
+	uint32_t bodyCount = (uint32_t)bodies.GetBodyCount();
+	uint32_t asteroidCount = belt != nullptr ? (uint32_t)belt->GetCount() : 0;
+	size_t columns = bodyCount + asteroidCount;
+
+	//Blocks hold up to 64MB of positions, enough for thousands of samples of the whole belt without needing the entire range in memory
+	size_t blockSamples = columns > 0 ? (64 << 20) / (columns * 3 * sizeof(float)) : 65536;
+	if (blockSamples < 1)
+		blockSamples = 1;
+	else if (blockSamples > 65536)
+		blockSamples = 65536;
+
+	if (blockSamples > settings.Samples)
+		blockSamples = (size_t)settings.Samples;
+
+	//Header
+	const uint32_t version = 1;
+	const uint32_t samplesPerBlock = (uint32_t)blockSamples;
+	const double speed = bodies.GetSpeed();
+
+	fwrite("EPHM", 1, 4, file);
+	fwrite(&version, sizeof(version), 1, file);
+	fwrite(&settings.Samples, sizeof(settings.Samples), 1, file);
+	fwrite(&bodyCount, sizeof(bodyCount), 1, file);
+	fwrite(&asteroidCount, sizeof(asteroidCount), 1, file);
+	fwrite(&samplesPerBlock, sizeof(samplesPerBlock), 1, file);
+	fwrite(&settings.Start, sizeof(settings.Start), 1, file);
+	fwrite(&settings.End, sizeof(settings.End), 1, file);
+	fwrite(&speed, sizeof(speed), 1, file);
+	fwrite(&settings.Seed, sizeof(settings.Seed), 1, file);
+
+	for (uint32_t b = 0; b < bodyCount; b++)
+	{
+		uint16_t length = (uint16_t)strlen(bodyNames[b]);
+		fwrite(&length, sizeof(length), 1, file);
+		fwrite(bodyNames[b], 1, length, file);
+	}
+
+	if (csv != nullptr)
+	{
+		fprintf(csv, "time");
+		for (uint32_t b = 0; b < bodyCount; b++)
+			fprintf(csv, ",%s_x,%s_y,%s_z", bodyNames[b], bodyNames[b], bodyNames[b]);
+		for (uint32_t a = 0; a < asteroidCount; a++)
+			fprintf(csv, ",asteroid%u_x,asteroid%u_y,asteroid%u_z", a, a, a);
+		fprintf(csv, "\n");
+	}
+
+	std::vector<double> times(blockSamples);
+	std::vector<float> block(columns * 3 * blockSamples);
+
+	for (unsigned long long first = 0; first < settings.Samples; first += blockSamples)
+	{
+		size_t count = settings.Samples - first < blockSamples ? (size_t)(settings.Samples - first) : blockSamples;
+
+		//Every sample is independent, each thread keeping its own working space for the run of samples it is given.
+		//The Kepler solve for the belt runs four asteroids at a time
+		ParallelFor(count, 16, [&](size_t begin, size_t end)
+		{
+			EphemerisWorkspace workspace;
+			std::vector<XMFLOAT4X4> transforms(bodyCount);
+			std::vector<float> anomalies(asteroidCount);
+			std::vector<XMFLOAT3> positions(asteroidCount);
+
+			for (size_t k = begin; k < end; k++)
+			{
+				double time = SampleTime(settings, first + k);
+				times[k] = time;
+
+				if (bodyCount > 0)
+					bodies.Evaluate(time, &transforms[0], workspace);
+
+				for (uint32_t b = 0; b < bodyCount; b++)
+				{
+					block[(b * 3 + 0) * blockSamples + k] = transforms[b]._41;
+					block[(b * 3 + 1) * blockSamples + k] = transforms[b]._42;
+					block[(b * 3 + 2) * blockSamples + k] = transforms[b]._43;
+				}
+
+				if (asteroidCount == 0)
+					continue;
+
+				double orbitTime = time * speed;
+				for (uint32_t a = 0; a < asteroidCount; a++)
+					anomalies[a] = belt->GetMeanAnomaly(a, orbitTime);
+
+				belt->EvaluateAtMeanAnomaly(&anomalies[0], &positions[0]);
+
+				for (uint32_t a = 0; a < asteroidCount; a++)
+				{
+					size_t column = bodyCount + a;
+					block[(column * 3 + 0) * blockSamples + k] = positions[a].x;
+					block[(column * 3 + 1) * blockSamples + k] = positions[a].y;
+					block[(column * 3 + 2) * blockSamples + k] = positions[a].z;
+				}
+			}
+		});
+
+		fwrite(&times[0], sizeof(double), count, file);
+		for (size_t run = 0; run < columns * 3; run++)
+			fwrite(&block[run * blockSamples], sizeof(float), count, file);
+
+		if (csv != nullptr)
+		{
+			for (size_t k = 0; k < count; k++)
+			{
+				fprintf(csv, "%.9g", times[k]);
+				for (size_t run = 0; run < columns * 3; run++)
+					fprintf(csv, ",%.7g", block[run * blockSamples + k]);
+				fprintf(csv, "\n");
+			}
+		}
+	}
+
+	bool failed = ferror(file) != 0;
+	fclose(file);
+
+	if (csv != nullptr)
+	{
+		failed = failed || ferror(csv) != 0;
+		fclose(csv);
+	}
+
+	if (failed)
+	{
+		error = L"Writing " + settings.Path + L" failed";
+		return E_FAIL;
+	}
+
+	return S_OK;
+}
+
+double EphemerisExport::SampleTime(const Settings& settings, unsigned long long sample)
+{
+	if (settings.Samples < 2)
+		return settings.Start;
+
+	return settings.Start + (settings.End - settings.Start) * ((double)sample / (double)(settings.Samples - 1));
+}
+
+bool EphemerisExport::ParseNumber(const wchar_t* text, double& value)
+{
+	wchar_t* end = nullptr;
+	value = wcstod(text, &end);
+	return end != text && *end == L'\0';
+}
+
+bool EphemerisExport::ParseNumber(const wchar_t* text, unsigned long long& value)
+{
+	wchar_t* end = nullptr;
+	value = wcstoull(text, &end, 10);
+	return end != text && *end == L'\0' && text[0] != L'-';
+}
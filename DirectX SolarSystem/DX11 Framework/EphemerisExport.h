@@ -0,0 +1,54 @@
+#pragma once
+#ifndef EPHEMERISEXPORT
+#define EPHEMERISEXPORT
+
+#include <windows.h>
+#include <string>
+#include "Ephemeris.h"
+#include "KeplerOrbits.h"
+
+//Batch mode that writes where everything is over a range of times to a file, instead of opening a window:
+//    "DX11 Framework.exe" -export <start> <end> <samples> <file> [-csv] [-asteroids] [-seed <n>] [-speed <s>] [-threads <n>]
+//Times are in simulation seconds, the same as Application::Evaluate takes.
+//
+//The file is little endian and columnar, in blocks so it can be written as it goes:
+//    char[4] "EPHM", uint32 version (1), uint64 samples, uint32 bodies, uint32 asteroids, uint32 samples per block,
+//    double start, double end, double speed, uint64 seed, then each body's name as a uint16 length and that many chars.
+//Each block of n samples (the last may be short) is double time[n], then for every body and then every asteroid, float x[n], y[n], z[n].
+//Positions are in world space, the asteroids' being relative to the Sun at the origin
+namespace EphemerisExport
+{
+	struct Settings
+	{
+		double Start, End;
+		unsigned long long Samples;
+		std::wstring Path;
+
+		//Also write a CSV to Path with ".csv" on the end, one row per sample
+		bool Csv;
+
+		//Include every asteroid in the belt as well as the planets and moons, generated from Seed
+		bool Asteroids;
+		unsigned long long Seed;
+
+		//Orbit time per unit of simulation time, zero for the scene's own
+		double Speed;
+	};
+
+	//Returns true if the full command line (program name first) asks for an export, filling settings from it with defaults for the rest.
+	//error is left empty unless the request is malformed
+	bool ParseCommandLine(const wchar_t* commandLine, Settings& settings, std::wstring& error);
+
+	//Evaluates every sample, spread across threads a block at a time, and streams each block out as it is finished. belt may be null
+	HRESULT Write(const Settings& settings, const Ephemeris& bodies, const char* const* bodyNames, const KeplerOrbits* belt, std::wstring& error);
+
+	//Helper methods for the above methods
+	//Simulation time of a sample, evenly spaced from Start to End inclusive
+	double SampleTime(const Settings& settings, unsigned long long sample);
+
+	//Whole argument as a number, false if there is anything else in it
+	bool ParseNumber(const wchar_t* text, double& value);
+	bool ParseNumber(const wchar_t* text, unsigned long long& value);
+};
+
+#endif
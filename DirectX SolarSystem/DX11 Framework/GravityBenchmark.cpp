@@ -0,0 +1,61 @@
+#include "GravityBenchmark.h"
+#include "EphemerisExport.h"
+#include "CommandLine.h"
+#include <shellapi.h>
+#include <stdio.h>
+
+bool GravityBenchmark::ParseCommandLine(const wchar_t* commandLine, Settings& settings, std::wstring& error)
+{
+	//A hundred thousand particles for long enough to settle into a steady rate, from a fixed seed so runs can be compared
+	settings.Particles = 100000;
+	settings.Steps = 300;
+	settings.Seed = 1;
+
+	error.clear();
+
+	int argc = 0;
+	LPWSTR* argv = CommandLineToArgvW(commandLine, &argc);
+	if (argv == nullptr)
+		return false;
+
+	bool requested = false;
+
+	for (int i = 1; i < argc && error.empty(); i++)
+	{
+		std::wstring argument = argv[i];
+
+		if (argument == L"-benchmark")
+		{
+			requested = true;
+
+			//Both counts are optional, but a count that is there has to be a number
+			if (i + 1 < argc && argv[i + 1][0] != L'-' && !EphemerisExport::ParseNumber(argv[++i], settings.Particles))
+				error = L"-benchmark takes a particle count and a step count";
+			else if (i + 1 < argc && argv[i + 1][0] != L'-' && !EphemerisExport::ParseNumber(argv[++i], settings.Steps))
+				error = L"-benchmark takes a particle count and a step count";
+		}
+	}
+
+	LocalFree(argv);
+
+	if (requested && error.empty())
+		CommandLine::ParseSeed(commandLine, settings.Seed, error);
+
+	if (requested && error.empty() && (settings.Particles == 0 || settings.Steps == 0))
+		error = L"-benchmark needs at least one particle and one step";
+
+	return requested;
+}
+
+std::wstring GravityBenchmark::Describe(const Settings& settings, const Result& result)
+{
+	wchar_t text[512];
+	swprintf_s(text, L"%llu particles, %llu steps, seed %llu, %u threads\n"
+		L"%.3f ms a step on average, %.3f ms at worst, up to %u substeps\n"
+		L"Energy drift %.3e",
+		settings.Particles, settings.Steps, settings.Seed, (unsigned int)result.Threads,
+		result.AverageSeconds * 1000.0, result.WorstSeconds * 1000.0, result.MaxSubsteps,
+		result.EnergyDrift);
+
+	return text;
+}
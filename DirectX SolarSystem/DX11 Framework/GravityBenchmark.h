@@ -0,0 +1,39 @@
+#pragma once
+#ifndef GRAVITYBENCHMARK
+#define GRAVITYBENCHMARK
+
+#include <windows.h>
+#include <string>
+
+//Batch mode that times the belt's gravity mode on a belt of any size, instead of opening a window:
+//    "DX11 Framework.exe" -benchmark [<particles>] [<steps>] [-seed <n>] [-threads <n>]
+//The belt is generated the same way as the scene's, just with more or fewer asteroids, and pulled on by the Sun and planets as in the scene.
+//Each step is a 60th of a second of simulation time, and what it took is reported when they are all done
+namespace GravityBenchmark
+{
+	struct Settings
+	{
+		unsigned long long Particles;
+		unsigned long long Steps;
+		unsigned long long Seed;
+	};
+
+	//What a run took, per step of the integrator
+	struct Result
+	{
+		double AverageSeconds;
+		double WorstSeconds;
+		double EnergyDrift;
+		unsigned int MaxSubsteps;
+		size_t Threads;
+	};
+
+	//Returns true if the full command line (program name first) asks for a benchmark, filling settings from it with defaults for the rest.
+	//error is left empty unless the request is malformed
+	bool ParseCommandLine(const wchar_t* commandLine, Settings& settings, std::wstring& error);
+
+	//One line per figure, for a message box
+	std::wstring Describe(const Settings& settings, const Result& result);
+};
+
+#endif
@@ -0,0 +1,267 @@
+#include "Integrator.h"
+#include "ParallelFor.h"
+#include <math.h>
+
+//Bodies per chunk below which splitting the update across threads costs more than it saves
+static const size_t MinimumChunk = 4096;
+
+void BodyState::Resize(size_t count)
+{
+	X.resize(count);
+	Y.resize(count);
+	Z.resize(count);
+	VX.resize(count);
+	VY.resize(count);
+	VZ.resize(count);
+}
+
+void BodyAccelerations::Resize(size_t count)
+{
+	X.resize(count);
+	Y.resize(count);
+	Z.resize(count);
+}
+
+Integrator::Integrator(IntegratorType type)
+{
+	m_Type = type;
+	m_AccelerationsValid = false;
+	m_Accuracy = 0.0f;
+	m_LengthScale = 1.0f;
+	m_MaxSubstepLevel = 0;
+	m_LastSubsteps = 1;
+}
+
+void Integrator::SetType(IntegratorType type)
+{
+	m_Type = type;
+}
+
+void Integrator::SetAdaptive(float accuracy, float lengthScale, unsigned int maxLevel)
+{
+	m_Accuracy = accuracy;
+	m_LengthScale = lengthScale;
+	m_MaxSubstepLevel = maxLevel;
+}
+
+const BodyAccelerations& Integrator::EnsureAccelerations(const BodyState& state, AccelerationField& field)
+{
+	if (!m_AccelerationsValid || m_Accelerations.X.size() != state.GetCount())
+	{
+		m_Accelerations.Resize(state.GetCount());
+		field.Evaluate(state, 0.0f, m_Accelerations);
+		m_AccelerationsValid = true;
+	}
+
+	return m_Accelerations;
+}
+
+void Integrator::Step(BodyState& state, AccelerationField& field, float dt)
+{
+	//The accelerations at the start say how hard the step will be, and leapfrog and Yoshida open with them anyway
+	EnsureAccelerations(state, field);
+
+	m_LastSubsteps = ChooseSubsteps(dt);
+	float substep = dt / m_LastSubsteps;
+
+	for (unsigned int i = 0; i < m_LastSubsteps; i++)
+	{
+		float time = substep * i;
+
+		switch (m_Type)
+		{
+		case INTEGRATOR_YOSHIDA4:
+			StepYoshida(state, field, substep, time);
+			break;
+		case INTEGRATOR_RK4:
+			StepRK4(state, field, substep, time);
+			break;
+		default:
+			StepLeapfrog(state, field, substep, time);
+			break;
+		}
+	}
+}
+
+const wchar_t* Integrator::GetName(IntegratorType type)
+{
+	switch (type)
+	{
+	case INTEGRATOR_LEAPFROG:
+		return L"leapfrog";
+	case INTEGRATOR_YOSHIDA4:
+		return L"Yoshida 4th order";
+	case INTEGRATOR_RK4:
+		return L"RK4";
+	default:
+		return L"unknown";
+	}
+}
+
+void Integrator::StepLeapfrog(BodyState& state, AccelerationField& field, float dt, float time)
+{
+	//Kick-drift-kick, the second kick's accelerations are kept for the next step's first
+	Kick(state, m_Accelerations, dt * 0.5f);
+	Drift(state, dt);
+	field.Evaluate(state, time + dt, m_Accelerations);
+	Kick(state, m_Accelerations, dt * 0.5f);
+}
+
+void Integrator::StepYoshida(BodyState& state, AccelerationField& field, float dt, float time)
+{
+	//Three leapfrog steps of w1, w0, w1 times dt cancel each other's third order error. w0 is negative, so the middle one goes backwards
+	const double cubeRootTwo = pow(2.0, 1.0 / 3.0);
+	const float weights[3] =
+	{
+		(float)(1.0 / (2.0 - cubeRootTwo)),
+		(float)(-cubeRootTwo / (2.0 - cubeRootTwo)),
+		(float)(1.0 / (2.0 - cubeRootTwo))
+	};
+
+	for (int i = 0; i < 3; i++)
+	{
+		float substep = dt * weights[i];
+
+		Kick(state, m_Accelerations, substep * 0.5f);
+		Drift(state, substep);
+		time += substep;
+		field.Evaluate(state, time, m_Accelerations);
+		Kick(state, m_Accelerations, substep * 0.5f);
+	}
+}
+
+void Integrator::StepRK4(BodyState& state, AccelerationField& field, float dt, float time)
+{
+	size_t count = state.GetCount();
+	m_Stage.Resize(count);
+	m_StageAccelerations.Resize(count);
+	m_Sum.Resize(count);
+
+	const float halfStep = dt * 0.5f;
+
+	//First stage is the state itself. m_Sum gathers v1 + 2v2 + 2v3 + v4 in its positions and the same of a in its velocities
+	ParallelFor(count, MinimumChunk, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			m_Sum.X[i] = state.VX[i];
+			m_Sum.Y[i] = state.VY[i];
+			m_Sum.Z[i] = state.VZ[i];
+			m_Sum.VX[i] = m_Accelerations.X[i];
+			m_Sum.VY[i] = m_Accelerations.Y[i];
+			m_Sum.VZ[i] = m_Accelerations.Z[i];
+
+			m_Stage.X[i] = state.X[i] + state.VX[i] * halfStep;
+			m_Stage.Y[i] = state.Y[i] + state.VY[i] * halfStep;
+			m_Stage.Z[i] = state.Z[i] + state.VZ[i] * halfStep;
+			m_Stage.VX[i] = state.VX[i] + m_Accelerations.X[i] * halfStep;
+			m_Stage.VY[i] = state.VY[i] + m_Accelerations.Y[i] * halfStep;
+			m_Stage.VZ[i] = state.VZ[i] + m_Accelerations.Z[i] * halfStep;
+		}
+	});
+
+	//Second and third stages, each starting from the state and moving along the stage before
+	const float stageSteps[2] = { halfStep, dt };
+
+	for (int stage = 0; stage < 2; stage++)
+	{
+		field.Evaluate(m_Stage, time + halfStep, m_StageAccelerations);
+
+		const float stageStep = stageSteps[stage];
+
+		ParallelFor(count, MinimumChunk, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				m_Sum.X[i] += 2.0f * m_Stage.VX[i];
+				m_Sum.Y[i] += 2.0f * m_Stage.VY[i];
+				m_Sum.Z[i] += 2.0f * m_Stage.VZ[i];
+				m_Sum.VX[i] += 2.0f * m_StageAccelerations.X[i];
+				m_Sum.VY[i] += 2.0f * m_StageAccelerations.Y[i];
+				m_Sum.VZ[i] += 2.0f * m_StageAccelerations.Z[i];
+
+				//Positions move with this stage's velocity before it is replaced
+				m_Stage.X[i] = state.X[i] + m_Stage.VX[i] * stageStep;
+				m_Stage.Y[i] = state.Y[i] + m_Stage.VY[i] * stageStep;
+				m_Stage.Z[i] = state.Z[i] + m_Stage.VZ[i] * stageStep;
+				m_Stage.VX[i] = state.VX[i] + m_StageAccelerations.X[i] * stageStep;
+				m_Stage.VY[i] = state.VY[i] + m_StageAccelerations.Y[i] * stageStep;
+				m_Stage.VZ[i] = state.VZ[i] + m_StageAccelerations.Z[i] * stageStep;
+			}
+		});
+	}
+
+	//Last stage at the end of the step, then the weighted average of all four
+	field.Evaluate(m_Stage, time + dt, m_StageAccelerations);
+
+	const float sixthStep = dt / 6.0f;
+
+	ParallelFor(count, MinimumChunk, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			state.X[i] += (m_Sum.X[i] + m_Stage.VX[i]) * sixthStep;
+			state.Y[i] += (m_Sum.Y[i] + m_Stage.VY[i]) * sixthStep;
+			state.Z[i] += (m_Sum.Z[i] + m_Stage.VZ[i]) * sixthStep;
+			state.VX[i] += (m_Sum.VX[i] + m_StageAccelerations.X[i]) * sixthStep;
+			state.VY[i] += (m_Sum.VY[i] + m_StageAccelerations.Y[i]) * sixthStep;
+			state.VZ[i] += (m_Sum.VZ[i] + m_StageAccelerations.Z[i]) * sixthStep;
+		}
+	});
+
+	//Nothing has been evaluated at the new state yet, so the next step has to start with that
+	m_AccelerationsValid = false;
+	EnsureAccelerations(state, field);
+}
+
+void Integrator::Kick(BodyState& state, const BodyAccelerations& accelerations, float dt)
+{
+	ParallelFor(state.GetCount(), MinimumChunk, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			state.VX[i] += accelerations.X[i] * dt;
+			state.VY[i] += accelerations.Y[i] * dt;
+			state.VZ[i] += accelerations.Z[i] * dt;
+		}
+	});
+}
+
+void Integrator::Drift(BodyState& state, float dt)
+{
+	ParallelFor(state.GetCount(), MinimumChunk, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			state.X[i] += state.VX[i] * dt;
+			state.Y[i] += state.VY[i] * dt;
+			state.Z[i] += state.VZ[i] * dt;
+		}
+	});
+}
+
+unsigned int Integrator::ChooseSubsteps(float dt) const
+{
+	if (m_Accuracy <= 0.0f || m_MaxSubstepLevel == 0)
+		return 1;
+
+	//Largest acceleration sets the shortest timescale
+	float largestSq = 0.0f;
+	for (size_t i = 0; i < m_Accelerations.X.size(); i++)
+	{
+		float accelerationSq = m_Accelerations.X[i] * m_Accelerations.X[i] + m_Accelerations.Y[i] * m_Accelerations.Y[i] + m_Accelerations.Z[i] * m_Accelerations.Z[i];
+		if (accelerationSq > largestSq)
+			largestSq = accelerationSq;
+	}
+
+	if (largestSq <= 0.0f)
+		return 1;
+
+	float timescale = m_Accuracy * sqrtf(m_LengthScale / sqrtf(largestSq));
+
+	unsigned int level = 0;
+	while (level < m_MaxSubstepLevel && dt / (float)(1u << level) > timescale)
+		level++;
+
+	return 1u << level;
+}
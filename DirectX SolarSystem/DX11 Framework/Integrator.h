@@ -0,0 +1,102 @@
+#pragma once
+#ifndef INTEGRATOR
+#define INTEGRATOR
+
+#include <vector>
+#include <stddef.h>
+
+enum IntegratorType
+{
+	INTEGRATOR_LEAPFROG,
+	INTEGRATOR_YOSHIDA4,
+	INTEGRATOR_RK4,
+	INTEGRATOR_TYPE_COUNT
+};
+
+//Positions and velocities of a batch of bodies, one array per component
+struct BodyState
+{
+	std::vector<float> X, Y, Z;
+	std::vector<float> VX, VY, VZ;
+
+	void Resize(size_t count);
+	size_t GetCount() const { return X.size(); }
+};
+
+//Accelerations of a batch of bodies, laid out like BodyState
+struct BodyAccelerations
+{
+	std::vector<float> X, Y, Z;
+
+	void Resize(size_t count);
+};
+
+//Whatever the bodies are moving through. Evaluate fills in every body's acceleration at the given state,
+//time being how far into the current step the state is
+class AccelerationField
+{
+public:
+	virtual ~AccelerationField() {}
+
+	virtual void Evaluate(const BodyState& state, float time, BodyAccelerations& accelerations) = 0;
+};
+
+//Steps a BodyState through an AccelerationField with a choice of method, each body's update running in parallel chunks.
+//A step can be split into a power of two substeps, as many as the body closest to an encounter needs.
+//Nothing depends on how the chunks fall across threads, so a given start always gives the same result
+class Integrator
+{
+private:
+	IntegratorType m_Type;
+
+	//Accelerations at the current state, kept from the end of one step to start the next when the method allows it
+	BodyAccelerations m_Accelerations;
+	bool m_AccelerationsValid;
+
+	//Stage state and running sums for RK4
+	BodyState m_Stage;
+	BodyAccelerations m_StageAccelerations;
+	BodyState m_Sum;
+
+	//Adaptive substepping, see SetAdaptive
+	float m_Accuracy;
+	float m_LengthScale;
+	unsigned int m_MaxSubstepLevel;
+	unsigned int m_LastSubsteps;
+
+	//Helper methods for the above method(s)
+	void StepLeapfrog(BodyState& state, AccelerationField& field, float dt, float time);
+	void StepYoshida(BodyState& state, AccelerationField& field, float dt, float time);
+	void StepRK4(BodyState& state, AccelerationField& field, float dt, float time);
+	void Kick(BodyState& state, const BodyAccelerations& accelerations, float dt);
+	void Drift(BodyState& state, float dt);
+	unsigned int ChooseSubsteps(float dt) const;
+
+public:
+	//Constructor
+	Integrator(IntegratorType type = INTEGRATOR_LEAPFROG);
+
+	void SetType(IntegratorType type);
+	IntegratorType GetType() const { return m_Type; }
+
+	//Splits a step until every body's substep is at most accuracy * sqrt(lengthScale / |a|), up to 2^maxLevel substeps.
+	//An accuracy of zero turns it off
+	void SetAdaptive(float accuracy, float lengthScale, unsigned int maxLevel);
+
+	//Call when the state has been changed from outside, so the kept accelerations are not used
+	void Invalidate() { m_AccelerationsValid = false; }
+
+	//Makes sure the accelerations at the current state have been evaluated, and returns them
+	const BodyAccelerations& EnsureAccelerations(const BodyState& state, AccelerationField& field);
+
+	//Advances the state by dt
+	void Step(BodyState& state, AccelerationField& field, float dt);
+
+	//How many substeps the last Step was split into
+	unsigned int GetLastSubsteps() const { return m_LastSubsteps; }
+
+	//Name of a method, for display
+	static const wchar_t* GetName(IntegratorType type);
+};
+
+#endif
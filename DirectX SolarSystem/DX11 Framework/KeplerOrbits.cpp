@@ -0,0 +1,244 @@
+#include "KeplerOrbits.h"
+#include <math.h>
+
+KeplerOrbits::KeplerOrbits()
+{
+	m_Count = 0;
+	m_LastIterations = 0;
+}
+
+void KeplerOrbits::Reserve(size_t count)
+{
+	size_t lanes = (count + 3) & ~(size_t)3;
+
+	m_SemiMajorAxis.reserve(lanes);
+	m_Eccentricity.reserve(lanes);
+	m_MinorAxisRatio.reserve(lanes);
+	m_MeanMotion.reserve(lanes);
+	m_MeanAnomalyAtEpoch.reserve(lanes);
+	m_Px.reserve(lanes);
+	m_Py.reserve(lanes);
+	m_Pz.reserve(lanes);
+	m_Qx.reserve(lanes);
+	m_Qy.reserve(lanes);
+	m_Qz.reserve(lanes);
+	m_MeanAnomaly.reserve(lanes);
+}
+
+size_t KeplerOrbits::Add(const OrbitalElements& elements)
+{
+	if (m_Count == m_SemiMajorAxis.size())
+		PushPadding();
+
+	size_t index = m_Count++;
+
+	float eccentricity = elements.Eccentricity;
+	if (eccentricity < 0.0f)
+		eccentricity = 0.0f;
+	else if (eccentricity > 0.99f)
+		eccentricity = 0.99f;
+
+	m_SemiMajorAxis[index] = elements.SemiMajorAxis;
+	m_Eccentricity[index] = eccentricity;
+	m_MinorAxisRatio[index] = sqrtf(1.0f - eccentricity * eccentricity);
+	m_MeanMotion[index] = elements.MeanMotion;
+	m_MeanAnomalyAtEpoch[index] = elements.MeanAnomalyAtEpoch;
+
+	//Turn the orbit within its plane by the argument of periapsis, tilt it about the line of nodes (X), then swing the nodes round by their longitude.
+	//Q starts on -Z so that the body moves the same way as a positive XMMatrixRotationY
+	XMMATRIX orientation = XMMatrixRotationY(elements.ArgumentOfPeriapsis) * XMMatrixRotationX(elements.Inclination) * XMMatrixRotationY(elements.LongitudeOfNode);
+
+	XMFLOAT3 p, q;
+	XMStoreFloat3(&p, XMVector3TransformNormal(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), orientation));
+	XMStoreFloat3(&q, XMVector3TransformNormal(XMVectorSet(0.0f, 0.0f, -1.0f, 0.0f), orientation));
+
+	m_Px[index] = p.x;
+	m_Py[index] = p.y;
+	m_Pz[index] = p.z;
+	m_Qx[index] = q.x;
+	m_Qy[index] = q.y;
+	m_Qz[index] = q.z;
+
+	return index;
+}
+
+void KeplerOrbits::Evaluate(double time, XMFLOAT3* positions, XMFLOAT3* velocities)
+{
+	m_LastIterations = 0;
+	if (m_Count == 0)
+		return;
+
+	for (size_t i = 0; i < m_Count; i++)
+		m_MeanAnomaly[i] = GetMeanAnomaly(i, time);
+
+	m_LastIterations = EvaluateAtMeanAnomaly(&m_MeanAnomaly[0], positions, velocities);
+}
+
+float KeplerOrbits::GetMeanAnomaly(size_t index, double time) const
+{
+	const double twoPi = 6.283185307179586;
+	const double pi = 3.141592653589793;
+
+	//Wrap the mean anomaly in double first, in float the fraction of an orbit would be lost after a long run
+	double meanAnomaly = fmod((double)m_MeanAnomalyAtEpoch[index] + (double)m_MeanMotion[index] * time, twoPi);
+
+	if (meanAnomaly > pi)
+		meanAnomaly -= twoPi;
+	else if (meanAnomaly < -pi)
+		meanAnomaly += twoPi;
+
+	return (float)meanAnomaly;
+}
+
+unsigned int KeplerOrbits::EvaluateAtMeanAnomaly(const float* meanAnomalies, XMFLOAT3* positions, XMFLOAT3* velocities) const
+{
+	size_t lanes = m_SemiMajorAxis.size();
+	unsigned int mostIterations = 0;
+
+	for (size_t i = 0; i < lanes; i += 4)
+	{
+		//The last group reads past the caller's m_Count anomalies only for padding lanes, so take those as zero
+		XMFLOAT4 anomalies(0.0f, 0.0f, 0.0f, 0.0f);
+		float* anomalyLanes = &anomalies.x;
+		for (size_t lane = 0; lane < 4 && i + lane < m_Count; lane++)
+			anomalyLanes[lane] = meanAnomalies[i + lane];
+
+		unsigned int iterations = SolveGroup(i, anomalies, positions, velocities);
+		if (iterations > mostIterations)
+			mostIterations = iterations;
+	}
+
+	return mostIterations;
+}
+
+unsigned int KeplerOrbits::EvaluateGroups(double time, const unsigned int* groups, size_t groupCount, XMFLOAT3* positions, XMFLOAT3* velocities)
+{
+	m_LastIterations = 0;
+
+	for (size_t g = 0; g < groupCount; g++)
+	{
+		size_t i = (size_t)groups[g] * 4;
+		if (i >= m_Count)
+			continue;
+
+		XMFLOAT4 anomalies(0.0f, 0.0f, 0.0f, 0.0f);
+		float* anomalyLanes = &anomalies.x;
+		for (size_t lane = 0; lane < 4 && i + lane < m_Count; lane++)
+			anomalyLanes[lane] = GetMeanAnomaly(i + lane, time);
+
+		unsigned int iterations = SolveGroup(i, anomalies, positions, velocities);
+		if (iterations > m_LastIterations)
+			m_LastIterations = iterations;
+	}
+
+	return m_LastIterations;
+}
+
+unsigned int KeplerOrbits::SolveGroup(size_t i, const XMFLOAT4& anomalies, XMFLOAT3* positions, XMFLOAT3* velocities) const
+{
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorReplicate(1.0f);
+	const XMVECTOR half = XMVectorReplicate(0.5f);
+	const XMVECTOR tolerance = XMVectorReplicate(1.0e-6f);
+	const XMVECTOR highEccentricity = XMVectorReplicate(0.8f);
+	const XMVECTOR allLanes = XMVectorTrueInt();
+
+	XMVECTOR M = XMLoadFloat4(&anomalies);
+	XMVECTOR e = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Eccentricity[i]));
+
+	//Start from M + e sin M, or from pi on the same side as M where that guess can overshoot on very eccentric orbits
+	XMVECTOR sinE, cosE;
+	XMVectorSinCos(&sinE, &cosE, M);
+
+	XMVECTOR E = XMVectorMultiplyAdd(e, sinE, M);
+	XMVECTOR signedPi = XMVectorSelect(XMVectorReplicate(XM_PI), XMVectorReplicate(-XM_PI), XMVectorLess(M, zero));
+	E = XMVectorSelect(E, signedPi, XMVectorGreater(e, highEccentricity));
+
+	//Halley's method on f(E) = E - e sin E - M. Each lane is frozen as soon as its step is small enough,
+	//and the group stops once every lane has
+	XMVECTOR converged = XMVectorFalseInt();
+	unsigned int iteration = 0;
+
+	while (iteration < MaxIterations)
+	{
+		iteration++;
+
+		XMVectorSinCos(&sinE, &cosE, E);
+
+		XMVECTOR eSinE = XMVectorMultiply(e, sinE);
+		XMVECTOR f = XMVectorSubtract(XMVectorSubtract(E, eSinE), M);
+		XMVECTOR firstDerivative = XMVectorNegativeMultiplySubtract(e, cosE, one);
+
+		//f / (f' - f f'' / 2f'), where f'' = e sin E. f' is at least 1 - e so never zero for a closed orbit
+		XMVECTOR denominator = XMVectorSubtract(firstDerivative, XMVectorDivide(XMVectorMultiply(XMVectorMultiply(half, f), eSinE), firstDerivative));
+		XMVECTOR delta = XMVectorSelect(XMVectorDivide(f, denominator), zero, converged);
+
+		E = XMVectorSubtract(E, delta);
+
+		converged = XMVectorOrInt(converged, XMVectorLessOrEqual(XMVectorAbs(delta), tolerance));
+
+		if (XMVector4EqualInt(converged, allLanes))
+			break;
+	}
+
+	XMVectorSinCos(&sinE, &cosE, E);
+
+	//Position within the orbital plane, along P and Q
+	XMVECTOR a = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_SemiMajorAxis[i]));
+	XMVECTOR b = XMVectorMultiply(a, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_MinorAxisRatio[i])));
+
+	XMVECTOR alongP = XMVectorMultiply(a, XMVectorSubtract(cosE, e));
+	XMVECTOR alongQ = XMVectorMultiply(b, sinE);
+
+	XMFLOAT4 x, y, z;
+	XMStoreFloat4(&x, XMVectorMultiplyAdd(alongP, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Px[i])), XMVectorMultiply(alongQ, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Qx[i])))));
+	XMStoreFloat4(&y, XMVectorMultiplyAdd(alongP, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Py[i])), XMVectorMultiply(alongQ, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Qy[i])))));
+	XMStoreFloat4(&z, XMVectorMultiplyAdd(alongP, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Pz[i])), XMVectorMultiply(alongQ, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Qz[i])))));
+
+	//Back out to one position per orbit, skipping the padding lanes
+	const float* xs = &x.x;
+	const float* ys = &y.x;
+	const float* zs = &z.x;
+
+	for (size_t lane = 0; lane < 4 && i + lane < m_Count; lane++)
+		positions[i + lane] = XMFLOAT3(xs[lane], ys[lane], zs[lane]);
+
+	if (velocities == nullptr)
+		return iteration;
+
+	//Differentiating through E, dE/dt = n / (1 - e cos E)
+	XMVECTOR n = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_MeanMotion[i]));
+	XMVECTOR eccentricAnomalyRate = XMVectorDivide(n, XMVectorNegativeMultiplySubtract(e, cosE, one));
+
+	XMVECTOR speedAlongP = XMVectorNegate(XMVectorMultiply(XMVectorMultiply(a, sinE), eccentricAnomalyRate));
+	XMVECTOR speedAlongQ = XMVectorMultiply(XMVectorMultiply(b, cosE), eccentricAnomalyRate);
+
+	XMStoreFloat4(&x, XMVectorMultiplyAdd(speedAlongP, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Px[i])), XMVectorMultiply(speedAlongQ, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Qx[i])))));
+	XMStoreFloat4(&y, XMVectorMultiplyAdd(speedAlongP, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Py[i])), XMVectorMultiply(speedAlongQ, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Qy[i])))));
+	XMStoreFloat4(&z, XMVectorMultiplyAdd(speedAlongP, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Pz[i])), XMVectorMultiply(speedAlongQ, XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&m_Qz[i])))));
+
+	for (size_t lane = 0; lane < 4 && i + lane < m_Count; lane++)
+		velocities[i + lane] = XMFLOAT3(xs[lane], ys[lane], zs[lane]);
+
+	return iteration;
+}
+
+void KeplerOrbits::PushPadding()
+{
+	//Empty orbits sit at the origin and converge on the first iteration, so they never hold the other lanes back
+	for (int i = 0; i < 4; i++)
+	{
+		m_SemiMajorAxis.push_back(0.0f);
+		m_Eccentricity.push_back(0.0f);
+		m_MinorAxisRatio.push_back(1.0f);
+		m_MeanMotion.push_back(0.0f);
+		m_MeanAnomalyAtEpoch.push_back(0.0f);
+		m_Px.push_back(0.0f);
+		m_Py.push_back(0.0f);
+		m_Pz.push_back(0.0f);
+		m_Qx.push_back(0.0f);
+		m_Qy.push_back(0.0f);
+		m_Qz.push_back(0.0f);
+		m_MeanAnomaly.push_back(0.0f);
+	}
+}
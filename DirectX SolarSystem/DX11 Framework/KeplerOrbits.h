@@ -0,0 +1,95 @@
+#pragma once
+#ifndef KEPLERORBITS
+#define KEPLERORBITS
+
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+//Classical orbital elements for one body, angles in radians.
+//The reference plane is XZ with Y up, and a body with every angle at zero starts on +X moving the same way XMMatrixRotationY turns
+struct OrbitalElements
+{
+	float SemiMajorAxis;
+	float Eccentricity;
+	float Inclination;
+	float LongitudeOfNode;
+	float ArgumentOfPeriapsis;
+	float MeanAnomalyAtEpoch;
+
+	//Radians of mean anomaly per unit of simulation time
+	float MeanMotion;
+};
+
+//Any number of Kepler orbits evaluated together.
+//The elements are kept as a structure of arrays so Kepler's equation can be solved four bodies at a time with Halley's method,
+//each lane dropping out of the iteration once it has converged
+class KeplerOrbits
+{
+private:
+	//Per orbit values, padded with empty orbits to a whole number of four wide lanes
+	std::vector<float> m_SemiMajorAxis;
+	std::vector<float> m_Eccentricity;
+	std::vector<float> m_MinorAxisRatio;
+	std::vector<float> m_MeanMotion;
+	std::vector<float> m_MeanAnomalyAtEpoch;
+
+	//Unit vectors towards periapsis (P) and a quarter of an orbit on from it (Q)
+	std::vector<float> m_Px, m_Py, m_Pz;
+	std::vector<float> m_Qx, m_Qy, m_Qz;
+
+	//Working space for Evaluate
+	std::vector<float> m_MeanAnomaly;
+
+	size_t m_Count;
+	unsigned int m_LastIterations;
+
+	//Helper methods for the above method(s)
+	void PushPadding();
+
+	//Solves the four orbits from i at their mean anomalies and writes their positions, and velocities if given. Returns the Halley iterations taken
+	unsigned int SolveGroup(size_t i, const XMFLOAT4& anomalies, XMFLOAT3* positions, XMFLOAT3* velocities) const;
+
+public:
+	static const unsigned int MaxIterations = 8;
+
+	//Constructor
+	KeplerOrbits();
+
+	//Makes room for a number of orbits so adding them does not reallocate
+	void Reserve(size_t count);
+
+	//Adds an orbit and returns its index. Eccentricity is clamped below 1, only closed orbits are supported
+	size_t Add(const OrbitalElements& elements);
+
+	size_t GetCount() const { return m_Count; }
+
+	//Writes every orbit's position at the given time, relative to whatever it orbits. positions must hold GetCount() entries,
+	//as must velocities if given, which are in distance per unit of the same time
+	void Evaluate(double time, XMFLOAT3* positions, XMFLOAT3* velocities = nullptr);
+
+	//Same as Evaluate, but at each orbit's mean anomaly (GetCount() of them) rather than a time. Changes nothing, so any number of threads
+	//can call it at once. Returns the most Halley iterations any lane needed
+	unsigned int EvaluateAtMeanAnomaly(const float* meanAnomalies, XMFLOAT3* positions, XMFLOAT3* velocities = nullptr) const;
+
+	//Same as Evaluate, but only for the listed groups of four orbits, group g being orbits 4g to 4g + 3, the width Kepler's equation is solved at.
+	//Only those orbits' positions and velocities are written. Returns the most Halley iterations any lane needed
+	unsigned int EvaluateGroups(double time, const unsigned int* groups, size_t groupCount, XMFLOAT3* positions, XMFLOAT3* velocities = nullptr);
+
+	//Groups of four orbits EvaluateGroups takes
+	size_t GetGroupCount() const { return m_SemiMajorAxis.size() / 4; }
+
+	//Mean anomaly of an orbit at a time, wrapped to [-pi, pi]
+	float GetMeanAnomaly(size_t index, double time) const;
+
+	float GetMeanMotion(size_t index) const { return m_MeanMotion[index]; }
+
+	//G times the mass being orbited that would give an orbit its period, n^2 a^3
+	float GetGravitationalParameter(size_t index) const { return m_MeanMotion[index] * m_MeanMotion[index] * m_SemiMajorAxis[index] * m_SemiMajorAxis[index] * m_SemiMajorAxis[index]; }
+
+	//The most Halley iterations any lane needed in the last Evaluate
+	unsigned int GetLastIterations() const { return m_LastIterations; }
+};
+
+#endif
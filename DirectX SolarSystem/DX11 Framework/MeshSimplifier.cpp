@@ -0,0 +1,575 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <queue>
+#include <string>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+
+namespace
+{
+	//Projected radius in pixels below which each level is used, level 0 is used above the first threshold
+	const float LODPixelThresholds[MeshSimplifier::MaxLODs] = { 0.0f, 120.0f, 48.0f, 16.0f };
+
+	//Symmetric 4x4 quadric stored as its upper triangle
+	struct Quadric
+	{
+		double a[10];
+
+		Quadric() { for (int i = 0; i < 10; i++) a[i] = 0.0; }
+
+		//Quadric of the plane nx + ny + nz + d = 0 scaled by weight
+		Quadric(double nx, double ny, double nz, double d, double weight)
+		{
+			a[0] = nx * nx * weight; a[1] = nx * ny * weight; a[2] = nx * nz * weight; a[3] = nx * d * weight;
+			a[4] = ny * ny * weight; a[5] = ny * nz * weight; a[6] = ny * d * weight;
+			a[7] = nz * nz * weight; a[8] = nz * d * weight;
+			a[9] = d * d * weight;
+		}
+
+		Quadric& operator+=(const Quadric& other)
+		{
+			for (int i = 0; i < 10; i++) a[i] += other.a[i];
+			return *this;
+		}
+
+		double Error(const XMFLOAT3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			return a[0] * x * x + 2 * a[1] * x * y + 2 * a[2] * x * z + 2 * a[3] * x
+				+ a[4] * y * y + 2 * a[5] * y * z + 2 * a[6] * y
+				+ a[7] * z * z + 2 * a[8] * z
+				+ a[9];
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		UINT from;
+		UINT to;
+		UINT version;
+
+		bool operator<(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	struct PositionLess
+	{
+		bool operator()(const XMFLOAT3& a, const XMFLOAT3& b) const
+		{
+			if (a.x != b.x) return a.x < b.x;
+			if (a.y != b.y) return a.y < b.y;
+			return a.z < b.z;
+		}
+	};
+
+	XMVECTOR FaceNormal(const XMFLOAT3& a, const XMFLOAT3& b, const XMFLOAT3& c)
+	{
+		XMVECTOR pa = XMLoadFloat3(&a);
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b), pa), XMVectorSubtract(XMLoadFloat3(&c), pa));
+	}
+
+	//Translation and uniform scale that take a model's bounding sphere onto the unit sphere at the origin
+	XMFLOAT4X4 FitToUnitSphere(const std::vector<SimpleVertex>& vertices)
+	{
+		XMFLOAT4X4 fit;
+		XMStoreFloat4x4(&fit, XMMatrixIdentity());
+
+		if (vertices.empty())
+			return fit;
+
+		XMVECTOR low = XMLoadFloat3(&vertices[0].Pos);
+		XMVECTOR high = low;
+		for (size_t i = 1; i < vertices.size(); i++)
+		{
+			low = XMVectorMin(low, XMLoadFloat3(&vertices[i].Pos));
+			high = XMVectorMax(high, XMLoadFloat3(&vertices[i].Pos));
+		}
+
+		XMVECTOR centre = XMVectorScale(XMVectorAdd(low, high), 0.5f);
+
+		float radiusSq = 0.0f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			float distanceSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&vertices[i].Pos), centre)));
+			radiusSq = distanceSq > radiusSq ? distanceSq : radiusSq;
+		}
+
+		if (radiusSq <= 0.0f)
+			return fit;
+
+		float scale = 1.0f / sqrtf(radiusSq);
+		XMStoreFloat4x4(&fit, XMMatrixTranslationFromVector(XMVectorNegate(centre)) * XMMatrixScaling(scale, scale, scale));
+		return fit;
+	}
+
+	//Working state for one Simplify call
+	struct Simplifier
+	{
+		const std::vector<SimpleVertex>& vertices;
+		std::vector<UINT> faces;
+		std::vector<bool> faceAlive;
+		std::vector<std::vector<UINT>> vertexFaces;
+		std::vector<Quadric> quadrics;
+		std::vector<bool> locked;
+		std::vector<UINT> positionIds;
+		std::vector<std::vector<UINT>> seamCopies;
+		std::vector<UINT> versions;
+		std::priority_queue<Collapse> queue;
+
+		Simplifier(const std::vector<SimpleVertex>& inVertices, const std::vector<unsigned short>& inIndices)
+			: vertices(inVertices)
+		{
+			//OBJLoader gives every corner its own vertex, so faces are joined up through the first copy of each vertex.
+			//The copies are left without faces and never take part
+			std::map<SimpleVertex, UINT> firstCopies;
+			std::vector<UINT> welded(vertices.size());
+			for (UINT i = 0; i < vertices.size(); i++)
+				welded[i] = firstCopies.insert(std::make_pair(vertices[i], i)).first->second;
+
+			faces.resize(inIndices.size());
+			for (size_t i = 0; i < inIndices.size(); i++)
+				faces[i] = welded[inIndices[i]];
+
+			faceAlive.assign(faces.size() / 3, true);
+			vertexFaces.resize(vertices.size());
+			quadrics.resize(vertices.size());
+			locked.assign(vertices.size(), false);
+			versions.assign(vertices.size(), 0);
+
+			for (UINT f = 0; f < faces.size() / 3; f++)
+			{
+				for (int i = 0; i < 3; i++)
+					vertexFaces[faces[f * 3 + i]].push_back(f);
+			}
+
+			//Welded vertices sharing a position with another one sit on a UV or normal seam
+			std::map<XMFLOAT3, UINT, PositionLess> positionCounts;
+			for (auto it = firstCopies.begin(); it != firstCopies.end(); ++it)
+				positionCounts[it->first.Pos]++;
+
+			for (auto it = firstCopies.begin(); it != firstCopies.end(); ++it)
+			{
+				if (positionCounts[it->first.Pos] > 1)
+					locked[it->second] = true;
+			}
+
+			//The surface is joined up across seams by position, so the link condition goes by these rather than vertices
+			std::map<XMFLOAT3, UINT, PositionLess> positionIndices;
+			positionIds.resize(vertices.size());
+			for (size_t i = 0; i < vertices.size(); i++)
+				positionIds[i] = positionIndices.insert(std::make_pair(vertices[i].Pos, (UINT)positionIndices.size())).first->second;
+
+			//Every welded vertex at each position, one of them unless it is on a seam
+			seamCopies.resize(positionIndices.size());
+			for (auto it = firstCopies.begin(); it != firstCopies.end(); ++it)
+				seamCopies[positionIds[it->second]].push_back(it->second);
+
+			//Area weighted plane quadrics, and lock both ends of any edge with only one face
+			std::map<std::pair<UINT, UINT>, UINT> edgeUse;
+			for (UINT f = 0; f < faces.size() / 3; f++)
+			{
+				const XMFLOAT3& a = vertices[faces[f * 3]].Pos;
+				const XMFLOAT3& b = vertices[faces[f * 3 + 1]].Pos;
+				const XMFLOAT3& c = vertices[faces[f * 3 + 2]].Pos;
+
+				XMVECTOR n = FaceNormal(a, b, c);
+				float area = XMVectorGetX(XMVector3Length(n));
+				if (area > 0.0f)
+				{
+					XMFLOAT3 unit;
+					XMStoreFloat3(&unit, XMVectorScale(n, 1.0f / area));
+					double d = -((double)unit.x * a.x + (double)unit.y * a.y + (double)unit.z * a.z);
+
+					Quadric q(unit.x, unit.y, unit.z, d, area * 0.5);
+					for (int i = 0; i < 3; i++)
+						quadrics[faces[f * 3 + i]] += q;
+				}
+
+				for (int i = 0; i < 3; i++)
+				{
+					UINT v0 = faces[f * 3 + i];
+					UINT v1 = faces[f * 3 + (i + 1) % 3];
+					edgeUse[std::make_pair((std::min)(v0, v1), (std::max)(v0, v1))]++;
+				}
+			}
+
+			for (auto it = edgeUse.begin(); it != edgeUse.end(); ++it)
+			{
+				if (it->second == 1)
+				{
+					locked[it->first.first] = true;
+					locked[it->first.second] = true;
+				}
+			}
+
+			for (UINT v = 0; v < vertices.size(); v++)
+				PushBestCollapse(v);
+		}
+
+		//Position of every vertex sharing a live face with v, in order and without v's own
+		void GatherRing(UINT v, std::vector<UINT>& ring) const
+		{
+			ring.clear();
+			for (size_t i = 0; i < vertexFaces[v].size(); i++)
+			{
+				UINT f = vertexFaces[v][i];
+				if (!faceAlive[f])
+					continue;
+
+				for (int k = 0; k < 3; k++)
+				{
+					if (positionIds[faces[f * 3 + k]] != positionIds[v])
+						ring.push_back(positionIds[faces[f * 3 + k]]);
+				}
+			}
+
+			std::sort(ring.begin(), ring.end());
+			ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+		}
+
+		//The link condition: the only positions next to both ends may be the ones opposite the edge. Any other shared neighbour
+		//would be left with two edges folded onto one, pinching the surface into a non-manifold one. Seam copies of 'to' have faces
+		//of their own, so those are gathered as well
+		bool LinkConditionHolds(UINT from, UINT to) const
+		{
+			std::vector<UINT> fromRing, toRing, copyRing, shared, opposite;
+			GatherRing(from, fromRing);
+
+			const std::vector<UINT>& copies = seamCopies[positionIds[to]];
+			for (size_t i = 0; i < copies.size(); i++)
+			{
+				GatherRing(copies[i], copyRing);
+				toRing.insert(toRing.end(), copyRing.begin(), copyRing.end());
+			}
+
+			std::sort(toRing.begin(), toRing.end());
+			toRing.erase(std::unique(toRing.begin(), toRing.end()), toRing.end());
+			std::set_intersection(fromRing.begin(), fromRing.end(), toRing.begin(), toRing.end(), std::back_inserter(shared));
+
+			for (size_t i = 0; i < vertexFaces[from].size(); i++)
+			{
+				UINT f = vertexFaces[from][i];
+				if (!faceAlive[f])
+					continue;
+
+				const UINT* face = &faces[f * 3];
+				if (face[0] != to && face[1] != to && face[2] != to)
+					continue;
+
+				for (int k = 0; k < 3; k++)
+				{
+					if (face[k] != from && face[k] != to)
+						opposite.push_back(positionIds[face[k]]);
+				}
+			}
+
+			std::sort(opposite.begin(), opposite.end());
+			opposite.erase(std::unique(opposite.begin(), opposite.end()), opposite.end());
+
+			return shared == opposite;
+		}
+
+		//Moving 'from' onto 'to' must not flip or collapse any face that survives
+		bool CollapseIsValid(UINT from, UINT to) const
+		{
+			for (size_t i = 0; i < vertexFaces[from].size(); i++)
+			{
+				UINT f = vertexFaces[from][i];
+				if (!faceAlive[f])
+					continue;
+
+				const UINT* face = &faces[f * 3];
+				if (face[0] == to || face[1] == to || face[2] == to)
+					continue;
+
+				XMFLOAT3 before[3], after[3];
+				for (int k = 0; k < 3; k++)
+				{
+					before[k] = vertices[face[k]].Pos;
+					after[k] = face[k] == from ? vertices[to].Pos : before[k];
+				}
+
+				XMVECTOR nBefore = FaceNormal(before[0], before[1], before[2]);
+				XMVECTOR nAfter = FaceNormal(after[0], after[1], after[2]);
+
+				float lengthAfter = XMVectorGetX(XMVector3Length(nAfter));
+				if (lengthAfter < 1e-12f)
+					return false;
+
+				float lengthBefore = XMVectorGetX(XMVector3Length(nBefore));
+				if (XMVectorGetX(XMVector3Dot(nBefore, nAfter)) < 0.2f * lengthBefore * lengthAfter)
+					return false;
+			}
+
+			return true;
+		}
+
+		void PushBestCollapse(UINT from)
+		{
+			if (locked[from])
+				return;
+
+			Collapse best;
+			best.cost = -1.0;
+
+			for (size_t i = 0; i < vertexFaces[from].size(); i++)
+			{
+				UINT f = vertexFaces[from][i];
+				if (!faceAlive[f])
+					continue;
+
+				for (int k = 0; k < 3; k++)
+				{
+					UINT to = faces[f * 3 + k];
+					if (to == from)
+						continue;
+
+					Quadric q = quadrics[from];
+					q += quadrics[to];
+					double cost = q.Error(vertices[to].Pos);
+
+					if (best.cost < 0.0 || cost < best.cost)
+					{
+						best.cost = cost;
+						best.to = to;
+					}
+				}
+			}
+
+			if (best.cost >= 0.0)
+			{
+				best.from = from;
+				best.version = versions[from];
+				queue.push(best);
+			}
+		}
+
+		UINT Run(UINT targetTriangles, double maxError)
+		{
+			UINT liveFaces = (UINT)faceAlive.size();
+
+			while (liveFaces > targetTriangles && !queue.empty())
+			{
+				Collapse c = queue.top();
+				queue.pop();
+
+				if (c.version != versions[c.from])
+					continue;
+
+				if (c.cost > maxError)
+					break;
+
+				if (!LinkConditionHolds(c.from, c.to) || !CollapseIsValid(c.from, c.to))
+				{
+					//Try again once the neighbourhood changes
+					versions[c.from]++;
+					continue;
+				}
+
+				//Faces using both ends disappear, the rest are moved onto 'to'
+				std::vector<UINT> touched;
+				for (size_t i = 0; i < vertexFaces[c.from].size(); i++)
+				{
+					UINT f = vertexFaces[c.from][i];
+					if (!faceAlive[f])
+						continue;
+
+					UINT* face = &faces[f * 3];
+					if (face[0] == c.to || face[1] == c.to || face[2] == c.to)
+					{
+						faceAlive[f] = false;
+						liveFaces--;
+					}
+					else
+					{
+						for (int k = 0; k < 3; k++)
+						{
+							if (face[k] == c.from)
+								face[k] = c.to;
+						}
+						vertexFaces[c.to].push_back(f);
+					}
+
+					for (int k = 0; k < 3; k++)
+						touched.push_back(face[k]);
+				}
+
+				quadrics[c.to] += quadrics[c.from];
+				vertexFaces[c.from].clear();
+				versions[c.from]++;
+
+				//Everything around the collapse needs a fresh candidate
+				std::sort(touched.begin(), touched.end());
+				touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+				for (size_t i = 0; i < touched.size(); i++)
+				{
+					if (touched[i] == c.from)
+						continue;
+
+					versions[touched[i]]++;
+					PushBestCollapse(touched[i]);
+				}
+			}
+
+			return liveFaces;
+		}
+	};
+}
+
+void MeshSimplifier::Simplify(const std::vector<SimpleVertex>& inVertices, const std::vector<unsigned short>& inIndices, UINT targetTriangles, float maxError,
+	std::vector<SimpleVertex>& outVertices, std::vector<unsigned short>& outIndices)
+{
+	Simplifier simplifier(inVertices, inIndices);
+	simplifier.Run(targetTriangles, maxError);
+
+	//Compact the surviving faces and the vertices they still use
+	const unsigned short unused = 0xffff;
+	std::vector<unsigned short> remap(inVertices.size(), unused);
+
+	outVertices.clear();
+	outIndices.clear();
+
+	for (size_t f = 0; f < simplifier.faceAlive.size(); f++)
+	{
+		if (!simplifier.faceAlive[f])
+			continue;
+
+		for (int k = 0; k < 3; k++)
+		{
+			UINT v = simplifier.faces[f * 3 + k];
+			if (remap[v] == unused)
+			{
+				remap[v] = (unsigned short)outVertices.size();
+				outVertices.push_back(inVertices[v]);
+			}
+			outIndices.push_back(remap[v]);
+		}
+	}
+}
+
+bool MeshSimplifier::ReadBinary(const char* filename, std::vector<SimpleVertex>& outVertices, std::vector<unsigned short>& outIndices)
+{
+	std::ifstream binaryInFile;
+	binaryInFile.open(filename, std::ios::in | std::ios::binary);
+
+	if (!binaryInFile.good())
+		return false;
+
+	unsigned int numVertices = 0;
+	unsigned int numIndices = 0;
+
+	//Read in array sizes
+	binaryInFile.read((char*)&numVertices, sizeof(unsigned int));
+	binaryInFile.read((char*)&numIndices, sizeof(unsigned int));
+
+	outVertices.resize(numVertices);
+	outIndices.resize(numIndices);
+	binaryInFile.read((char*)outVertices.data(), sizeof(SimpleVertex) * numVertices);
+	binaryInFile.read((char*)outIndices.data(), sizeof(unsigned short) * numIndices);
+
+	return binaryInFile.good();
+}
+
+bool MeshSimplifier::WriteBinary(const char* filename, const std::vector<SimpleVertex>& vertices, const std::vector<unsigned short>& indices)
+{
+	unsigned int numVertices = (unsigned int)vertices.size();
+	unsigned int numIndices = (unsigned int)indices.size();
+
+	std::ofstream outbin(filename, std::ios::out | std::ios::binary);
+	outbin.write((char*)&numVertices, sizeof(unsigned int));
+	outbin.write((char*)&numIndices, sizeof(unsigned int));
+	outbin.write((char*)vertices.data(), sizeof(SimpleVertex) * numVertices);
+	outbin.write((char*)indices.data(), sizeof(unsigned short) * numIndices);
+	outbin.close();
+
+	//A partly written level would be loaded every run after this one
+	if (outbin.fail())
+	{
+		remove(filename);
+		return false;
+	}
+
+	return true;
+}
+
+MeshSimplifier::LODChain MeshSimplifier::LoadLODs(ResourceManager& resources, const char* filename, const char* group, const float* triangleFractions, UINT fractionCount, bool invertTexCoords)
+{
+	LODChain chain;
+	ZeroMemory(&chain, sizeof(chain));
+	XMStoreFloat4x4(&chain.Fit, XMMatrixIdentity());
+
+	//LOD 0 is the model itself, loading it also makes sure the binary file exists
+	MeshHandle model = resources.LoadMesh((char*)filename, invertTexCoords, group);
+	if (resources.GetMesh(model).IndexCount == 0)
+	{
+		resources.Release(model);
+		return chain;
+	}
+
+	chain.Levels[0] = model;
+	chain.Count = 1;
+
+	std::string baseFilename = filename;
+	if (group)
+		baseFilename.append(group);
+
+	std::vector<SimpleVertex> baseVertices;
+	std::vector<unsigned short> baseIndices;
+	if (!ReadBinary((baseFilename + "Binary").c_str(), baseVertices, baseIndices))
+		return chain;
+
+	chain.Fit = FitToUnitSphere(baseVertices);
+
+	for (UINT i = 0; i < fractionCount && chain.Count < MaxLODs; i++)
+	{
+		std::string lodFilename = baseFilename + "LOD" + std::to_string(chain.Count);
+
+		//Only built the first time, after that OBJLoader finds the level's binary file
+		std::ifstream lodFile((lodFilename + "Binary").c_str(), std::ios::in | std::ios::binary);
+		if (!lodFile.good())
+		{
+			std::vector<SimpleVertex> lodVertices;
+			std::vector<unsigned short> lodIndices;
+
+			UINT target = (UINT)(baseIndices.size() / 3 * triangleFractions[i]);
+			Simplify(baseVertices, baseIndices, target, FLT_MAX, lodVertices, lodIndices);
+
+			if (lodIndices.empty() || !WriteBinary((lodFilename + "Binary").c_str(), lodVertices, lodIndices))
+				break;
+		}
+		lodFile.close();
+
+		chain.Levels[chain.Count] = resources.LoadMesh((char*)lodFilename.c_str(), invertTexCoords);
+		chain.Count++;
+	}
+
+	return chain;
+}
+
+UINT MeshSimplifier::SelectLOD(const LODChain& chain, float pixels, int bias)
+{
+	if (chain.Count == 0)
+		return 0;
+
+	int level = 0;
+	for (UINT i = 1; i < chain.Count; i++)
+	{
+		if (pixels < LODPixelThresholds[i])
+			level = i;
+	}
+
+	level += bias;
+	return level < 0 ? 0 : (level >= (int)chain.Count ? chain.Count - 1 : (UINT)level);
+}
+
+void MeshSimplifier::Release(ResourceManager& resources, LODChain& chain)
+{
+	for (UINT i = 0; i < chain.Count; i++)
+		resources.Release(chain.Levels[i]);
+
+	chain.Count = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifndef MESHSIMPLIFIER
+#define MESHSIMPLIFIER
+
+#include "Structures.h"
+#include "ResourceManager.h"
+#include <windows.h>
+#include <d3d11_1.h>
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace MeshSimplifier
+{
+	const UINT MaxLODs = 4;
+
+	//A model and its simplified variants, LOD 0 being the original. Fit moves the model's bounding sphere onto the unit sphere
+	//at the origin, so it can be drawn with the same world matrix as a sphere
+	struct LODChain
+	{
+		MeshHandle Levels[MaxLODs];
+		UINT Count;
+		XMFLOAT4X4 Fit;
+	};
+
+	//Quadric error edge collapse down to targetTriangles, or until the cheapest collapse would cost more than maxError. Identical vertices are welded first.
+	//Vertices on UV seams or open edges are never moved, so seams and normals survive, and collapses that would flip a face or break the link condition are skipped
+	void Simplify(const std::vector<SimpleVertex>& inVertices, const std::vector<unsigned short>& inIndices, UINT targetTriangles, float maxError,
+		std::vector<SimpleVertex>& outVertices, std::vector<unsigned short>& outIndices);
+
+	//Loads an OBJ, or one group of it, through the resource manager as LOD 0, then builds each further level at the given fraction of its triangle count.
+	//Each level is cached as "<model>LOD<n>Binary" in the same layout as OBJLoader's binary file, <model> being the filename followed by the group.
+	//A model that cannot be loaded gives an empty chain
+	LODChain LoadLODs(ResourceManager& resources, const char* filename, const char* group, const float* triangleFractions, UINT fractionCount, bool invertTexCoords = true);
+
+	//Picks the coarsest level whose projected radius in pixels is still above the threshold for it, moved bias levels coarser
+	UINT SelectLOD(const LODChain& chain, float pixels, int bias = 0);
+
+	//Hands back every level in a chain
+	void Release(ResourceManager& resources, LODChain& chain);
+
+	//Helper methods for the above methods
+	//Reads and writes OBJLoader's binary mesh layout
+	bool ReadBinary(const char* filename, std::vector<SimpleVertex>& outVertices, std::vector<unsigned short>& outIndices);
+	bool WriteBinary(const char* filename, const std::vector<SimpleVertex>& vertices, const std::vector<unsigned short>& indices);
+};
+
+#endif
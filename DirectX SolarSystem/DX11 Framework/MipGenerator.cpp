@@ -0,0 +1,510 @@
+#include "MipGenerator.h"
+#include <fstream>
+#include <string>
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	//Just enough of the DDS layout to read the top level and write a mipped copy back out
+#pragma pack(push,1)
+	struct MipPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t RGBBitCount;
+		uint32_t RBitMask;
+		uint32_t GBitMask;
+		uint32_t BBitMask;
+		uint32_t ABitMask;
+	};
+
+	struct MipDDSHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		MipPixelFormat ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+#pragma pack(pop)
+
+	const uint32_t DDS_MAGIC_NUMBER = 0x20534444; // "DDS "
+	const uint32_t FOURCC_DXT1 = 0x31545844;      // "DXT1"
+	const uint32_t PF_FOURCC = 0x00000004;
+	const uint32_t PF_RGB = 0x00000040;
+	const uint32_t HEADER_MIPMAPCOUNT = 0x00020000;
+	const uint32_t CAPS_COMPLEX_MIPMAP = 0x00400008;
+
+	//sRGB <-> linear tables so the filter does not need pow() per texel
+	float g_ToLinear[256];
+	uint8_t g_ToSRGB[4096];
+	bool g_TablesBuilt = false;
+
+	void BuildTables()
+	{
+		if (g_TablesBuilt)
+			return;
+
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			g_ToLinear[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+		}
+
+		for (int i = 0; i < 4096; i++)
+		{
+			float l = i / 4095.0f;
+			float c = (l <= 0.0031308f) ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+			g_ToSRGB[i] = (uint8_t)(std::min)(255.0f, c * 255.0f + 0.5f);
+		}
+
+		g_TablesBuilt = true;
+	}
+
+	//Expands a 5:6:5 colour into RGBA8
+	void Unpack565(uint16_t c, uint8_t* out)
+	{
+		uint8_t r = (c >> 11) & 0x1f;
+		uint8_t g = (c >> 5) & 0x3f;
+		uint8_t b = c & 0x1f;
+
+		out[0] = (r << 3) | (r >> 2);
+		out[1] = (g << 2) | (g >> 4);
+		out[2] = (b << 3) | (b >> 2);
+		out[3] = 255;
+	}
+
+	uint16_t Pack565(const float* rgb)
+	{
+		int r = (int)((std::max)(0.0f, (std::min)(255.0f, rgb[0])) * 31.0f / 255.0f + 0.5f);
+		int g = (int)((std::max)(0.0f, (std::min)(255.0f, rgb[1])) * 63.0f / 255.0f + 0.5f);
+		int b = (int)((std::max)(0.0f, (std::min)(255.0f, rgb[2])) * 31.0f / 255.0f + 0.5f);
+
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	UINT BC1LevelSize(UINT width, UINT height)
+	{
+		return (std::max)(1u, (width + 3) / 4) * (std::max)(1u, (height + 3) / 4) * 8;
+	}
+
+	//An RGBA8 texel as 0 to 1 floats, colour in linear space when srgb is true and alpha as-is
+	XMVECTOR LoadTexel(const uint8_t* t, bool srgb)
+	{
+		if (srgb)
+			return XMVectorSet(g_ToLinear[t[0]], g_ToLinear[t[1]], g_ToLinear[t[2]], t[3] / 255.0f);
+
+		return XMVectorSet(t[0] / 255.0f, t[1] / 255.0f, t[2] / 255.0f, t[3] / 255.0f);
+	}
+
+	//Weighted sum of texels. Fully transparent texels only count towards alpha, DXT1 decodes them as black
+	//and averaging that in would darken the edges of cut-outs
+	XMVECTOR BlendTexels(const uint8_t* const* taps, const float* weights, int count, bool srgb)
+	{
+		XMVECTOR colour = XMVectorZero();
+		float colourWeight = 0.0f;
+		float alpha = 0.0f;
+
+		for (int i = 0; i < count; i++)
+		{
+			alpha += weights[i] * taps[i][3] / 255.0f;
+
+			if (taps[i][3] == 0)
+				continue;
+
+			colour = XMVectorAdd(colour, XMVectorScale(LoadTexel(taps[i], srgb), weights[i]));
+			colourWeight += weights[i];
+		}
+
+		if (colourWeight > 0.0f)
+			colour = XMVectorScale(colour, 1.0f / colourWeight);
+
+		return XMVectorSetW(colour, alpha);
+	}
+
+	void StoreTexel(FXMVECTOR texel, uint8_t* out, bool srgb)
+	{
+		XMFLOAT4 value;
+		XMStoreFloat4(&value, texel);
+
+		if (srgb)
+		{
+			out[0] = g_ToSRGB[(int)(value.x * 4095.0f + 0.5f)];
+			out[1] = g_ToSRGB[(int)(value.y * 4095.0f + 0.5f)];
+			out[2] = g_ToSRGB[(int)(value.z * 4095.0f + 0.5f)];
+		}
+		else
+		{
+			XMFLOAT4 bytes;
+			XMStoreFloat4(&bytes, XMVectorMultiply(texel, XMVectorReplicate(255.0f)));
+			out[0] = (uint8_t)(bytes.x + 0.5f);
+			out[1] = (uint8_t)(bytes.y + 0.5f);
+			out[2] = (uint8_t)(bytes.z + 0.5f);
+		}
+		out[3] = (uint8_t)(value.w * 255.0f + 0.5f);
+	}
+}
+
+UINT MipGenerator::CountMips(UINT width, UINT height)
+{
+	UINT count = 1;
+
+	while (width > 1 || height > 1)
+	{
+		width = (std::max)(1u, width / 2);
+		height = (std::max)(1u, height / 2);
+		count++;
+	}
+
+	return count;
+}
+
+void MipGenerator::DecodeBC1(const uint8_t* blocks, UINT width, UINT height, std::vector<uint8_t>& outRGBA)
+{
+	outRGBA.resize(width * height * 4);
+
+	UINT blocksWide = (std::max)(1u, (width + 3) / 4);
+	UINT blocksHigh = (std::max)(1u, (height + 3) / 4);
+
+	for (UINT by = 0; by < blocksHigh; by++)
+	{
+		for (UINT bx = 0; bx < blocksWide; bx++)
+		{
+			const uint8_t* block = blocks + (by * blocksWide + bx) * 8;
+
+			uint16_t c0 = block[0] | (block[1] << 8);
+			uint16_t c1 = block[2] | (block[3] << 8);
+			uint32_t bits = block[4] | (block[5] << 8) | (block[6] << 16) | ((uint32_t)block[7] << 24);
+
+			uint8_t palette[4][4];
+			Unpack565(c0, palette[0]);
+			Unpack565(c1, palette[1]);
+
+			for (int c = 0; c < 3; c++)
+			{
+				if (c0 > c1)
+				{
+					palette[2][c] = (uint8_t)((2 * palette[0][c] + palette[1][c]) / 3);
+					palette[3][c] = (uint8_t)((palette[0][c] + 2 * palette[1][c]) / 3);
+				}
+				else
+				{
+					palette[2][c] = (uint8_t)((palette[0][c] + palette[1][c]) / 2);
+					palette[3][c] = 0;
+				}
+			}
+			palette[2][3] = 255;
+			palette[3][3] = (c0 > c1) ? 255 : 0;
+
+			for (UINT py = 0; py < 4; py++)
+			{
+				for (UINT px = 0; px < 4; px++)
+				{
+					UINT x = bx * 4 + px;
+					UINT y = by * 4 + py;
+					UINT index = (bits >> (2 * (py * 4 + px))) & 3;
+
+					if (x < width && y < height)
+						memcpy(&outRGBA[(y * width + x) * 4], palette[index], 4);
+				}
+			}
+		}
+	}
+}
+
+void MipGenerator::EncodeBC1(const std::vector<uint8_t>& rgba, UINT width, UINT height, std::vector<uint8_t>& outBlocks)
+{
+	UINT blocksWide = (std::max)(1u, (width + 3) / 4);
+	UINT blocksHigh = (std::max)(1u, (height + 3) / 4);
+
+	outBlocks.resize(blocksWide * blocksHigh * 8);
+
+	for (UINT by = 0; by < blocksHigh; by++)
+	{
+		for (UINT bx = 0; bx < blocksWide; bx++)
+		{
+			//Gather the block, clamping at the edge for levels smaller than 4x4
+			//Texels under half alpha become the transparent index, so only the rest decide the end points
+			float texels[16][3];
+			bool transparent[16];
+			bool hasAlpha = false;
+			bool hasColour = false;
+			float minC[3] = { 255.0f, 255.0f, 255.0f };
+			float maxC[3] = { 0.0f, 0.0f, 0.0f };
+
+			for (UINT i = 0; i < 16; i++)
+			{
+				UINT x = (std::min)(bx * 4 + (i & 3), width - 1);
+				UINT y = (std::min)(by * 4 + (i >> 2), height - 1);
+				const uint8_t* t = &rgba[(y * width + x) * 4];
+
+				transparent[i] = t[3] < 128;
+				hasAlpha |= transparent[i];
+				if (transparent[i])
+					continue;
+
+				hasColour = true;
+				for (int c = 0; c < 3; c++)
+				{
+					texels[i][c] = t[c];
+					minC[c] = (std::min)(minC[c], texels[i][c]);
+					maxC[c] = (std::max)(maxC[c], texels[i][c]);
+				}
+			}
+
+			uint16_t c0 = 0;
+			uint16_t c1 = 0;
+			uint32_t bits = 0;
+
+			if (hasColour)
+			{
+				//Inset the bounding box slightly to reduce the error of the end points
+				for (int c = 0; c < 3; c++)
+				{
+					float inset = (maxC[c] - minC[c]) / 16.0f;
+					minC[c] += inset;
+					maxC[c] -= inset;
+				}
+
+				c0 = Pack565(maxC);
+				c1 = Pack565(minC);
+			}
+
+			//Four colour mode needs c0 > c1, blocks with transparent texels need three colour mode and c0 <= c1
+			if ((c0 < c1) != hasAlpha && c0 != c1)
+				std::swap(c0, c1);
+
+			if (c0 != c1)
+			{
+				uint8_t e0[4], e1[4];
+				Unpack565(c0, e0);
+				Unpack565(c1, e1);
+
+				float axis[3] = { (float)e1[0] - e0[0], (float)e1[1] - e0[1], (float)e1[2] - e0[2] };
+				float lengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+				//Palette order along the axis is 0, 2, 3, 1 with four colours and 0, 2, 1 with three
+				const uint32_t remap4[4] = { 0, 2, 3, 1 };
+				const uint32_t remap3[3] = { 0, 2, 1 };
+				int steps = hasAlpha ? 2 : 3;
+
+				for (UINT i = 0; i < 16; i++)
+				{
+					if (transparent[i])
+						continue;
+
+					float t = ((texels[i][0] - e0[0]) * axis[0] + (texels[i][1] - e0[1]) * axis[1] + (texels[i][2] - e0[2]) * axis[2]) / lengthSq;
+					int step = (int)(t * steps + 0.5f);
+					step = (std::max)(0, (std::min)(steps, step));
+
+					bits |= (hasAlpha ? remap3[step] : remap4[step]) << (2 * i);
+				}
+			}
+
+			//Index 3 is transparent black in three colour mode
+			for (UINT i = 0; i < 16; i++)
+			{
+				if (transparent[i])
+					bits |= 3u << (2 * i);
+			}
+
+			uint8_t* block = &outBlocks[(by * blocksWide + bx) * 8];
+			block[0] = c0 & 0xff;
+			block[1] = c0 >> 8;
+			block[2] = c1 & 0xff;
+			block[3] = c1 >> 8;
+			block[4] = bits & 0xff;
+			block[5] = (bits >> 8) & 0xff;
+			block[6] = (bits >> 16) & 0xff;
+			block[7] = (bits >> 24) & 0xff;
+		}
+	}
+}
+
+void MipGenerator::Downsample(const std::vector<uint8_t>& src, UINT srcWidth, UINT srcHeight, std::vector<uint8_t>& dst, bool srgb)
+{
+	BuildTables();
+
+	UINT dstWidth = (std::max)(1u, srcWidth / 2);
+	UINT dstHeight = (std::max)(1u, srcHeight / 2);
+
+	dst.resize(dstWidth * dstHeight * 4);
+
+	for (UINT y = 0; y < dstHeight; y++)
+	{
+		UINT y0 = (std::min)(y * 2, srcHeight - 1);
+		UINT y1 = (std::min)(y * 2 + 1, srcHeight - 1);
+
+		for (UINT x = 0; x < dstWidth; x++)
+		{
+			UINT x0 = (std::min)(x * 2, srcWidth - 1);
+			UINT x1 = (std::min)(x * 2 + 1, srcWidth - 1);
+
+			const uint8_t* taps[4] =
+			{
+				&src[(y0 * srcWidth + x0) * 4],
+				&src[(y0 * srcWidth + x1) * 4],
+				&src[(y1 * srcWidth + x0) * 4],
+				&src[(y1 * srcWidth + x1) * 4]
+			};
+
+			const float weights[4] = { 0.25f, 0.25f, 0.25f, 0.25f };
+
+			StoreTexel(BlendTexels(taps, weights, 4, srgb), &dst[(y * dstWidth + x) * 4], srgb);
+		}
+	}
+}
+
+void MipGenerator::Resample(const std::vector<uint8_t>& src, UINT srcWidth, UINT srcHeight, std::vector<uint8_t>& dst, UINT dstWidth, UINT dstHeight, bool srgb)
+{
+	BuildTables();
+
+	dst.resize(dstWidth * dstHeight * 4);
+
+	float scaleX = (float)srcWidth / dstWidth;
+	float scaleY = (float)srcHeight / dstHeight;
+
+	for (UINT y = 0; y < dstHeight; y++)
+	{
+		//Texel centres line up across the two sizes, anything past the edge clamps to it
+		float v = (y + 0.5f) * scaleY - 0.5f;
+		v = v > 0.0f ? v : 0.0f;
+		UINT y0 = (std::min)((UINT)v, srcHeight - 1);
+		UINT y1 = (std::min)(y0 + 1, srcHeight - 1);
+		float fy = v - y0;
+		fy = fy < 1.0f ? fy : 1.0f;
+
+		for (UINT x = 0; x < dstWidth; x++)
+		{
+			float u = (x + 0.5f) * scaleX - 0.5f;
+			u = u > 0.0f ? u : 0.0f;
+			UINT x0 = (std::min)((UINT)u, srcWidth - 1);
+			UINT x1 = (std::min)(x0 + 1, srcWidth - 1);
+			float fx = u - x0;
+			fx = fx < 1.0f ? fx : 1.0f;
+
+			const uint8_t* taps[4] =
+			{
+				&src[(y0 * srcWidth + x0) * 4],
+				&src[(y0 * srcWidth + x1) * 4],
+				&src[(y1 * srcWidth + x0) * 4],
+				&src[(y1 * srcWidth + x1) * 4]
+			};
+
+			const float weights[4] = { (1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy };
+
+			StoreTexel(BlendTexels(taps, weights, 4, srgb), &dst[(y * dstWidth + x) * 4], srgb);
+		}
+	}
+}
+
+HRESULT MipGenerator::CreateTextureWithMips(ID3D11Device* _pd3dDevice, const wchar_t* filename, ID3D11ShaderResourceView** textureView)
+{
+	std::wstring cacheFilename = filename;
+	cacheFilename.append(L"Mips");
+
+	//If the chain has been generated before, load that instead
+	std::ifstream cacheInFile(cacheFilename.c_str(), std::ios::in | std::ios::binary);
+	if (cacheInFile.good())
+	{
+		cacheInFile.close();
+		return CreateDDSTextureFromFile(_pd3dDevice, cacheFilename.c_str(), nullptr, textureView);
+	}
+
+	std::ifstream inFile(filename, std::ios::in | std::ios::binary);
+	if (!inFile.good())
+	{
+		return CreateDDSTextureFromFile(_pd3dDevice, filename, nullptr, textureView);
+	}
+
+	uint32_t magic = 0;
+	MipDDSHeader header;
+	inFile.read((char*)&magic, sizeof(uint32_t));
+	inFile.read((char*)&header, sizeof(MipDDSHeader));
+
+	bool isBC1 = (header.ddspf.flags & PF_FOURCC) && header.ddspf.fourCC == FOURCC_DXT1;
+	bool isRGBA8 = (header.ddspf.flags & PF_RGB) && header.ddspf.RGBBitCount == 32;
+
+	//Only plain 2D DXT1 and 32 bit colour files without a chain are handled here, everything else goes straight to the loader
+	if (!inFile.good() || magic != DDS_MAGIC_NUMBER || header.mipMapCount > 1 || header.caps2 != 0 || !(isBC1 || isRGBA8))
+	{
+		inFile.close();
+		return CreateDDSTextureFromFile(_pd3dDevice, filename, nullptr, textureView);
+	}
+
+	UINT width = header.width;
+	UINT height = header.height;
+	UINT topSize = isBC1 ? BC1LevelSize(width, height) : width * height * 4;
+
+	std::vector<uint8_t> topLevel(topSize);
+	inFile.read((char*)topLevel.data(), topSize);
+	std::streamsize readSize = inFile.gcount();
+	inFile.close();
+
+	//A truncated file would otherwise be decoded from zeroes and cached, so leave it to the loader to report
+	if (readSize != (std::streamsize)topSize)
+	{
+		return CreateDDSTextureFromFile(_pd3dDevice, filename, nullptr, textureView);
+	}
+
+	std::vector<uint8_t> level;
+	if (isBC1)
+		DecodeBC1(topLevel.data(), width, height, level);
+	else
+		level = topLevel;
+
+	UINT mipCount = CountMips(width, height);
+
+	//Output file is the original header with the mip count filled in, followed by every level
+	header.mipMapCount = mipCount;
+	header.flags |= HEADER_MIPMAPCOUNT;
+	header.caps |= CAPS_COMPLEX_MIPMAP;
+
+	std::vector<uint8_t> ddsData;
+	ddsData.insert(ddsData.end(), (uint8_t*)&magic, (uint8_t*)&magic + sizeof(uint32_t));
+	ddsData.insert(ddsData.end(), (uint8_t*)&header, (uint8_t*)&header + sizeof(MipDDSHeader));
+	ddsData.insert(ddsData.end(), topLevel.begin(), topLevel.end());
+
+	std::vector<uint8_t> nextLevel;
+	std::vector<uint8_t> encoded;
+	for (UINT i = 1; i < mipCount; i++)
+	{
+		Downsample(level, width, height, nextLevel);
+		width = (std::max)(1u, width / 2);
+		height = (std::max)(1u, height / 2);
+		level.swap(nextLevel);
+
+		if (isBC1)
+		{
+			EncodeBC1(level, width, height, encoded);
+			ddsData.insert(ddsData.end(), encoded.begin(), encoded.end());
+		}
+		else
+		{
+			ddsData.insert(ddsData.end(), level.begin(), level.end());
+		}
+	}
+
+	//Output data into a cache file, the next time this runs the full chain will be loaded straight from disk
+	//A partly written cache would be loaded every run after this one, so remove it if anything failed
+	std::ofstream outFile(cacheFilename.c_str(), std::ios::out | std::ios::binary);
+	outFile.write((char*)ddsData.data(), ddsData.size());
+	outFile.close();
+	if (outFile.fail())
+	{
+		DeleteFileW(cacheFilename.c_str());
+	}
+
+	return CreateDDSTextureFromMemory(_pd3dDevice, ddsData.data(), ddsData.size(), nullptr, textureView);
+}
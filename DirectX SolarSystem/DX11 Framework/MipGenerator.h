@@ -0,0 +1,37 @@
+#pragma once
+#ifndef MIPGENERATOR
+#define MIPGENERATOR
+
+#include <windows.h>
+#include <d3d11_1.h>
+#include <directxmath.h>
+#include <stdint.h>
+#include <vector>
+#include "DDSTextureLoader.h"
+
+using namespace DirectX;
+
+namespace MipGenerator
+{
+	//Loads a DDS texture, and if it only has a top level, builds the full mip chain on the CPU.
+	//The generated chain is written next to the original as "<filename>Mips" so it is only built once
+	HRESULT CreateTextureWithMips(ID3D11Device* _pd3dDevice, const wchar_t* filename, ID3D11ShaderResourceView** textureView);
+
+	//Number of levels in a full chain down to 1x1
+	UINT CountMips(UINT width, UINT height);
+
+	//Helper methods for the above method
+	//Decodes a DXT1 (BC1) surface into tightly packed RGBA8 texels
+	void DecodeBC1(const uint8_t* blocks, UINT width, UINT height, std::vector<uint8_t>& outRGBA);
+
+	//Encodes tightly packed RGBA8 texels into DXT1 (BC1) blocks. Blocks with texels under half alpha use the three colour mode so they stay cut out
+	void EncodeBC1(const std::vector<uint8_t>& rgba, UINT width, UINT height, std::vector<uint8_t>& outBlocks);
+
+	//Halves an RGBA8 level with a 2x2 box filter. Colour channels are averaged in linear space when srgb is true, leaving out fully transparent texels
+	void Downsample(const std::vector<uint8_t>& src, UINT srcWidth, UINT srcHeight, std::vector<uint8_t>& dst, bool srgb = true);
+
+	//Resizes an RGBA8 level with a bilinear filter. Nothing is prefiltered, so it should only shrink to half its size at most
+	void Resample(const std::vector<uint8_t>& src, UINT srcWidth, UINT srcHeight, std::vector<uint8_t>& dst, UINT dstWidth, UINT dstHeight, bool srgb = true);
+};
+
+#endif
@@ -0,0 +1,130 @@
+#include "NBodySystem.h"
+#include "ParallelFor.h"
+
+NBodySystem::NBodySystem()
+{
+	m_ParticleMass = 0.0f;
+	m_Softening = 0.05f;
+	m_OpeningAngle = 0.5f;
+	m_InitialEnergy = 0.0;
+	m_Energy = 0.0;
+}
+
+void NBodySystem::Reset(const XMFLOAT3* positions, const XMFLOAT3* velocities, size_t count, float particleMass)
+{
+	m_ParticleMass = particleMass;
+
+	m_State.Resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		m_State.X[i] = positions[i].x;
+		m_State.Y[i] = positions[i].y;
+		m_State.Z[i] = positions[i].z;
+		m_State.VX[i] = velocities[i].x;
+		m_State.VY[i] = velocities[i].y;
+		m_State.VZ[i] = velocities[i].z;
+	}
+
+	m_ParticlePotentials.resize(count);
+	m_BodyPotentials.resize(count);
+
+	//Evaluating here fills in the starting potentials, and leaves the integrator its first accelerations
+	m_Integrator.Invalidate();
+	m_Integrator.EnsureAccelerations(m_State, *this);
+
+	m_Energy = ComputeEnergy();
+	m_InitialEnergy = m_Energy;
+}
+
+size_t NBodySystem::AddMassiveBody(float mass)
+{
+	MassiveBody body;
+	body.Position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	body.Mass = mass;
+
+	m_Bodies.push_back(body);
+	return m_Bodies.size() - 1;
+}
+
+void NBodySystem::SetMassiveBodyPosition(size_t index, const XMFLOAT3& position)
+{
+	m_Bodies[index].Position = position;
+}
+
+void NBodySystem::Step(float dt)
+{
+	m_Integrator.Step(m_State, *this, dt);
+
+	//Every method finishes with an evaluation at the new state, so the potentials are current for the energy
+	m_Energy = ComputeEnergy();
+}
+
+void NBodySystem::Evaluate(const BodyState& state, float time, BodyAccelerations& accelerations)
+{
+	size_t count = state.GetCount();
+	if (count == 0)
+		return;
+
+	m_Tree.Build(&state.X[0], &state.Y[0], &state.Z[0], count, m_ParticleMass);
+
+	const float softeningSq = m_Softening * m_Softening;
+
+	//Walk the particles in tree order so neighbouring threads and iterations touch the same nodes
+	ParallelFor(count, 256, [&](size_t begin, size_t end)
+	{
+		for (size_t sorted = begin; sorted < end; sorted++)
+		{
+			UINT i = m_Tree.GetParticleIndex((UINT)sorted);
+
+			XMFLOAT3 acceleration;
+			float potential;
+			m_Tree.Evaluate((UINT)sorted, m_OpeningAngle, m_Softening, acceleration, potential);
+
+			float bodyPotential = 0.0f;
+
+			for (size_t b = 0; b < m_Bodies.size(); b++)
+			{
+				const MassiveBody& body = m_Bodies[b];
+
+				float dx = body.Position.x - state.X[i];
+				float dy = body.Position.y - state.Y[i];
+				float dz = body.Position.z - state.Z[i];
+
+				float inverse = 1.0f / sqrtf(dx * dx + dy * dy + dz * dz + softeningSq);
+				float strength = body.Mass * inverse * inverse * inverse;
+
+				acceleration.x += dx * strength;
+				acceleration.y += dy * strength;
+				acceleration.z += dz * strength;
+				bodyPotential -= body.Mass * inverse;
+			}
+
+			accelerations.X[i] = acceleration.x;
+			accelerations.Y[i] = acceleration.y;
+			accelerations.Z[i] = acceleration.z;
+			m_ParticlePotentials[i] = potential;
+			m_BodyPotentials[i] = bodyPotential;
+		}
+	});
+}
+
+void NBodySystem::CopyPositions(XMFLOAT3* positions) const
+{
+	for (size_t i = 0; i < m_State.GetCount(); i++)
+		positions[i] = XMFLOAT3(m_State.X[i], m_State.Y[i], m_State.Z[i]);
+}
+
+double NBodySystem::ComputeEnergy() const
+{
+	double energy = 0.0;
+
+	for (size_t i = 0; i < m_State.GetCount(); i++)
+	{
+		double speedSq = (double)m_State.VX[i] * m_State.VX[i] + (double)m_State.VY[i] * m_State.VY[i] + (double)m_State.VZ[i] * m_State.VZ[i];
+
+		//Each pair's potential appears at both of its particles, so only half of it is counted per particle
+		energy += 0.5 * speedSq + m_BodyPotentials[i] + 0.5 * m_ParticlePotentials[i];
+	}
+
+	return energy;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#ifndef NBODYSYSTEM
+#define NBODYSYSTEM
+
+#include "BarnesHutTree.h"
+#include "Integrator.h"
+#include <vector>
+#include <math.h>
+
+//Equal mass particles attracting each other through a Barnes-Hut tree, and pulled on by a few massive bodies whose positions are set from outside.
+//Steps with an Integrator, kick-drift-kick leapfrog unless told otherwise, which being symplectic keeps the energy error bounded rather than letting it grow.
+//Masses are gravitational parameters (G times mass) throughout
+class NBodySystem : public AccelerationField
+{
+private:
+	struct MassiveBody
+	{
+		XMFLOAT3 Position;
+		float Mass;
+	};
+
+	BarnesHutTree m_Tree;
+	Integrator m_Integrator;
+
+	//Per particle, in the order they were given to Reset
+	BodyState m_State;
+
+	//Potential at each particle from the other particles, and from the massive bodies, as of the last evaluation.
+	//Kept apart so pairs are not counted twice in the energy
+	std::vector<float> m_ParticlePotentials;
+	std::vector<float> m_BodyPotentials;
+
+	std::vector<MassiveBody> m_Bodies;
+
+	float m_ParticleMass;
+	float m_Softening;
+	float m_OpeningAngle;
+
+	double m_InitialEnergy;
+	double m_Energy;
+
+	//Helper methods for the above method(s)
+	double ComputeEnergy() const;
+
+public:
+	//Constructor
+	NBodySystem();
+
+	//Starts again from the given particles. Set the massive bodies' positions first, their pull is part of the starting state
+	void Reset(const XMFLOAT3* positions, const XMFLOAT3* velocities, size_t count, float particleMass);
+
+	//Adds a body that pulls on the particles without being moved by them, returning its index
+	size_t AddMassiveBody(float mass);
+	void SetMassiveBodyPosition(size_t index, const XMFLOAT3& position);
+
+	//Distance below which forces stop growing, so close pairs do not need tiny steps
+	void SetSoftening(float softening) { m_Softening = softening; }
+
+	//Size over distance below which a node of the tree is treated as one mass. Must stay under 0.57 so no node is used for a particle inside it
+	void SetOpeningAngle(float openingAngle) { m_OpeningAngle = openingAngle; }
+
+	//Integration method and substepping, see Integrator. Switching keeps the particles where they are
+	void SetIntegrator(IntegratorType type) { m_Integrator.SetType(type); }
+	IntegratorType GetIntegrator() const { return m_Integrator.GetType(); }
+	void SetAdaptive(float accuracy, unsigned int maxLevel) { m_Integrator.SetAdaptive(accuracy, m_Softening, maxLevel); }
+	unsigned int GetLastSubsteps() const { return m_Integrator.GetLastSubsteps(); }
+
+	//Advances every particle by dt, with the massive bodies where they should be at the end of the step
+	void Step(float dt);
+
+	//AccelerationField, the pull of the other particles and the massive bodies at each particle
+	void Evaluate(const BodyState& state, float time, BodyAccelerations& accelerations);
+
+	size_t GetCount() const { return m_State.GetCount(); }
+	void CopyPositions(XMFLOAT3* positions) const;
+
+	//Kinetic plus potential energy of the particles per unit of particle mass, and how far it has moved relative to where Reset left it.
+	//The massive bodies are not part of the total, so if they move they do work on the particles and that shows up as drift too
+	double GetEnergy() const { return m_Energy; }
+	double GetEnergyDrift() const { return m_InitialEnergy != 0.0 ? (m_Energy - m_InitialEnergy) / fabs(m_InitialEnergy) : 0.0; }
+};
+
+#endif
@@ -1,5 +1,6 @@
 #include "OBJLoader.h"
 #include <string>
+#include <sstream>
 
 bool OBJLoader::FindSimilarVertex(const SimpleVertex& vertex, std::map<SimpleVertex, unsigned short>& vertToIndexMap, unsigned short& index)
 {
@@ -65,9 +66,10 @@ void OBJLoader::CreateIndices(const std::vector<XMFLOAT3>& inVertices,
 //WARNING: This code makes a big assumption -- that your models have texture coordinates AND normals which they should have anyway (else you can't do texturing and lighting!)
 //If your .obj file has no lines beginning with "vt" or "vn", then you'll need to change the Export settings in your modelling software so that it exports the texture coordinates 
 //and normals. If you still have no "vt" lines, you'll need to do some texture unwrapping, also known as UV unwrapping.
-MeshData OBJLoader::Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords)
+MeshData OBJLoader::Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords, const char* group)
 {
 	std::string binaryFilename = filename;
+	if(group) binaryFilename.append(group);
 	binaryFilename.append("Binary");
 	std::ifstream binaryInFile;
 	binaryInFile.open(binaryFilename, std::ios::in | std::ios::binary);
@@ -106,6 +108,7 @@ MeshData OBJLoader::Load(char* filename, ID3D11Device* _pd3dDevice, bool invertT
 			std::string beforeFirstSlash;
 			std::string afterFirstSlash;
 			std::string afterSecondSlash;
+			bool inGroup = group == nullptr;
 
 			while(!inFile.eof()) //While we have yet to reach the end of the file...
 			{
@@ -137,11 +140,25 @@ MeshData OBJLoader::Load(char* filename, ID3D11Device* _pd3dDevice, bool invertT
 
 					normals.push_back(normal);
 				}
+				else if(input.compare("g") == 0) //Group, only faces in the one asked for are kept
+				{
+					std::string groupName;
+					std::getline(inFile, groupName);
+					groupName.erase(0, groupName.find_first_not_of(" \t"));
+					groupName.erase(groupName.find_last_not_of(" \t\r") + 1);
+
+					inGroup = group == nullptr || groupName.compare(group) == 0;
+				}
 				else if(input.compare("f") == 0) //Face
 				{
-					for(int i = 0; i < 3; ++i)
+					//Faces can have more than 3 corners, so the rest of the line is split into a fan of triangles (0, 1, 2), (0, 2, 3)...
+					std::string faceLine;
+					std::getline(inFile, faceLine);
+					std::istringstream corners(faceLine);
+
+					for(int corner = 0; corners >> input; ++corner)
 					{
-						inFile >> input;
+						int i = corner < 2 ? corner : 2;
 						int slash = input.find("/"); //Find first forward slash
 						int secondSlash = input.find("/", slash + 1); //Find second forward slash
 
@@ -154,14 +171,25 @@ MeshData OBJLoader::Load(char* filename, ID3D11Device* _pd3dDevice, bool invertT
 						vInd[i] = (unsigned short)atoi(beforeFirstSlash.c_str()); //atoi = "ASCII to int"
 						tInd[i] = (unsigned short)atoi(afterFirstSlash.c_str());
 						nInd[i] = (unsigned short)atoi(afterSecondSlash.c_str());
-					}
 
-					//Place into vectors
-					for(int i = 0; i < 3; ++i)
-					{
-						vertIndices.push_back(vInd[i] - 1);		//Minus 1 from each as these as OBJ indexes start from 1 whereas C++ arrays start from 0
-						textureIndices.push_back(tInd[i] - 1);	//which is really annoying. Apart from Lua and SQL, there's not much else that has indexing 
-						normalIndices.push_back(nInd[i] - 1);	//starting at 1. So many more languages index from 0, the .OBJ people screwed up there.
+						if(corner < 2)
+							continue;
+
+						//Place into vectors
+						if(inGroup)
+						{
+							for(int k = 0; k < 3; ++k)
+							{
+								vertIndices.push_back(vInd[k] - 1);		//Minus 1 from each as these as OBJ indexes start from 1 whereas C++ arrays start from 0
+								textureIndices.push_back(tInd[k] - 1);	//which is really annoying. Apart from Lua and SQL, there's not much else that has indexing 
+								normalIndices.push_back(nInd[k] - 1);	//starting at 1. So many more languages index from 0, the .OBJ people screwed up there.
+							}
+						}
+
+						//The next triangle of the fan shares this corner
+						vInd[1] = vInd[2];
+						tInd[1] = tInd[2];
+						nInd[1] = nInd[2];
 					}
 				}
 			}
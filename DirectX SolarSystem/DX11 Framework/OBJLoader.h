@@ -21,8 +21,9 @@ struct MeshData
 
 namespace OBJLoader
 {
-	//The only method you'll need to call
-	MeshData Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords = true);
+	//The only method you'll need to call. Faces with more than 3 corners are split into triangles.
+	//Given a group, only the faces under that "g" line are loaded and the binary file is "<filename><group>Binary"
+	MeshData Load(char* filename, ID3D11Device* _pd3dDevice, bool invertTexCoords = true, const char* group = nullptr);
 
 	//Helper methods for the above method
 	//Searhes to see if a similar vertex already exists in the buffer -- if true, we re-use that index
@@ -0,0 +1,223 @@
+#include "OcclusionBuffer.h"
+#include <float.h>
+#include <math.h>
+
+OcclusionBuffer::OcclusionBuffer(UINT width, UINT height)
+{
+	//Whole groups of four pixels to a row, so a row never needs a partial load
+	m_Width = width < 4 ? 4 : (width + 3) & ~3u;
+	m_Height = height < 1 ? 1 : height;
+
+	m_RayX.resize(m_Width * m_Height);
+	m_RayY.resize(m_Width * m_Height);
+	m_RayZ.resize(m_Width * m_Height);
+	m_RayProjection = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	//Each level rounds up, so the last row or column of an odd sized level still has a texel above it
+	UINT levelWidth = m_Width;
+	UINT levelHeight = m_Height;
+	for (;;)
+	{
+		m_Levels.push_back(std::vector<float>(levelWidth * levelHeight, FLT_MAX));
+		m_LevelWidths.push_back(levelWidth);
+		m_LevelHeights.push_back(levelHeight);
+
+		if (levelWidth == 1 && levelHeight == 1)
+			break;
+
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+
+	XMStoreFloat4x4(&m_View, XMMatrixIdentity());
+	XMStoreFloat4x4(&m_Projection, XMMatrixIdentity());
+	m_NearDepth = 0.0f;
+	m_PixelAngle = 0.0f;
+	m_Statistics = Statistics();
+}
+
+void OcclusionBuffer::Begin(CXMMATRIX view, CXMMATRIX projection)
+{
+	XMStoreFloat4x4(&m_View, view);
+	XMStoreFloat4x4(&m_Projection, projection);
+
+	//A perspective projection keeps near's depth in _33 and _43
+	m_NearDepth = -m_Projection._43 / m_Projection._33;
+
+	if (m_RayProjection.x != m_Projection._11 || m_RayProjection.y != m_Projection._22 || m_RayProjection.z != m_Projection._31 || m_RayProjection.w != m_Projection._32)
+		BuildRays();
+
+	std::vector<float>& depths = m_Levels[0];
+	for (size_t i = 0; i < depths.size(); i++)
+		depths[i] = FLT_MAX;
+
+	m_Statistics = Statistics();
+}
+
+void OcclusionBuffer::BuildRays()
+{
+	m_RayProjection = XMFLOAT4(m_Projection._11, m_Projection._22, m_Projection._31, m_Projection._32);
+
+	for (UINT y = 0; y < m_Height; y++)
+	{
+		for (UINT x = 0; x < m_Width; x++)
+		{
+			float ndcX = (x + 0.5f) / m_Width * 2.0f - 1.0f;
+			float ndcY = 1.0f - (y + 0.5f) / m_Height * 2.0f;
+
+			XMVECTOR ray = XMVector3Normalize(XMVectorSet((ndcX - m_Projection._31) / m_Projection._11, (ndcY - m_Projection._32) / m_Projection._22, 1.0f, 0.0f));
+
+			UINT i = y * m_Width + x;
+			m_RayX[i] = XMVectorGetX(ray);
+			m_RayY[i] = XMVectorGetY(ray);
+			m_RayZ[i] = XMVectorGetZ(ray);
+		}
+	}
+
+	//Pixels cover the widest angle in the middle of the screen, where a step across the view plane turns the ray furthest
+	float halfWidth = 1.0f / (m_Projection._11 * m_Width);
+	float halfHeight = 1.0f / (m_Projection._22 * m_Height);
+	m_PixelAngle = atanf(sqrtf(halfWidth * halfWidth + halfHeight * halfHeight));
+}
+
+bool OcclusionBuffer::GetPixelRect(FXMVECTOR centreView, float radius, PixelRect& rect) const
+{
+	XMFLOAT3 c;
+	XMStoreFloat3(&c, centreView);
+
+	//Slopes across the box round the sphere, each edge's furthest corner being on the near or far face depending on which side of the view axis it is
+	float minX = (c.x - radius) / (c.x - radius >= 0.0f ? c.z + radius : c.z - radius);
+	float maxX = (c.x + radius) / (c.x + radius >= 0.0f ? c.z - radius : c.z + radius);
+	float minY = (c.y - radius) / (c.y - radius >= 0.0f ? c.z + radius : c.z - radius);
+	float maxY = (c.y + radius) / (c.y + radius >= 0.0f ? c.z - radius : c.z + radius);
+
+	float left = ((minX * m_Projection._11 + m_Projection._31) * 0.5f + 0.5f) * m_Width;
+	float right = ((maxX * m_Projection._11 + m_Projection._31) * 0.5f + 0.5f) * m_Width;
+	float top = (0.5f - (maxY * m_Projection._22 + m_Projection._32) * 0.5f) * m_Height;
+	float bottom = (0.5f - (minY * m_Projection._22 + m_Projection._32) * 0.5f) * m_Height;
+
+	if (right < 0.0f || bottom < 0.0f || left >= m_Width || top >= m_Height)
+		return false;
+
+	//What is off the edge of the screen cannot be seen anyway
+	rect.Left = left < 0.0f ? 0 : (int)left;
+	rect.Top = top < 0.0f ? 0 : (int)top;
+	rect.Right = right >= m_Width ? m_Width - 1 : (int)right;
+	rect.Bottom = bottom >= m_Height ? m_Height - 1 : (int)bottom;
+
+	return true;
+}
+
+void OcclusionBuffer::AddOccluder(FXMVECTOR centre, float radius)
+{
+	XMVECTOR centreView = XMVector3TransformCoord(centre, XMLoadFloat4x4(&m_View));
+	float distance = XMVectorGetX(XMVector3Length(centreView));
+
+	if (XMVectorGetZ(centreView) - radius <= m_NearDepth || distance <= radius)
+		return;
+
+	//Half the angle the sphere covers, less a pixel's worth so any pixel whose centre ray is inside is covered all over
+	float halfAngle = asinf(radius / distance);
+	if (halfAngle <= m_PixelAngle)
+		return;
+
+	PixelRect rect;
+	if (!GetPixelRect(centreView, radius, rect))
+		return;
+
+	m_Statistics.Occluders++;
+
+	//Every covered pixel gets the distance to the sphere's silhouette, the furthest any ray inside the cone meets it at,
+	//so whatever is further than that along a covered ray is behind the sphere
+	XMVECTOR direction = XMVectorScale(centreView, 1.0f / distance);
+	XMVECTOR directionX = XMVectorSplatX(direction);
+	XMVECTOR directionY = XMVectorSplatY(direction);
+	XMVECTOR directionZ = XMVectorSplatZ(direction);
+	XMVECTOR cosLimit = XMVectorReplicate(cosf(halfAngle - m_PixelAngle));
+	XMVECTOR depth = XMVectorReplicate(sqrtf(distance * distance - radius * radius));
+
+	float* depths = &m_Levels[0][0];
+	int left = rect.Left & ~3;
+
+	for (int y = rect.Top; y <= rect.Bottom; y++)
+	{
+		for (int x = left; x <= rect.Right; x += 4)
+		{
+			UINT i = y * m_Width + x;
+
+			XMVECTOR cosine = XMVectorMultiply(XMLoadFloat4((const XMFLOAT4*)&m_RayX[i]), directionX);
+			cosine = XMVectorMultiplyAdd(XMLoadFloat4((const XMFLOAT4*)&m_RayY[i]), directionY, cosine);
+			cosine = XMVectorMultiplyAdd(XMLoadFloat4((const XMFLOAT4*)&m_RayZ[i]), directionZ, cosine);
+
+			XMVECTOR previous = XMLoadFloat4((const XMFLOAT4*)&depths[i]);
+			XMVECTOR covered = XMVectorGreaterOrEqual(cosine, cosLimit);
+			XMStoreFloat4((XMFLOAT4*)&depths[i], XMVectorSelect(previous, XMVectorMin(previous, depth), covered));
+		}
+	}
+}
+
+void OcclusionBuffer::Finish()
+{
+	for (size_t level = 1; level < m_Levels.size(); level++)
+	{
+		const std::vector<float>& below = m_Levels[level - 1];
+		std::vector<float>& depths = m_Levels[level];
+		UINT belowWidth = m_LevelWidths[level - 1];
+		UINT belowHeight = m_LevelHeights[level - 1];
+
+		for (UINT y = 0; y < m_LevelHeights[level]; y++)
+		{
+			UINT y0 = y * 2;
+			UINT y1 = y0 + 1 < belowHeight ? y0 + 1 : y0;
+
+			for (UINT x = 0; x < m_LevelWidths[level]; x++)
+			{
+				UINT x0 = x * 2;
+				UINT x1 = x0 + 1 < belowWidth ? x0 + 1 : x0;
+
+				float a = below[y0 * belowWidth + x0] > below[y0 * belowWidth + x1] ? below[y0 * belowWidth + x0] : below[y0 * belowWidth + x1];
+				float b = below[y1 * belowWidth + x0] > below[y1 * belowWidth + x1] ? below[y1 * belowWidth + x0] : below[y1 * belowWidth + x1];
+				depths[y * m_LevelWidths[level] + x] = a > b ? a : b;
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::IsVisible(FXMVECTOR centre, float radius)
+{
+	m_Statistics.Tested++;
+
+	XMVECTOR centreView = XMVector3TransformCoord(centre, XMLoadFloat4x4(&m_View));
+
+	//Anything reaching the near plane is too close to be sure of
+	if (XMVectorGetZ(centreView) - radius <= m_NearDepth)
+		return true;
+
+	PixelRect rect;
+	if (!GetPixelRect(centreView, radius, rect))
+		return true;
+
+	//The first level the bounds cover no more than two texels across and down
+	UINT level = 0;
+	while (level + 1 < m_Levels.size() && ((rect.Right >> level) - (rect.Left >> level) > 1 || (rect.Bottom >> level) - (rect.Top >> level) > 1))
+		level++;
+
+	const std::vector<float>& depths = m_Levels[level];
+	UINT levelWidth = m_LevelWidths[level];
+	float furthest = 0.0f;
+
+	for (int y = rect.Top >> level; y <= rect.Bottom >> level; y++)
+	{
+		for (int x = rect.Left >> level; x <= rect.Right >> level; x++)
+			furthest = depths[y * levelWidth + x] > furthest ? depths[y * levelWidth + x] : furthest;
+	}
+
+	//Hidden if even the sphere's nearest point is further than anything drawn over it
+	if (furthest < XMVectorGetX(XMVector3Length(centreView)) - radius)
+	{
+		m_Statistics.Culled++;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef OCCLUSIONBUFFER
+#define OCCLUSIONBUFFER
+
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+//Low resolution depth buffer drawn on the CPU from a few large spheres each frame, then used to find bounding spheres hidden behind them
+//so they can be left out before they are ever submitted. Depth is distance from the eye rather than view z, since that is what a sphere
+//gives simply, and a max depth chain over it lets a sphere of any size be tested against at most four texels.
+//Everything errs towards visible, so an item is only reported hidden if it really is behind what was drawn
+class OcclusionBuffer
+{
+public:
+	static const UINT DefaultWidth = 256;
+	static const UINT DefaultHeight = 128;
+
+	//Occluders drawn and spheres tested and found hidden since the last Begin
+	struct Statistics
+	{
+		UINT Occluders;
+		UINT Tested;
+		UINT Culled;
+	};
+
+private:
+	//A sphere's bounds on the buffer in pixels, last row and column included
+	struct PixelRect
+	{
+		int Left;
+		int Top;
+		int Right;
+		int Bottom;
+	};
+
+	UINT m_Width;
+	UINT m_Height;
+
+	//Unit direction from the eye through each pixel's centre in view space, by component so four pixels load at once
+	std::vector<float> m_RayX;
+	std::vector<float> m_RayY;
+	std::vector<float> m_RayZ;
+
+	//Projection the rays were worked out for, so they are only rebuilt when it changes
+	XMFLOAT4 m_RayProjection;
+
+	//Furthest depth of each level, level 0 being the buffer drawn into and each after it half the size of the one before
+	std::vector<std::vector<float>> m_Levels;
+	std::vector<UINT> m_LevelWidths;
+	std::vector<UINT> m_LevelHeights;
+
+	XMFLOAT4X4 m_View;
+	XMFLOAT4X4 m_Projection;
+	float m_NearDepth;
+
+	//Widest angle from a pixel's centre ray to its corners, which coverage is tested to so a pixel is only marked if all of it is covered
+	float m_PixelAngle;
+
+	Statistics m_Statistics;
+
+	//Helper methods for the above method(s)
+	void BuildRays();
+	bool GetPixelRect(FXMVECTOR centreView, float radius, PixelRect& rect) const;
+
+public:
+	//Constructor
+	OcclusionBuffer(UINT width = DefaultWidth, UINT height = DefaultHeight);
+
+	//Clears the buffer for a new frame seen through a view and perspective projection
+	void Begin(CXMMATRIX view, CXMMATRIX projection);
+
+	//Draws a solid sphere given in world space into the buffer. Spheres crossing the near plane or too small to cover a whole pixel are skipped
+	void AddOccluder(FXMVECTOR centre, float radius);
+
+	//Builds the depth chain once every occluder is in
+	void Finish();
+
+	//False only if every part of a world space sphere is behind the occluders. A sphere is never hidden by itself, so an occluder can be tested too
+	bool IsVisible(FXMVECTOR centre, float radius);
+
+	UINT GetWidth() const { return m_Width; }
+	UINT GetHeight() const { return m_Height; }
+	const float* GetDepths() const { return &m_Levels[0][0]; }
+	const Statistics& GetStatistics() const { return m_Statistics; }
+};
+
+#endif
@@ -14,14 +14,18 @@ OrbitalCamera::OrbitalCamera(XMFLOAT4X4 position, XMFLOAT4X4 at, XMFLOAT3 up, FL
 	eyeFloat = XMFLOAT3(_eye._41, _eye._42, _eye._43);
 	atFloat = XMFLOAT3(_at._41, _at._42, at._43);
 
-	XMStoreFloat4x4(&_view, XMMatrixLookAtLH(XMLoadFloat3(&eyeFloat), XMLoadFloat3(&atFloat), XMLoadFloat3(&_up)));
-	XMStoreFloat4x4(&_projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, _windowWidth / (FLOAT)_windowHeight, 0.01f, 100.0f));
-
-	XMMATRIX _viewMatrix = XMLoadFloat4x4(&_view);
-	XMMATRIX _projectionMatrix = XMLoadFloat4x4(&_projection);
-	XMMATRIX _viewProj = _projectionMatrix * _viewMatrix;
+	_transitionEye = eyeFloat;
+	_transitionAt = atFloat;
+	_transitionDuration = 0.0f;
+	_transitionElapsed = 0.0f;
+
+	_viewDirty = true;
+	_projectionDirty = true;
+	_viewProjectionDirty = true;
+}
 
-	XMStoreFloat4x4(&_viewProjection, _viewProj);
+OrbitalCamera::~OrbitalCamera()
+{
 }
 
 void OrbitalCamera::Reshape(FLOAT windowWidth, FLOAT windowHeight, FLOAT nearDepth, FLOAT farDepth)
@@ -31,7 +35,8 @@ void OrbitalCamera::Reshape(FLOAT windowWidth, FLOAT windowHeight, FLOAT nearDep
 	_nearDepth = nearDepth;
 	_farDepth = farDepth;
 
-	XMStoreFloat4x4(&_projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, _windowWidth / (FLOAT)_windowHeight, 0.01f, 100.0f));
+	_projectionDirty = true;
+	_viewProjectionDirty = true;
 }
 
 void OrbitalCamera::Update(XMFLOAT4X4 pos, XMFLOAT4X4 at)
@@ -42,12 +47,15 @@ void OrbitalCamera::Update(XMFLOAT4X4 pos, XMFLOAT4X4 at)
 	eyeFloat = XMFLOAT3(_eye._41, _eye._42, _eye._43);
 	atFloat = XMFLOAT3(_at._41, _at._42, _at._43);
 
-	XMStoreFloat4x4(&_view, XMMatrixLookAtLH(XMLoadFloat3(&eyeFloat), XMLoadFloat3(&atFloat), XMLoadFloat3(&_up)));
-	XMStoreFloat4x4(&_projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, _windowWidth / (FLOAT)_windowHeight, 0.01f, 100.0f));
+	MarkViewDirty();
 }
 
 void OrbitalCamera::Update()
 {
+	//The setters have already marked the view if they moved anything
+	if (_eye._41 == eyeFloat.x && _eye._42 == eyeFloat.y && _eye._43 == eyeFloat.z && _at._41 == atFloat.x && _at._42 == atFloat.y && _at._43 == atFloat.z)
+		return;
+
 	_eye._41 = eyeFloat.x;
 	_eye._42 = eyeFloat.y;
 	_eye._43 = eyeFloat.z;
@@ -56,18 +64,105 @@ void OrbitalCamera::Update()
 	_at._42 = atFloat.y;
 	_at._43 = atFloat.z;
 
-	XMStoreFloat4x4(&_view, XMMatrixLookAtLH(XMLoadFloat3(&eyeFloat), XMLoadFloat3(&atFloat), XMLoadFloat3(&_up)));
-	XMStoreFloat4x4(&_projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, _windowWidth / (FLOAT)_windowHeight, 0.01f, 100.0f));
+	MarkViewDirty();
+}
+
+FLOAT OrbitalCamera::TransitionWeight()
+{
+	if (_transitionElapsed >= _transitionDuration)
+		return 1.0f;
+
+	FLOAT s = _transitionElapsed / _transitionDuration;
+	return s * s * (3.0f - 2.0f * s);
+}
+
+XMFLOAT3 OrbitalCamera::GetEyePosition()
+{
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, XMVectorLerp(XMLoadFloat3(&_transitionEye), XMLoadFloat3(&eyeFloat), TransitionWeight()));
+
+	return eye;
+}
+
+XMFLOAT3 OrbitalCamera::GetLookAtPosition()
+{
+	XMFLOAT3 lookAt;
+	XMStoreFloat3(&lookAt, XMVectorLerp(XMLoadFloat3(&_transitionAt), XMLoadFloat3(&atFloat), TransitionWeight()));
+
+	return lookAt;
 }
 
+XMFLOAT4X4 OrbitalCamera::GetViewMatrix()
+{
+	if (_viewDirty)
+	{
+		XMFLOAT3 eye = GetEyePosition();
+		XMFLOAT3 lookAt = GetLookAtPosition();
+
+		XMStoreFloat4x4(&_view, XMMatrixLookAtLH(XMLoadFloat3(&eye), XMLoadFloat3(&lookAt), XMLoadFloat3(&_up)));
+		_viewDirty = false;
+	}
+
+	return _view;
+}
+
+XMFLOAT4X4 OrbitalCamera::GetProjectionMatrix()
+{
+	if (_projectionDirty)
+	{
+		XMStoreFloat4x4(&_projection, XMMatrixPerspectiveFovLH(XM_PIDIV2, _windowWidth / (FLOAT)_windowHeight, _nearDepth, _farDepth));
+		_projectionDirty = false;
+	}
+
+	return _projection;
+}
 
 XMFLOAT4X4 OrbitalCamera::GetViewProjection()
 {
-	XMMATRIX _viewMatrix = XMLoadFloat4x4(&_view);
-	XMMATRIX _projectionMatrix = XMLoadFloat4x4(&_projection);
-	XMMATRIX _viewProj = _projectionMatrix * _viewMatrix;
+	if (_viewProjectionDirty)
+	{
+		XMMATRIX _viewMatrix = XMLoadFloat4x4(&GetViewMatrix());
+		XMMATRIX _projectionMatrix = XMLoadFloat4x4(&GetProjectionMatrix());
 
-	XMStoreFloat4x4(&_viewProjection, _viewProj);
+		//Row vectors, so the view is applied first
+		XMStoreFloat4x4(&_viewProjection, _viewMatrix * _projectionMatrix);
+		_viewProjectionDirty = false;
+	}
 
 	return _viewProjection;
-}
\ No newline at end of file
+}
+
+void OrbitalCamera::GetPickRay(FLOAT x, FLOAT y, XMFLOAT3& origin, XMFLOAT3& direction)
+{
+	//Window pixels to normalised device coordinates, y pointing up
+	FLOAT ndcX = 2.0f * x / _windowWidth - 1.0f;
+	FLOAT ndcY = 1.0f - 2.0f * y / _windowHeight;
+
+	//Back through the inverse view projection from the near and far planes, the ray starting on the near plane
+	XMMATRIX inverseViewProjection = XMMatrixInverse(nullptr, XMLoadFloat4x4(&GetViewProjection()));
+
+	XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverseViewProjection);
+	XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverseViewProjection);
+
+	XMStoreFloat3(&origin, nearPoint);
+	XMStoreFloat3(&direction, XMVector3Normalize(farPoint - nearPoint));
+}
+
+void OrbitalCamera::BeginTransition(XMFLOAT3 fromEye, XMFLOAT3 fromAt, FLOAT duration)
+{
+	_transitionEye = fromEye;
+	_transitionAt = fromAt;
+	_transitionDuration = duration;
+	_transitionElapsed = 0.0f;
+
+	MarkViewDirty();
+}
+
+void OrbitalCamera::AdvanceTransition(FLOAT deltaTime)
+{
+	if (!IsTransitioning())
+		return;
+
+	_transitionElapsed += deltaTime;
+	MarkViewDirty();
+}
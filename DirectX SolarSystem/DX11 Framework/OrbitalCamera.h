@@ -22,10 +22,26 @@ private:
 	FLOAT _nearDepth;
 	FLOAT _farDepth;
 
+	//Matrices are only rebuilt when asked for after one of their inputs has changed
 	XMFLOAT4X4 _view;
 	XMFLOAT4X4 _projection;
 	XMFLOAT4X4 _viewProjection;
 
+	bool _viewDirty;
+	bool _projectionDirty;
+	bool _viewProjectionDirty;
+
+	//Eye and at the camera is blending away from, and how far through the blend it is
+	XMFLOAT3 _transitionEye;
+	XMFLOAT3 _transitionAt;
+	FLOAT _transitionDuration;
+	FLOAT _transitionElapsed;
+
+	//Smoothstepped blend weight of the live eye and at, 1 once a transition has finished
+	FLOAT TransitionWeight();
+
+	void MarkViewDirty() { _viewDirty = true; _viewProjectionDirty = true; }
+
 public:
 
 	XMFLOAT4X4 _at;
@@ -35,16 +51,16 @@ public:
 	OrbitalCamera(XMFLOAT4X4 position, XMFLOAT4X4 at, XMFLOAT3 up, FLOAT windowWidth, FLOAT windowHeight, FLOAT nearDepth, FLOAT farDepth);
 	~OrbitalCamera();
 
-	// Overloaded Update function to make the current view and projection matrices
+	// Overloaded Update function to set where the camera is and what it follows, the view is built when next asked for
 	void Update(XMFLOAT4X4 pos, XMFLOAT4X4 at);
 
 	//Update Function for the free camera
 	void Update();
 
 	// Get and set methods
-	void SetPosition(XMFLOAT3 eye) { eyeFloat = eye; }
-	void SetLookAt(XMFLOAT3 at) { atFloat = at; }
-	void SetUp(XMFLOAT3 up) { _up = up; }
+	void SetPosition(XMFLOAT3 eye) { eyeFloat = eye; MarkViewDirty(); }
+	void SetLookAt(XMFLOAT3 at) { atFloat = at; MarkViewDirty(); }
+	void SetUp(XMFLOAT3 up) { _up = up; MarkViewDirty(); }
 
 	XMFLOAT4X4 GetPosition() { return _eye; }
 	XMFLOAT4X4 GetAt() { return _at; }
@@ -53,13 +69,28 @@ public:
 	XMFLOAT3 GetFloatPos() { return eyeFloat; }
 	XMFLOAT3 GetFloatAt() { return atFloat; }
 
+	//Where the camera is actually looking from and at, including any transition in progress
+	XMFLOAT3 GetEyePosition();
+	XMFLOAT3 GetLookAtPosition();
+
 	// Get method for matrices
-	XMFLOAT4X4 GetViewMatrix() { return _view; }
-	XMFLOAT4X4 GetProjectionMatrix() { return _projection; }
+	XMFLOAT4X4 GetViewMatrix();
+	XMFLOAT4X4 GetProjectionMatrix();
 	XMFLOAT4X4 GetViewProjection();
 
+	//Ray from the near plane through a point in the window, given in pixels from its top left, for picking what is under the cursor
+	void GetPickRay(FLOAT x, FLOAT y, XMFLOAT3& origin, XMFLOAT3& direction);
+
 	// A function to reshape the camera volume if the window is resized
 	void Reshape(FLOAT windowWidth, FLOAT windowHeight, FLOAT nearDepth, FLOAT farDepth);
+
+	//Starts blending from another camera's eye and at to this camera's own over duration seconds
+	void BeginTransition(XMFLOAT3 fromEye, XMFLOAT3 fromAt, FLOAT duration);
+
+	//Moves a transition on, does nothing once it has finished
+	void AdvanceTransition(FLOAT deltaTime);
+
+	bool IsTransitioning() { return _transitionElapsed < _transitionDuration; }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,139 @@
+#include "ParallelFor.h"
+
+namespace
+{
+	//Set on a thread while it is running a range, so a ParallelFor inside one knows not to wait on the workers
+	thread_local bool InsideRange = false;
+}
+
+ParallelWorkers::ParallelWorkers()
+{
+	m_Stopping = false;
+	m_Call = 0;
+	m_Function = nullptr;
+	m_Body = nullptr;
+	m_Count = 0;
+	m_Chunk = 0;
+	m_Ranges = 0;
+	m_NextRange = 0;
+	m_Openings = 0;
+	m_Joined = 0;
+}
+
+ParallelWorkers::~ParallelWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+
+	m_Wake.notify_all();
+
+	for (size_t i = 0; i < m_Threads.size(); i++)
+		m_Threads[i].join();
+}
+
+ParallelWorkers& ParallelWorkers::Get()
+{
+	static ParallelWorkers workers;
+	return workers;
+}
+
+void ParallelWorkers::EnsureThreads(size_t threads)
+{
+	while (m_Threads.size() < threads)
+		m_Threads.emplace_back([this]() { WorkerLoop(); });
+}
+
+void ParallelWorkers::RunRanges(RangeFunction function, const void* body, size_t count, size_t chunk, size_t ranges)
+{
+	bool wasInside = InsideRange;
+	InsideRange = true;
+
+	for (size_t range = m_NextRange++; range < ranges; range = m_NextRange++)
+	{
+		size_t begin = range * chunk;
+		function(body, begin, begin + chunk < count ? begin + chunk : count);
+	}
+
+	InsideRange = wasInside;
+}
+
+void ParallelWorkers::WorkerLoop()
+{
+	uint64_t lastCall = 0;
+
+	for (;;)
+	{
+		RangeFunction function;
+		const void* body;
+		size_t count, chunk, ranges;
+
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wake.wait(lock, [&]() { return m_Stopping || (m_Call != lastCall && m_Openings > 0); });
+
+			if (m_Stopping)
+				return;
+
+			lastCall = m_Call;
+			m_Openings--;
+			m_Joined++;
+
+			function = m_Function;
+			body = m_Body;
+			count = m_Count;
+			chunk = m_Chunk;
+			ranges = m_Ranges;
+		}
+
+		RunRanges(function, body, count, chunk, ranges);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Joined--;
+		}
+
+		m_Finished.notify_one();
+	}
+}
+
+void ParallelWorkers::Run(RangeFunction function, const void* body, size_t count, size_t chunk, size_t ranges)
+{
+	//Nested inside a range every worker may already be busy, including with the range this was called from
+	if (InsideRange || ranges <= 1)
+	{
+		for (size_t range = 0; range < ranges; range++)
+		{
+			size_t begin = range * chunk;
+			function(body, begin, begin + chunk < count ? begin + chunk : count);
+		}
+
+		return;
+	}
+
+	std::lock_guard<std::mutex> call(m_CallMutex);
+	EnsureThreads(ranges - 1);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Call++;
+		m_Function = function;
+		m_Body = body;
+		m_Count = count;
+		m_Chunk = chunk;
+		m_Ranges = ranges;
+		m_NextRange = 0;
+		m_Openings = ranges - 1;
+	}
+
+	m_Wake.notify_all();
+
+	RunRanges(function, body, count, chunk, ranges);
+
+	//Every range has been claimed once the caller runs out, but the workers that claimed them may still be running them.
+	//Closing the call to any worker yet to join before waiting means none can pick up the next call's ranges with this one's body
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Openings = 0;
+	m_Finished.wait(lock, [&]() { return m_Joined == 0; });
+}
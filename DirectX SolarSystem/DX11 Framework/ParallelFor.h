@@ -0,0 +1,121 @@
+#pragma once
+#ifndef PARALLELFOR
+#define PARALLELFOR
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+#include <stdint.h>
+
+//Threads ParallelFor splits work across when set, rather than one per hardware thread.
+//Callers keep each item's work independent of where the ranges fall, so this changes timings and not results, for comparable benchmark runs
+inline size_t& ParallelThreadCountOverride()
+{
+	static size_t threads = 0;
+	return threads;
+}
+
+inline void SetParallelThreadCount(size_t threads)
+{
+	ParallelThreadCountOverride() = threads;
+}
+
+inline size_t GetParallelThreadCount()
+{
+	size_t threads = ParallelThreadCountOverride();
+	if (threads == 0)
+		threads = std::thread::hardware_concurrency();
+
+	return threads > 0 ? threads : 1;
+}
+
+//Worker threads started the first time ParallelFor needs them and kept waiting between calls, so a call costs a wake-up rather than
+//creating and joining threads. There is one set for the whole program, growing if the thread count is raised past it.
+//One call runs on it at a time, another thread calling meanwhile waits its turn. A call from inside a range that is already running
+//would wait on itself, so it runs its ranges in order on the thread it was made from instead
+class ParallelWorkers
+{
+private:
+	typedef void (*RangeFunction)(const void* body, size_t begin, size_t end);
+
+	std::vector<std::thread> m_Threads;
+
+	//Held for the whole of a call, so only one is ever handed out
+	std::mutex m_CallMutex;
+
+	//Guards everything about the call being handed out below, workers wait on m_Wake for one and the caller on m_Finished for it to end
+	std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	std::condition_variable m_Finished;
+	bool m_Stopping;
+
+	//The call being handed out, numbered so a worker takes each at most once. Ranges are claimed through m_NextRange
+	uint64_t m_Call;
+	RangeFunction m_Function;
+	const void* m_Body;
+	size_t m_Count;
+	size_t m_Chunk;
+	size_t m_Ranges;
+	std::atomic<size_t> m_NextRange;
+
+	//Workers that may still join the call, and those that have joined and not yet left it
+	size_t m_Openings;
+	size_t m_Joined;
+
+	//Helper methods for the above method(s)
+	void WorkerLoop();
+	void RunRanges(RangeFunction function, const void* body, size_t count, size_t chunk, size_t ranges);
+	void EnsureThreads(size_t threads);
+	void Run(RangeFunction function, const void* body, size_t count, size_t chunk, size_t ranges);
+
+	template <typename Function> static void Invoke(const void* body, size_t begin, size_t end)
+	{
+		(*(const Function*)body)(begin, end);
+	}
+
+	//Constructor
+	ParallelWorkers();
+
+public:
+	//Destructor
+	~ParallelWorkers();
+
+	static ParallelWorkers& Get();
+
+	//Calls body(begin, end) for each of ranges ranges of chunk items, the last cut short at count, returning once they have all finished.
+	//The calling thread takes ranges too
+	template <typename Function>
+	void For(size_t count, size_t chunk, size_t ranges, const Function& body)
+	{
+		Run(&Invoke<Function>, &body, count, chunk, ranges);
+	}
+
+	size_t GetThreadCount() const { return m_Threads.size(); }
+};
+
+//Splits [0, count) into one contiguous range per thread and calls body(begin, end) for each, returning once they have all finished.
+//The calling thread takes a range as well. Counts too small to be worth a thread each, going by minimumPerThread, use fewer threads
+template <typename Function>
+void ParallelFor(size_t count, size_t minimumPerThread, const Function& body)
+{
+	if (count == 0)
+		return;
+
+	size_t threads = GetParallelThreadCount();
+	size_t worthwhile = minimumPerThread > 0 ? count / minimumPerThread : count;
+	if (threads > worthwhile)
+		threads = worthwhile > 0 ? worthwhile : 1;
+
+	if (threads == 1)
+	{
+		body((size_t)0, count);
+		return;
+	}
+
+	size_t chunk = (count + threads - 1) / threads;
+	ParallelWorkers::Get().For(count, chunk, (count + chunk - 1) / chunk, body);
+}
+
+#endif
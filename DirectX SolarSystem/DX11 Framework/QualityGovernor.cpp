@@ -0,0 +1,123 @@
+#include "QualityGovernor.h"
+
+namespace
+{
+	//Lowest quality first. Level 5 is what the scene drew before there was a governor, apart from bodies picking their own sphere level
+	//and distant asteroids being solved less often
+	const QualityGovernor::Settings Levels[QualityGovernor::LevelCount] =
+	{
+		{ 0.25f, 2, 2.0f, 1.0f },
+		{ 0.4f, 2, 1.5f, 1.0f },
+		{ 0.6f, 1, 1.0f, 0.5f },
+		{ 0.8f, 1, 0.75f, 0.5f },
+		{ 1.0f, 0, 0.5f, 0.25f },
+		{ 1.0f, 0, 0.0f, 0.25f },
+		{ 1.0f, -1, 0.0f, 0.125f },
+		{ 1.0f, -2, 0.0f, 0.125f }
+	};
+
+	//Length of a window, and of a frame long enough to be a hitch rather than load
+	const double WindowSeconds = 0.25;
+	const double HitchSeconds = 0.25;
+
+	//Share of the target a window has to be over to count against the level, or under to count towards the next one up
+	const double OverBudget = 1.1;
+	const double UnderBudget = 0.75;
+
+	//Windows in a row before dropping or climbing, and to wait after either for the change to show
+	const UINT LowerWindows = 2;
+	const UINT MinRaiseWindows = 8;
+	const UINT MaxRaiseWindows = 256;
+	const UINT CooldownWindows = 4;
+
+	//Windows a climb is on trial for, a drop inside them meaning the level above cannot be held
+	const UINT RaiseTrialWindows = 16;
+}
+
+QualityGovernor::QualityGovernor(double targetSeconds, UINT level)
+{
+	m_TargetSeconds = targetSeconds;
+	Reset(level);
+}
+
+void QualityGovernor::Reset(UINT level)
+{
+	m_Level = level < LevelCount ? level : LevelCount - 1;
+	m_WindowSeconds = 0.0;
+	m_WindowFrames = 0;
+	m_AverageSeconds = 0.0;
+	m_OverWindows = 0;
+	m_UnderWindows = 0;
+	m_CooldownWindows = 0;
+	m_RaiseWindows = MinRaiseWindows;
+	m_WindowsSinceRaise = RaiseTrialWindows;
+}
+
+QualityGovernor::Decision QualityGovernor::AddFrame(double frameSeconds)
+{
+	if (frameSeconds <= 0.0 || frameSeconds > HitchSeconds)
+		return DECISION_NONE;
+
+	m_WindowSeconds += frameSeconds;
+	m_WindowFrames++;
+
+	if (m_WindowSeconds < WindowSeconds)
+		return DECISION_NONE;
+
+	m_AverageSeconds = m_WindowSeconds / m_WindowFrames;
+	m_WindowSeconds = 0.0;
+	m_WindowFrames = 0;
+
+	return JudgeWindow();
+}
+
+QualityGovernor::Decision QualityGovernor::JudgeWindow()
+{
+	if (m_WindowsSinceRaise < RaiseTrialWindows && ++m_WindowsSinceRaise == RaiseTrialWindows)
+		m_RaiseWindows = MinRaiseWindows;
+
+	if (m_CooldownWindows > 0)
+	{
+		m_CooldownWindows--;
+		return DECISION_NONE;
+	}
+
+	//Between the two bounds nothing builds up, so a level that is only just holding is left alone
+	bool over = m_AverageSeconds > m_TargetSeconds * OverBudget;
+	bool under = m_AverageSeconds < m_TargetSeconds * UnderBudget;
+	m_OverWindows = over ? m_OverWindows + 1 : 0;
+	m_UnderWindows = under ? m_UnderWindows + 1 : 0;
+
+	if (m_OverWindows >= LowerWindows && m_Level > 0)
+	{
+		//Dropping straight back from a climb means the level above is out of reach for now
+		if (m_WindowsSinceRaise < RaiseTrialWindows)
+		{
+			m_RaiseWindows = m_RaiseWindows * 2 < MaxRaiseWindows ? m_RaiseWindows * 2 : MaxRaiseWindows;
+			m_WindowsSinceRaise = RaiseTrialWindows;
+		}
+
+		m_Level--;
+		m_OverWindows = 0;
+		m_UnderWindows = 0;
+		m_CooldownWindows = CooldownWindows;
+		return DECISION_LOWER;
+	}
+
+	if (m_UnderWindows >= m_RaiseWindows && m_Level + 1 < LevelCount)
+	{
+		m_Level++;
+		m_OverWindows = 0;
+		m_UnderWindows = 0;
+		m_CooldownWindows = CooldownWindows;
+		m_WindowsSinceRaise = 0;
+		return DECISION_RAISE;
+	}
+
+	return DECISION_NONE;
+}
+
+const QualityGovernor::Settings& QualityGovernor::GetLevelSettings(UINT level)
+{
+	return Levels[level < LevelCount ? level : LevelCount - 1];
+}
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef QUALITYGOVERNOR
+#define QUALITYGOVERNOR
+
+#include <windows.h>
+
+//Keeps frame time near a target by moving the scene's quality settings up and down a fixed ladder of levels, lowest first.
+//Frames are averaged over short windows and a level only changes after several windows in a row agree, dropping quickly when over budget
+//and climbing slowly when well under it. A climb that has to be undone soon after makes the next climb wait twice as long, so it settles
+//rather than bouncing between two levels
+class QualityGovernor
+{
+public:
+	//What a level draws
+	struct Settings
+	{
+		//Share of the belt asteroids and ring particles drawn at all, the same ones each frame
+		float AsteroidFraction;
+
+		//Sphere levels taken off what a body's size on screen would give it, negative for finer
+		int LODBias;
+
+		//Radius on screen in pixels below which an asteroid or ring particle is left out
+		float DetailPixels;
+
+		//Pixels an asteroid may drift from its orbit between the steps its orbit is solved at, larger solving distant ones less often
+		float ExtrapolationPixels;
+	};
+
+	enum Decision
+	{
+		DECISION_NONE,
+		DECISION_LOWER,
+		DECISION_RAISE
+	};
+
+	static const UINT LevelCount = 8;
+
+	//Draws everything at the sizes the scene was built with, where the governor starts
+	static const UINT DefaultLevel = 5;
+
+private:
+	double m_TargetSeconds;
+	UINT m_Level;
+
+	//Frames in the window being filled, and the average of the last full one
+	double m_WindowSeconds;
+	UINT m_WindowFrames;
+	double m_AverageSeconds;
+
+	//Full windows in a row over and under budget, and windows left to wait after a change before judging again
+	UINT m_OverWindows;
+	UINT m_UnderWindows;
+	UINT m_CooldownWindows;
+
+	//Windows under budget a climb needs, and windows since the last climb while it is still on trial
+	UINT m_RaiseWindows;
+	UINT m_WindowsSinceRaise;
+
+	//Helper methods for the above method(s)
+	Decision JudgeWindow();
+
+public:
+	//Constructor
+	QualityGovernor(double targetSeconds = 1.0 / 60.0, UINT level = DefaultLevel);
+
+	//Counts a frame's length, returning whether the level changed because of it. Hitches, such as the window being dragged, are ignored
+	Decision AddFrame(double frameSeconds);
+
+	//Starts again at a level with nothing measured
+	void Reset(UINT level = DefaultLevel);
+
+	UINT GetLevel() const { return m_Level; }
+	const Settings& GetSettings() const { return GetLevelSettings(m_Level); }
+	double GetTargetSeconds() const { return m_TargetSeconds; }
+	double GetAverageSeconds() const { return m_AverageSeconds; }
+
+	static const Settings& GetLevelSettings(UINT level);
+};
+
+#endif
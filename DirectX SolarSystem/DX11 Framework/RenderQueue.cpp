@@ -0,0 +1,128 @@
+#include "RenderQueue.h"
+#include <string.h>
+
+//Bits of the key each radix pass sorts on
+static const int DigitBits = 8;
+static const int DigitCount = 64 / DigitBits;
+static const int Buckets = 1 << DigitBits;
+
+RenderQueue::RenderQueue()
+{
+	m_Statistics = Statistics();
+}
+
+void RenderQueue::Clear()
+{
+	m_Items.clear();
+	m_Entries.clear();
+}
+
+void RenderQueue::Submit(const DrawItem& item, float depth)
+{
+	SortEntry entry;
+	entry.Key = MakeKey(item.Blend, item.Shader, item.Mesh.Index, item.Texture.Index, depth);
+	entry.Item = (UINT)m_Items.size();
+
+	m_Items.push_back(item);
+	m_Entries.push_back(entry);
+}
+
+void RenderQueue::Sort()
+{
+	size_t count = m_Entries.size();
+	if (count < 2)
+		return;
+
+	//Every digit's histogram in one read of the keys
+	UINT histograms[DigitCount][Buckets];
+	memset(histograms, 0, sizeof(histograms));
+
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = m_Entries[i].Key;
+		for (int digit = 0; digit < DigitCount; digit++)
+			histograms[digit][(key >> (digit * DigitBits)) & (Buckets - 1)]++;
+	}
+
+	m_Scratch.resize(count);
+
+	//Least significant digit first, each pass stable, skipping any digit every key shares, which with few meshes and textures is most of them
+	for (int digit = 0; digit < DigitCount; digit++)
+	{
+		UINT* histogram = histograms[digit];
+		UINT firstKeyBucket = (UINT)((m_Entries[0].Key >> (digit * DigitBits)) & (Buckets - 1));
+		if (histogram[firstKeyBucket] == count)
+			continue;
+
+		UINT offset = 0;
+		for (int bucket = 0; bucket < Buckets; bucket++)
+		{
+			UINT bucketCount = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketCount;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const SortEntry& entry = m_Entries[i];
+			m_Scratch[histogram[(entry.Key >> (digit * DigitBits)) & (Buckets - 1)]++] = entry;
+		}
+
+		m_Entries.swap(m_Scratch);
+	}
+}
+
+uint64_t RenderQueue::MakeKey(BlendMode blend, UINT shader, UINT mesh, UINT texture, float depth)
+{
+	//A float that is not negative orders the same way as its bits read as an integer
+	float clamped = depth > 0.0f ? depth : 0.0f;
+	uint32_t depthBits;
+	memcpy(&depthBits, &clamped, sizeof(depthBits));
+
+	uint64_t state = ((uint64_t)(shader & ((1u << ShaderBits) - 1)) << (MeshBits + TextureBits))
+		| ((uint64_t)(mesh & ((1u << MeshBits) - 1)) << TextureBits)
+		| (uint64_t)(texture & ((1u << TextureBits) - 1));
+
+	//Opaque items group by state and go front to back within it, so the nearest fill the depth buffer first
+	if (blend == BLEND_OPAQUE)
+		return (state << 32) | depthBits;
+
+	//Transparent ones have to go back to front whatever their state, so the depth goes above it, inverted to put the furthest first
+	return (1ull << 63) | ((uint64_t)(~depthBits) << (ShaderBits + MeshBits + TextureBits)) | state;
+}
+
+UINT RenderQueue::ChangesBetween(const DrawItem& previous, const DrawItem& item)
+{
+	UINT changes = 0;
+
+	if (item.Shader != previous.Shader)
+		changes |= CHANGE_SHADER;
+
+	if (item.Mesh.Index != previous.Mesh.Index || item.Mesh.Generation != previous.Mesh.Generation)
+		changes |= CHANGE_MESH;
+
+	if (item.Texture.Index != previous.Texture.Index || item.Texture.Generation != previous.Texture.Generation)
+		changes |= CHANGE_TEXTURE;
+
+	if (item.Blend != previous.Blend || (item.Blend == BLEND_TRANSPARENT && item.BlendFactor != previous.BlendFactor))
+		changes |= CHANGE_BLEND;
+
+	return changes;
+}
+
+void RenderQueue::Count(UINT changes)
+{
+	m_Statistics.Draws++;
+
+	if (changes & CHANGE_SHADER)
+		m_Statistics.ShaderBinds++;
+
+	if (changes & CHANGE_MESH)
+		m_Statistics.MeshBinds++;
+
+	if (changes & CHANGE_TEXTURE)
+		m_Statistics.TextureBinds++;
+
+	if (changes & CHANGE_BLEND)
+		m_Statistics.BlendBinds++;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#ifndef RENDERQUEUE
+#define RENDERQUEUE
+
+#include "Components.h"
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+#include <stdint.h>
+
+using namespace DirectX;
+
+//Everything that needs drawing in a frame, collected in any order then sorted by a 64 bit key so draws sharing state go out together.
+//Opaque items sort by shader, mesh and texture and then front to back, transparent ones after every opaque one and back to front
+class RenderQueue
+{
+public:
+	enum BlendMode
+	{
+		BLEND_OPAQUE,
+		BLEND_TRANSPARENT
+	};
+
+	struct DrawItem
+	{
+		XMFLOAT4X4 World;
+		MeshHandle Mesh;
+		TextureHandle Texture;
+		Material Surface;
+		UINT Shader;
+		BlendMode Blend;
+		float BlendFactor;
+	};
+
+	//State an item needs bound that the one before it did not, as passed to Execute
+	enum StateChange
+	{
+		CHANGE_SHADER = 1,
+		CHANGE_MESH = 2,
+		CHANGE_TEXTURE = 4,
+		CHANGE_BLEND = 8
+	};
+
+	//Draws and binds in the last Execute
+	struct Statistics
+	{
+		UINT Draws;
+		UINT ShaderBinds;
+		UINT MeshBinds;
+		UINT TextureBinds;
+		UINT BlendBinds;
+	};
+
+	//Width of each state field in a key, handles beyond these share a value and only lose some grouping, never correctness
+	static const int ShaderBits = 7;
+	static const int MeshBits = 12;
+	static const int TextureBits = 12;
+
+private:
+	struct SortEntry
+	{
+		uint64_t Key;
+		UINT Item;
+	};
+
+	std::vector<DrawItem> m_Items;
+
+	//Keys and the item each belongs to, sorted by Sort, and the other half of each radix pass
+	std::vector<SortEntry> m_Entries;
+	std::vector<SortEntry> m_Scratch;
+
+	Statistics m_Statistics;
+
+	//Helper methods for the above method(s)
+	static UINT ChangesBetween(const DrawItem& previous, const DrawItem& item);
+	void Count(UINT changes);
+
+public:
+	//Constructor
+	RenderQueue();
+
+	//Empties the queue for the next frame, keeping its memory
+	void Clear();
+
+	//Adds an item, depth being how far it is from the eye in any measure that grows with distance, such as the distance squared
+	void Submit(const DrawItem& item, float depth);
+
+	//Puts the items in key order. Equal keys stay in the order they were submitted, so the same items always sort the same way
+	void Sort();
+
+	size_t GetCount() const { return m_Entries.size(); }
+	const DrawItem& GetItem(size_t sorted) const { return m_Items[m_Entries[sorted].Item]; }
+	uint64_t GetKey(size_t sorted) const { return m_Entries[sorted].Key; }
+
+	//Calls draw(item, changes) for each item in sorted order, changes being the StateChange bits that differ from the item before,
+	//every bit for the first. Binds are counted as they are asked for, so GetStatistics is what that frame really bound
+	template <typename Function> void Execute(const Function& draw)
+	{
+		m_Statistics = Statistics();
+
+		for (size_t i = 0; i < m_Entries.size(); i++)
+		{
+			const DrawItem& item = GetItem(i);
+			UINT changes = i == 0 ? CHANGE_SHADER | CHANGE_MESH | CHANGE_TEXTURE | CHANGE_BLEND : ChangesBetween(GetItem(i - 1), item);
+
+			Count(changes);
+			draw(item, changes);
+		}
+	}
+
+	const Statistics& GetStatistics() const { return m_Statistics; }
+
+	//Key for an item, blend mode first so all opaque items go before all transparent ones
+	static uint64_t MakeKey(BlendMode blend, UINT shader, UINT mesh, UINT texture, float depth);
+};
+
+#endif
@@ -0,0 +1,532 @@
+#include "ResourceManager.h"
+#include "MipGenerator.h"
+#include "SphereGenerator.h"
+
+namespace
+{
+	const uint64_t FNVOffsetBasis = 14695981039346656037ULL;
+	const uint64_t FNVPrime = 1099511628211ULL;
+
+	//Case and slash direction do not tell two paths apart
+	unsigned int NormalisePathCharacter(unsigned int c)
+	{
+		if (c >= 'A' && c <= 'Z')
+			c += 'a' - 'A';
+		else if (c == '\\')
+			c = '/';
+
+		return c;
+	}
+
+	uint64_t HashCharacter(uint64_t hash, unsigned int c)
+	{
+		c = NormalisePathCharacter(c);
+
+		//Hash both bytes so narrow and wide spellings of the same path match
+		hash = (hash ^ (c & 0xff)) * FNVPrime;
+		hash = (hash ^ ((c >> 8) & 0xff)) * FNVPrime;
+
+		return hash;
+	}
+
+	template <typename Character> bool SamePathCharacters(const Character* a, const Character* b)
+	{
+		for (; *a && *b; a++, b++)
+		{
+			if (NormalisePathCharacter((unsigned int)*a) != NormalisePathCharacter((unsigned int)*b))
+				return false;
+		}
+
+		return *a == *b;
+	}
+
+	//Texels across and down each block a format is stored in, 4 for the block compressed formats and 1 for the rest, and the bytes in a block.
+	//False for a format this does not know, whose size is left out rather than guessed
+	bool FormatBlock(DXGI_FORMAT format, UINT& blockSize, UINT& blockBytes)
+	{
+		blockSize = 1;
+
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+		case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+			blockSize = 4;
+			blockBytes = 8;
+			return true;
+
+		case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+		case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+		case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+		case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+		case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+			blockSize = 4;
+			blockBytes = 16;
+			return true;
+
+		case DXGI_FORMAT_R32G32B32A32_TYPELESS: case DXGI_FORMAT_R32G32B32A32_FLOAT: case DXGI_FORMAT_R32G32B32A32_UINT: case DXGI_FORMAT_R32G32B32A32_SINT:
+			blockBytes = 16;
+			return true;
+
+		case DXGI_FORMAT_R32G32B32_TYPELESS: case DXGI_FORMAT_R32G32B32_FLOAT: case DXGI_FORMAT_R32G32B32_UINT: case DXGI_FORMAT_R32G32B32_SINT:
+			blockBytes = 12;
+			return true;
+
+		case DXGI_FORMAT_R16G16B16A16_TYPELESS: case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R16G16B16A16_UINT: case DXGI_FORMAT_R16G16B16A16_SNORM: case DXGI_FORMAT_R16G16B16A16_SINT:
+		case DXGI_FORMAT_R32G32_TYPELESS: case DXGI_FORMAT_R32G32_FLOAT: case DXGI_FORMAT_R32G32_UINT: case DXGI_FORMAT_R32G32_SINT:
+			blockBytes = 8;
+			return true;
+
+		case DXGI_FORMAT_R8G8B8A8_TYPELESS: case DXGI_FORMAT_R8G8B8A8_UNORM: case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_R8G8B8A8_UINT: case DXGI_FORMAT_R8G8B8A8_SNORM: case DXGI_FORMAT_R8G8B8A8_SINT:
+		case DXGI_FORMAT_B8G8R8A8_TYPELESS: case DXGI_FORMAT_B8G8R8A8_UNORM: case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8X8_TYPELESS: case DXGI_FORMAT_B8G8R8X8_UNORM: case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		case DXGI_FORMAT_R10G10B10A2_TYPELESS: case DXGI_FORMAT_R10G10B10A2_UNORM: case DXGI_FORMAT_R10G10B10A2_UINT:
+		case DXGI_FORMAT_R11G11B10_FLOAT: case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+		case DXGI_FORMAT_R16G16_TYPELESS: case DXGI_FORMAT_R16G16_FLOAT: case DXGI_FORMAT_R16G16_UNORM:
+		case DXGI_FORMAT_R16G16_UINT: case DXGI_FORMAT_R16G16_SNORM: case DXGI_FORMAT_R16G16_SINT:
+		case DXGI_FORMAT_R32_TYPELESS: case DXGI_FORMAT_R32_FLOAT: case DXGI_FORMAT_R32_UINT: case DXGI_FORMAT_R32_SINT:
+			blockBytes = 4;
+			return true;
+
+		case DXGI_FORMAT_R8G8_TYPELESS: case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R8G8_UINT: case DXGI_FORMAT_R8G8_SNORM: case DXGI_FORMAT_R8G8_SINT:
+		case DXGI_FORMAT_R16_TYPELESS: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM: case DXGI_FORMAT_R16_UINT: case DXGI_FORMAT_R16_SNORM: case DXGI_FORMAT_R16_SINT:
+		case DXGI_FORMAT_B5G6R5_UNORM: case DXGI_FORMAT_B5G5R5A1_UNORM: case DXGI_FORMAT_B4G4R4A4_UNORM:
+			blockBytes = 2;
+			return true;
+
+		case DXGI_FORMAT_R8_TYPELESS: case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_R8_UINT: case DXGI_FORMAT_R8_SNORM: case DXGI_FORMAT_R8_SINT:
+		case DXGI_FORMAT_A8_UNORM:
+			blockBytes = 1;
+			return true;
+
+		default:
+			blockBytes = 0;
+			return false;
+		}
+	}
+}
+
+ResourceManager::ResourceManager(ID3D11Device* device)
+{
+	m_Device = device;
+	m_FallbackTexture = nullptr;
+
+	for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++)
+		m_ResidentBytes[i] = 0;
+
+	//Flat grey stand-in for textures that are missing from disk
+	const uint32_t grey = 0xff808080;
+
+	D3D11_TEXTURE2D_DESC desc;
+	ZeroMemory(&desc, sizeof(desc));
+	desc.Width = 1;
+	desc.Height = 1;
+	desc.MipLevels = 1;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	D3D11_SUBRESOURCE_DATA initData;
+	ZeroMemory(&initData, sizeof(initData));
+	initData.pSysMem = &grey;
+	initData.SysMemPitch = sizeof(grey);
+
+	ID3D11Texture2D* texture = nullptr;
+	if (SUCCEEDED(m_Device->CreateTexture2D(&desc, &initData, &texture)))
+	{
+		m_Device->CreateShaderResourceView(texture, nullptr, &m_FallbackTexture);
+		texture->Release();
+	}
+
+	if (m_FallbackTexture)
+		m_ResidentBytes[RESOURCE_TEXTURE] += TextureBytes(m_FallbackTexture);
+}
+
+ResourceManager::~ResourceManager()
+{
+	ReleaseAll();
+
+	if (m_FallbackTexture)
+	{
+		m_FallbackTexture->Release();
+		m_FallbackTexture = nullptr;
+	}
+}
+
+TextureHandle ResourceManager::LoadTexture(const wchar_t* filename)
+{
+	uint64_t hash = HashPath(filename);
+
+	UINT index = FindTexture(hash, filename);
+	if (index < m_Textures.size())
+	{
+		TextureEntry& entry = m_Textures[index];
+		entry.m_RefCount++;
+
+		TextureHandle handle = { index, entry.m_Generation };
+		return handle;
+	}
+
+	ID3D11ShaderResourceView* view = nullptr;
+	if (FAILED(MipGenerator::CreateTextureWithMips(m_Device, filename, &view)))
+		view = nullptr;
+
+	return AddTexture(view, hash, filename);
+}
+
+MeshHandle ResourceManager::LoadMesh(char* filename, bool invertTexCoords, const char* group)
+{
+	//A group is named after the file the way OBJLoader names its binary file, which is the same mesh however it is asked for
+	std::string path = filename;
+	if (group)
+		path.append(group);
+
+	//The same file loaded with different texture coordinate handling is a different mesh
+	uint64_t hash = HashPath(path.c_str());
+	if (!invertTexCoords)
+		hash = HashCharacter(hash, '!');
+
+	UINT index = FindMesh(hash, path.c_str(), invertTexCoords);
+	if (index < m_Meshes.size())
+	{
+		MeshEntry& entry = m_Meshes[index];
+		entry.m_RefCount++;
+
+		MeshHandle handle = { index, entry.m_Generation };
+		return handle;
+	}
+
+	return AddMesh(OBJLoader::Load(filename, m_Device, invertTexCoords, group), hash, path, invertTexCoords);
+}
+
+MeshHandle ResourceManager::LoadSphere(UINT level)
+{
+	if (level > SphereGenerator::MaxLevel)
+		level = SphereGenerator::MaxLevel;
+
+	//Procedural meshes get a path that cannot clash with a file
+	std::string name = "<sphere:" + std::to_string(level) + ">";
+	uint64_t hash = HashPath(name.c_str());
+
+	UINT index = FindMesh(hash, name.c_str(), true);
+	if (index < m_Meshes.size())
+	{
+		MeshEntry& entry = m_Meshes[index];
+		entry.m_RefCount++;
+
+		MeshHandle handle = { index, entry.m_Generation };
+		return handle;
+	}
+
+	std::vector<SimpleVertex> vertices;
+	std::vector<unsigned short> indices;
+	SphereGenerator::Generate(level, vertices, indices);
+
+	return AddMesh(SphereGenerator::CreateBuffers(vertices, indices, m_Device), hash, name, true);
+}
+
+TextureHandle ResourceManager::AddTexture(ID3D11ShaderResourceView* view, uint64_t hash, const std::wstring& path)
+{
+	UINT index;
+	if (!m_FreeTextures.empty())
+	{
+		index = m_FreeTextures.back();
+		m_FreeTextures.pop_back();
+	}
+	else
+	{
+		index = (UINT)m_Textures.size();
+		m_Textures.push_back(TextureEntry());
+		m_Textures[index].m_Generation = 0;
+	}
+
+	//A missing file still gets its own entry so its path is only tried once
+	TextureEntry& entry = m_Textures[index];
+	entry.m_View = view;
+	entry.m_Hash = hash;
+	entry.m_Path = path;
+	entry.m_RefCount = 1;
+	entry.m_Generation++;
+	entry.m_Bytes = view ? TextureBytes(view) : 0;
+
+	m_ResidentBytes[RESOURCE_TEXTURE] += entry.m_Bytes;
+	m_TextureLookup.insert(std::make_pair(hash, index));
+
+	TextureHandle handle = { index, entry.m_Generation };
+	return handle;
+}
+
+MeshHandle ResourceManager::AddMesh(MeshData mesh, uint64_t hash, const std::string& path, bool invertTexCoords)
+{
+	UINT index;
+	if (!m_FreeMeshes.empty())
+	{
+		index = m_FreeMeshes.back();
+		m_FreeMeshes.pop_back();
+	}
+	else
+	{
+		index = (UINT)m_Meshes.size();
+		m_Meshes.push_back(MeshEntry());
+		m_Meshes[index].m_Generation = 0;
+	}
+
+	MeshEntry& entry = m_Meshes[index];
+	entry.m_Mesh = mesh;
+	entry.m_Hash = hash;
+	entry.m_Path = path;
+	entry.m_InvertTexCoords = invertTexCoords;
+	entry.m_RefCount = 1;
+	entry.m_Generation++;
+	entry.m_Bytes = MeshBytes(mesh);
+
+	m_ResidentBytes[RESOURCE_MESH] += entry.m_Bytes;
+	m_MeshLookup.insert(std::make_pair(hash, index));
+
+	MeshHandle handle = { index, entry.m_Generation };
+	return handle;
+}
+
+UINT ResourceManager::FindTexture(uint64_t hash, const wchar_t* path) const
+{
+	auto range = m_TextureLookup.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (SamePath(m_Textures[it->second].m_Path.c_str(), path))
+			return it->second;
+	}
+
+	return (UINT)m_Textures.size();
+}
+
+UINT ResourceManager::FindMesh(uint64_t hash, const char* path, bool invertTexCoords) const
+{
+	auto range = m_MeshLookup.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		const MeshEntry& entry = m_Meshes[it->second];
+		if (entry.m_InvertTexCoords == invertTexCoords && SamePath(entry.m_Path.c_str(), path))
+			return it->second;
+	}
+
+	return (UINT)m_Meshes.size();
+}
+
+void ResourceManager::EraseLookup(std::unordered_multimap<uint64_t, UINT>& lookup, uint64_t hash, UINT index)
+{
+	auto range = lookup.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		if (it->second == index)
+		{
+			lookup.erase(it);
+			return;
+		}
+	}
+}
+
+void ResourceManager::Release(TextureHandle handle)
+{
+	if (handle.Index >= m_Textures.size())
+		return;
+
+	TextureEntry& entry = m_Textures[handle.Index];
+	if (entry.m_Generation != handle.Generation || entry.m_RefCount == 0)
+		return;
+
+	if (--entry.m_RefCount > 0)
+		return;
+
+	if (entry.m_View)
+		entry.m_View->Release();
+
+	m_ResidentBytes[RESOURCE_TEXTURE] -= entry.m_Bytes;
+	EraseLookup(m_TextureLookup, entry.m_Hash, handle.Index);
+
+	entry.m_View = nullptr;
+	entry.m_Bytes = 0;
+	entry.m_Path.clear();
+	entry.m_Generation++;
+	m_FreeTextures.push_back(handle.Index);
+}
+
+void ResourceManager::Release(MeshHandle handle)
+{
+	if (handle.Index >= m_Meshes.size())
+		return;
+
+	MeshEntry& entry = m_Meshes[handle.Index];
+	if (entry.m_Generation != handle.Generation || entry.m_RefCount == 0)
+		return;
+
+	if (--entry.m_RefCount > 0)
+		return;
+
+	if (entry.m_Mesh.VertexBuffer) entry.m_Mesh.VertexBuffer->Release();
+	if (entry.m_Mesh.IndexBuffer) entry.m_Mesh.IndexBuffer->Release();
+
+	m_ResidentBytes[RESOURCE_MESH] -= entry.m_Bytes;
+	EraseLookup(m_MeshLookup, entry.m_Hash, handle.Index);
+
+	entry.m_Mesh = MeshData();
+	entry.m_Bytes = 0;
+	entry.m_Path.clear();
+	entry.m_Generation++;
+	m_FreeMeshes.push_back(handle.Index);
+}
+
+ID3D11ShaderResourceView* ResourceManager::GetTexture(TextureHandle handle) const
+{
+	if (handle.Index >= m_Textures.size())
+		return m_FallbackTexture;
+
+	const TextureEntry& entry = m_Textures[handle.Index];
+	if (entry.m_Generation != handle.Generation || entry.m_RefCount == 0 || !entry.m_View)
+		return m_FallbackTexture;
+
+	return entry.m_View;
+}
+
+MeshData ResourceManager::GetMesh(MeshHandle handle) const
+{
+	if (handle.Index >= m_Meshes.size())
+		return MeshData();
+
+	const MeshEntry& entry = m_Meshes[handle.Index];
+	if (entry.m_Generation != handle.Generation || entry.m_RefCount == 0)
+		return MeshData();
+
+	return entry.m_Mesh;
+}
+
+void ResourceManager::ReleaseAll()
+{
+	for (size_t i = 0; i < m_Textures.size(); i++)
+	{
+		TextureEntry& entry = m_Textures[i];
+		if (entry.m_RefCount == 0)
+			continue;
+
+		if (entry.m_View)
+			entry.m_View->Release();
+
+		entry.m_View = nullptr;
+		entry.m_RefCount = 0;
+		entry.m_Generation++;
+	}
+
+	for (size_t i = 0; i < m_Meshes.size(); i++)
+	{
+		MeshEntry& entry = m_Meshes[i];
+		if (entry.m_RefCount == 0)
+			continue;
+
+		if (entry.m_Mesh.VertexBuffer) entry.m_Mesh.VertexBuffer->Release();
+		if (entry.m_Mesh.IndexBuffer) entry.m_Mesh.IndexBuffer->Release();
+
+		entry.m_Mesh = MeshData();
+		entry.m_RefCount = 0;
+		entry.m_Generation++;
+	}
+
+	m_TextureLookup.clear();
+	m_MeshLookup.clear();
+
+	//Every slot is free again, generations carry on so old handles stay stale
+	m_FreeTextures.clear();
+	m_FreeMeshes.clear();
+	for (UINT i = 0; i < m_Textures.size(); i++)
+		m_FreeTextures.push_back(i);
+	for (UINT i = 0; i < m_Meshes.size(); i++)
+		m_FreeMeshes.push_back(i);
+
+	m_ResidentBytes[RESOURCE_TEXTURE] = m_FallbackTexture ? TextureBytes(m_FallbackTexture) : 0;
+	m_ResidentBytes[RESOURCE_MESH] = 0;
+}
+
+uint64_t ResourceManager::HashPath(const wchar_t* path)
+{
+	uint64_t hash = FNVOffsetBasis;
+	for (; *path; path++)
+		hash = HashCharacter(hash, (unsigned int)*path);
+
+	return hash;
+}
+
+uint64_t ResourceManager::HashPath(const char* path)
+{
+	uint64_t hash = FNVOffsetBasis;
+	for (; *path; path++)
+		hash = HashCharacter(hash, (unsigned char)*path);
+
+	return hash;
+}
+
+bool ResourceManager::SamePath(const wchar_t* a, const wchar_t* b)
+{
+	return SamePathCharacters(a, b);
+}
+
+bool ResourceManager::SamePath(const char* a, const char* b)
+{
+	return SamePathCharacters((const unsigned char*)a, (const unsigned char*)b);
+}
+
+size_t ResourceManager::TextureBytes(ID3D11ShaderResourceView* view)
+{
+	ID3D11Resource* resource = nullptr;
+	view->GetResource(&resource);
+	if (!resource)
+		return 0;
+
+	ID3D11Texture2D* texture = nullptr;
+	HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&texture);
+	resource->Release();
+
+	if (FAILED(hr) || !texture)
+		return 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+	texture->Release();
+
+	UINT blockSize, blockBytes;
+	if (!FormatBlock(desc.Format, blockSize, blockBytes))
+		return 0;
+
+	size_t bytes = 0;
+	UINT width = desc.Width;
+	UINT height = desc.Height;
+	for (UINT mip = 0; mip < desc.MipLevels; mip++)
+	{
+		bytes += (size_t)((width + blockSize - 1) / blockSize) * ((height + blockSize - 1) / blockSize) * blockBytes;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	return bytes * desc.ArraySize;
+}
+
+size_t ResourceManager::MeshBytes(const MeshData& mesh)
+{
+	size_t bytes = 0;
+	D3D11_BUFFER_DESC desc;
+
+	if (mesh.VertexBuffer)
+	{
+		mesh.VertexBuffer->GetDesc(&desc);
+		bytes += desc.ByteWidth;
+	}
+
+	if (mesh.IndexBuffer)
+	{
+		mesh.IndexBuffer->GetDesc(&desc);
+		bytes += desc.ByteWidth;
+	}
+
+	return bytes;
+}
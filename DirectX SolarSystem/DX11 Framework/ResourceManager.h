@@ -0,0 +1,135 @@
+#pragma once
+#ifndef RESOURCEMANAGER
+#define RESOURCEMANAGER
+
+#include "Structures.h"
+#include "OBJLoader.h"
+#include <windows.h>
+#include <d3d11_1.h>
+#include <directxmath.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace DirectX;
+
+//Handles are an index into the manager's table plus the generation of that slot,
+//so a handle to something that has since been freed never resolves to whatever reused the slot
+struct TextureHandle
+{
+	UINT Index;
+	UINT Generation;
+};
+
+struct MeshHandle
+{
+	UINT Index;
+	UINT Generation;
+};
+
+enum ResourceCategory
+{
+	RESOURCE_TEXTURE,
+	RESOURCE_MESH,
+	RESOURCE_CATEGORY_COUNT
+};
+
+class ResourceManager
+{
+private:
+	struct TextureEntry
+	{
+		ID3D11ShaderResourceView* m_View;
+		uint64_t m_Hash;
+		std::wstring m_Path;
+		UINT m_RefCount;
+		UINT m_Generation;
+		size_t m_Bytes;
+	};
+
+	struct MeshEntry
+	{
+		MeshData m_Mesh;
+		uint64_t m_Hash;
+		std::string m_Path;
+		bool m_InvertTexCoords;
+		UINT m_RefCount;
+		UINT m_Generation;
+		size_t m_Bytes;
+	};
+
+	ID3D11Device* m_Device;
+
+	//Slot tables, freed slots are reused so handles stay small
+	std::vector<TextureEntry> m_Textures;
+	std::vector<MeshEntry> m_Meshes;
+	std::vector<UINT> m_FreeTextures;
+	std::vector<UINT> m_FreeMeshes;
+
+	//Path hash to slot, so asking for the same file twice returns the same handle. Two paths can share a hash, so every slot under it is
+	//checked against the path itself
+	std::unordered_multimap<uint64_t, UINT> m_TextureLookup;
+	std::unordered_multimap<uint64_t, UINT> m_MeshLookup;
+
+	//Shared by every texture that failed to load, owned by the manager rather than any one handle
+	ID3D11ShaderResourceView* m_FallbackTexture;
+
+	size_t m_ResidentBytes[RESOURCE_CATEGORY_COUNT];
+
+	//Helper methods for the above method(s)
+	TextureHandle AddTexture(ID3D11ShaderResourceView* view, uint64_t hash, const std::wstring& path);
+	MeshHandle AddMesh(MeshData mesh, uint64_t hash, const std::string& path, bool invertTexCoords);
+
+	//Slot already holding a path, or the size of the table if none does
+	UINT FindTexture(uint64_t hash, const wchar_t* path) const;
+	UINT FindMesh(uint64_t hash, const char* path, bool invertTexCoords) const;
+
+	static void EraseLookup(std::unordered_multimap<uint64_t, UINT>& lookup, uint64_t hash, UINT index);
+
+public:
+	//Constructor
+	ResourceManager(ID3D11Device* device);
+
+	//Destructor, releases anything still loaded
+	~ResourceManager();
+
+	//Loads a DDS texture through MipGenerator, or adds a reference if it is already loaded.
+	//Files that cannot be loaded share the fallback texture
+	TextureHandle LoadTexture(const wchar_t* filename);
+
+	//Loads an OBJ model through OBJLoader, or adds a reference if it is already loaded. A group loads only that part of the model
+	MeshHandle LoadMesh(char* filename, bool invertTexCoords = true, const char* group = nullptr);
+
+	//Builds an icosphere through SphereGenerator, or adds a reference if that level is already loaded. This is the only cache of sphere meshes
+	MeshHandle LoadSphere(UINT level);
+
+	//Drop a reference, the resource is freed when the last one goes
+	void Release(TextureHandle handle);
+	void Release(MeshHandle handle);
+
+	//Resolve a handle. Stale or empty handles give the fallback texture or an empty mesh
+	ID3D11ShaderResourceView* GetTexture(TextureHandle handle) const;
+	MeshData GetMesh(MeshHandle handle) const;
+
+	//Exact GPU memory held for a category, including the fallback texture
+	size_t GetResidentBytes(ResourceCategory category) const { return m_ResidentBytes[category]; }
+
+	//Releases every resource regardless of reference counts
+	void ReleaseAll();
+
+	//Helper methods for the above methods
+	//FNV-1a over the lower case path with forward slashes, so "Earth.dds" and "earth.dds" are one entry
+	static uint64_t HashPath(const wchar_t* path);
+	static uint64_t HashPath(const char* path);
+
+	//Whether two paths are the same file by the rules HashPath follows
+	static bool SamePath(const wchar_t* a, const wchar_t* b);
+	static bool SamePath(const char* a, const char* b);
+
+	//Size of a texture's full mip chain and of a mesh's vertex and index buffers. A texture in a format with no known size counts as 0
+	static size_t TextureBytes(ID3D11ShaderResourceView* view);
+	static size_t MeshBytes(const MeshData& mesh);
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "RigidGroup.h"
+#include <math.h>
+
+RigidGroup::RigidGroup(float angularRate)
+{
+	m_AngularRate = angularRate;
+}
+
+void RigidGroup::Add(const XMFLOAT4X4& localMatrix)
+{
+	m_LocalMatrices.push_back(localMatrix);
+}
+
+XMMATRIX RigidGroup::GetGroupMatrix(FXMMATRIX rotation, const XMFLOAT4X4& referenceMatrix) const
+{
+	return rotation * XMLoadFloat4x4(&referenceMatrix);
+}
+
+const float RigidGroup::RateTolerance = 1e-4f;
+
+bool RigidGroup::SameRate(float a, float b)
+{
+	float largest = fabsf(a) > fabsf(b) ? fabsf(a) : fabsf(b);
+	return fabsf(a - b) <= largest * RateTolerance;
+}
+
+void RigidGroup::Collect(const BeltGenerator::BeltParticle* particles, size_t count, size_t maxGroups, std::vector<RigidGroup>& groups,
+	std::vector<BeltGenerator::BeltParticle>& loose)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		//Spinning at the rate it orbits keeps the same face to the centre, like part of a solid ring
+		const BeltGenerator::BeltParticle& particle = particles[i];
+		if (!SameRate(particle.Spin, particle.OrbitRate))
+		{
+			loose.push_back(particle);
+			continue;
+		}
+
+		//A particle joins the first group near enough its rate, which then turns every member at the rate of the one that started it
+		size_t group = 0;
+		while (group < groups.size() && !SameRate(groups[group].GetAngularRate(), particle.OrbitRate))
+			group++;
+
+		if (group == groups.size())
+		{
+			if (groups.size() >= maxGroups)
+			{
+				loose.push_back(particle);
+				continue;
+			}
+
+			groups.push_back(RigidGroup(particle.OrbitRate));
+		}
+
+		XMFLOAT4X4 local;
+		XMStoreFloat4x4(&local, XMMatrixScaling(particle.Scale.x, particle.Scale.y, particle.Scale.z) * XMMatrixTranslation(particle.Position.x, particle.Position.y, particle.Position.z));
+		groups[group].Add(local);
+	}
+}
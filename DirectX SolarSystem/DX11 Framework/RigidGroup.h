@@ -0,0 +1,49 @@
+#pragma once
+#ifndef RIGIDGROUP
+#define RIGIDGROUP
+
+#include <DirectXMath.h>
+#include <vector>
+#include "BeltGenerator.h"
+
+using namespace DirectX;
+
+//Particles that all turn about the same axis at the same rate, so the whole group moves as one body.
+//Each particle's place in the group is baked once, and a frame only needs the one group matrix
+class RigidGroup
+{
+private:
+	float m_AngularRate;
+
+	//Scaling and offset of each particle within the group, fixed once the group is built
+	std::vector<XMFLOAT4X4> m_LocalMatrices;
+
+public:
+	//Constructor
+	RigidGroup(float angularRate);
+
+	float GetAngularRate() const { return m_AngularRate; }
+
+	void Add(const XMFLOAT4X4& localMatrix);
+
+	size_t GetCount() const { return m_LocalMatrices.size(); }
+	const XMFLOAT4X4& GetLocalMatrix(size_t index) const { return m_LocalMatrices[index]; }
+
+	//Where the whole group is once turned about its centre by a rotation at GetAngularRate, then carried by the reference matrix.
+	//A particle's world matrix is its local matrix times this
+	XMMATRIX GetGroupMatrix(FXMMATRIX rotation, const XMFLOAT4X4& referenceMatrix) const;
+
+	//Relative difference between two rates small enough for them to count as the same, against rounding in working a rate out from a period
+	static const float RateTolerance;
+
+	//Sorts particles into groups by angular rate, adding to any group within RateTolerance of theirs.
+	//Only particles that spin at the rate they orbit can be grouped. Those that do not, and any that would need more than maxGroups groups,
+	//are added to loose instead to be moved one at a time
+	static void Collect(const BeltGenerator::BeltParticle* particles, size_t count, size_t maxGroups, std::vector<RigidGroup>& groups,
+		std::vector<BeltGenerator::BeltParticle>& loose);
+
+	//Whether two rates are within RateTolerance of each other
+	static bool SameRate(float a, float b);
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include "RingAllocator.h"
+
+RingAllocator::RingAllocator(size_t capacity)
+{
+	Reset(capacity);
+}
+
+void RingAllocator::Reset(size_t capacity)
+{
+	m_Capacity = capacity;
+	Discard();
+}
+
+bool RingAllocator::Allocate(size_t size, size_t alignment, size_t& offset)
+{
+	if (size == 0 || size > m_Capacity)
+		return false;
+
+	//Nothing in use, so start again from the beginning for the longest run. Closed frames that took nothing still hold where the head was,
+	//and retiring one moves the tail there, so the ring is only rewound once they have gone as well
+	if (m_Used == 0 && m_Frames.empty())
+	{
+		m_Head = 0;
+		m_Tail = 0;
+	}
+
+	size_t start = (m_Head + alignment - 1) & ~(alignment - 1);
+	size_t taken;
+
+	if (m_Used == 0 || m_Head > m_Tail)
+	{
+		//Free from the head to the end and from the start to the tail, the end being skipped if the range does not fit before it
+		if (start + size <= m_Capacity)
+		{
+			taken = start - m_Head + size;
+		}
+		else if (size <= m_Tail)
+		{
+			start = 0;
+			taken = m_Capacity - m_Head + size;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else
+	{
+		//The head has wrapped behind the tail, or met it with the ring full
+		if (m_Head == m_Tail || start + size > m_Tail)
+			return false;
+
+		taken = start - m_Head + size;
+	}
+
+	offset = start;
+	m_Head = start + size;
+	m_Used += taken;
+	m_FrameBytes += taken;
+
+	return true;
+}
+
+void RingAllocator::EndFrame(uint64_t id)
+{
+	Frame frame = { id, m_Head, m_FrameBytes };
+	m_Frames.push_back(frame);
+	m_FrameBytes = 0;
+}
+
+void RingAllocator::Retire(uint64_t id)
+{
+	while (!m_Frames.empty() && m_Frames.front().Id <= id)
+	{
+		m_Tail = m_Frames.front().End;
+		m_Used -= m_Frames.front().Bytes;
+		m_Frames.pop_front();
+	}
+}
+
+void RingAllocator::Discard()
+{
+	m_Head = 0;
+	m_Tail = 0;
+	m_Used = 0;
+	m_FrameBytes = 0;
+	m_Frames.clear();
+}
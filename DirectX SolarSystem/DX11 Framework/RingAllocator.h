@@ -0,0 +1,59 @@
+#pragma once
+#ifndef RINGALLOCATOR
+#define RINGALLOCATOR
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+
+//Hands out ranges of a fixed size buffer in order, wrapping round to the start, for data written once by the CPU and read once by the GPU.
+//Ranges are handed out for an open frame, EndFrame closes it under an id, and Retire frees every closed frame up to an id once the GPU is done with them.
+//Only offsets are tracked, the memory itself belongs to whoever owns the buffer
+class RingAllocator
+{
+private:
+	struct Frame
+	{
+		uint64_t Id;
+
+		//Where the frame's last range ended, and everything it took including what was skipped to align or wrap
+		size_t End;
+		size_t Bytes;
+	};
+
+	size_t m_Capacity;
+
+	//Next byte to hand out and the oldest byte still in use, with m_Used telling a full ring from an empty one when they meet
+	size_t m_Head;
+	size_t m_Tail;
+	size_t m_Used;
+
+	//Taken by the open frame so far, and the closed frames still waiting to retire, oldest first
+	size_t m_FrameBytes;
+	std::deque<Frame> m_Frames;
+
+public:
+	//Constructor
+	RingAllocator(size_t capacity = 0);
+
+	//Empties the ring and gives it a new size
+	void Reset(size_t capacity);
+
+	//Finds size bytes starting on a multiple of alignment, a power of two. False if there is no room until an earlier frame retires
+	bool Allocate(size_t size, size_t alignment, size_t& offset);
+
+	//Closes the open frame under id, which must be higher than any before it
+	void EndFrame(uint64_t id);
+
+	//Frees every closed frame up to and including id
+	void Retire(uint64_t id);
+
+	//Frees everything, the open frame's ranges too, for when the buffer has been swapped for fresh memory and nothing old can be overwritten
+	void Discard();
+
+	size_t GetCapacity() const { return m_Capacity; }
+	size_t GetUsed() const { return m_Used; }
+	size_t GetPendingFrames() const { return m_Frames.size(); }
+};
+
+#endif
@@ -0,0 +1,53 @@
+#include "SimulationClock.h"
+
+SimulationClock::SimulationClock(const Clock* source, double stepLength, unsigned int maxStepsPerTick)
+{
+	m_Source = source;
+	m_StepLength = stepLength;
+	m_MaxStepsPerTick = maxStepsPerTick;
+
+	Reset();
+}
+
+void SimulationClock::Reset()
+{
+	m_LastNow = m_Source->Now();
+	m_Accumulator = 0.0;
+	m_Time = 0.0;
+	m_StepCount = 0;
+	m_DueSteps = 0;
+}
+
+unsigned int SimulationClock::Tick()
+{
+	double now = m_Source->Now();
+	m_Accumulator += now - m_LastNow;
+	m_LastNow = now;
+
+	unsigned int due = (unsigned int)(m_Accumulator / m_StepLength);
+
+	//Drop whole steps we can never catch up on rather than falling further behind every tick
+	if (due > m_MaxStepsPerTick)
+	{
+		m_Accumulator -= (due - m_MaxStepsPerTick) * m_StepLength;
+		due = m_MaxStepsPerTick;
+	}
+
+	m_DueSteps = due;
+	return due;
+}
+
+bool SimulationClock::Step()
+{
+	if (m_DueSteps == 0)
+		return false;
+
+	m_DueSteps--;
+	m_Accumulator -= m_StepLength;
+
+	//Multiply rather than add so rounding does not build up over a long run
+	m_StepCount++;
+	m_Time = (double)m_StepCount * m_StepLength;
+
+	return true;
+}
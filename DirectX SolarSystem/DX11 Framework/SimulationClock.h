@@ -0,0 +1,50 @@
+#pragma once
+#ifndef SIMULATIONCLOCK
+#define SIMULATIONCLOCK
+
+#include "Clock.h"
+
+//Turns real time from a Clock into whole fixed length simulation steps.
+//Call Tick once per loop, then Step until it returns false. Whatever is left over is GetAlpha of a step
+class SimulationClock
+{
+private:
+	const Clock* m_Source;
+
+	double m_StepLength;
+	unsigned int m_MaxStepsPerTick;
+
+	double m_LastNow;
+	double m_Accumulator;
+	double m_Time;
+	unsigned long long m_StepCount;
+	unsigned int m_DueSteps;
+
+public:
+	//Constructor, maxStepsPerTick stops a slow frame from queueing more work than can ever be caught up
+	SimulationClock(const Clock* source, double stepLength, unsigned int maxStepsPerTick = 8);
+
+	//Starts counting from the source's current time with the simulation at zero
+	void Reset();
+
+	//Adds the real time since the last tick and returns how many steps are now due
+	unsigned int Tick();
+
+	//Uses up one due step and moves simulation time on by a step. Returns false when none are due
+	bool Step();
+
+	//Simulation time after the last step taken
+	double GetTime() const { return m_Time; }
+
+	double GetStepLength() const { return m_StepLength; }
+
+	//How far real time is into the next step, from 0 to 1
+	float GetAlpha() const { return (float)(m_Accumulator / m_StepLength); }
+
+	//Real seconds until another step will be due
+	double TimeUntilNextStep() const { return m_StepLength - m_Accumulator; }
+
+	const Clock* GetSource() const { return m_Source; }
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include "SpatialHashGrid.h"
+#include "CounterRandom.h"
+#include "ParallelFor.h"
+#include <math.h>
+
+//Bits per axis of a packed cell, cells further out than this from the origin share the outermost one
+static const int CellBits = 21;
+static const int CellLimit = 1 << (CellBits - 1);
+
+SpatialHashGrid::SpatialHashGrid(float cellSize)
+{
+	m_BucketMask = 0;
+	SetCellSize(cellSize);
+}
+
+void SpatialHashGrid::SetCellSize(float cellSize)
+{
+	m_CellSize = cellSize;
+	m_InverseCellSize = 1.0f / cellSize;
+}
+
+void SpatialHashGrid::Build(const XMFLOAT3* positions, size_t count)
+{
+	//Around one particle per bucket keeps each run short without the table outgrowing the particles
+	UINT buckets = 256;
+	while (buckets < count)
+		buckets <<= 1;
+
+	m_BucketMask = buckets - 1;
+	m_BucketStart.assign(buckets + 1, 0);
+
+	m_Buckets.resize(count);
+	m_Cells.resize(count);
+	m_Sorted.resize(count);
+
+	if (count == 0)
+		return;
+
+	//Each range of particles counts into its own histogram so no counter is shared between threads
+	size_t ranges = GetParallelThreadCount();
+	if (ranges > count / MinimumPerThread)
+		ranges = count / MinimumPerThread > 0 ? count / MinimumPerThread : 1;
+
+	size_t chunk = (count + ranges - 1) / ranges;
+	m_RangeCounts.assign(ranges * buckets, 0);
+
+	ParallelFor(ranges, 1, [&](size_t firstRange, size_t lastRange)
+	{
+		for (size_t range = firstRange; range < lastRange; range++)
+		{
+			UINT* counts = &m_RangeCounts[range * buckets];
+			size_t end = (range + 1) * chunk < count ? (range + 1) * chunk : count;
+
+			for (size_t i = range * chunk; i < end; i++)
+			{
+				int x, y, z;
+				GetCell(positions[i], x, y, z);
+
+				m_Cells[i] = PackCell(x, y, z);
+				m_Buckets[i] = GetBucket(m_Cells[i]);
+				counts[m_Buckets[i]]++;
+			}
+		}
+	});
+
+	//Within a bucket the ranges go in order, so each range's counts become where it starts writing and the total is the bucket's size
+	ParallelFor(buckets, MinimumPerThread, [&](size_t begin, size_t end)
+	{
+		for (size_t bucket = begin; bucket < end; bucket++)
+		{
+			UINT running = 0;
+			for (size_t range = 0; range < ranges; range++)
+			{
+				UINT& counter = m_RangeCounts[range * buckets + bucket];
+				UINT rangeCount = counter;
+				counter = running;
+				running += rangeCount;
+			}
+
+			m_BucketStart[bucket + 1] = running;
+		}
+	});
+
+	for (UINT bucket = 0; bucket < buckets; bucket++)
+		m_BucketStart[bucket + 1] += m_BucketStart[bucket];
+
+	//Scatter, each particle landing after every earlier one in its bucket, which makes the sort stable and the same for any number of ranges
+	ParallelFor(ranges, 1, [&](size_t firstRange, size_t lastRange)
+	{
+		for (size_t range = firstRange; range < lastRange; range++)
+		{
+			UINT* offsets = &m_RangeCounts[range * buckets];
+			size_t end = (range + 1) * chunk < count ? (range + 1) * chunk : count;
+
+			for (size_t i = range * chunk; i < end; i++)
+			{
+				UINT bucket = m_Buckets[i];
+				UINT sorted = m_BucketStart[bucket] + offsets[bucket]++;
+
+				m_Sorted[sorted].Cell = m_Cells[i];
+				m_Sorted[sorted].Position = positions[i];
+				m_Sorted[sorted].Index = (UINT)i;
+			}
+		}
+	});
+}
+
+size_t SpatialHashGrid::QueryRadius(const XMFLOAT3& centre, float radius, std::vector<UINT>& indices) const
+{
+	indices.clear();
+
+	if (m_Sorted.empty())
+		return 0;
+
+	const float radiusSq = radius * radius;
+
+	int minX, minY, minZ, maxX, maxY, maxZ;
+	GetCell(XMFLOAT3(centre.x - radius, centre.y - radius, centre.z - radius), minX, minY, minZ);
+	GetCell(XMFLOAT3(centre.x + radius, centre.y + radius, centre.z + radius), maxX, maxY, maxZ);
+
+	//A sphere covering more cells than there are particles is quicker to answer by testing every particle
+	double cells = (double)(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+	if (cells > (double)m_Sorted.size())
+	{
+		for (size_t sorted = 0; sorted < m_Sorted.size(); sorted++)
+		{
+			const XMFLOAT3& position = m_Sorted[sorted].Position;
+			float dx = position.x - centre.x;
+			float dy = position.y - centre.y;
+			float dz = position.z - centre.z;
+
+			if (dx * dx + dy * dy + dz * dz <= radiusSq)
+				indices.push_back(m_Sorted[sorted].Index);
+		}
+
+		return indices.size();
+	}
+
+	for (int z = minZ; z <= maxZ; z++)
+	{
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				uint64_t cell = PackCell(x, y, z);
+				UINT bucket = GetBucket(cell);
+
+				for (UINT sorted = m_BucketStart[bucket]; sorted < m_BucketStart[bucket + 1]; sorted++)
+				{
+					if (m_Sorted[sorted].Cell != cell)
+						continue;
+
+					const XMFLOAT3& position = m_Sorted[sorted].Position;
+					float dx = position.x - centre.x;
+					float dy = position.y - centre.y;
+					float dz = position.z - centre.z;
+
+					if (dx * dx + dy * dy + dz * dz <= radiusSq)
+						indices.push_back(m_Sorted[sorted].Index);
+				}
+			}
+		}
+	}
+
+	return indices.size();
+}
+
+void SpatialHashGrid::FindCloseApproaches(float distance, std::vector<ParticlePair>& pairs) const
+{
+	pairs.clear();
+
+	size_t count = m_Sorted.size();
+	if (count == 0)
+		return;
+
+	const float distanceSq = distance * distance;
+	const int reach = (int)ceilf(distance * m_InverseCellSize);
+
+	//Fixed blocks of sorted particles each collect their own pairs, joined in block order so the threads never change the result
+	size_t blockCount = (count + MinimumPerThread - 1) / MinimumPerThread;
+	std::vector<std::vector<ParticlePair>> blocks(blockCount);
+
+	ParallelFor(blockCount, 1, [&](size_t firstBlock, size_t lastBlock)
+	{
+		for (size_t block = firstBlock; block < lastBlock; block++)
+		{
+			std::vector<ParticlePair>& found = blocks[block];
+			size_t end = (block + 1) * MinimumPerThread < count ? (block + 1) * MinimumPerThread : count;
+
+			for (size_t sorted = block * MinimumPerThread; sorted < end; sorted++)
+			{
+				const SortedParticle& particle = m_Sorted[sorted];
+
+				int cellX, cellY, cellZ;
+				GetCell(particle.Position, cellX, cellY, cellZ);
+
+				//Only the cells ahead of this one, plus the later particles in its own cell, so each pair is found from one side
+				for (int dz = 0; dz <= reach; dz++)
+				{
+					for (int dy = dz == 0 ? 0 : -reach; dy <= reach; dy++)
+					{
+						for (int dx = dz == 0 && dy == 0 ? 0 : -reach; dx <= reach; dx++)
+						{
+							uint64_t cell = PackCell(cellX + dx, cellY + dy, cellZ + dz);
+							UINT bucket = GetBucket(cell);
+
+							UINT other = m_BucketStart[bucket];
+							if (dx == 0 && dy == 0 && dz == 0)
+								other = (UINT)sorted + 1;
+
+							for (; other < m_BucketStart[bucket + 1]; other++)
+							{
+								const SortedParticle& candidate = m_Sorted[other];
+								if (candidate.Cell != cell)
+									continue;
+
+								float ox = candidate.Position.x - particle.Position.x;
+								float oy = candidate.Position.y - particle.Position.y;
+								float oz = candidate.Position.z - particle.Position.z;
+								float lengthSq = ox * ox + oy * oy + oz * oz;
+
+								if (lengthSq <= distanceSq)
+								{
+									ParticlePair pair;
+									pair.First = particle.Index < candidate.Index ? particle.Index : candidate.Index;
+									pair.Second = particle.Index < candidate.Index ? candidate.Index : particle.Index;
+									pair.DistanceSq = lengthSq;
+									found.push_back(pair);
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	});
+
+	for (size_t block = 0; block < blockCount; block++)
+		pairs.insert(pairs.end(), blocks[block].begin(), blocks[block].end());
+}
+
+void SpatialHashGrid::GetCell(const XMFLOAT3& position, int& x, int& y, int& z) const
+{
+	//Clamped in floating point first, anything beyond the packable range would overflow the conversion
+	const float limit = (float)CellLimit;
+
+	x = (int)fmaxf(-limit, fminf(limit - 1.0f, floorf(position.x * m_InverseCellSize)));
+	y = (int)fmaxf(-limit, fminf(limit - 1.0f, floorf(position.y * m_InverseCellSize)));
+	z = (int)fmaxf(-limit, fminf(limit - 1.0f, floorf(position.z * m_InverseCellSize)));
+}
+
+UINT SpatialHashGrid::GetBucket(uint64_t cell) const
+{
+	return (UINT)CounterRandom::Mix(cell) & m_BucketMask;
+}
+
+uint64_t SpatialHashGrid::PackCell(int x, int y, int z)
+{
+	const uint64_t mask = (1ull << CellBits) - 1;
+
+	return (((uint64_t)(x + CellLimit) & mask) << (2 * CellBits)) | (((uint64_t)(y + CellLimit) & mask) << CellBits) | ((uint64_t)(z + CellLimit) & mask);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#ifndef SPATIALHASHGRID
+#define SPATIALHASHGRID
+
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+#include <stdint.h>
+
+using namespace DirectX;
+
+//Uniform grid over a set of particles for finding which of them are near a point or near each other.
+//Space is cut into cubes of one size and each cube is hashed into a table sized to the particle count, so there are no bounds to fit
+//and the build is a counting sort into the table's buckets. Cubes sharing a bucket are told apart by their cell, which every particle keeps
+class SpatialHashGrid
+{
+public:
+	//Two particles found closer than the distance asked for, First being the lower original index
+	struct ParticlePair
+	{
+		UINT First;
+		UINT Second;
+		float DistanceSq;
+	};
+
+private:
+	struct SortedParticle
+	{
+		uint64_t Cell;
+		XMFLOAT3 Position;
+		UINT Index;
+	};
+
+	float m_CellSize;
+	float m_InverseCellSize;
+
+	//Buckets in the table less one, the table always being a power of two
+	UINT m_BucketMask;
+
+	//Run of sorted particles in each bucket, m_BucketStart[b] up to m_BucketStart[b + 1]
+	std::vector<UINT> m_BucketStart;
+
+	//Bucket and packed cell of each particle in original order, as the sort reads them
+	std::vector<UINT> m_Buckets;
+	std::vector<uint64_t> m_Cells;
+
+	//Particles in bucket order, with the cell and position of each alongside so a query touches one entry per candidate
+	//and never goes back to the original arrays
+	std::vector<SortedParticle> m_Sorted;
+
+	//One count per bucket for each range of particles the sort is split into, turned into each range's write offsets
+	std::vector<UINT> m_RangeCounts;
+
+	//Helper methods for the above method(s)
+	void GetCell(const XMFLOAT3& position, int& x, int& y, int& z) const;
+	UINT GetBucket(uint64_t cell) const;
+	static uint64_t PackCell(int x, int y, int z);
+
+public:
+	//Particles each thread is given at least of the sort, and of the sorted particles when looking for close approaches
+	static const size_t MinimumPerThread = 4096;
+
+	//Constructor
+	SpatialHashGrid(float cellSize = 1.0f);
+
+	//Edge length of each cell. Queries are quickest with it around the distance they look over. Takes effect at the next Build
+	void SetCellSize(float cellSize);
+	float GetCellSize() const { return m_CellSize; }
+
+	//Sorts the given positions into the grid, replacing whatever was there. Any order of threads gives the same grid
+	void Build(const XMFLOAT3* positions, size_t count);
+
+	size_t GetCount() const { return m_Sorted.size(); }
+
+	//Original indices of every particle within radius of a point, in sorted order. Returns how many were found
+	size_t QueryRadius(const XMFLOAT3& centre, float radius, std::vector<UINT>& indices) const;
+
+	//Every pair of particles within distance of each other, each pair once. The order depends only on the positions, never on the thread count
+	void FindCloseApproaches(float distance, std::vector<ParticlePair>& pairs) const;
+};
+
+#endif
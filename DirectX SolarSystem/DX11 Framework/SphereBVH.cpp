@@ -0,0 +1,208 @@
+#include "SphereBVH.h"
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+//Deepest a tree can be, median splits halve every level so this covers far more spheres than fit in memory
+static const UINT MaxDepth = 64;
+
+void SphereBVH::Build(const XMFLOAT4* spheres, size_t count)
+{
+	m_Entries.resize(count);
+	m_Nodes.clear();
+
+	if (count == 0)
+		return;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		m_Entries[i].Sphere = spheres[i];
+		m_Entries[i].Index = (UINT)i;
+	}
+
+	//A median split into leaves of LeafSize always needs fewer than twice as many nodes as leaves
+	m_Nodes.reserve(2 * (count / LeafSize + 1));
+	m_Nodes.resize(1);
+	BuildNode(0, 0, (UINT)count);
+}
+
+void SphereBVH::BuildNode(UINT nodeIndex, UINT begin, UINT end)
+{
+	//Box round every sphere in the run, and round their centres to pick the split axis
+	XMFLOAT3 minimum = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 maximum = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	XMFLOAT3 centreMinimum = minimum;
+	XMFLOAT3 centreMaximum = maximum;
+
+	for (UINT i = begin; i < end; i++)
+	{
+		const XMFLOAT4& sphere = m_Entries[i].Sphere;
+
+		minimum.x = fminf(minimum.x, sphere.x - sphere.w);
+		minimum.y = fminf(minimum.y, sphere.y - sphere.w);
+		minimum.z = fminf(minimum.z, sphere.z - sphere.w);
+		maximum.x = fmaxf(maximum.x, sphere.x + sphere.w);
+		maximum.y = fmaxf(maximum.y, sphere.y + sphere.w);
+		maximum.z = fmaxf(maximum.z, sphere.z + sphere.w);
+
+		centreMinimum.x = fminf(centreMinimum.x, sphere.x);
+		centreMinimum.y = fminf(centreMinimum.y, sphere.y);
+		centreMinimum.z = fminf(centreMinimum.z, sphere.z);
+		centreMaximum.x = fmaxf(centreMaximum.x, sphere.x);
+		centreMaximum.y = fmaxf(centreMaximum.y, sphere.y);
+		centreMaximum.z = fmaxf(centreMaximum.z, sphere.z);
+	}
+
+	m_Nodes[nodeIndex].Min = minimum;
+	m_Nodes[nodeIndex].Max = maximum;
+
+	if (end - begin <= LeafSize)
+	{
+		m_Nodes[nodeIndex].First = begin;
+		m_Nodes[nodeIndex].Count = end - begin;
+		return;
+	}
+
+	//Half the spheres either side of the median centre along the widest axis
+	float extentX = centreMaximum.x - centreMinimum.x;
+	float extentY = centreMaximum.y - centreMinimum.y;
+	float extentZ = centreMaximum.z - centreMinimum.z;
+	int axis = extentX >= extentY && extentX >= extentZ ? 0 : (extentY >= extentZ ? 1 : 2);
+
+	UINT middle = begin + (end - begin) / 2;
+
+	std::nth_element(m_Entries.begin() + begin, m_Entries.begin() + middle, m_Entries.begin() + end, [axis](const Entry& a, const Entry& b)
+	{
+		const float* centreA = &a.Sphere.x;
+		const float* centreB = &b.Sphere.x;
+
+		//Ties go by index so the tree is the same every time for the same spheres
+		return centreA[axis] < centreB[axis] || (centreA[axis] == centreB[axis] && a.Index < b.Index);
+	});
+
+	UINT firstChild = (UINT)m_Nodes.size();
+	m_Nodes.resize(m_Nodes.size() + 2);
+	m_Nodes[nodeIndex].First = firstChild;
+	m_Nodes[nodeIndex].Count = 0;
+
+	BuildNode(firstChild, begin, middle);
+	BuildNode(firstChild + 1, middle, end);
+}
+
+bool SphereBVH::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit) const
+{
+	return Raycast(origin, direction, maxDistance, nullptr, nullptr, hit);
+}
+
+bool SphereBVH::Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, SphereFunction exact, const void* context, RayHit& hit) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	//Zero components give infinities, which the slab test handles the right way round
+	const XMFLOAT3 inverseDirection = XMFLOAT3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	float nearest = maxDistance;
+	bool found = false;
+
+	float entry;
+	if (!IntersectBox(m_Nodes[0], origin, inverseDirection, nearest, entry))
+		return false;
+
+	//Nearer child is always taken first, so one sibling per level is left waiting
+	UINT stack[MaxDepth + 1];
+	float stackEntry[MaxDepth + 1];
+	int top = 0;
+	stack[top] = 0;
+	stackEntry[top++] = entry;
+
+	while (top > 0)
+	{
+		top--;
+
+		//Anything nearer was found since this node was put aside
+		if (stackEntry[top] > nearest)
+			continue;
+
+		const Node& node = m_Nodes[stack[top]];
+
+		if (node.Count > 0)
+		{
+			for (UINT i = node.First; i < node.First + node.Count; i++)
+			{
+				const XMFLOAT4 sphere = exact ? exact(context, m_Entries[i].Index) : m_Entries[i].Sphere;
+
+				float ox = origin.x - sphere.x;
+				float oy = origin.y - sphere.y;
+				float oz = origin.z - sphere.z;
+
+				float b = ox * direction.x + oy * direction.y + oz * direction.z;
+				float c = ox * ox + oy * oy + oz * oz - sphere.w * sphere.w;
+
+				//Behind the origin and not around it
+				if (c > 0.0f && b > 0.0f)
+					continue;
+
+				//From the line's closest approach rather than b * b - c, which loses a small sphere's radius to rounding when it is far away
+				float px = ox - b * direction.x;
+				float py = oy - b * direction.y;
+				float pz = oz - b * direction.z;
+
+				float discriminant = sphere.w * sphere.w - (px * px + py * py + pz * pz);
+				if (discriminant < 0.0f)
+					continue;
+
+				float distance = -b - sqrtf(discriminant);
+				if (distance < 0.0f)
+					distance = 0.0f;
+
+				if (distance < nearest)
+				{
+					nearest = distance;
+					hit.Index = m_Entries[i].Index;
+					hit.Distance = distance;
+					found = true;
+				}
+			}
+
+			continue;
+		}
+
+		float entryA, entryB;
+		bool hitA = IntersectBox(m_Nodes[node.First], origin, inverseDirection, nearest, entryA);
+		bool hitB = IntersectBox(m_Nodes[node.First + 1], origin, inverseDirection, nearest, entryB);
+
+		//Pushed far then near, so the near one comes off next
+		if (hitA && hitB)
+		{
+			bool aFirst = entryA <= entryB;
+			stack[top] = aFirst ? node.First + 1 : node.First;
+			stackEntry[top++] = aFirst ? entryB : entryA;
+			stack[top] = aFirst ? node.First : node.First + 1;
+			stackEntry[top++] = aFirst ? entryA : entryB;
+		}
+		else if (hitA || hitB)
+		{
+			stack[top] = hitA ? node.First : node.First + 1;
+			stackEntry[top++] = hitA ? entryA : entryB;
+		}
+	}
+
+	return found;
+}
+
+bool SphereBVH::IntersectBox(const Node& node, const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance, float& entry)
+{
+	float x0 = (node.Min.x - origin.x) * inverseDirection.x;
+	float x1 = (node.Max.x - origin.x) * inverseDirection.x;
+	float y0 = (node.Min.y - origin.y) * inverseDirection.y;
+	float y1 = (node.Max.y - origin.y) * inverseDirection.y;
+	float z0 = (node.Min.z - origin.z) * inverseDirection.z;
+	float z1 = (node.Max.z - origin.z) * inverseDirection.z;
+
+	float enterDistance = fmaxf(fmaxf(fminf(x0, x1), fminf(y0, y1)), fmaxf(fminf(z0, z1), 0.0f));
+	float leaveDistance = fminf(fminf(fmaxf(x0, x1), fmaxf(y0, y1)), fminf(fmaxf(z0, z1), maxDistance));
+
+	entry = enterDistance;
+	return enterDistance <= leaveDistance;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef SPHEREBVH
+#define SPHEREBVH
+
+#include <windows.h>
+#include <DirectXMath.h>
+#include <vector>
+
+using namespace DirectX;
+
+//Bounding volume hierarchy over a set of spheres for finding the nearest one a ray hits.
+//Each node is a box round a contiguous run of the spheres, which are reordered so every leaf's spheres sit next to each other
+class SphereBVH
+{
+public:
+	struct Node
+	{
+		XMFLOAT3 Min;
+
+		//First of the two children, which are stored next to each other, or the first sphere of a leaf
+		UINT First;
+
+		XMFLOAT3 Max;
+
+		//Spheres in a leaf, zero for a node with children
+		UINT Count;
+	};
+
+	//Nearest sphere a ray hit, by its index in the array the tree was built from, and how far along the ray it was
+	struct RayHit
+	{
+		UINT Index;
+		float Distance;
+	};
+
+	//Sphere a ray is tested against exactly once it reaches an entry's leaf, by the entry's index in the array the tree was built from
+	typedef XMFLOAT4 (*SphereFunction)(const void* context, UINT index);
+
+	static const UINT LeafSize = 4;
+
+private:
+	//A sphere as centre and radius, and where it was in the array the tree was built from
+	struct Entry
+	{
+		XMFLOAT4 Sphere;
+		UINT Index;
+	};
+
+	std::vector<Node> m_Nodes;
+
+	//Spheres in tree order. The build partitions these directly so it never chases indices back into the original array
+	std::vector<Entry> m_Entries;
+
+	//Helper methods for the above method(s)
+	void BuildNode(UINT nodeIndex, UINT begin, UINT end);
+	static bool IntersectBox(const Node& node, const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance, float& entry);
+
+public:
+	//Rebuilds the tree over the given spheres, xyz being each one's centre and w its radius
+	void Build(const XMFLOAT4* spheres, size_t count);
+
+	//Nearest sphere along the ray from origin within maxDistance, direction needing to be unit length.
+	//A ray starting inside a sphere hits it at distance zero. Returns false if nothing was hit
+	bool Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, RayHit& hit) const;
+
+	//As above, but the spheres the tree was built from only have to enclose the ones exact gives, which are what the ray is tested against.
+	//A tree built round everywhere something can be over a stretch of time then serves every moment in it
+	bool Raycast(const XMFLOAT3& origin, const XMFLOAT3& direction, float maxDistance, SphereFunction exact, const void* context, RayHit& hit) const;
+
+	size_t GetCount() const { return m_Entries.size(); }
+	const std::vector<Node>& GetNodes() const { return m_Nodes; }
+};
+
+#endif
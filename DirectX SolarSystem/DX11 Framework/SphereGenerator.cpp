@@ -0,0 +1,244 @@
+#include "SphereGenerator.h"
+#include <map>
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	//Icosahedron with a vertex on each pole, same orientation as the 3ds Max geosphere that sphere.obj came from
+	//Ring vertices are at y = +-1/sqrt(5) with a radius of 2/sqrt(5), the lower ring offset by 36 degrees
+	const float RingY = 0.4472136f;
+	const float RingRadius = 0.8944272f;
+
+	//Equirectangular mapping matching sphere.obj after OBJLoader inverts v
+	XMFLOAT2 SphereUV(const XMFLOAT3& p)
+	{
+		float u = 0.5f - atan2f(p.z, p.x) / XM_2PI;
+		float v = 0.5f - asinf((std::max)(-1.0f, (std::min)(1.0f, p.y))) / XM_PI;
+
+		return XMFLOAT2(u, v);
+	}
+
+	unsigned short Midpoint(unsigned short a, unsigned short b, std::vector<XMFLOAT3>& positions, std::map<unsigned int, unsigned short>& edgeMap)
+	{
+		unsigned int key = a < b ? (a << 16) | b : (b << 16) | a;
+
+		auto it = edgeMap.find(key);
+		if (it != edgeMap.end())
+		{
+			return it->second;
+		}
+
+		XMFLOAT3 mid;
+		XMStoreFloat3(&mid, XMVector3Normalize(XMVectorAdd(XMLoadFloat3(&positions[a]), XMLoadFloat3(&positions[b]))));
+		positions.push_back(mid);
+
+		unsigned short index = (unsigned short)(positions.size() - 1);
+		edgeMap[key] = index;
+
+		return index;
+	}
+}
+
+void SphereGenerator::Generate(UINT level, std::vector<SimpleVertex>& outVertices, std::vector<unsigned short>& outIndices)
+{
+	if (level > MaxLevel)
+		level = MaxLevel;
+
+	//Base icosahedron
+	std::vector<XMFLOAT3> positions;
+	positions.reserve(SharedVertexCount(level));
+	positions.push_back(XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+	for (int i = 0; i < 5; i++)
+	{
+		float angle = i * XM_2PI / 5.0f;
+		positions.push_back(XMFLOAT3(RingRadius * cosf(angle), RingY, -RingRadius * sinf(angle)));
+	}
+	for (int i = 0; i < 5; i++)
+	{
+		float angle = (i + 0.5f) * XM_2PI / 5.0f;
+		positions.push_back(XMFLOAT3(RingRadius * cosf(angle), -RingY, -RingRadius * sinf(angle)));
+	}
+	positions.push_back(XMFLOAT3(0.0f, -1.0f, 0.0f));
+
+	std::vector<unsigned short> faces;
+	faces.reserve(IndexCount(level));
+	for (unsigned short i = 0; i < 5; i++)
+	{
+		unsigned short upper = 1 + i;
+		unsigned short upperNext = 1 + (i + 1) % 5;
+		unsigned short lower = 6 + i;
+		unsigned short lowerNext = 6 + (i + 1) % 5;
+
+		unsigned short tris[] =
+		{
+			0, upper, upperNext,
+			upper, lower, upperNext,
+			upperNext, lower, lowerNext,
+			lower, 11, lowerNext
+		};
+		faces.insert(faces.end(), tris, tris + 12);
+	}
+
+	//Wind every face so the cross product of its edges points outwards, as sphere.obj does
+	for (size_t f = 0; f < faces.size(); f += 3)
+	{
+		XMVECTOR a = XMLoadFloat3(&positions[faces[f]]);
+		XMVECTOR b = XMLoadFloat3(&positions[faces[f + 1]]);
+		XMVECTOR c = XMLoadFloat3(&positions[faces[f + 2]]);
+
+		if (XMVectorGetX(XMVector3Dot(XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a)), a)) < 0.0f)
+			std::swap(faces[f + 1], faces[f + 2]);
+	}
+
+	//Split every face into four, pushing the new vertices out onto the sphere
+	for (UINT l = 0; l < level; l++)
+	{
+		std::map<unsigned int, unsigned short> edgeMap;
+		std::vector<unsigned short> subdivided;
+		subdivided.reserve(faces.size() * 4);
+
+		for (size_t f = 0; f < faces.size(); f += 3)
+		{
+			unsigned short a = faces[f];
+			unsigned short b = faces[f + 1];
+			unsigned short c = faces[f + 2];
+
+			unsigned short ab = Midpoint(a, b, positions, edgeMap);
+			unsigned short bc = Midpoint(b, c, positions, edgeMap);
+			unsigned short ca = Midpoint(c, a, positions, edgeMap);
+
+			unsigned short tris[] =
+			{
+				a, ab, ca,
+				ab, b, bc,
+				ca, bc, c,
+				ab, bc, ca
+			};
+			subdivided.insert(subdivided.end(), tris, tris + 12);
+		}
+
+		faces.swap(subdivided);
+	}
+
+	//Unit sphere so the normal is the position
+	outVertices.clear();
+	outVertices.reserve(positions.size() + positions.size() / 8);
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		SimpleVertex vertex = { positions[i], positions[i], SphereUV(positions[i]) };
+		outVertices.push_back(vertex);
+	}
+
+	//Faces that straddle the u = 0/1 seam get copies of their low-u vertices shifted up by one,
+	//and faces touching a pole get their own pole vertex with u centred on the face
+	std::map<unsigned short, unsigned short> seamCopies;
+	for (size_t f = 0; f < faces.size(); f += 3)
+	{
+		float u[3];
+		for (int i = 0; i < 3; i++)
+			u[i] = outVertices[faces[f + i]].TexC.x;
+
+		float maxU = (std::max)(u[0], (std::max)(u[1], u[2]));
+		float minU = (std::min)(u[0], (std::min)(u[1], u[2]));
+
+		if (maxU - minU > 0.5f)
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				unsigned short index = faces[f + i];
+				if (outVertices[index].TexC.x >= 0.5f || fabsf(outVertices[index].Pos.y) > 0.9999f)
+					continue;
+
+				auto it = seamCopies.find(index);
+				if (it == seamCopies.end())
+				{
+					SimpleVertex copy = outVertices[index];
+					copy.TexC.x += 1.0f;
+					outVertices.push_back(copy);
+					it = seamCopies.insert(std::make_pair(index, (unsigned short)(outVertices.size() - 1))).first;
+				}
+				faces[f + i] = it->second;
+			}
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned short index = faces[f + i];
+			if (fabsf(outVertices[index].Pos.y) <= 0.9999f)
+				continue;
+
+			SimpleVertex pole = outVertices[index];
+			pole.TexC.x = 0.5f * (outVertices[faces[f + (i + 1) % 3]].TexC.x + outVertices[faces[f + (i + 2) % 3]].TexC.x);
+			outVertices.push_back(pole);
+			faces[f + i] = (unsigned short)(outVertices.size() - 1);
+		}
+	}
+
+	outIndices.swap(faces);
+
+	OptimiseVertexOrder(outVertices, outIndices);
+}
+
+void SphereGenerator::OptimiseVertexOrder(std::vector<SimpleVertex>& vertices, std::vector<unsigned short>& indices)
+{
+	const unsigned short unused = 0xffff;
+	std::vector<unsigned short> remap(vertices.size(), unused);
+	std::vector<SimpleVertex> ordered;
+	ordered.reserve(vertices.size());
+
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		unsigned short& newIndex = remap[indices[i]];
+		if (newIndex == unused)
+		{
+			newIndex = (unsigned short)ordered.size();
+			ordered.push_back(vertices[indices[i]]);
+		}
+		indices[i] = newIndex;
+	}
+
+	vertices.swap(ordered);
+}
+
+MeshData SphereGenerator::CreateBuffers(const std::vector<SimpleVertex>& vertices, const std::vector<unsigned short>& indices, ID3D11Device* _pd3dDevice)
+{
+	MeshData meshData;
+
+	ID3D11Buffer* vertexBuffer = nullptr;
+
+	D3D11_BUFFER_DESC bd;
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_IMMUTABLE;
+	bd.ByteWidth = (UINT)(sizeof(SimpleVertex) * vertices.size());
+	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bd.CPUAccessFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA InitData;
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = vertices.data();
+
+	_pd3dDevice->CreateBuffer(&bd, &InitData, &vertexBuffer);
+
+	meshData.VertexBuffer = vertexBuffer;
+	meshData.VBOffset = 0;
+	meshData.VBStride = sizeof(SimpleVertex);
+
+	ID3D11Buffer* indexBuffer = nullptr;
+
+	ZeroMemory(&bd, sizeof(bd));
+	bd.Usage = D3D11_USAGE_IMMUTABLE;
+	bd.ByteWidth = (UINT)(sizeof(WORD) * indices.size());
+	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	bd.CPUAccessFlags = 0;
+
+	ZeroMemory(&InitData, sizeof(InitData));
+	InitData.pSysMem = indices.data();
+	_pd3dDevice->CreateBuffer(&bd, &InitData, &indexBuffer);
+
+	meshData.IndexCount = (UINT)indices.size();
+	meshData.IndexBuffer = indexBuffer;
+
+	return meshData;
+}
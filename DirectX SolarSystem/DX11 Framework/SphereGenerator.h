@@ -0,0 +1,40 @@
+#pragma once
+#ifndef SPHEREGENERATOR
+#define SPHEREGENERATOR
+
+#include "Structures.h"
+#include "OBJLoader.h"
+#include <windows.h>
+#include <d3d11_1.h>
+#include <directxmath.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace SphereGenerator
+{
+	//Highest subdivision level that still fits in 16 bit indices once the UV seam has been split
+	const UINT MaxLevel = 6;
+
+	//Level 2 has the same 162 vertex / 320 face layout as the old sphere.obj geosphere
+	const UINT DefaultLevel = 2;
+
+	//Triangle and index counts are known at compile time so buffers can be sized up front
+	constexpr UINT FaceCount(UINT level) { return level == 0 ? 20 : 4 * FaceCount(level - 1); }
+	constexpr UINT IndexCount(UINT level) { return FaceCount(level) * 3; }
+
+	//Vertex count on the closed sphere, before the seam and pole vertices are duplicated
+	constexpr UINT SharedVertexCount(UINT level) { return 10 * (FaceCount(level) / 20) + 2; }
+
+	//Builds a unit icosphere with the same UV mapping as sphere.obj on the CPU
+	void Generate(UINT level, std::vector<SimpleVertex>& outVertices, std::vector<unsigned short>& outIndices);
+
+	//Helper methods for the above methods
+	//Reorders vertices into the order the index buffer first uses them so vertex fetches stay sequential
+	void OptimiseVertexOrder(std::vector<SimpleVertex>& vertices, std::vector<unsigned short>& indices);
+
+	//Creates the vertex and index buffers for a generated mesh. ResourceManager::LoadSphere keeps one per level
+	MeshData CreateBuffers(const std::vector<SimpleVertex>& vertices, const std::vector<unsigned short>& indices, ID3D11Device* _pd3dDevice);
+};
+
+#endif
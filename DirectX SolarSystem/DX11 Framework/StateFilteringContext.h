@@ -0,0 +1,302 @@
+#pragma once
+#ifndef STATEFILTERINGCONTEXT
+#define STATEFILTERINGCONTEXT
+
+#include <string.h>
+
+//Stands in front of a device context for the calls that bind pipeline state, keeping a copy of everything bound
+//and dropping any call that would bind what is already there. Context is ID3D11DeviceContext in the application, with Types naming
+//the interfaces and enums its methods take (D3D11StateTypes), but any pair with the same methods will do. Nothing here needs the SDK,
+//so a mock context that records what reaches it can check the filtering without a GPU.
+//State bound by going round this straight to the context is not seen, so Invalidate after doing that
+template <typename Context, typename Types>
+class StateFilteringContext
+{
+public:
+	typedef typename Types::InputLayout InputLayout;
+	typedef typename Types::Topology Topology;
+	typedef typename Types::Buffer Buffer;
+	typedef typename Types::Format Format;
+	typedef typename Types::VertexShader VertexShader;
+	typedef typename Types::PixelShader PixelShader;
+	typedef typename Types::ClassInstance ClassInstance;
+	typedef typename Types::ShaderResourceView ShaderResourceView;
+	typedef typename Types::SamplerState SamplerState;
+	typedef typename Types::BlendState BlendState;
+	typedef typename Types::RasterizerState RasterizerState;
+
+	//Calls passed on to the context and calls dropped as changing nothing, since the last ResetStatistics
+	struct Statistics
+	{
+		unsigned int Forwarded;
+		unsigned int Filtered;
+	};
+
+	//Slots whose contents are shadowed, calls reaching past these are always passed on
+	static const unsigned int VertexBufferSlots = 16;
+	static const unsigned int ConstantBufferSlots = Types::ConstantBufferSlots;
+	static const unsigned int ShaderResourceSlots = 16;
+	static const unsigned int SamplerSlots = Types::SamplerSlots;
+
+private:
+	Context* m_Context;
+	Statistics m_Statistics;
+
+	//Everything below is only trusted where its Known flag is set, which Invalidate clears
+	bool m_InputLayoutKnown;
+	InputLayout* m_InputLayout;
+	bool m_TopologyKnown;
+	Topology m_Topology;
+
+	bool m_VertexBufferKnown[VertexBufferSlots];
+	Buffer* m_VertexBuffers[VertexBufferSlots];
+	unsigned int m_Strides[VertexBufferSlots];
+	unsigned int m_Offsets[VertexBufferSlots];
+
+	bool m_IndexBufferKnown;
+	Buffer* m_IndexBuffer;
+	Format m_IndexFormat;
+	unsigned int m_IndexOffset;
+
+	bool m_VertexShaderKnown;
+	VertexShader* m_VertexShader;
+	bool m_PixelShaderKnown;
+	PixelShader* m_PixelShader;
+
+	bool m_VSConstantBufferKnown[ConstantBufferSlots];
+	Buffer* m_VSConstantBuffers[ConstantBufferSlots];
+	bool m_PSConstantBufferKnown[ConstantBufferSlots];
+	Buffer* m_PSConstantBuffers[ConstantBufferSlots];
+
+	bool m_ShaderResourceKnown[ShaderResourceSlots];
+	ShaderResourceView* m_ShaderResources[ShaderResourceSlots];
+	bool m_SamplerKnown[SamplerSlots];
+	SamplerState* m_Samplers[SamplerSlots];
+
+	bool m_BlendStateKnown;
+	BlendState* m_BlendState;
+	float m_BlendFactor[4];
+	unsigned int m_SampleMask;
+
+	bool m_RasterizerStateKnown;
+	RasterizerState* m_RasterizerState;
+
+	//Helper methods for the above method(s)
+	bool Filter(bool unchanged)
+	{
+		if (unchanged)
+			m_Statistics.Filtered++;
+		else
+			m_Statistics.Forwarded++;
+
+		return unchanged;
+	}
+
+	//Whether every slot of a call is already bound to what it asks for
+	template <typename T> static bool SlotsMatch(const bool* known, T* const* bound, unsigned int startSlot, unsigned int count, T* const* values, unsigned int slots)
+	{
+		if (startSlot + count > slots)
+			return false;
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (!known[startSlot + i] || bound[startSlot + i] != (values ? values[i] : nullptr))
+				return false;
+		}
+
+		return true;
+	}
+
+	template <typename T> static void StoreSlots(bool* known, T** bound, unsigned int startSlot, unsigned int count, T* const* values, unsigned int slots)
+	{
+		for (unsigned int i = 0; i < count && startSlot + i < slots; i++)
+		{
+			known[startSlot + i] = true;
+			bound[startSlot + i] = values ? values[i] : nullptr;
+		}
+	}
+
+public:
+	//Constructor
+	StateFilteringContext(Context* context = nullptr) : m_Context(context)
+	{
+		ResetStatistics();
+		Invalidate();
+	}
+
+	//Points the filter at a context, which starts out with nothing known about it
+	void SetContext(Context* context)
+	{
+		m_Context = context;
+		Invalidate();
+	}
+
+	Context* GetContext() const { return m_Context; }
+
+	//Forgets everything shadowed, so the next call for each piece of state is passed on whatever it binds
+	void Invalidate()
+	{
+		m_InputLayoutKnown = false;
+		m_TopologyKnown = false;
+		m_IndexBufferKnown = false;
+		m_VertexShaderKnown = false;
+		m_PixelShaderKnown = false;
+		m_BlendStateKnown = false;
+		m_RasterizerStateKnown = false;
+
+		memset(m_VertexBufferKnown, 0, sizeof(m_VertexBufferKnown));
+		memset(m_VSConstantBufferKnown, 0, sizeof(m_VSConstantBufferKnown));
+		memset(m_PSConstantBufferKnown, 0, sizeof(m_PSConstantBufferKnown));
+		memset(m_ShaderResourceKnown, 0, sizeof(m_ShaderResourceKnown));
+		memset(m_SamplerKnown, 0, sizeof(m_SamplerKnown));
+	}
+
+	//Forgets a run of constant buffer slots in both stages, for when they have been bound round this, such as by offset
+	void InvalidateConstantBuffers(unsigned int startSlot, unsigned int numBuffers)
+	{
+		for (unsigned int i = startSlot; i < startSlot + numBuffers && i < ConstantBufferSlots; i++)
+		{
+			m_VSConstantBufferKnown[i] = false;
+			m_PSConstantBufferKnown[i] = false;
+		}
+	}
+
+	const Statistics& GetStatistics() const { return m_Statistics; }
+	void ResetStatistics() { m_Statistics.Forwarded = 0; m_Statistics.Filtered = 0; }
+
+	void IASetInputLayout(InputLayout* inputLayout)
+	{
+		if (Filter(m_InputLayoutKnown && m_InputLayout == inputLayout))
+			return;
+
+		m_InputLayoutKnown = true;
+		m_InputLayout = inputLayout;
+		m_Context->IASetInputLayout(inputLayout);
+	}
+
+	void IASetPrimitiveTopology(Topology topology)
+	{
+		if (Filter(m_TopologyKnown && m_Topology == topology))
+			return;
+
+		m_TopologyKnown = true;
+		m_Topology = topology;
+		m_Context->IASetPrimitiveTopology(topology);
+	}
+
+	void IASetVertexBuffers(unsigned int startSlot, unsigned int numBuffers, Buffer* const* buffers, const unsigned int* strides, const unsigned int* offsets)
+	{
+		bool unchanged = SlotsMatch(m_VertexBufferKnown, m_VertexBuffers, startSlot, numBuffers, buffers, VertexBufferSlots);
+		for (unsigned int i = 0; unchanged && i < numBuffers; i++)
+			unchanged = m_Strides[startSlot + i] == strides[i] && m_Offsets[startSlot + i] == offsets[i];
+
+		if (Filter(unchanged))
+			return;
+
+		StoreSlots(m_VertexBufferKnown, m_VertexBuffers, startSlot, numBuffers, buffers, VertexBufferSlots);
+		for (unsigned int i = 0; i < numBuffers && startSlot + i < VertexBufferSlots; i++)
+		{
+			m_Strides[startSlot + i] = strides[i];
+			m_Offsets[startSlot + i] = offsets[i];
+		}
+
+		m_Context->IASetVertexBuffers(startSlot, numBuffers, buffers, strides, offsets);
+	}
+
+	void IASetIndexBuffer(Buffer* indexBuffer, Format format, unsigned int offset)
+	{
+		if (Filter(m_IndexBufferKnown && m_IndexBuffer == indexBuffer && m_IndexFormat == format && m_IndexOffset == offset))
+			return;
+
+		m_IndexBufferKnown = true;
+		m_IndexBuffer = indexBuffer;
+		m_IndexFormat = format;
+		m_IndexOffset = offset;
+		m_Context->IASetIndexBuffer(indexBuffer, format, offset);
+	}
+
+	//Shaders bound with class instances are always passed on, only plain shaders are shadowed
+	void VSSetShader(VertexShader* shader, ClassInstance* const* classInstances, unsigned int numClassInstances)
+	{
+		if (Filter(numClassInstances == 0 && m_VertexShaderKnown && m_VertexShader == shader))
+			return;
+
+		m_VertexShaderKnown = numClassInstances == 0;
+		m_VertexShader = shader;
+		m_Context->VSSetShader(shader, classInstances, numClassInstances);
+	}
+
+	void PSSetShader(PixelShader* shader, ClassInstance* const* classInstances, unsigned int numClassInstances)
+	{
+		if (Filter(numClassInstances == 0 && m_PixelShaderKnown && m_PixelShader == shader))
+			return;
+
+		m_PixelShaderKnown = numClassInstances == 0;
+		m_PixelShader = shader;
+		m_Context->PSSetShader(shader, classInstances, numClassInstances);
+	}
+
+	void VSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, Buffer* const* buffers)
+	{
+		if (Filter(SlotsMatch(m_VSConstantBufferKnown, m_VSConstantBuffers, startSlot, numBuffers, buffers, ConstantBufferSlots)))
+			return;
+
+		StoreSlots(m_VSConstantBufferKnown, m_VSConstantBuffers, startSlot, numBuffers, buffers, ConstantBufferSlots);
+		m_Context->VSSetConstantBuffers(startSlot, numBuffers, buffers);
+	}
+
+	void PSSetConstantBuffers(unsigned int startSlot, unsigned int numBuffers, Buffer* const* buffers)
+	{
+		if (Filter(SlotsMatch(m_PSConstantBufferKnown, m_PSConstantBuffers, startSlot, numBuffers, buffers, ConstantBufferSlots)))
+			return;
+
+		StoreSlots(m_PSConstantBufferKnown, m_PSConstantBuffers, startSlot, numBuffers, buffers, ConstantBufferSlots);
+		m_Context->PSSetConstantBuffers(startSlot, numBuffers, buffers);
+	}
+
+	void PSSetShaderResources(unsigned int startSlot, unsigned int numViews, ShaderResourceView* const* views)
+	{
+		if (Filter(SlotsMatch(m_ShaderResourceKnown, m_ShaderResources, startSlot, numViews, views, ShaderResourceSlots)))
+			return;
+
+		StoreSlots(m_ShaderResourceKnown, m_ShaderResources, startSlot, numViews, views, ShaderResourceSlots);
+		m_Context->PSSetShaderResources(startSlot, numViews, views);
+	}
+
+	void PSSetSamplers(unsigned int startSlot, unsigned int numSamplers, SamplerState* const* samplers)
+	{
+		if (Filter(SlotsMatch(m_SamplerKnown, m_Samplers, startSlot, numSamplers, samplers, SamplerSlots)))
+			return;
+
+		StoreSlots(m_SamplerKnown, m_Samplers, startSlot, numSamplers, samplers, SamplerSlots);
+		m_Context->PSSetSamplers(startSlot, numSamplers, samplers);
+	}
+
+	//A null blend factor means all ones, the same as the context takes it
+	void OMSetBlendState(BlendState* blendState, const float blendFactor[4], unsigned int sampleMask)
+	{
+		const float ones[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		const float* factor = blendFactor ? blendFactor : ones;
+
+		if (Filter(m_BlendStateKnown && m_BlendState == blendState && m_SampleMask == sampleMask && memcmp(m_BlendFactor, factor, sizeof(m_BlendFactor)) == 0))
+			return;
+
+		m_BlendStateKnown = true;
+		m_BlendState = blendState;
+		m_SampleMask = sampleMask;
+		memcpy(m_BlendFactor, factor, sizeof(m_BlendFactor));
+		m_Context->OMSetBlendState(blendState, blendFactor, sampleMask);
+	}
+
+	void RSSetState(RasterizerState* rasterizerState)
+	{
+		if (Filter(m_RasterizerStateKnown && m_RasterizerState == rasterizerState))
+			return;
+
+		m_RasterizerStateKnown = true;
+		m_RasterizerState = rasterizerState;
+		m_Context->RSSetState(rasterizerState);
+	}
+};
+
+#endif
@@ -56,4 +56,14 @@ struct SpotLight
 
 	DirectX::XMFLOAT3 Att;
 	float Pad;
-};
\ No newline at end of file
+};
+//One body in an instanced draw, read from the second vertex buffer alongside the mesh's vertices.
+//World is stored the same way round as it is for the constant buffer before the transpose
+struct BodyInstance
+{
+	DirectX::XMFLOAT4X4 World;
+	DirectX::XMFLOAT4 Diffuse;
+	DirectX::XMFLOAT4 Ambient;
+	DirectX::XMFLOAT4 Specular;
+	UINT Slice;
+};
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef CHECK
+#define CHECK
+
+#include <stdio.h>
+
+//Just enough of a test harness for the pieces that build without the DirectX SDK. Each test is a program that returns
+//the number of checks that failed, so make stops at the first one with something wrong
+
+inline int& CheckFailures()
+{
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK_TRUE(condition) \
+	do { if (!(condition)) { printf("%s(%d): failed %s\n", __FILE__, __LINE__, #condition); CheckFailures()++; } } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { if (!((expected) == (actual))) { printf("%s(%d): expected %s == %s\n", __FILE__, __LINE__, #expected, #actual); CheckFailures()++; } } while (0)
+
+inline int CheckResult(const char* name)
+{
+	printf("%s: %s\n", name, CheckFailures() == 0 ? "passed" : "FAILED");
+	return CheckFailures();
+}
+
+#endif
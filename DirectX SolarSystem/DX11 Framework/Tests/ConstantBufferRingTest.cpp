@@ -0,0 +1,258 @@
+#include "Check.h"
+#include "../ConstantBufferRing.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	//Stand-ins for the SDK's buffer and query, released the way the ring releases them
+	struct Buffer
+	{
+		std::vector<unsigned char> Memory;
+		void Release() { delete this; }
+	};
+
+	//A query counts as done once the mock GPU has got through the frame it was ended in
+	struct Query
+	{
+		int EndedAt;
+		void Release() { delete this; }
+	};
+
+	struct BufferDesc
+	{
+		int Usage;
+		unsigned int ByteWidth;
+		unsigned int BindFlags;
+		unsigned int CPUAccessFlags;
+		unsigned int MiscFlags;
+		unsigned int StructureByteStride;
+	};
+
+	struct QueryDesc
+	{
+		int Query;
+		unsigned int MiscFlags;
+	};
+
+	struct MappedSubresource
+	{
+		void* pData;
+		unsigned int RowPitch;
+		unsigned int DepthPitch;
+	};
+
+	struct MockTypes
+	{
+		typedef ::Buffer Buffer;
+		typedef ::Query Query;
+		typedef ::BufferDesc BufferDesc;
+		typedef ::QueryDesc QueryDesc;
+		typedef ::MappedSubresource MappedSubresource;
+		typedef long Result;
+
+		//The same values the SDK uses, S_FALSE for a query that is not done yet
+		static const Result Ok = 0;
+		static const Result NotYet = 1;
+
+		static const int UsageDynamic = 2;
+		static const unsigned int BindConstantBuffer = 0x4;
+		static const unsigned int CpuAccessWrite = 0x10000;
+		static const int QueryEvent = 0;
+		static const int MapWriteDiscard = 4;
+		static const int MapWriteNoOverwrite = 5;
+		static const unsigned int GetDataDoNotFlush = 0x1;
+	};
+
+	class MockDevice
+	{
+	public:
+		long CreateBuffer(const BufferDesc* desc, const void*, Buffer** buffer)
+		{
+			*buffer = new Buffer;
+			(*buffer)->Memory.resize(desc->ByteWidth);
+			return MockTypes::Ok;
+		}
+
+		long CreateQuery(const QueryDesc*, Query** query)
+		{
+			*query = new Query;
+			(*query)->EndedAt = -1;
+			return MockTypes::Ok;
+		}
+	};
+
+	//Records every map and every query ended, with a GPU that finishes frames only when the test says so
+	class MockContext
+	{
+	public:
+		std::vector<int> MapTypes;
+		int EndedQueries;
+		int GpuFinished;
+
+		MockContext() : EndedQueries(0), GpuFinished(-1) {}
+
+		long Map(Buffer* buffer, unsigned int, int mapType, unsigned int, MappedSubresource* mapped)
+		{
+			MapTypes.push_back(mapType);
+			mapped->pData = &buffer->Memory[0];
+			return MockTypes::Ok;
+		}
+
+		void Unmap(Buffer*, unsigned int) {}
+
+		void End(Query* query) { query->EndedAt = EndedQueries++; }
+
+		long GetData(Query* query, void*, unsigned int, unsigned int flags)
+		{
+			CHECK_EQUAL(MockTypes::GetDataDoNotFlush, flags);
+			return query->EndedAt >= 0 && query->EndedAt <= GpuFinished ? MockTypes::Ok : MockTypes::NotYet;
+		}
+
+		void VSSetConstantBuffers1(unsigned int, unsigned int, Buffer* const*, const unsigned int*, const unsigned int*) {}
+		void PSSetConstantBuffers1(unsigned int, unsigned int, Buffer* const*, const unsigned int*, const unsigned int*) {}
+	};
+
+	typedef ConstantBufferRing<MockContext, MockTypes> Ring;
+
+	//Room for four uploads of up to AllocationAlignment bytes
+	const unsigned int Capacity = Ring::AllocationAlignment * 4;
+
+	unsigned int Upload(Ring& ring, unsigned char value)
+	{
+		unsigned char data[64];
+		memset(data, value, sizeof(data));
+
+		Ring::Allocation allocation;
+		if (!ring.Upload(data, sizeof(data), allocation))
+			return ~0u;
+
+		CHECK_EQUAL(Ring::AllocationAlignment / 16, allocation.NumConstants);
+		return allocation.FirstConstant * 16;
+	}
+
+	void TestUploadsAndMaps()
+	{
+		MockDevice device;
+		MockContext context;
+		Ring ring;
+
+		//Nothing to upload to before Create
+		CHECK_EQUAL(~0u, Upload(ring, 1));
+
+		CHECK_EQUAL(MockTypes::Ok, ring.Create(&device, &context, Capacity - 1));
+		CHECK_EQUAL((size_t)Capacity, ring.GetCapacity());
+
+		//The first map discards since nothing is known about the buffer, the rest never overwrite
+		CHECK_EQUAL(0u, Upload(ring, 1));
+		CHECK_EQUAL(256u, Upload(ring, 2));
+		CHECK_EQUAL((size_t)2, context.MapTypes.size());
+		CHECK_EQUAL(MockTypes::MapWriteDiscard, context.MapTypes[0]);
+		CHECK_EQUAL(MockTypes::MapWriteNoOverwrite, context.MapTypes[1]);
+
+		const std::vector<unsigned char>& memory = ring.GetBuffer()->Memory;
+		CHECK_EQUAL(1, memory[0]);
+		CHECK_EQUAL(1, memory[63]);
+		CHECK_EQUAL(0, memory[64]);
+		CHECK_EQUAL(2, memory[256]);
+
+		//More than the whole ring can never fit
+		unsigned char tooBig[Capacity + 16] = {};
+		Ring::Allocation allocation;
+		CHECK_TRUE(!ring.Upload(tooBig, sizeof(tooBig), allocation));
+	}
+
+	void TestReuseOnceGpuIsDone()
+	{
+		MockDevice device;
+		MockContext context;
+		Ring ring;
+		ring.Create(&device, &context, Capacity);
+
+		Upload(ring, 1);
+		Upload(ring, 1);
+		ring.EndFrame();
+		Upload(ring, 2);
+		Upload(ring, 2);
+		ring.EndFrame();
+		CHECK_EQUAL(2, context.EndedQueries);
+
+		//Full, but the GPU has got through the first frame, so its ranges come back without a discard
+		context.GpuFinished = 0;
+		CHECK_EQUAL(0u, Upload(ring, 3));
+		CHECK_EQUAL(MockTypes::MapWriteNoOverwrite, context.MapTypes.back());
+		CHECK_EQUAL(0u, ring.GetDiscards());
+
+		//The second frame is still in flight, so what is left of the first is all there is
+		CHECK_EQUAL(256u, Upload(ring, 3));
+		CHECK_EQUAL((size_t)Capacity, ring.GetUsed());
+	}
+
+	void TestDiscardWhenGpuIsBehind()
+	{
+		MockDevice device;
+		MockContext context;
+		Ring ring;
+		ring.Create(&device, &context, Capacity);
+
+		for (int i = 0; i < 4; i++)
+			Upload(ring, 1);
+		ring.EndFrame();
+
+		//Nothing finished and nothing free, so it starts again on fresh memory rather than waiting
+		CHECK_EQUAL(0u, Upload(ring, 2));
+		CHECK_EQUAL(MockTypes::MapWriteDiscard, context.MapTypes.back());
+		CHECK_EQUAL(1u, ring.GetDiscards());
+		CHECK_EQUAL((size_t)Ring::AllocationAlignment, ring.GetUsed());
+
+		//and goes back to never overwriting straight after
+		CHECK_EQUAL(256u, Upload(ring, 3));
+		CHECK_EQUAL(MockTypes::MapWriteNoOverwrite, context.MapTypes.back());
+	}
+
+	void TestEndFrameWithEveryQueryPending()
+	{
+		MockDevice device;
+		MockContext context;
+		Ring ring;
+		ring.Create(&device, &context, Ring::AllocationAlignment * 8);
+
+		for (unsigned int frame = 0; frame < Ring::MaxFramesInFlight; frame++)
+		{
+			Upload(ring, 1);
+			ring.EndFrame();
+		}
+
+		CHECK_EQUAL((int)Ring::MaxFramesInFlight, context.EndedQueries);
+
+		//No query is free, so the frame is left open rather than waited on and carries on into the next
+		Upload(ring, 2);
+		ring.EndFrame();
+		CHECK_EQUAL((int)Ring::MaxFramesInFlight, context.EndedQueries);
+
+		Upload(ring, 3);
+		CHECK_EQUAL((size_t)Ring::AllocationAlignment * 6, ring.GetUsed());
+
+		//Once the GPU catches up the four ended frames retire, and the carried over one closes under the next query with both its uploads
+		context.GpuFinished = (int)Ring::MaxFramesInFlight - 1;
+		ring.EndFrame();
+		CHECK_EQUAL((int)Ring::MaxFramesInFlight + 1, context.EndedQueries);
+		CHECK_EQUAL((size_t)Ring::AllocationAlignment * 2, ring.GetUsed());
+
+		context.GpuFinished = (int)Ring::MaxFramesInFlight;
+		ring.EndFrame();
+		CHECK_EQUAL((size_t)0, ring.GetUsed());
+		CHECK_EQUAL(0u, ring.GetDiscards());
+	}
+}
+
+int main()
+{
+	TestUploadsAndMaps();
+	TestReuseOnceGpuIsDone();
+	TestDiscardWhenGpuIsBehind();
+	TestEndFrameWithEveryQueryPending();
+
+	return CheckResult("ConstantBufferRing");
+}
@@ -0,0 +1,261 @@
+#include "Check.h"
+#include "../Integrator.h"
+#include "../ParallelFor.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace
+{
+	//Enough bodies that every update is split into several chunks
+	const size_t BodyCount = 20000;
+	const int StepCount = 24;
+
+	//A few point masses, one of them swinging round so the field changes within a step, with every body's acceleration
+	//worked out on its own in parallel the way NBodySystem does it
+	class PointMasses : public AccelerationField
+	{
+	public:
+		void Evaluate(const BodyState& state, float time, BodyAccelerations& accelerations) override
+		{
+			const float masses[3] = { 1.0f, 0.01f, 0.002f };
+			const float planetX = 1.5f * cosf(2.0f * time);
+			const float planetY = 1.5f * sinf(2.0f * time);
+
+			ParallelFor(state.GetCount(), 256, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					const float positions[3][3] = { { 0.0f, 0.0f, 0.0f }, { planetX, planetY, 0.0f }, { -2.0f, 0.5f, 0.1f } };
+
+					float ax = 0.0f, ay = 0.0f, az = 0.0f;
+					for (int m = 0; m < 3; m++)
+					{
+						float dx = positions[m][0] - state.X[i];
+						float dy = positions[m][1] - state.Y[i];
+						float dz = positions[m][2] - state.Z[i];
+
+						float inverse = 1.0f / sqrtf(dx * dx + dy * dy + dz * dz + 1e-4f);
+						float strength = masses[m] * inverse * inverse * inverse;
+
+						ax += dx * strength;
+						ay += dy * strength;
+						az += dz * strength;
+					}
+
+					accelerations.X[i] = ax;
+					accelerations.Y[i] = ay;
+					accelerations.Z[i] = az;
+				}
+			});
+		}
+	};
+
+	//Bodies on roughly circular orbits through a disc, some close enough to the masses to need substeps
+	void FillDisc(BodyState& state)
+	{
+		state.Resize(BodyCount);
+
+		unsigned int random = 12345;
+		for (size_t i = 0; i < BodyCount; i++)
+		{
+			random = random * 1664525u + 1013904223u;
+			float angle = (random >> 8) * (6.2831853f / 16777216.0f);
+			random = random * 1664525u + 1013904223u;
+			float radius = 0.3f + (random >> 8) * (2.5f / 16777216.0f);
+
+			float speed = 1.0f / sqrtf(radius);
+			state.X[i] = radius * cosf(angle);
+			state.Y[i] = radius * sinf(angle);
+			state.Z[i] = 0.01f * sinf(7.0f * angle);
+			state.VX[i] = -speed * sinf(angle);
+			state.VY[i] = speed * cosf(angle);
+			state.VZ[i] = 0.0f;
+		}
+	}
+
+	void Run(IntegratorType type, size_t threads, BodyState& state, unsigned int& maxSubsteps)
+	{
+		SetParallelThreadCount(threads);
+
+		FillDisc(state);
+
+		PointMasses field;
+		Integrator integrator(type);
+		integrator.SetAdaptive(0.2f, 0.05f, 4);
+
+		maxSubsteps = 0;
+		for (int step = 0; step < StepCount; step++)
+		{
+			integrator.Step(state, field, 0.01f);
+			maxSubsteps = integrator.GetLastSubsteps() > maxSubsteps ? integrator.GetLastSubsteps() : maxSubsteps;
+		}
+
+		SetParallelThreadCount(0);
+	}
+
+	//A unit mass at the origin pulling on bodies that are too light to pull back, so a body at radius 1 moving at speed 1
+	//is on a circular orbit with a period of 2 pi
+	class CentralMass : public AccelerationField
+	{
+	public:
+		void Evaluate(const BodyState& state, float time, BodyAccelerations& accelerations) override
+		{
+			for (size_t i = 0; i < state.GetCount(); i++)
+			{
+				float inverse = 1.0f / sqrtf(state.X[i] * state.X[i] + state.Y[i] * state.Y[i] + state.Z[i] * state.Z[i]);
+				float strength = -inverse * inverse * inverse;
+
+				accelerations.X[i] = state.X[i] * strength;
+				accelerations.Y[i] = state.Y[i] * strength;
+				accelerations.Z[i] = state.Z[i] * strength;
+			}
+		}
+	};
+
+	const float Period = 6.2831853f;
+
+	//One body at (1, 0, 0) moving along y, on a circle at a speed of 1 and on an ellipse below that
+	void StartOrbit(BodyState& state, float speed)
+	{
+		state.Resize(1);
+		state.X[0] = 1.0f;
+		state.Y[0] = state.Z[0] = 0.0f;
+		state.VX[0] = state.VZ[0] = 0.0f;
+		state.VY[0] = speed;
+	}
+
+	double OrbitEnergy(const BodyState& state)
+	{
+		double speedSq = (double)state.VX[0] * state.VX[0] + (double)state.VY[0] * state.VY[0] + (double)state.VZ[0] * state.VZ[0];
+		double radius = sqrt((double)state.X[0] * state.X[0] + (double)state.Y[0] * state.Y[0] + (double)state.Z[0] * state.Z[0]);
+
+		return speedSq * 0.5 - 1.0 / radius;
+	}
+
+	//How far from the start the body is after one period taken in the given number of steps
+	double ErrorAfterOnePeriod(IntegratorType type, int steps)
+	{
+		BodyState state;
+		StartOrbit(state, 1.0f);
+
+		CentralMass field;
+		Integrator integrator(type);
+		for (int step = 0; step < steps; step++)
+			integrator.Step(state, field, Period / steps);
+
+		return sqrt((state.X[0] - 1.0) * (state.X[0] - 1.0) + (double)state.Y[0] * state.Y[0] + (double)state.Z[0] * state.Z[0]);
+	}
+
+	//After one period the body should be back where it started, and the energy should stay at -1/2 over ten of them
+	void TestCircularOrbit(IntegratorType type, double periodError, double energyDrift)
+	{
+		CHECK_TRUE(ErrorAfterOnePeriod(type, 256) < periodError);
+
+		BodyState state;
+		StartOrbit(state, 1.0f);
+
+		CentralMass field;
+		Integrator integrator(type);
+
+		double worstDrift = 0.0;
+		for (int step = 0; step < 64 * 10; step++)
+		{
+			integrator.Step(state, field, Period / 64);
+
+			double drift = fabs(OrbitEnergy(state) + 0.5);
+			worstDrift = drift > worstDrift ? drift : worstDrift;
+		}
+
+		CHECK_TRUE(worstDrift < energyDrift);
+	}
+
+	//Halving the step should cut the error by about 2^order. Steps are kept large enough that float rounding stays well below it
+	void TestConvergenceOrder(IntegratorType type, int order)
+	{
+		double coarse = ErrorAfterOnePeriod(type, 32);
+		double fine = ErrorAfterOnePeriod(type, 64);
+		double expected = (double)(1 << order);
+
+		CHECK_TRUE(coarse / fine > expected * 0.75);
+		CHECK_TRUE(coarse / fine < expected * 2.0);
+	}
+
+	//An eccentric orbit dips to about 0.05 from the mass. Far out one step is enough, at the closest pass it has to be split
+	void TestSubstepsNearEncounter(IntegratorType type)
+	{
+		BodyState state;
+		StartOrbit(state, 0.3f);
+
+		CentralMass field;
+		Integrator integrator(type);
+		integrator.SetAdaptive(0.2f, 0.05f, 6);
+
+		integrator.Step(state, field, 0.01f);
+		unsigned int farSubsteps = integrator.GetLastSubsteps();
+
+		float closest = 1.0f;
+		unsigned int closestSubsteps = 0;
+		for (int step = 1; step < 150; step++)
+		{
+			integrator.Step(state, field, 0.01f);
+
+			float radius = sqrtf(state.X[0] * state.X[0] + state.Y[0] * state.Y[0] + state.Z[0] * state.Z[0]);
+			if (radius < closest)
+			{
+				closest = radius;
+				closestSubsteps = integrator.GetLastSubsteps();
+			}
+		}
+
+		CHECK_EQUAL(1u, farSubsteps);
+		CHECK_TRUE(closest < 0.1f);
+		CHECK_TRUE(closestSubsteps > 1);
+	}
+
+	bool SameBits(const std::vector<float>& a, const std::vector<float>& b)
+	{
+		return a.size() == b.size() && memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0;
+	}
+
+	//The same start has to give the same bits whether one thread does all of it or the chunks are shared out
+	void TestThreadCountDoesNotChangeResult(IntegratorType type)
+	{
+		BodyState single, shared;
+		unsigned int singleSubsteps, sharedSubsteps;
+
+		Run(type, 1, single, singleSubsteps);
+		Run(type, 7, shared, sharedSubsteps);
+
+		CHECK_TRUE(singleSubsteps > 1);
+		CHECK_EQUAL(singleSubsteps, sharedSubsteps);
+
+		CHECK_TRUE(SameBits(single.X, shared.X));
+		CHECK_TRUE(SameBits(single.Y, shared.Y));
+		CHECK_TRUE(SameBits(single.Z, shared.Z));
+		CHECK_TRUE(SameBits(single.VX, shared.VX));
+		CHECK_TRUE(SameBits(single.VY, shared.VY));
+		CHECK_TRUE(SameBits(single.VZ, shared.VZ));
+	}
+}
+
+int main()
+{
+	TestThreadCountDoesNotChangeResult(INTEGRATOR_LEAPFROG);
+	TestThreadCountDoesNotChangeResult(INTEGRATOR_YOSHIDA4);
+	TestThreadCountDoesNotChangeResult(INTEGRATOR_RK4);
+
+	TestCircularOrbit(INTEGRATOR_LEAPFROG, 5e-3, 1e-4);
+	TestCircularOrbit(INTEGRATOR_YOSHIDA4, 1e-4, 1e-5);
+	TestCircularOrbit(INTEGRATOR_RK4, 1e-4, 1e-4);
+
+	TestConvergenceOrder(INTEGRATOR_LEAPFROG, 2);
+	TestConvergenceOrder(INTEGRATOR_YOSHIDA4, 4);
+	TestConvergenceOrder(INTEGRATOR_RK4, 4);
+
+	TestSubstepsNearEncounter(INTEGRATOR_LEAPFROG);
+	TestSubstepsNearEncounter(INTEGRATOR_YOSHIDA4);
+	TestSubstepsNearEncounter(INTEGRATOR_RK4);
+
+	return CheckResult("Integrator");
+}
@@ -0,0 +1,157 @@
+#include "Check.h"
+#include "../RingAllocator.h"
+
+#include <deque>
+#include <vector>
+
+namespace
+{
+	struct Range
+	{
+		uint64_t Frame;
+		size_t Begin, End;
+	};
+
+	//Ranges handed out to frames that have not retired yet must never share a byte
+	bool Overlaps(const std::deque<Range>& live, size_t begin, size_t end)
+	{
+		for (size_t i = 0; i < live.size(); i++)
+		{
+			if (begin < live[i].End && live[i].Begin < end)
+				return true;
+		}
+
+		return false;
+	}
+
+	void RetireLive(std::deque<Range>& live, uint64_t id)
+	{
+		while (!live.empty() && live.front().Frame <= id)
+			live.pop_front();
+	}
+
+	void TestWrapsAndRetires()
+	{
+		RingAllocator ring(4096);
+		size_t offset;
+
+		CHECK_TRUE(ring.Allocate(1000, 256, offset));
+		CHECK_EQUAL((size_t)0, offset);
+		CHECK_TRUE(ring.Allocate(1000, 256, offset));
+		CHECK_EQUAL((size_t)1024, offset);
+		ring.EndFrame(1);
+
+		CHECK_TRUE(ring.Allocate(2000, 256, offset));
+		CHECK_EQUAL((size_t)2048, offset);
+		ring.EndFrame(2);
+
+		//Full until the first frame retires, then the next range wraps to the start
+		CHECK_TRUE(!ring.Allocate(256, 256, offset));
+		ring.Retire(1);
+		CHECK_TRUE(ring.Allocate(256, 256, offset));
+		CHECK_EQUAL((size_t)0, offset);
+		ring.EndFrame(3);
+
+		ring.Retire(3);
+		CHECK_EQUAL((size_t)0, ring.GetUsed());
+		CHECK_EQUAL((size_t)0, ring.GetPendingFrames());
+	}
+
+	//A frame that took nothing still remembers where the head was when it closed. With the ring empty but that frame waiting,
+	//the head must not be rewound, or retiring it later would move the tail back over ranges still in use
+	void TestEmptyFrameKeepsTail()
+	{
+		RingAllocator ring(6144);
+		size_t offset;
+
+		CHECK_TRUE(ring.Allocate(1024, 256, offset));
+		ring.EndFrame(1);
+		ring.EndFrame(2);
+		ring.Retire(1);
+		CHECK_EQUAL((size_t)0, ring.GetUsed());
+
+		CHECK_TRUE(ring.Allocate(1024, 256, offset));
+		size_t third = offset;
+		CHECK_TRUE(ring.Allocate(2048, 256, offset));
+		ring.EndFrame(3);
+		ring.Retire(2);
+
+		//Frame 3 is still in flight, so whatever is handed out now has to miss it
+		while (ring.Allocate(1024, 256, offset))
+			CHECK_TRUE(offset >= third + 3072 || offset + 1024 <= third);
+	}
+
+	//The frames the scene makes: a few ranges or none at all, retired a couple of frames behind
+	void TestFramesInFlight()
+	{
+		const size_t Capacity = 6144;
+		const uint64_t Latency = 2;
+
+		RingAllocator ring(Capacity);
+		std::deque<Range> live;
+		unsigned int random = 12345;
+		bool overlapped = false;
+
+		for (uint64_t frame = 1; frame <= 20000; frame++)
+		{
+			random = random * 1664525 + 1013904223;
+			size_t ranges = (random >> 16) % 4;
+
+			for (size_t i = 0; i < ranges; i++)
+			{
+				random = random * 1664525 + 1013904223;
+				size_t size = 16 + (random >> 16) % 1024;
+				size_t offset;
+
+				if (!ring.Allocate(size, 256, offset))
+					continue;
+
+				CHECK_TRUE(offset % 256 == 0 && offset + size <= Capacity);
+				if (Overlaps(live, offset, offset + size) && !overlapped)
+				{
+					printf("frame %llu got %zu..%zu over a range still in flight\n", (unsigned long long)frame, offset, offset + size);
+					overlapped = true;
+				}
+
+				Range range = { frame, offset, offset + size };
+				live.push_back(range);
+			}
+
+			ring.EndFrame(frame);
+
+			if (frame > Latency)
+			{
+				ring.Retire(frame - Latency);
+				RetireLive(live, frame - Latency);
+			}
+		}
+
+		CHECK_TRUE(!overlapped);
+	}
+
+	void TestDiscard()
+	{
+		RingAllocator ring(1024);
+		size_t offset;
+
+		CHECK_TRUE(ring.Allocate(1024, 16, offset));
+		ring.EndFrame(1);
+		CHECK_TRUE(!ring.Allocate(16, 16, offset));
+
+		ring.Discard();
+		CHECK_TRUE(ring.Allocate(1024, 16, offset));
+		CHECK_EQUAL((size_t)0, offset);
+		CHECK_TRUE(!ring.Allocate(0, 16, offset));
+		CHECK_TRUE(!ring.Allocate(2048, 16, offset));
+	}
+}
+
+int main()
+{
+	TestWrapsAndRetires();
+	TestEmptyFrameKeepsTail();
+	TestFramesInFlight();
+	TestDiscard();
+
+	return CheckResult("RingAllocator");
+}
@@ -0,0 +1,116 @@
+#include "Check.h"
+#include "../SimulationClock.h"
+
+namespace
+{
+	//Steps and advances are all sums of powers of two, so every time and alpha below comes out exact
+	const double StepLength = 0.25;
+
+	unsigned int TakeSteps(SimulationClock& clock)
+	{
+		unsigned int taken = 0;
+		while (clock.Step())
+			taken++;
+
+		return taken;
+	}
+
+	void TestCatchUp()
+	{
+		ManualClock source(100.0);
+		SimulationClock clock(&source, StepLength);
+
+		//Two and a half steps of real time give two steps and leave half of the next
+		source.Advance(0.625);
+		CHECK_EQUAL(2u, clock.Tick());
+		CHECK_EQUAL(2u, TakeSteps(clock));
+		CHECK_EQUAL(0.5, clock.GetTime());
+		CHECK_EQUAL(0.5f, clock.GetAlpha());
+
+		//The half left over counts towards the next step
+		source.Advance(0.125);
+		CHECK_EQUAL(1u, clock.Tick());
+		CHECK_EQUAL(1u, TakeSteps(clock));
+		CHECK_EQUAL(0.75, clock.GetTime());
+		CHECK_EQUAL(0.0f, clock.GetAlpha());
+	}
+
+	void TestStepsLeftForNextTick()
+	{
+		ManualClock source;
+		SimulationClock clock(&source, StepLength);
+
+		//Steps not taken before the next tick are still due then
+		source.Advance(0.75);
+		CHECK_EQUAL(3u, clock.Tick());
+		CHECK_TRUE(clock.Step());
+
+		CHECK_EQUAL(2u, clock.Tick());
+		CHECK_EQUAL(2u, TakeSteps(clock));
+		CHECK_EQUAL(0.75, clock.GetTime());
+	}
+
+	void TestStepCap()
+	{
+		ManualClock source;
+		SimulationClock clock(&source, StepLength, 8);
+
+		//Forty and a quarter steps behind only ever gives eight, the whole steps past that being dropped and the quarter kept
+		source.Advance(10.0625);
+		CHECK_EQUAL(8u, clock.Tick());
+		CHECK_EQUAL(8u, TakeSteps(clock));
+		CHECK_EQUAL(2.0, clock.GetTime());
+		CHECK_EQUAL(0.25f, clock.GetAlpha());
+
+		CHECK_EQUAL(0u, clock.Tick());
+		CHECK_TRUE(!clock.Step());
+	}
+
+	void TestAlphaWithinStep()
+	{
+		ManualClock source;
+		SimulationClock clock(&source, StepLength);
+
+		//Alpha follows real time into a step that is not due yet
+		source.Advance(0.0625);
+		CHECK_EQUAL(0u, clock.Tick());
+		CHECK_EQUAL(0.25f, clock.GetAlpha());
+
+		source.Advance(0.125);
+		CHECK_EQUAL(0u, clock.Tick());
+		CHECK_EQUAL(0.75f, clock.GetAlpha());
+		CHECK_EQUAL(0.0625, clock.TimeUntilNextStep());
+		CHECK_TRUE(!clock.Step());
+		CHECK_EQUAL(0.0, clock.GetTime());
+	}
+
+	void TestReset()
+	{
+		ManualClock source;
+		SimulationClock clock(&source, StepLength);
+
+		source.Advance(1.125);
+		clock.Tick();
+		TakeSteps(clock);
+
+		//Time before a reset never counts after it
+		clock.Reset();
+		CHECK_EQUAL(0.0, clock.GetTime());
+		CHECK_EQUAL(0.0f, clock.GetAlpha());
+		CHECK_EQUAL(0u, clock.Tick());
+
+		source.Advance(0.25);
+		CHECK_EQUAL(1u, clock.Tick());
+	}
+}
+
+int main()
+{
+	TestCatchUp();
+	TestStepsLeftForNextTick();
+	TestStepCap();
+	TestAlphaWithinStep();
+	TestReset();
+
+	return CheckResult("SimulationClock");
+}
@@ -0,0 +1,201 @@
+#include "Check.h"
+#include "../StateFilteringContext.h"
+
+#include <string>
+#include <vector>
+
+namespace
+{
+	//Stand-ins for the SDK's interfaces, only ever compared by address
+	struct Object {};
+
+	struct MockTypes
+	{
+		typedef Object InputLayout;
+		typedef int Topology;
+		typedef Object Buffer;
+		typedef int Format;
+		typedef Object VertexShader;
+		typedef Object PixelShader;
+		typedef Object ClassInstance;
+		typedef Object ShaderResourceView;
+		typedef Object SamplerState;
+		typedef Object BlendState;
+		typedef Object RasterizerState;
+
+		static const unsigned int ConstantBufferSlots = 14;
+		static const unsigned int SamplerSlots = 16;
+	};
+
+	//Records the name of every call that gets through
+	class MockContext
+	{
+	public:
+		std::vector<std::string> Calls;
+
+		void IASetInputLayout(Object*) { Calls.push_back("IASetInputLayout"); }
+		void IASetPrimitiveTopology(int) { Calls.push_back("IASetPrimitiveTopology"); }
+		void IASetVertexBuffers(unsigned int, unsigned int, Object* const*, const unsigned int*, const unsigned int*) { Calls.push_back("IASetVertexBuffers"); }
+		void IASetIndexBuffer(Object*, int, unsigned int) { Calls.push_back("IASetIndexBuffer"); }
+		void VSSetShader(Object*, Object* const*, unsigned int) { Calls.push_back("VSSetShader"); }
+		void PSSetShader(Object*, Object* const*, unsigned int) { Calls.push_back("PSSetShader"); }
+		void VSSetConstantBuffers(unsigned int, unsigned int, Object* const*) { Calls.push_back("VSSetConstantBuffers"); }
+		void PSSetConstantBuffers(unsigned int, unsigned int, Object* const*) { Calls.push_back("PSSetConstantBuffers"); }
+		void PSSetShaderResources(unsigned int, unsigned int, Object* const*) { Calls.push_back("PSSetShaderResources"); }
+		void PSSetSamplers(unsigned int, unsigned int, Object* const*) { Calls.push_back("PSSetSamplers"); }
+		void OMSetBlendState(Object*, const float*, unsigned int) { Calls.push_back("OMSetBlendState"); }
+		void RSSetState(Object*) { Calls.push_back("RSSetState"); }
+	};
+
+	typedef StateFilteringContext<MockContext, MockTypes> FilteringContext;
+
+	void TestRedundantBindsDropped()
+	{
+		MockContext mock;
+		FilteringContext context(&mock);
+		Object layout, shader, pixelShader, rasterizer;
+
+		context.IASetInputLayout(&layout);
+		context.IASetInputLayout(&layout);
+		context.IASetPrimitiveTopology(4);
+		context.IASetPrimitiveTopology(4);
+		context.VSSetShader(&shader, nullptr, 0);
+		context.VSSetShader(&shader, nullptr, 0);
+		context.PSSetShader(&pixelShader, nullptr, 0);
+		context.PSSetShader(&pixelShader, nullptr, 0);
+		context.RSSetState(&rasterizer);
+		context.RSSetState(&rasterizer);
+
+		CHECK_EQUAL((size_t)5, mock.Calls.size());
+		CHECK_EQUAL(5u, context.GetStatistics().Forwarded);
+		CHECK_EQUAL(5u, context.GetStatistics().Filtered);
+	}
+
+	void TestChangedBindsForwarded()
+	{
+		MockContext mock;
+		FilteringContext context(&mock);
+		Object first, second;
+
+		context.RSSetState(&first);
+		context.RSSetState(&second);
+		context.RSSetState(&first);
+		context.RSSetState(nullptr);
+		context.RSSetState(nullptr);
+
+		CHECK_EQUAL((size_t)4, mock.Calls.size());
+
+		//The blend factor counts as part of the state, and null means all ones
+		const float half[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+		const float ones[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		mock.Calls.clear();
+		context.OMSetBlendState(&first, nullptr, 0xffffffff);
+		context.OMSetBlendState(&first, ones, 0xffffffff);
+		context.OMSetBlendState(&first, half, 0xffffffff);
+		context.OMSetBlendState(&first, half, 0x0000ffff);
+
+		CHECK_EQUAL((size_t)3, mock.Calls.size());
+
+		//Shaders bound with class instances are never filtered, and the next plain bind is passed on after them
+		Object shader, instance;
+		Object* instances[1] = { &instance };
+		mock.Calls.clear();
+		context.VSSetShader(&shader, instances, 1);
+		context.VSSetShader(&shader, instances, 1);
+		context.VSSetShader(&shader, nullptr, 0);
+
+		CHECK_EQUAL((size_t)3, mock.Calls.size());
+	}
+
+	void TestSlots()
+	{
+		MockContext mock;
+		FilteringContext context(&mock);
+		Object a, b;
+		Object* pair[2] = { &a, &b };
+		Object* single[1] = { &b };
+
+		//Binding a range shadows each slot in it, so a later bind of one slot inside it is already there
+		context.PSSetShaderResources(0, 2, pair);
+		context.PSSetShaderResources(1, 1, single);
+		context.PSSetShaderResources(0, 1, single);
+		CHECK_EQUAL((size_t)2, mock.Calls.size());
+
+		//VS and PS constant buffers are shadowed apart
+		mock.Calls.clear();
+		context.VSSetConstantBuffers(0, 1, single);
+		context.PSSetConstantBuffers(0, 1, single);
+		context.PSSetConstantBuffers(0, 1, single);
+		CHECK_EQUAL((size_t)2, mock.Calls.size());
+
+		//Past the shadowed slots everything goes through
+		mock.Calls.clear();
+		context.PSSetSamplers(FilteringContext::SamplerSlots - 1, 2, pair);
+		context.PSSetSamplers(FilteringContext::SamplerSlots - 1, 2, pair);
+		CHECK_EQUAL((size_t)2, mock.Calls.size());
+
+		//A vertex buffer rebound with a different offset is a change
+		const unsigned int strides[1] = { 32 };
+		const unsigned int offsets[1] = { 0 };
+		const unsigned int moved[1] = { 64 };
+		mock.Calls.clear();
+		context.IASetVertexBuffers(0, 1, single, strides, offsets);
+		context.IASetVertexBuffers(0, 1, single, strides, offsets);
+		context.IASetVertexBuffers(0, 1, single, strides, moved);
+		context.IASetIndexBuffer(&a, 57, 0);
+		context.IASetIndexBuffer(&a, 57, 0);
+		context.IASetIndexBuffer(&a, 42, 0);
+		CHECK_EQUAL((size_t)4, mock.Calls.size());
+	}
+
+	void TestInvalidate()
+	{
+		MockContext mock;
+		FilteringContext context(&mock);
+		Object layout;
+
+		context.IASetInputLayout(&layout);
+		context.Invalidate();
+		context.IASetInputLayout(&layout);
+		context.IASetInputLayout(&layout);
+		CHECK_EQUAL((size_t)2, mock.Calls.size());
+
+		context.ResetStatistics();
+		CHECK_EQUAL(0u, context.GetStatistics().Forwarded);
+		CHECK_EQUAL(0u, context.GetStatistics().Filtered);
+	}
+
+	void TestInvalidateConstantBuffers()
+	{
+		MockContext mock;
+		FilteringContext context(&mock);
+		Object buffers[2];
+		Object* bound[2] = { &buffers[0], &buffers[1] };
+
+		context.VSSetConstantBuffers(0, 2, bound);
+		context.PSSetConstantBuffers(0, 2, bound);
+		mock.Calls.clear();
+
+		//Only the slot forgotten is bound again, in both stages
+		context.InvalidateConstantBuffers(1, 1);
+		context.VSSetConstantBuffers(0, 1, &bound[0]);
+		context.PSSetConstantBuffers(0, 1, &bound[0]);
+		CHECK_EQUAL((size_t)0, mock.Calls.size());
+
+		context.VSSetConstantBuffers(1, 1, &bound[1]);
+		context.PSSetConstantBuffers(1, 1, &bound[1]);
+		context.VSSetConstantBuffers(1, 1, &bound[1]);
+		CHECK_EQUAL((size_t)2, mock.Calls.size());
+	}
+}
+
+int main()
+{
+	TestRedundantBindsDropped();
+	TestChangedBindsForwarded();
+	TestSlots();
+	TestInvalidate();
+	TestInvalidateConstantBuffers();
+
+	return CheckResult("StateFilteringContext");
+}
@@ -0,0 +1,187 @@
+#include "TextureArrayBuilder.h"
+#include <string.h>
+
+namespace
+{
+	//Format of every slice, which is what the DDS loader gives the planet and moon textures
+	const DXGI_FORMAT ArrayFormat = DXGI_FORMAT_BC1_UNORM;
+
+	//The texture behind a view, or nullptr if it is not a 2D one. The caller releases it
+	ID3D11Texture2D* GetTexture(ID3D11ShaderResourceView* view)
+	{
+		ID3D11Resource* resource = nullptr;
+		view->GetResource(&resource);
+		if (!resource)
+			return nullptr;
+
+		ID3D11Texture2D* texture = nullptr;
+		HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&texture);
+		resource->Release();
+
+		return SUCCEEDED(hr) ? texture : nullptr;
+	}
+}
+
+HRESULT TextureArrayBuilder::ReadTopLevel(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11Texture2D* texture, std::vector<uint8_t>& outRGBA)
+{
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+
+	bool isBC1 = desc.Format == DXGI_FORMAT_BC1_UNORM || desc.Format == DXGI_FORMAT_BC1_UNORM_SRGB;
+	bool isRGBA8 = desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM || desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	if (!isBC1 && !isRGBA8)
+		return E_FAIL;
+
+	//Only the top level comes back, the rest of the chain is rebuilt from it at the new size
+	D3D11_TEXTURE2D_DESC stagingDesc = desc;
+	stagingDesc.MipLevels = 1;
+	stagingDesc.ArraySize = 1;
+	stagingDesc.Usage = D3D11_USAGE_STAGING;
+	stagingDesc.BindFlags = 0;
+	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	stagingDesc.MiscFlags = 0;
+
+	ID3D11Texture2D* staging = nullptr;
+	HRESULT hr = device->CreateTexture2D(&stagingDesc, nullptr, &staging);
+	if (FAILED(hr))
+		return hr;
+
+	context->CopySubresourceRegion(staging, 0, 0, 0, 0, texture, 0, nullptr);
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	hr = context->Map(staging, 0, D3D11_MAP_READ, 0, &mapped);
+	if (FAILED(hr))
+	{
+		staging->Release();
+		return hr;
+	}
+
+	//Rows come back padded out to RowPitch, a row of BC1 being a row of 4x4 blocks
+	UINT rows = isBC1 ? (desc.Height + 3) / 4 : desc.Height;
+	UINT rowBytes = isBC1 ? ((desc.Width + 3) / 4) * 8 : desc.Width * 4;
+
+	std::vector<uint8_t> packed(rows * rowBytes);
+	for (UINT row = 0; row < rows; row++)
+		memcpy(&packed[row * rowBytes], (const uint8_t*)mapped.pData + row * mapped.RowPitch, rowBytes);
+
+	context->Unmap(staging, 0);
+	staging->Release();
+
+	if (isBC1)
+		MipGenerator::DecodeBC1(packed.data(), desc.Width, desc.Height, outRGBA);
+	else
+		outRGBA.swap(packed);
+
+	return S_OK;
+}
+
+HRESULT TextureArrayBuilder::CreateTextureArray(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11ShaderResourceView* const* textures, UINT count, ID3D11ShaderResourceView** arrayView)
+{
+	*arrayView = nullptr;
+
+	if (count == 0 || count > D3D11_REQ_TEXTURE2D_ARRAY_AXIS_DIMENSION)
+		return E_INVALIDARG;
+
+	std::vector<ID3D11Texture2D*> sources(count, nullptr);
+	std::vector<D3D11_TEXTURE2D_DESC> descs(count);
+
+	HRESULT hr = S_OK;
+	UINT width = 0;
+	UINT height = 0;
+
+	for (UINT i = 0; i < count; i++)
+	{
+		sources[i] = textures[i] ? GetTexture(textures[i]) : nullptr;
+		if (!sources[i])
+		{
+			hr = E_INVALIDARG;
+			break;
+		}
+
+		sources[i]->GetDesc(&descs[i]);
+		width = descs[i].Width > width ? descs[i].Width : width;
+		height = descs[i].Height > height ? descs[i].Height : height;
+	}
+
+	//BC1 needs the top level in whole blocks
+	width = (width + 3) & ~3u;
+	height = (height + 3) & ~3u;
+
+	UINT mipCount = MipGenerator::CountMips(width, height);
+	ID3D11Texture2D* array = nullptr;
+
+	if (SUCCEEDED(hr))
+	{
+		D3D11_TEXTURE2D_DESC desc;
+		ZeroMemory(&desc, sizeof(desc));
+		desc.Width = width;
+		desc.Height = height;
+		desc.MipLevels = mipCount;
+		desc.ArraySize = count;
+		desc.Format = ArrayFormat;
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+		hr = device->CreateTexture2D(&desc, nullptr, &array);
+	}
+
+	std::vector<uint8_t> level;
+	std::vector<uint8_t> resampled;
+	std::vector<uint8_t> encoded;
+
+	for (UINT slice = 0; slice < count && SUCCEEDED(hr); slice++)
+	{
+		const D3D11_TEXTURE2D_DESC& desc = descs[slice];
+
+		//Same size and format, so every level it needs is already on the GPU
+		if (desc.Width == width && desc.Height == height && desc.Format == ArrayFormat && desc.MipLevels >= mipCount && desc.ArraySize == 1)
+		{
+			for (UINT mip = 0; mip < mipCount; mip++)
+				context->CopySubresourceRegion(array, D3D11CalcSubresource(mip, slice, mipCount), 0, 0, 0, sources[slice], D3D11CalcSubresource(mip, 0, desc.MipLevels), nullptr);
+
+			continue;
+		}
+
+		hr = ReadTopLevel(device, context, sources[slice], level);
+		if (FAILED(hr))
+			break;
+
+		if (desc.Width != width || desc.Height != height)
+		{
+			MipGenerator::Resample(level, desc.Width, desc.Height, resampled, width, height);
+			level.swap(resampled);
+		}
+
+		//Each level encoded and uploaded in turn, then halved for the next
+		UINT mipWidth = width;
+		UINT mipHeight = height;
+		for (UINT mip = 0; mip < mipCount; mip++)
+		{
+			if (mip > 0)
+			{
+				MipGenerator::Downsample(level, mipWidth, mipHeight, resampled);
+				mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+				mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+				level.swap(resampled);
+			}
+
+			MipGenerator::EncodeBC1(level, mipWidth, mipHeight, encoded);
+			context->UpdateSubresource(array, D3D11CalcSubresource(mip, slice, mipCount), nullptr, encoded.data(), ((mipWidth + 3) / 4) * 8, 0);
+		}
+	}
+
+	for (UINT i = 0; i < count; i++)
+	{
+		if (sources[i])
+			sources[i]->Release();
+	}
+
+	if (SUCCEEDED(hr))
+		hr = device->CreateShaderResourceView(array, nullptr, arrayView);
+
+	if (array)
+		array->Release();
+
+	return hr;
+}
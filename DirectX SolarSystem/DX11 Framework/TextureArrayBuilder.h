@@ -0,0 +1,22 @@
+#pragma once
+#ifndef TEXTUREARRAYBUILDER
+#define TEXTUREARRAYBUILDER
+
+#include <windows.h>
+#include <d3d11_1.h>
+#include <stdint.h>
+#include <vector>
+#include "MipGenerator.h"
+
+namespace TextureArrayBuilder
+{
+	//Packs textures into one BC1 Texture2DArray with a full mip chain, slice i holding textures[i]. Every slice is the size of the largest texture given.
+	//Textures that are already that size and format with enough mips are copied across on the GPU, any other is read back, resampled and encoded on the CPU
+	HRESULT CreateTextureArray(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11ShaderResourceView* const* textures, UINT count, ID3D11ShaderResourceView** arrayView);
+
+	//Helper methods for the above method
+	//Reads the top level of a BC1 or 32 bit RGBA texture back into tightly packed RGBA8 texels
+	HRESULT ReadTopLevel(ID3D11Device* device, ID3D11DeviceContext* context, ID3D11Texture2D* texture, std::vector<uint8_t>& outRGBA);
+};
+
+#endif
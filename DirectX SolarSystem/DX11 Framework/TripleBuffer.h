@@ -0,0 +1,60 @@
+#pragma once
+#ifndef TRIPLEBUFFER
+#define TRIPLEBUFFER
+
+#include <atomic>
+
+//Single producer, single consumer handoff of whole values without locks.
+//The writer fills Back() and publishes it, the reader acquires the newest published value into Front().
+//Each side owns one slot and the third is swapped through an atomic, so neither side ever waits on the other
+//and the reader can skip values if the writer gets ahead.
+//A fourth slot keeps the reader's previous value alive so it can interpolate between the last two it acquired
+template <typename T>
+class TripleBuffer
+{
+private:
+	static const unsigned int IndexMask = 3;
+	static const unsigned int FreshBit = 4;
+
+	T m_Slots[4];
+
+	//Slot between the two sides, with FreshBit set when the writer has put something there the reader has not seen
+	std::atomic<unsigned int> m_Middle;
+
+	unsigned int m_Back;
+	unsigned int m_Front;
+	unsigned int m_Previous;
+
+public:
+	TripleBuffer() : m_Middle(1), m_Back(0), m_Front(2), m_Previous(3) {}
+
+	//Writer side, the slot to fill next
+	T& Back() { return m_Slots[m_Back]; }
+
+	//Writer side, hands the filled slot over and takes back whichever slot the reader is not using
+	void Publish()
+	{
+		m_Back = m_Middle.exchange(m_Back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+	}
+
+	//Reader side, swaps in the newest published value. Returns false and keeps the current one if nothing new has arrived
+	bool Acquire()
+	{
+		if (!(m_Middle.load(std::memory_order_relaxed) & FreshBit))
+			return false;
+
+		//The old previous slot goes back to the writer, the old front becomes previous
+		unsigned int newest = m_Middle.exchange(m_Previous, std::memory_order_acq_rel) & IndexMask;
+		m_Previous = m_Front;
+		m_Front = newest;
+		return true;
+	}
+
+	//Reader side, the value from the last successful Acquire
+	const T& Front() const { return m_Slots[m_Front]; }
+
+	//Reader side, the value Front replaced
+	const T& Previous() const { return m_Slots[m_Previous]; }
+};
+
+#endif
@@ -0,0 +1,71 @@
+#include "UpdateScheduler.h"
+
+namespace
+{
+	//Last update of an item that has to be updated before anything is extrapolated from it
+	const uint64_t NeverUpdated = ~(uint64_t)0;
+}
+
+UpdateScheduler::UpdateScheduler(size_t count)
+{
+	m_Step = 0;
+	Reset(count);
+}
+
+void UpdateScheduler::Reset(size_t count)
+{
+	m_Intervals.assign(count, 1);
+	m_LastUpdates.assign(count, NeverUpdated);
+	m_Due.clear();
+	m_Due.reserve(count);
+}
+
+void UpdateScheduler::Invalidate()
+{
+	m_LastUpdates.assign(m_LastUpdates.size(), NeverUpdated);
+}
+
+void UpdateScheduler::SetInterval(size_t item, UINT interval)
+{
+	UINT rounded = 1;
+	while (rounded * 2 <= interval && rounded < MaxInterval)
+		rounded *= 2;
+
+	m_Intervals[item] = rounded;
+}
+
+bool UpdateScheduler::IsDue(size_t item) const
+{
+	if (m_LastUpdates[item] == NeverUpdated)
+		return true;
+
+	//Its turn comes round once every interval steps, offset by its index, or sooner if the interval has just been cut
+	UINT interval = m_Intervals[item];
+	return ((m_Step + item) & (interval - 1)) == 0 || m_Step - m_LastUpdates[item] >= interval;
+}
+
+const std::vector<UINT>& UpdateScheduler::Schedule()
+{
+	m_Due.clear();
+
+	for (size_t i = 0; i < m_Intervals.size(); i++)
+	{
+		if (IsDue(i))
+		{
+			m_Due.push_back((UINT)i);
+			m_LastUpdates[i] = m_Step;
+		}
+	}
+
+	m_Step++;
+	return m_Due;
+}
+
+UINT UpdateScheduler::IntervalForError(float errorPerStep, float tolerance)
+{
+	UINT interval = 1;
+	while (interval < MaxInterval && errorPerStep * (interval * 2) * (interval * 2) <= tolerance)
+		interval *= 2;
+
+	return interval;
+}
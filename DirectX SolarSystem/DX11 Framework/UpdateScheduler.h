@@ -0,0 +1,54 @@
+#pragma once
+#ifndef UPDATESCHEDULER
+#define UPDATESCHEDULER
+
+#include <windows.h>
+#include <stdint.h>
+#include <vector>
+
+//Spreads the updates of many items over several steps. Each item has an interval, a power of two, and is updated once in that many steps,
+//items sharing an interval taking turns by index so the work each step stays even. In between the caller extrapolates from the last update
+class UpdateScheduler
+{
+public:
+	static const UINT MaxInterval = 16;
+
+private:
+	std::vector<UINT> m_Intervals;
+
+	//Step each item was last updated at, and the items due in the step Schedule last ran
+	std::vector<uint64_t> m_LastUpdates;
+	std::vector<UINT> m_Due;
+
+	uint64_t m_Step;
+
+	//Helper methods for the above method(s)
+	bool IsDue(size_t item) const;
+
+public:
+	//Constructor
+	UpdateScheduler(size_t count = 0);
+
+	//Resizes to count items, every one due on the next step with an interval of one
+	void Reset(size_t count);
+
+	//Makes every item due on the next step, for when what was extrapolated from can no longer be trusted
+	void Invalidate();
+
+	//Sets how many steps an item may go between updates, rounded down to a power of two between 1 and MaxInterval.
+	//Shortening it makes the item due at once if it has already gone that long
+	void SetInterval(size_t item, UINT interval);
+
+	//Lists the items to update this step and moves on to the next
+	const std::vector<UINT>& Schedule();
+
+	//Longest interval, a power of two, an item can have when its error grows with the square of the steps since its update,
+	//errorPerStep being what it would be after one step
+	static UINT IntervalForError(float errorPerStep, float tolerance);
+
+	size_t GetCount() const { return m_Intervals.size(); }
+	UINT GetInterval(size_t item) const { return m_Intervals[item]; }
+	size_t GetDueCount() const { return m_Due.size(); }
+};
+
+#endif